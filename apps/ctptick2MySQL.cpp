@@ -1,24 +1,48 @@
 ﻿#include <chrono>
+#include <limits>
+#include <memory>
 #include <thread>
 #include <vector>
 
 #include <CLI/CLI.hpp>
 #include <spdlog/spdlog.h>
 
+#include "barengine.h"
 #include "ctpmarketdatarecorder.h"
 #include "dbconfig.h"
+#include "latencymonitor.h"
+#ifndef _WIN32
+#include "journaleddatarecorder.h"
+#endif
 #include "mariadbdatarecorder.h"
+#include "sqlite3datarecorder.h"
 #include "trading_utils.h"
 
 using namespace std::chrono_literals;
 
 int main(int argc, char* argv[]) {
 	std::filesystem::path config_file;
+	int latency_dump_interval = 0;
+	std::filesystem::path journal_dir;
+	std::filesystem::path bar_db_name;
+	bool redundant_fronts = false;
 
 	CLI::App app{"Dump CTP tick data into mariadb"};
 	app.add_option("-c,--config", config_file, "UTS config db location")->required()->check(CLI::ExistingFile);
+	app.add_option("--latency", latency_dump_interval, "log tick latency every N seconds, 0 to disable");
+#ifndef _WIN32
+	app.add_option("--journal", journal_dir, "write-ahead journal directory, ticks are replayed after crash");
+#endif
+	app.add_option("--bars", bar_db_name, "record 1s/1min/5min/session bars into this sqlite3 file");
+	app.add_flag("--redundant-fronts", redundant_fronts,
+				 "connect every front with its own API and keep the first arrival of each tick");
 	CLI11_PARSE(app, argc, argv)
 
+	if (latency_dump_interval > 0) {
+		LatencyMonitor::Instance().Enable();
+		LatencyMonitor::Instance().StartPeriodicDump(std::chrono::seconds(latency_dump_interval));
+	}
+
 	UTSConfigDB db(config_file);
 	std::vector<Ticker> tickers = db.GetSubscriptionTickers();
 
@@ -26,8 +50,26 @@ int main(int argc, char* argv[]) {
 	MySQLConnectionInfo db_info = db.GetMySQLConnectionInfo();
 
 	MariadbDataRecorder sink(db_info);
+	DataRecorder* recorder = &sink;
+#ifndef _WIN32
+	std::unique_ptr<JournaledDataRecorder> journaled;
+	if (!journal_dir.empty()) {
+		journaled = std::make_unique<JournaledDataRecorder>(journal_dir, &sink);
+		recorder = journaled.get();
+	}
+#endif
+	TradingEventBus event_bus;
+	std::unique_ptr<SQLite3BarRecorder> bar_recorder;
+	std::unique_ptr<BarEngine> bar_engine;
+	if (!bar_db_name.empty()) {
+		bar_recorder = std::make_unique<SQLite3BarRecorder>(bar_db_name);
+		event_bus.Subscribe<Bar, &BarRecorder::BarSink>(bar_recorder.get());
+		bar_engine = std::make_unique<BarEngine>(event_bus);
+	}
 	CTPMarketDataRecorder market_data_recorder(md_server);
-	market_data_recorder.setSink(&sink);
+	market_data_recorder.setSink(recorder);
+	if (bar_engine) { market_data_recorder.SetEventBus(&event_bus); }
+	if (redundant_fronts) { market_data_recorder.EnableRedundantFronts(); }
 	market_data_recorder.LogIn();
 	market_data_recorder.Subscribe(tickers);
 
@@ -40,4 +82,10 @@ int main(int argc, char* argv[]) {
 
 	std::this_thread::sleep_until(end_time);
 	// std::this_thread::sleep_for(1min);
+	// 停止行情后完成未结束的K线, 由 `bar_recorder` 析构时写完
+	market_data_recorder.LogOut();
+	if (bar_engine) {
+		bar_engine->CloseExpiredBars(std::numeric_limits<Timestamp>::max() / 2);
+		bar_engine->CloseSession();
+	}
 }
@@ -1,53 +1,148 @@
-﻿#include <chrono>
+﻿#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <csignal>
+#include <ctime>
+#include <exception>
+#include <limits>
+#include <memory>
 #include <ranges>
+#include <string>
+#include <thread>
 #include <vector>
 
 #include <CLI/CLI.hpp>
 #include <spdlog/spdlog.h>
 
+#include "barengine.h"
 #include "ctpmarketdatarecorder.h"
 #include "dbconfig.h"
+#include "latencymonitor.h"
+#include "rotatingdatarecorder.h"
+#ifndef _WIN32
+#include "journaleddatarecorder.h"
+#endif
 #include "sqlite3datarecorder.h"
 #include "trading_utils.h"
 
 using std::string, std::vector;
 using namespace std::chrono_literals;
 
+namespace {
+std::atomic<bool> stop_requested = false;
+void OnSignal(int) { stop_requested = true; }
+}  // namespace
+
 int main(int argc, char* argv[]) {
 	std::filesystem::path config_file;
 	string db_name = "tick.sqlite3";
+	int latency_dump_interval = 0;
+	std::filesystem::path journal_dir;
+	std::filesystem::path bar_db_name;
+	bool redundant_fronts = false;
+	bool daemon = false;
 
 	CLI::App app{"Dump CTP tick data into sqlite3 database"};
 	app.add_option("-c,--config", config_file, "UTS config db location")->required()->check(CLI::ExistingFile);
 	app.add_option("-o,--output", db_name, "output sqlite3 file");
+	app.add_option("--latency", latency_dump_interval, "log tick latency every N seconds, 0 to disable");
+#ifndef _WIN32
+	app.add_option("--journal", journal_dir, "write-ahead journal directory, ticks are replayed after crash");
+#endif
+	app.add_option("--bars", bar_db_name, "record 1s/1min/5min/session bars into this sqlite3 file");
+	app.add_flag("--daemon", daemon, "keep recording across trading days until SIGINT or SIGTERM");
+	app.add_flag("--redundant-fronts", redundant_fronts,
+				 "connect every front with its own API and keep the first arrival of each tick");
 	CLI11_PARSE(app, argc, argv)
 
+	if (latency_dump_interval > 0) {
+		LatencyMonitor::Instance().Enable();
+		LatencyMonitor::Instance().StartPeriodicDump(std::chrono::seconds(latency_dump_interval));
+	}
+
 	UTSConfigDB db(config_file);
 	vector<Ticker> tickers = db.GetSubscriptionTickers();
 	vector<IPAddress> md_server = db.FartestCTPMDServers(2);
 
-	auto end_time = GetMarketCloseTime() + 2min;
-
-	auto dot_loc = db_name.find('.');
-// TODO: C++20 fmt replace
-#include <ctime>
-#include <iomanip>
-#include <sstream>
-	auto end_time_t = std::chrono::system_clock::to_time_t(end_time);
-	std::stringstream ss;
-	ss << std::put_time(localtime(&end_time_t), "%Y%m%d");
-	db_name = db_name.substr(0, dot_loc) + "_" + ss.str() + db_name.substr(dot_loc);
-	// db_name = std::format("{}_{:%F}{}", db_name.substr(0, dot_loc), end_time, db_name.substr(dot_loc));
-
-	SQLite3DataRecorder sink(db_name);
+	// 每个交易日写入各自的文件, 如 `tick_20210601.sqlite3`, 夜盘计入下一交易日. 交易日结束后以低优先级整理
+	auto factory = [db_name, journal_dir](int trading_day) -> std::unique_ptr<DataRecorder> {
+		auto sink = std::make_unique<SQLite3DataRecorder>(RotatingDataRecorder::FileName(db_name, trading_day));
+#ifndef _WIN32
+		if (!journal_dir.empty()) {
+			return std::make_unique<JournaledDataRecorder>(journal_dir / std::to_string(trading_day), std::move(sink));
+		}
+#endif
+		return sink;
+	};
+	auto compactor = [db_name](int trading_day) {
+		SQLite3DataRecorder::Compact(RotatingDataRecorder::FileName(db_name, trading_day));
+	};
+#ifndef _WIN32
+	// 上次运行未提交的各交易日日志在启动时补写并整理, 不等到该交易日再有行情. 补写完的日志删除
+	if (!journal_dir.empty() && std::filesystem::is_directory(journal_dir)) {
+		vector<int> uncommitted_days;
+		for (const auto& entry : std::filesystem::directory_iterator(journal_dir)) {
+			string name = entry.path().filename().string();
+			int trading_day = 0;
+			auto [end, ec] = std::from_chars(name.data(), name.data() + name.size(), trading_day);
+			if (!entry.is_directory() || (ec != std::errc()) || (end != name.data() + name.size())) { continue; }
+			TickJournal journal(entry.path());
+			if (journal.head() != journal.committed()) { uncommitted_days.push_back(trading_day); }
+		}
+		for (int trading_day : uncommitted_days) {
+			std::filesystem::path day_dir = journal_dir / std::to_string(trading_day);
+			spdlog::info("Replaying journal {}.", day_dir.string());
+			std::unique_ptr<DataRecorder> journaled = factory(trading_day);
+			journaled->Stop();
+			if (journaled->statistics().pending != 0) {
+				spdlog::warn("Journal {} is not fully replayed, kept for the next start.", day_dir.string());
+				continue;
+			}
+			journaled.reset();
+			std::filesystem::remove_all(day_dir);
+			try {
+				compactor(trading_day);
+			} catch (const std::exception& e) {
+				spdlog::error("Failed to compact trading day {}: {}", trading_day, e.what());
+			}
+		}
+	}
+#endif
+	RotatingDataRecorder recorder(factory, compactor);
+	// K线由行情合成后写入单独的文件, 不随交易日轮换
+	TradingEventBus event_bus;
+	std::unique_ptr<SQLite3BarRecorder> bar_recorder;
+	std::unique_ptr<BarEngine> bar_engine;
+	if (!bar_db_name.empty()) {
+		bar_recorder = std::make_unique<SQLite3BarRecorder>(bar_db_name);
+		event_bus.Subscribe<Bar, &BarRecorder::BarSink>(bar_recorder.get());
+		bar_engine = std::make_unique<BarEngine>(event_bus);
+	}
 	CTPMarketDataRecorder market_data_recorder(md_server);
-	market_data_recorder.setSink(&sink);
+	market_data_recorder.setSink(&recorder);
+	if (bar_engine) { market_data_recorder.SetEventBus(&event_bus); }
+	if (redundant_fronts) { market_data_recorder.EnableRedundantFronts(); }
 	market_data_recorder.LogIn();
 	market_data_recorder.Subscribe(tickers);
 
-	// TODO: C++20 fmt replace
-	spdlog::info("Program ends at {}", ctime(&end_time_t));
-	// spdlog::info(std::format("Program ends at {:%c}", end_time));
-	std::this_thread::sleep_until(end_time);
-	// std::this_thread::sleep_for(1min);
+	if (daemon) {
+		spdlog::info("Recording until SIGINT or SIGTERM.");
+		std::signal(SIGINT, OnSignal);
+		std::signal(SIGTERM, OnSignal);
+		while (!stop_requested) { std::this_thread::sleep_for(1s); }
+	} else {
+		auto end_time = GetMarketCloseTime() + 2min;
+		// TODO: C++20 fmt replace
+		auto end_time_t = std::chrono::system_clock::to_time_t(end_time);
+		spdlog::info("Program ends at {}", ctime(&end_time_t));
+		// spdlog::info(std::format("Program ends at {:%c}", end_time));
+		std::this_thread::sleep_until(end_time);
+		// std::this_thread::sleep_for(1min);
+	}
+	// 停止行情后完成未结束的K线, 由 `bar_recorder` 析构时写完
+	market_data_recorder.LogOut();
+	if (bar_engine) {
+		bar_engine->CloseExpiredBars(std::numeric_limits<Timestamp>::max() / 2);
+		bar_engine->CloseSession();
+	}
 }
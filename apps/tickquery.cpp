@@ -0,0 +1,116 @@
+﻿#include <charconv>
+#include <filesystem>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <CLI/CLI.hpp>
+#include <spdlog/spdlog.h>
+
+#include "csvwriter.h"
+#include "tickquery.h"
+#include "trading_utils.h"
+
+using std::string, std::vector;
+
+namespace {
+/// 解析北京时间 `YYYYMMDD[ hh:mm:ss[.mmm]]`
+Timestamp ParseDateTime(std::string_view str) {
+	auto invalid = [str]() {
+		return CLI::ValidationError("expect YYYYMMDD[ hh:mm:ss[.mmm]], got " + string(str));
+	};
+	if ((str.size() != 8) && (str.size() != 17) && (str.size() != 21)) { throw invalid(); }
+	auto number = [str, &invalid](size_t pos, size_t length) {
+		int ret = 0;
+		auto [ptr, ec] = std::from_chars(str.data() + pos, str.data() + pos + length, ret);
+		if ((ec != std::errc()) || (ptr != str.data() + pos + length)) { throw invalid(); }
+		return ret;
+	};
+	int date = number(0, 8);
+	Timestamp time_of_day = 0;
+	if (str.size() >= 17) {
+		int seconds = number(9, 2) * 3600 + number(12, 2) * 60 + number(15, 2);
+		int millisec = (str.size() == 21) ? number(18, 3) : 0;
+		time_of_day = (seconds * 1000LL + millisec) * 1'000'000;
+	}
+	return MakeTimestamp(date, time_of_day);
+}
+
+void WriteRow(CSVWriter& writer, const MarketDepth& data) {
+	char datetime[kDateTimeStrLength + 1];
+	writer.Write(std::string_view(datetime, FormatDateTime(data.exchange_time, datetime)));
+	writer.Write(std::string_view(data.instrument_id));
+	writer.Write(data.ohlclvt.open);
+	writer.Write(data.ohlclvt.high);
+	writer.Write(data.ohlclvt.low);
+	writer.Write(data.ohlclvt.last);
+	writer.Write(data.ohlclvt.turnover);
+	writer.Write(data.ohlclvt.volume);
+	writer.Write(data.open_interest);
+	writer.Write(data.bid[0].price);
+	writer.Write(data.bid[0].volume);
+	writer.Write(data.ask[0].price);
+	writer.Write(data.ask[0].volume);
+	writer.EndRow();
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+	vector<std::filesystem::path> inputs;
+	vector<Ticker> tickers;
+	string begin_str;
+	string end_str;
+	string at_str;
+	std::filesystem::path output = "ticks.csv";
+	size_t threads = 0;
+
+	CLI::App app{"Query ticks from archive files by instrument and time range"};
+	app.add_option("-i,--input", inputs, "archive files or directories")->required()->check(CLI::ExistingPath);
+	app.add_option("-t,--ticker", tickers, "instruments, all instruments if omitted");
+	auto begin_option = app.add_option("-b,--begin", begin_str, "range begin, YYYYMMDD[ hh:mm:ss[.mmm]]");
+	auto end_option = app.add_option("-e,--end", end_str, "range end (exclusive), YYYYMMDD[ hh:mm:ss[.mmm]]");
+	app.add_option("--at", at_str, "snapshot of all instruments as of YYYYMMDD[ hh:mm:ss[.mmm]]")
+		->excludes(begin_option)
+		->excludes(end_option);
+	app.add_option("-o,--output", output, "output csv file");
+	app.add_option("-j,--threads", threads, "reader threads, 0 for hardware concurrency");
+	CLI11_PARSE(app, argc, argv)
+
+	Timestamp begin = std::numeric_limits<Timestamp>::min();
+	Timestamp end = std::numeric_limits<Timestamp>::max();
+	Timestamp at = 0;
+	try {
+		if (!begin_str.empty()) { begin = ParseDateTime(begin_str); }
+		if (!end_str.empty()) { end = ParseDateTime(end_str); }
+		if (!at_str.empty()) { at = ParseDateTime(at_str); }
+	} catch (const CLI::Error& e) {
+		return app.exit(e);
+	}
+
+	TickQueryEngine engine(inputs, threads);
+	spdlog::info("Opened {} archive files.", engine.files().size());
+
+	CSVWriter writer(output, false, CSVWriter::kDefaultBufferSize, ", ");
+	if (writer.new_file()) {
+		for (const char* column : {"DateTime", "ID", "Open", "High", "Low", "Latest", "TurnOver", "Volume",
+								   "OpenInterest", "BidPrice1", "BidVolume1", "AskPrice1", "AskVolume1"}) {
+			writer.Write(column);
+		}
+		writer.EndRow();
+	}
+	size_t rows = 0;
+	if (!at_str.empty()) {
+		vector<MarketDepth> snapshot = engine.Snapshot(at, tickers);
+		for (const MarketDepth& md : snapshot) { WriteRow(writer, md); }
+		rows = snapshot.size();
+	} else {
+		// 按文件和块的顺序流式输出, 不在内存中保留全部结果
+		engine.ForEach(tickers, begin, end, [&writer, &rows](std::span<const MarketDepth> block) {
+			for (const MarketDepth& md : block) { WriteRow(writer, md); }
+			rows += block.size();
+		});
+	}
+	writer.Close();
+	spdlog::info("Wrote {} ticks into {}.", rows, output.string());
+}
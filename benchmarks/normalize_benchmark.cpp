@@ -0,0 +1,159 @@
+/**
+ * @file normalize_benchmark.cpp
+ * @brief 比较CTP行情规范化的逐字段实现与向量化实现
+ * @details 用法: NormalizeBenchmark [CSVDataRecorder记录的csv文件]. 未提供文件时使用生成的行情
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ctp_utils.h"
+
+using Field = CThostFtdcDepthMarketDataField;
+
+namespace {
+constexpr double kInvalid = std::numeric_limits<double>::max();
+
+/// 记录中的无效价格(-1)还原为CTP的无效值
+double Restore(double price) { return price < 0 ? kInvalid : price; }
+
+/// 空档位和盘中无效字段按CTP的习惯填 DBL_MAX
+Field EmptyField() {
+	Field field{};
+	field.ClosePrice = kInvalid;
+	field.SettlementPrice = kInvalid;
+	field.CurrDelta = kInvalid;
+	field.PreDelta = kInvalid;
+	for (double* price : {&field.BidPrice2, &field.BidPrice3, &field.BidPrice4, &field.BidPrice5, &field.AskPrice2,
+						  &field.AskPrice3, &field.AskPrice4, &field.AskPrice5}) {
+		*price = kInvalid;
+	}
+	return field;
+}
+
+/// 读取 `CSVDataRecorder` 记录的一档行情
+std::vector<Field> LoadRecordedTicks(const char* filename) {
+	std::vector<Field> ticks;
+	std::ifstream in(filename);
+	std::string line;
+	std::getline(in, line);
+	while (std::getline(in, line)) {
+		std::stringstream ss(line);
+		std::vector<std::string> cells;
+		for (std::string cell; std::getline(ss, cell, ',');) { cells.push_back(cell); }
+		if (cells.size() < 13) { continue; }
+		Field field = EmptyField();
+		field.OpenPrice = Restore(std::stod(cells[2]));
+		field.HighestPrice = Restore(std::stod(cells[3]));
+		field.LowestPrice = Restore(std::stod(cells[4]));
+		field.LastPrice = std::stod(cells[5]);
+		field.AveragePrice = field.LastPrice;
+		field.UpperLimitPrice = field.LastPrice * 1.1;
+		field.LowerLimitPrice = field.LastPrice * 0.9;
+		field.BidPrice1 = Restore(std::stod(cells[9]));
+		field.BidVolume1 = std::stoi(cells[10]);
+		field.AskPrice1 = Restore(std::stod(cells[11]));
+		field.AskVolume1 = std::stoi(cells[12]);
+		ticks.push_back(field);
+	}
+	return ticks;
+}
+
+/// 生成行情: 九成只有一档, 其余为五档
+std::vector<Field> GenerateTicks(size_t count) {
+	std::mt19937 gen(42);
+	std::uniform_real_distribution<double> price(3000, 6000);
+	std::uniform_int_distribution<int> volume(1, 100);
+	std::vector<Field> ticks;
+	for (size_t i = 0; i < count; ++i) {
+		Field field = EmptyField();
+		field.LastPrice = price(gen);
+		field.AveragePrice = field.LastPrice;
+		field.UpperLimitPrice = field.LastPrice * 1.1;
+		field.LowerLimitPrice = field.LastPrice * 0.9;
+		bool full_depth = (i % 10) == 0;
+		double* bid_prices[] = {&field.BidPrice1, &field.BidPrice2, &field.BidPrice3, &field.BidPrice4,
+								&field.BidPrice5};
+		double* ask_prices[] = {&field.AskPrice1, &field.AskPrice2, &field.AskPrice3, &field.AskPrice4,
+								&field.AskPrice5};
+		int* bid_volumes[] = {&field.BidVolume1, &field.BidVolume2, &field.BidVolume3, &field.BidVolume4,
+							  &field.BidVolume5};
+		int* ask_volumes[] = {&field.AskVolume1, &field.AskVolume2, &field.AskVolume3, &field.AskVolume4,
+							  &field.AskVolume5};
+		for (int level = 0; level < (full_depth ? 5 : 1); ++level) {
+			*bid_prices[level] = field.LastPrice - level - 1;
+			*ask_prices[level] = field.LastPrice + level + 1;
+			*bid_volumes[level] = volume(gen);
+			*ask_volumes[level] = volume(gen);
+		}
+		ticks.push_back(field);
+	}
+	return ticks;
+}
+
+/// 规范化前的逐字段转换, 作为基准
+void LegacyNormalize(const Field& field, MarketDepth& md) noexcept {
+	md.settle = SanitizeData(field.SettlementPrice);
+	md.average_price = field.AveragePrice;
+	md.upper_limit = field.UpperLimitPrice;
+	md.lower_limit = field.LowerLimitPrice;
+	md.ohlclvt.close = SanitizeData(field.ClosePrice);
+	md.delta = SanitizeData(field.CurrDelta);
+	md.ask = {
+		PriceVolume{SanitizeData(field.AskPrice1), field.AskVolume1},
+		PriceVolume{SanitizeData(field.AskPrice2), field.AskVolume2},
+		PriceVolume{SanitizeData(field.AskPrice3), field.AskVolume3},
+		PriceVolume{SanitizeData(field.AskPrice4), field.AskVolume4},
+		PriceVolume{SanitizeData(field.AskPrice5), field.AskVolume5},
+	};
+	md.bid = {
+		PriceVolume{SanitizeData(field.BidPrice1), field.BidVolume1},
+		PriceVolume{SanitizeData(field.BidPrice2), field.BidVolume2},
+		PriceVolume{SanitizeData(field.BidPrice3), field.BidVolume3},
+		PriceVolume{SanitizeData(field.BidPrice4), field.BidVolume4},
+		PriceVolume{SanitizeData(field.BidPrice5), field.BidVolume5},
+	};
+}
+
+/// 行情回调中CTP行情和输出都在缓存中, 因此每次只在一个能放进L1的窗口内循环
+template <typename Normalize>
+void Run(const char* name, const std::vector<Field>& ticks, Normalize normalize) {
+	constexpr size_t kWindow = 64;
+	constexpr int kRounds = 200;
+	std::vector<MarketDepth> out(kWindow);
+	double checksum = 0;
+	size_t count = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (size_t begin = 0; begin < ticks.size(); begin += kWindow) {
+		size_t end = std::min(begin + kWindow, ticks.size());
+		for (int round = 0; round < kRounds; ++round) {
+			for (size_t i = begin; i < end; ++i) { normalize(ticks[i], out[i - begin]); }
+			checksum += out[0].bid[0].price;
+		}
+		count += (end - begin) * kRounds;
+	}
+	auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+	std::printf("%-10s %8.2f ns/tick  (checksum %.1f)\n", name, elapsed / static_cast<double>(count), checksum);
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+	std::vector<Field> ticks = argc > 1 ? LoadRecordedTicks(argv[1]) : GenerateTicks(100'000);
+	if (ticks.empty()) {
+		std::printf("no ticks loaded.\n");
+		return 1;
+	}
+	std::printf("%zu ticks, AVX2 %s\n", ticks.size(), CPUSupportsAVX2() ? "available" : "not available");
+
+	Run("legacy", ticks, LegacyNormalize);
+	Run("scalar", ticks, NormalizeDepthMarketDataScalar);
+	if (CPUSupportsAVX2()) { Run("avx2", ticks, NormalizeDepthMarketDataAVX2); }
+	Run("dispatch", ticks, NormalizeDepthMarketData);
+}
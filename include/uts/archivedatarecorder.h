@@ -0,0 +1,42 @@
+#pragma once
+
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <unordered_map>
+
+#include <uts/data_struct.h>
+#include <uts/datarecorder.h>
+#include <uts/tickarchive.h>
+
+/**
+ * @brief 列式归档数据记录器，将收到的 `MarketDepth` 信息按交易日写入 `TickArchiveWriter` 格式的文件
+ * @details 每个交易日一个文件 `tick_YYYYMMDD.utstick`, 收到新交易日的行情时关闭前一个文件.
+ *          价格以 `InstrumentInfo::price_ticker` 为单位编码, 未提供合约信息的合约价格存放原始值.
+ *          无法打开某交易日的文件时记录错误并丢弃该交易日的行情
+ */
+class ArchiveDataRecorder : public DataRecorder {
+public:
+	/**
+	 * @brief 构造函数.
+	 * @param directory 归档文件所在目录, 不存在时创建
+	 * @param instruments 合约信息, 用于取得最小变动价位
+	 */
+	ArchiveDataRecorder(const std::filesystem::path& directory,
+						const std::map<Ticker, InstrumentInfo>& instruments = {});
+	~ArchiveDataRecorder() override;
+
+	/// 某交易日的归档文件
+	static std::filesystem::path FileName(const std::filesystem::path& directory, int trading_day);
+
+protected:
+	using DataRecorder::WriteDB;
+	void WriteDB(const MarketDepth& data) override;
+	void Flush() override;
+
+private:
+	const std::filesystem::path directory_;
+	std::unordered_map<Ticker, Price> price_ticks_;
+	std::unique_ptr<TickArchiveWriter> writer_;
+	int failed_day_ = 0;  ///< 无法打开归档文件的交易日, 其行情被丢弃
+};
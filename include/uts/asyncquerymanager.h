@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <functional>
@@ -15,6 +16,9 @@ enum class QueryCondition {
 
 class ASyncQueryManager {
 public:
+	/// `query` 的尝试次数, 不断重试直至成功
+	static constexpr uint kRetryForever = 0;
+
 	ASyncQueryManager();
 	ASyncQueryManager(std::function<void()> func, std::chrono::milliseconds timeout = std::chrono::seconds(1),
 					  std::chrono::milliseconds wait_time = std::chrono::seconds(3));
@@ -24,7 +28,11 @@ public:
 	void set_timeout(std::chrono::milliseconds timeout) { timeout_ = timeout; }
 
 	QueryCondition condition() const { return condition_; };
-	[[nodiscard]] QueryCondition query(uint num_tries = 1);
+	/**
+	 * @brief 发送请求并等待结果
+	 * @param num_tries 最多尝试次数, 默认不断重试直至成功. 两次尝试之间等待 `wait_time`, 最后一次失败后立即返回
+	 */
+	[[nodiscard]] QueryCondition query(uint num_tries = kRetryForever);
 	void done(bool success);
 
 private:
@@ -32,7 +40,7 @@ private:
 	std::chrono::milliseconds timeout_;
 	std::chrono::milliseconds wait_time_;
 
-	QueryCondition condition_{QueryCondition::Initialized};
+	std::atomic<QueryCondition> condition_{QueryCondition::Initialized};
 
 	std::mutex mutex_;
 	std::condition_variable cv_;
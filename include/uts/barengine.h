@@ -0,0 +1,86 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <uts/data_struct.h>
+#include <uts/eventbus.h>
+
+/**
+ * @brief 实时K线合成器
+ *
+ * 从事件总线接收行情, 以 `MarketDepth` 中的逐笔成交量和成交额增量合成1秒, 1分钟, 5分钟及交易日K线, 每笔行情O(1)更新.
+ * 完成的K线发布至同一事件总线, 供策略订阅. 本类不持久化K线, 需要保存时以 `BarRecorder` 订阅.
+ * 内部定时器按各合约最近的交易所时钟推算当前时间, 即使没有新行情, 时间K线也会在结束后 `grace_period` 内完成.
+ * 交易日K线在交易日切换或调用 `CloseSession` 时完成.
+ * @note K线在释放内部锁后按完成顺序发布, K线的处理函数可以回调本类.
+ *       时间K线完成后才到达的行情不再计入该周期, 按周期分别计入 `late_ticks`
+ */
+class BarEngine {
+public:
+	/// 周期数量
+	static constexpr size_t kPeriodCount = 4;
+	/// 各时间周期的长度(纳秒), 交易日周期为0
+	static constexpr std::array<Timestamp, kPeriodCount> kPeriodLength = {
+		1'000'000'000LL, 60'000'000'000LL, 300'000'000'000LL, 0};
+
+	/**
+	 * @brief 构造函数
+	 * @param event_bus 事件总线. 从其接收行情并向其发布K线
+	 * @param grace_period 时间K线结束后等待迟到行情的时长(纳秒)
+	 * @param timer_interval 定时检查间隔(毫秒)
+	 */
+	BarEngine(TradingEventBus& event_bus, Timestamp grace_period = 500'000'000LL, int timer_interval = 100);
+	BarEngine(const BarEngine&) = delete;
+	BarEngine& operator=(const BarEngine&) = delete;
+	~BarEngine();
+
+	/// 处理一笔行情. 通常由事件总线调用
+	void OnMarketData(const MarketDepth& md);
+	/**
+	 * @brief 按给定的交易所时间完成已到期的时间K线
+	 * @param exchange_time 交易所时间. 为0时按各合约最近的交易所时钟推算
+	 */
+	void CloseExpiredBars(Timestamp exchange_time = 0);
+	/// 完成所有合约的交易日K线
+	void CloseSession();
+
+	/// 迟到而未计入时间K线的行情笔数
+	uint64_t late_ticks() const { return late_ticks_.load(std::memory_order_relaxed); }
+
+private:
+	/// 单个合约的合成状态
+	struct InstrumentState {
+		std::array<Bar, kPeriodCount> bars;			 ///< 正在合成的K线
+		std::array<bool, kPeriodCount> open{};		 ///< 是否有正在合成的K线
+		std::array<Timestamp, kPeriodCount> closed{};  ///< 已完成的时间K线的结束时间
+		Timestamp clock_offset = 0;					 ///< 交易所时间 - 本地接收时间
+		bool seen = false;
+	};
+
+	TradingEventBus& event_bus_;
+	int subscription_;
+	const Timestamp grace_period_;
+	const int timer_interval_;
+
+	std::mutex mutex_;
+	std::vector<InstrumentState> states_;  ///< 以合约ID为下标
+	std::vector<SymbolID> instruments_;	   ///< 已收到行情的合约
+	std::atomic<uint64_t> late_ticks_ = 0;
+	std::vector<Bar> finished_;	 ///< 已完成而尚未发布的K线
+	bool publishing_ = false;	 ///< 是否有线程正在发布 `finished_`
+
+	std::thread timer_;
+	std::condition_variable timer_cv_;
+	bool running_ = true;
+
+	void Update(InstrumentState& state, size_t period, const MarketDepth& md);
+	void Close(InstrumentState& state, size_t period);
+	/// 释放 `lock` 发布已完成的K线, 返回前重新加锁
+	void PublishFinished(std::unique_lock<std::mutex>& lock);
+	void TimerLoop();
+};
@@ -1,25 +1,33 @@
 ﻿#pragma once
 
 #include <filesystem>
-#include <fstream>
 
+#include <uts/csvwriter.h>
 #include <uts/datarecorder.h>
 
 /**
  * @brief CSV 数据记录器，将收到的 `MarketDepth` 信息写入 `.csv` 文件
+ * @details 以 `CSVWriter` 格式化并整块写入, 记录线程空闲时写出缓冲区. 文件已存在时追加, 不再写表头.
+ *          盘口二至五档的列位于一档之后
  */
 class CSVDataRecorder : public DataRecorder {
 public:
 	/**
 	 * @brief 构造函数.
 	 * @param filename csv 文件名称
+	 * @param depth_levels 记录的盘口档数, 1至5
+	 * @param direct_io 是否尝试以 `O_DIRECT` 写入
+	 * @exception IOError 无法打开文件
 	 */
-	CSVDataRecorder(const std::filesystem::path& filename);
-	~CSVDataRecorder() override = default;
+	CSVDataRecorder(const std::filesystem::path& filename, size_t depth_levels = 1, bool direct_io = false);
+	~CSVDataRecorder() override { Stop(); }
 
 protected:
+	using DataRecorder::WriteDB;
 	void WriteDB(const MarketDepth& data) override;
+	void Flush() override;
 
 private:
-	std::ofstream out_;
+	CSVWriter writer_;
+	const size_t depth_levels_;
 };
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <charconv>
+#include <concepts>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief CSV 文件写入器
+ * @details 各字段以 `std::to_chars` 直接格式化至预分配的缓冲区, 浮点数为最短可往返表示, 不经过 iostream 和 locale,
+ *          写入过程中不分配内存. 缓冲区写满时整块写入文件. 文件以追加方式打开.
+ *          `direct_io` 时以 `O_DIRECT` 绕过页缓存, 只写出对齐的整块, 不足一块的尾部留在缓冲区中直至 `Close`;
+ *          系统不支持或已有文件长度未对齐时退回普通写入
+ * @note 非线程安全
+ */
+class CSVWriter {
+public:
+	/// 默认缓冲区大小
+	static constexpr size_t kDefaultBufferSize = 1 << 20;
+	/// `O_DIRECT` 写入的对齐长度
+	static constexpr size_t kAlignment = 4096;
+
+	/**
+	 * @brief 构造函数
+	 * @param filename 文件名称
+	 * @param direct_io 是否尝试以 `O_DIRECT` 写入
+	 * @param buffer_size 缓冲区大小, 向上取整至 `kAlignment` 的倍数
+	 * @param separator 字段分隔符
+	 * @exception IOError 无法打开文件
+	 */
+	explicit CSVWriter(const std::filesystem::path& filename, bool direct_io = false,
+					   size_t buffer_size = kDefaultBufferSize, std::string_view separator = ",");
+	CSVWriter(const CSVWriter&) = delete;
+	CSVWriter& operator=(const CSVWriter&) = delete;
+	/// 写出缓冲区中的全部数据并关闭文件
+	~CSVWriter();
+
+	/// 打开时文件是否为空, 可据此决定是否写表头
+	bool new_file() const noexcept { return new_file_; }
+	/// 是否以 `O_DIRECT` 写入
+	bool direct_io() const noexcept { return direct_io_; }
+
+	/// 写入一个浮点数字段
+	void Write(double value) {
+		Separate(kMaxNumberLength);
+		pos_ = std::to_chars(pos_, end_, value).ptr;
+	}
+	/// 写入一个整数字段
+	template <std::integral T>
+	void Write(T value) {
+		Separate(kMaxNumberLength);
+		pos_ = std::to_chars(pos_, end_, value).ptr;
+	}
+	/// 写入一个字符串字段, 不转义
+	void Write(std::string_view value) {
+		Separate(value.size());
+		std::memcpy(pos_, value.data(), value.size());
+		pos_ += value.size();
+	}
+	/// 结束当前行
+	void EndRow() {
+		Reserve(1);
+		*pos_++ = '\n';
+		row_start_ = true;
+	}
+
+	/// 将缓冲区写入文件. `O_DIRECT` 时不足一块的尾部保留在缓冲区中
+	void Flush();
+	/// 写出缓冲区中的全部数据并关闭文件
+	void Close();
+
+private:
+	/// 数值字段的最大长度
+	static constexpr size_t kMaxNumberLength = 32;
+
+	struct AlignedDelete {
+		void operator()(char* p) const { ::operator delete[](p, std::align_val_t{kAlignment}); }
+	};
+
+	int fd_ = -1;
+	bool new_file_ = false;
+	bool direct_io_ = false;
+	bool row_start_ = true;
+	const std::string separator_;
+	std::unique_ptr<char[], AlignedDelete> buffer_;
+	size_t capacity_ = 0;
+	char* pos_ = nullptr;
+	char* end_ = nullptr;
+
+	/// 写入分隔符并确保之后有 `length` 字节可用
+	void Separate(size_t length) {
+		Reserve(length + separator_.size());
+		if (!row_start_) {
+			std::memcpy(pos_, separator_.data(), separator_.size());
+			pos_ += separator_.size();
+		}
+		row_start_ = false;
+	}
+	void Reserve(size_t length) {
+		if (static_cast<size_t>(end_ - pos_) < length) { Drain(length); }
+	}
+	void Drain(size_t length);
+	void WriteFile(const char* data, size_t length);
+};
@@ -26,6 +26,56 @@ inline std::string GetProductID(const Ticker& ticker) {
 /// 将无效数据替换成 -1
 inline double SanitizeData(double data) { return data < 1e308 ? data : -1.0; }
 
+/**
+ * @brief 复制CTP行情中无需推导的价格字段和五档盘口, 并将无效价格替换为 -1
+ * @details 写入收盘价, 结算价, 涨跌停价, 均价, Delta和买卖五档. 首次调用时按CPU选择实现,
+ *          支持AVX2时每档买卖盘一次处理, 否则逐字段处理
+ */
+void NormalizeDepthMarketData(const CThostFtdcDepthMarketDataField& field, MarketDepth& md) noexcept;
+/// `NormalizeDepthMarketData` 的逐字段实现
+void NormalizeDepthMarketDataScalar(const CThostFtdcDepthMarketDataField& field, MarketDepth& md) noexcept;
+/// `NormalizeDepthMarketData` 的AVX2实现. 调用前需确认 `CPUSupportsAVX2`
+void NormalizeDepthMarketDataAVX2(const CThostFtdcDepthMarketDataField& field, MarketDepth& md) noexcept;
+/// 当前CPU是否支持AVX2, 且本构建包含AVX2实现
+bool CPUSupportsAVX2() noexcept;
+
+/// 将CTP日期(YYYYMMDD)转为整数, 格式不符时返回0
+inline int CTPDateToInt(const char* date) noexcept {
+	int ret = 0;
+	for (int i = 0; i < 8; ++i) {
+		if (date[i] < '0' || date[i] > '9') { return 0; }
+		ret = ret * 10 + (date[i] - '0');
+	}
+	return ret;
+}
+
+/**
+ * @brief 解析CTP行情中的交易所时间, 不分配内存
+ *
+ * 夜盘时各交易所 `ActionDay` 的含义不同(如大商所夜盘 `ActionDay` 与 `TradingDay` 相同, 为下一交易日),
+ * 因此日期以本地接收时间为准: 在接收时刻所在自然日及前后各一天中, 选取与 `UpdateTime` 拼接后最接近接收时刻的一天.
+ * 本地接收时间未知(为0)时使用 `ActionDay`.
+ * @param action_day 业务日期(YYYYMMDD)
+ * @param update_time 最后修改时间(hh:mm:ss)
+ * @param millisec 最后修改毫秒
+ * @param local_time 本地接收时间
+ */
+Timestamp ParseCTPDateTime(const char* action_day, const char* update_time, int millisec,
+						   Timestamp local_time) noexcept;
+
+/**
+ * @brief 校正CTP行情中的交易日
+ *
+ * 郑商所夜盘行情的 `TradingDay` 为当前自然日而非下一交易日. 晚间(18点后)的行情若交易日不晚于自然日,
+ * 则改为自然日后的第一个工作日(不考虑节假日).
+ * @param trading_day 行情中的交易日(YYYYMMDD)
+ * @param exchange_time 交易所时间
+ */
+int NormalizeTradingDay(int trading_day, Timestamp exchange_time) noexcept;
+
+/// 将CTP交易所代码转换为 `Exchange`, 不分配内存. 无法识别时返回 `Exchange::NA`
+Exchange ParseCTPExchange(const char* exchange_id) noexcept;
+
 /// 将GB2312编码的string转成UTF-8的
 std::string GB2312ToUTF8(const std::string& gb2312);
 
@@ -1,10 +1,15 @@
 ﻿#pragma once
 
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <filesystem>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <set>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <CTP/ThostFtdcMdApi.h>
@@ -12,15 +17,24 @@
 #include <uts/asyncquerymanager.h>
 #include <uts/data_struct.h>
 #include <uts/market_data.h>
-#include <uts/observer.h>
+#include <uts/optionchain.h>
+#include <uts/spscring.h>
+#include <uts/symboltable.h>
+#include <uts/tickarbiter.h>
 
 /**
  * @brief CTP行情基类
- * @note 已完成登录登出和订阅退订功能. 继承后可定制行情处理
+ * @note 已完成登录登出和订阅退订功能. 继承后通过 `ProcessDepthMarketData` 定制行情处理
+ *
+ * 默认在CTP回调线程中直接处理行情. 调用 `EnableRingDispatch` 后, 回调线程只将原始行情复制进预分配的环形缓冲区,
+ * 由单独的消费线程完成处理, 慢速的下游不再阻塞CTP回调.
+ *
+ * 默认所有服务器地址注册在同一API实例上, 同一时间只连接其中一个. 调用 `EnableRedundantFronts` 后,
+ * 每个地址使用独立的API实例同时连接, 同一笔行情只处理最先到达的一份.
  */
 class CTPMarketDataBase : public MarketDataSource, private CThostFtdcMdSpi {
 public:
-	CTPMarketDataBase(const std::vector<IPAddress>& server_addr);
+	CTPMarketDataBase(const std::vector<IPAddress>& server_addr, size_t snapshot_capacity = SymbolTable::kCapacity);
 	CTPMarketDataBase(const IPAddress& server_addr) : CTPMarketDataBase(std::vector<IPAddress>{server_addr}) {}
 	CTPMarketDataBase(const CTPMarketDataBase&) = delete;
 	CTPMarketDataBase& operator=(const CTPMarketDataBase&) = delete;
@@ -29,21 +43,99 @@ public:
 	void LogIn() override;
 	void LogOut() noexcept override;
 
-	void Subscribe(const std::vector<Ticker>& ticker_list) override;
-	void Unsubscribe(const std::vector<Ticker>& ticker_list) override;
+	std::vector<Ticker> Subscribe(const std::vector<Ticker>& ticker_list) override;
+	std::vector<Ticker> Unsubscribe(const std::vector<Ticker>& ticker_list) override;
+	/// 设置(解除)订阅的等待时长. 所有批次共用一次等待
+	void set_subscription_timeout(std::chrono::milliseconds timeout) { subscription_timeout_ = timeout; }
+
+	/// 默认环形缓冲区容量
+	static constexpr size_t kDefaultRingCapacity = 1 << 16;
+	/**
+	 * @brief 启用环形缓冲区分发, 需在 `LogIn` 前调用
+	 * @param capacity 环形缓冲区容量. 缓冲区满时新行情被丢弃, 并计入 `ring_overruns`
+	 */
+	void EnableRingDispatch(size_t capacity = kDefaultRingCapacity);
+	/// 环形缓冲区中待处理的行情数量
+	size_t ring_occupancy() const { return ring_ ? ring_->size() : 0; }
+	/// 因环形缓冲区已满而丢弃的行情数量
+	uint64_t ring_overruns() const { return ring_overruns_.load(std::memory_order_relaxed); }
+
+	/**
+	 * @brief 启用多前置冗余行情, 需在 `LogIn` 前调用
+	 * @details 每个服务器地址使用独立的API实例同时登录和订阅. 行情以(合约, 交易所时间, 累计成交量)去重,
+	 *          只处理最先到达的一笔. 此时 `ProcessDepthMarketData` 会在各前置的回调线程中并发调用,
+	 *          同一合约的行情依次处理
+	 * @note 第一个前置登录失败时 `LogIn` 抛出异常, 其余前置登录失败只记录日志. 合约在任一前置订阅成功即视为成功
+	 */
+	void EnableRedundantFronts();
+	/// 各前置的行情到达统计, 顺序同服务器地址. 未启用冗余行情时为空
+	std::vector<TickArbiter::FrontStatistics> front_statistics() const;
 
 protected:
-	void OnRtnDepthMarketData(CThostFtdcDepthMarketDataField* pDepthMarketData) override = 0;
+	/**
+	 * @brief 行情处理. 未启用环形缓冲区分发时在CTP回调线程中调用, 否则在消费线程中调用
+	 * @param pDepthMarketData CTP行情
+	 * @param local_time 本地接收时间
+	 */
+	virtual void ProcessDepthMarketData(CThostFtdcDepthMarketDataField* pDepthMarketData, Timestamp local_time) = 0;
+
+	/**
+	 * @brief 将一笔行情交给行情处理. 启用环形缓冲区分发时放入缓冲区, 否则直接调用 `ProcessDepthMarketData`
+	 * @param pDepthMarketData CTP行情
+	 * @param local_time 本地接收时间
+	 */
+	void DeliverDepthMarketData(CThostFtdcDepthMarketDataField* pDepthMarketData, Timestamp local_time);
+	/// 启动环形缓冲区的消费线程. 未启用环形缓冲区分发或已启动时不做任何事
+	void StartRingDispatch();
+	/**
+	 * @brief 处理完环形缓冲区中剩余的行情后停止消费线程
+	 * @note 消费线程会调用 `ProcessDepthMarketData`. 重写该函数的派生类须在析构函数中调用 `LogOut`
+	 *       (其中会调用本函数), 保证消费线程在派生类成员析构前退出
+	 */
+	void StopRingDispatch();
 
 private:
+	/// 环形缓冲区中的原始行情
+	struct RawDepthMarketData {
+		CThostFtdcDepthMarketDataField field;
+		Timestamp local_time;
+	};
+	std::unique_ptr<SPSCRing<RawDepthMarketData>> ring_;
+	std::atomic<uint64_t> ring_overruns_ = 0;
+	std::atomic<bool> dispatching_ = false;
+	std::atomic<bool> discard_ring_ = false;  ///< 析构时不再处理环形缓冲区中剩余的行情
+	std::thread dispatcher_;
+	std::mutex ring_producer_mutex_;  ///< 冗余前置的回调线程共用环形缓冲区的生产端
+
+	void OnRtnDepthMarketData(CThostFtdcDepthMarketDataField* pDepthMarketData) final;
+	void Dispatch();
+
+	// redundant fronts
+	class RedundantFront;
+	std::unique_ptr<TickArbiter> arbiter_;
+	std::vector<std::unique_ptr<RedundantFront>> fronts_;  ///< 第二个及以后的前置
+	void LogInRedundantFronts();
+	void LogOutRedundantFronts() noexcept;
+	void ArbitrateDepthMarketData(size_t front, CThostFtdcDepthMarketDataField* pDepthMarketData,
+								  Timestamp local_time);
+
 	CThostFtdcMdApi* md_api_ = nullptr;
 
 	int request_id_ = 0;
 	std::filesystem::path cache_path_;
 
 	ASyncQueryManager log_in_query_manager_{std::bind(&CTPMarketDataBase::LogInASync, this)};
+	uint log_in_tries_ = ASyncQueryManager::kRetryForever;	///< 登录的尝试次数
+	bool arbitrated_ = false;  ///< 冗余前置的行情由所属的行情源仲裁并记录回调延迟
 	ASyncQueryManager log_out_query_manager_{std::bind(&CTPMarketDataBase::LogOutASync, this)};
-	ASyncQueryManager flexible_query_manager_;
+
+	// subscription
+	static constexpr size_t kSubscriptionBatchSize = 100;
+	std::chrono::milliseconds subscription_timeout_ = std::chrono::seconds(5);
+	std::mutex subscription_mutex_;
+	std::condition_variable subscription_cv_;
+	std::set<Ticker> pending_tickers_;	 ///< 已发送请求, 尚未收到回报的合约
+	std::set<Ticker> rejected_tickers_;	 ///< 回报出错的合约
 
 	// login and logout
 	void LogInASync() noexcept;
@@ -54,7 +146,10 @@ private:
 	void OnRspUserLogout(CThostFtdcUserLogoutField* pUserLogout, CThostFtdcRspInfoField* pRspInfo, int nRequestID,
 						 bool bIsLast) override;
 
-	// subscription
+	std::vector<Ticker> RequestAllFronts(const std::vector<Ticker>& ticker_list, bool subscribe);
+	std::vector<Ticker> RequestSubscription(const std::vector<Ticker>& ticker_list, bool subscribe);
+	void OnSubscriptionResponse(CThostFtdcSpecificInstrumentField* pSpecificInstrument,
+								CThostFtdcRspInfoField* pRspInfo, bool subscribe);
 	void OnRspSubMarketData(CThostFtdcSpecificInstrumentField* pSpecificInstrument, CThostFtdcRspInfoField* pRspInfo,
 							int nRequestID, bool bIsLast) override;
 	void OnRspUnSubMarketData(CThostFtdcSpecificInstrumentField* pSpecificInstrument, CThostFtdcRspInfoField* pRspInfo,
@@ -71,23 +166,40 @@ private:
 class CTPMarketData : public CTPMarketDataBase {
 public:
 	CTPMarketData(const std::vector<IPAddress>& server_addr) : CTPMarketDataBase(server_addr) {}
+	/// 先登出并停止消费线程, 再析构派生状态
+	~CTPMarketData() override { LogOut(); }
+
+	/**
+	 * @brief 设置期权链, 需在 `LogIn` 前设置. 期权行情在保存快照和发布前由 `OptionChain::Enrich` 写入计算的Delta
+	 * @note 期权链由本类加锁调用, 其他线程不应同时使用
+	 */
+	void SetOptionChain(OptionChain* option_chain) { option_chain_ = option_chain; }
 
 protected:
-	void OnRtnDepthMarketData(CThostFtdcDepthMarketDataField* pDepthMarketData) override;
+	void ProcessDepthMarketData(CThostFtdcDepthMarketDataField* pDepthMarketData, Timestamp local_time) override;
 
-	MarketDepth CTPMarketData2MarketDepth(CThostFtdcDepthMarketDataField* pDepthMarketData);
+	/**
+	 * @brief 将CTP行情转换为 `MarketDepth`
+	 * @param pDepthMarketData CTP行情
+	 * @param local_time 本地接收时间
+	 */
+	MarketDepth CTPMarketData2MarketDepth(CThostFtdcDepthMarketDataField* pDepthMarketData, Timestamp local_time);
 
 private:
-	std::map<std::string, Price> pre_latest_;
-	std::map<std::string, Price> pre_high_;
-	std::map<std::string, Price> pre_low_;
-	std::map<std::string, Price> pre_turnover_;
-	std::map<std::string, Volume> pre_volume_;
-};
-
-/// 可被观察的CTP行情基类
-class ObservableCTPMarketDataBase : public CTPMarketDataBase, public Observable {
-public:
-	ObservableCTPMarketDataBase(const std::vector<IPAddress>& server_addr) : CTPMarketDataBase(server_addr){};
-	ObservableCTPMarketDataBase(const IPAddress& server_addr) : CTPMarketDataBase(server_addr){};
+	/// 单个合约计算区间量价所需的上一笔行情, 每个合约独占一条缓存行
+	struct alignas(64) DerivationState {
+		int trading_day = 0;  ///< 交易日(YYYYMMDD)
+		Volume volume = 0;	  ///< 累计成交量
+		Price latest = 0;	  ///< 最新价
+		Price high = 0;		  ///< 当日最高价
+		Price low = 0;		  ///< 当日最低价
+		Price turnover = 0;	  ///< 累计成交额
+	};
+	static_assert(sizeof(DerivationState) == 64);
+
+	/// 以合约ID为下标. 符号表已满时无法登记的合约不派生增量字段
+	std::vector<DerivationState> derivation_state_ = std::vector<DerivationState>(SymbolTable::kCapacity);
+
+	OptionChain* option_chain_ = nullptr;
+	std::mutex option_chain_mutex_;	 ///< 冗余前置的回调线程可能同时处理不同合约的行情
 };
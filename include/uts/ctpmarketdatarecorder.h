@@ -5,6 +5,8 @@
 
 /**
  * @brief 基于 `CTP` 的行情记录器
+ * @details 行情写入 `DataRecorder`. 通过 `SetEventBus` 设置事件总线后同时发布至该总线,
+ *          可由 `BarEngine` 合成K线并交给 `BarRecorder` 记录
  */
 class CTPMarketDataRecorder : public CTPMarketData {
 public:
@@ -15,10 +17,14 @@ public:
 	CTPMarketDataRecorder(const std::vector<IPAddress>& server_addr) : CTPMarketData(server_addr) {}
 	CTPMarketDataRecorder(const CTPMarketDataRecorder&) = delete;
 	CTPMarketDataRecorder& operator=(const CTPMarketDataRecorder&) = delete;
-	~CTPMarketDataRecorder() { data_recorder_ = nullptr; }
+	~CTPMarketDataRecorder() override {
+		LogOut();
+		data_recorder_ = nullptr;
+	}
 
 	/**
-	 * @brief 指定数据记录器。系统提供 `CSVDataRecorder` 和 `SQLite3DataRecorder`
+	 * @brief 指定数据记录器。系统提供 `CSVDataRecorder` 和 `SQLite3DataRecorder`.
+	 *        同时记录至多个数据记录器时使用 `FanoutDataRecorder`
 	 * @param data_recorder 指向 `DataRecorder` 的指针
 	 */
 	void setSink(DataRecorder* data_recorder) { data_recorder_ = data_recorder; }
@@ -26,5 +32,5 @@ public:
 private:
 	DataRecorder* data_recorder_ = nullptr;
 
-	void OnRtnDepthMarketData(CThostFtdcDepthMarketDataField* pDepthMarketData) override;
+	void ProcessDepthMarketData(CThostFtdcDepthMarketDataField* pDepthMarketData, Timestamp local_time) override;
 };
@@ -136,6 +136,8 @@ private:
 
 	OrderIndex PlaceOrderASync(CThostFtdcInputOrderField&);
 	void FilterCancelableOrders(std::map<OrderIndex, OrderRecord>::iterator& loc);
+	/// 记录成交并更新持仓
+	void UpdateHolding(TradingRecord trade);
 	void PostingLoginRequest() noexcept;
 
 	// translation
@@ -7,6 +7,9 @@
 
 #include <algorithm>
 #include <array>
+#include <compare>
+#include <cstdint>
+#include <limits>
 #include <map>
 #include <ranges>
 #include <string>
@@ -33,7 +36,12 @@ using IndexFutureTicker = Ticker;  ///< 股指期货合约代码
 using OptionTicker = Ticker;	   ///< 期权合约代码
 using CallOptionTicker = Ticker;   ///< 看涨期权合约代码
 using PutOptionTicker = Ticker;	   ///< 看跌期权代码
+using SymbolID = uint32_t;		   ///< 合约ID, 由 `SymbolTable` 分配的稠密整数
 
+/// 无效合约ID
+constexpr SymbolID kInvalidSymbol = std::numeric_limits<SymbolID>::max();
+
+using Timestamp = int64_t;		  ///< 时间戳, 1970-01-01 00:00:00 UTC 起的纳秒数
 using DateTimeStr = std::string;  ///< 日期时间字符串(YYYY-MM-DD hh:mm:ss.mmm)
 using DateStr = std::string;	  ///< 日期字符串(YYYY-MM-DD)
 using TimeStr = std::string;	  ///< 时间字符串(hh:mm:ss.mmm)
@@ -209,11 +217,14 @@ struct OHLCLVT {
 	Turnover turnover;	///< 成交额
 };
 
-/// 市场行情
+/// 市场行情. 可平凡复制, 以便在线程间无锁传递
 struct MarketDepth {
-	Ticker instrument_id;  ///< 合约代码
+	char instrument_id[32];	 ///< 合约代码
+	SymbolID symbol_id;		 ///< 合约ID
 
-	DateTimeStr update_time;  ///< 更新时间
+	int trading_day;		  ///< 交易日(YYYYMMDD)
+	Timestamp exchange_time;  ///< 交易所更新时间
+	Timestamp local_time;	  ///< 本地接收时间
 	OHLCLVT ohlclvt;		  ///< 高开低收量额
 	Price settle;			  ///< 结算价
 	Volume open_interest;	  ///< 持仓量
@@ -226,6 +237,49 @@ struct MarketDepth {
 	std::array<PriceVolume, 5> ask;	 ///< 竞卖
 };
 
+/// 行情告警类型
+enum class MarketDataAlertType {
+	InstrumentStale,	///< 合约在交易时段内超过预期间隔没有行情
+	InstrumentResumed,	///< 告警后的合约重新收到行情
+	FrontSilent,		///< 前置在交易时段内没有任何行情
+	FrontResumed,		///< 告警后的前置重新收到行情
+};
+
+/// 行情告警. 可平凡复制
+struct MarketDataAlert {
+	MarketDataAlertType type;  ///< 告警类型
+	SymbolID symbol_id;		   ///< 合约ID, 前置告警时为 `kInvalidSymbol`
+	size_t front;			   ///< 前置序号, 合约告警时为0
+	Timestamp last_tick;	   ///< 告警前最近一笔行情的本地接收时间, 没有行情时为开始监视的时间
+	Timestamp time;			   ///< 告警时间
+};
+
+/// K线周期
+enum class BarPeriod {
+	Second,		  ///< 1秒
+	Minute,		  ///< 1分钟
+	FiveMinutes,  ///< 5分钟
+	Session,	  ///< 交易日
+};
+
+/// K线. 可平凡复制
+struct Bar {
+	SymbolID symbol_id;	   ///< 合约ID
+	BarPeriod period;	   ///< 周期
+	int trading_day;	   ///< 交易日(YYYYMMDD)
+	Timestamp start_time;  ///< 开始时间(含). 交易日K线为首笔行情时间
+	Timestamp end_time;	   ///< 结束时间(不含). 交易日K线为末笔行情时间
+
+	Price open;				///< 开盘价
+	Price high;				///< 最高价
+	Price low;				///< 最低价
+	Price close;			///< 收盘价
+	Volume volume;			///< 成交量
+	Turnover turnover;		///< 成交额
+	Volume open_interest;	///< 持仓量
+	int tick_count;			///< 行情笔数
+};
+
 /// 合约类型
 enum class InstrumentType {
 	Stock,		   ///< 股票
@@ -319,6 +373,7 @@ struct InstrumentInfo {
 	InstrumentType instrument_type;						 ///< 合约类型
 	bool is_trading;									 ///< 是否在交易
 	Ticker instrument_id;								 ///< 合约代码
+	SymbolID symbol_id = kInvalidSymbol;				 ///< 合约ID
 	std::string instrument_name;						 ///< 合约名称
 	Exchange exchange;									 ///< 交易所
 	ProductID product_id;								 ///< 产品代码
@@ -351,17 +406,31 @@ struct CapitalInfo {
 
 /// 合约索引
 struct InstrumentIndex {
-	Ticker instrument_id;	   ///< 合约代码
-	Direction direction;	   ///< 持仓方向
-	HedgeFlagType hedge_flag;  ///< 投机套保标识
-	auto operator<=>(const InstrumentIndex& rhs) const = default;
+	SymbolID symbol_id = kInvalidSymbol;  ///< 合约ID
+	Ticker instrument_id;				  ///< 合约代码
+	Direction direction;				  ///< 持仓方向
+	HedgeFlagType hedge_flag;			  ///< 投机套保标识
+
+	/**
+	 * @brief 按合约ID比较, 合约ID相同时不比较合约代码
+	 * @note 没有合约ID(如由JSON读取或符号表已满)时按合约代码区分, 排在有合约ID的索引之后
+	 */
+	std::strong_ordering operator<=>(const InstrumentIndex& rhs) const {
+		if (auto c = symbol_id <=> rhs.symbol_id; c != 0) { return c; }
+		if (symbol_id == kInvalidSymbol) {
+			if (auto c = instrument_id <=> rhs.instrument_id; c != 0) { return c; }
+		}
+		return std::tie(direction, hedge_flag) <=> std::tie(rhs.direction, rhs.hedge_flag);
+	}
+	bool operator==(const InstrumentIndex& rhs) const { return (*this <=> rhs) == 0; }
 };
 
 /// 持仓记录
 struct HoldingRecord {
-	Exchange exchange;			///< 交易所
-	Ticker instrument_id;		///< 合约代码
-	Direction direction;		///< 持仓方向
+	Exchange exchange;					  ///< 交易所
+	Ticker instrument_id;				  ///< 合约代码
+	SymbolID symbol_id = kInvalidSymbol;  ///< 合约ID
+	Direction direction;				  ///< 持仓方向
 	HedgeFlagType hedge_flag;	///< 投机套保标识
 	Volume total_quantity = 0;	///< 总持仓量
 	Volume today_quantity = 0;	///< 持今仓量
@@ -370,10 +439,11 @@ struct HoldingRecord {
 
 /// 成交记录
 struct TradingRecord {
-	OrderRef order_ref;		   ///< 成交编号
-	Exchange exchange;		   ///< 交易所
-	Ticker instrument_id;	   ///< 合约代码
-	OpenCloseType open_close;  ///< 开平
+	OrderRef order_ref;					  ///< 成交编号
+	Exchange exchange;					  ///< 交易所
+	Ticker instrument_id;				  ///< 合约代码
+	SymbolID symbol_id = kInvalidSymbol;  ///< 合约ID
+	OpenCloseType open_close;			  ///< 开平
 	Direction direction;	   ///< 交易方向
 	HedgeFlagType hedge_flag;  ///< 投机套保标识
 	Price price;			   ///< 成交价格
@@ -388,6 +458,7 @@ struct OrderRecord {
 	OrderRef order_ref;								///< 委托编号
 	Exchange exchange;								///< 交易所
 	Ticker instrument_id;							///< 合约代码
+	SymbolID symbol_id = kInvalidSymbol;			///< 合约ID
 	OpenCloseType open_close;						///< 开平
 	Direction direction;							///< 交易方向
 	HedgeFlagType hedge_flag;						///< 投机套保标识
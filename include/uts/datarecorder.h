@@ -1,39 +1,207 @@
 ﻿#pragma once
 
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
 #include <mutex>
-#include <queue>
+#include <span>
 #include <thread>
+#include <vector>
 
 #include <uts/data_struct.h>
 
+/// 数据记录器缓冲区已满时的处理方式
+enum class BackpressurePolicy {
+	Block,		  ///< 阻塞写入方, 直至记录线程取走缓冲区
+	DropOldest,	  ///< 丢弃最早的一笔
+	SpillToDisk,  ///< 将整个缓冲区交给转存线程写入磁盘文件, 由记录线程稍后补写
+};
+
+/// 数据记录器统计
+struct RecorderStatistics {
+	uint64_t received = 0;	///< 收到的行情笔数
+	uint64_t written = 0;	///< 已写入的行情笔数
+	uint64_t dropped = 0;	///< 因缓冲区已满而丢弃的笔数
+	uint64_t spilled = 0;	///< 因缓冲区已满而转存至磁盘的笔数
+	uint64_t blocked = 0;	///< 写入方因缓冲区已满而等待的次数
+	size_t pending = 0;		///< 缓冲区及转存文件中尚未写入的笔数
+};
+
 /**
  * @brief 行情数据记录气基类，通过不断调用其 `DataSink` 函数记录行情数据。子类需实现 `WriteDB` 函数完成数据如入库
- * @details 该类内部有一个数据写入队列，可应对段时间的大量数据写入请求
+ * @details 该类内部有一个有界的数据写入缓冲区，可应对段时间的大量数据写入请求。
+ *          写入方只在缓冲区由空变为非空时唤醒记录线程; 记录线程每次加锁将整个缓冲区与空缓冲区交换，
+ *          再以 `WriteDB(std::span<const MarketDepth>)` 批量写入。缓冲区已满时按 `BackpressurePolicy` 处理
  */
 class DataRecorder {
 public:
+	/// 默认缓冲区容量
+	static constexpr size_t kDefaultCapacity = 1 << 14;
+	/// 默认的空闲提交间隔
+	static constexpr std::chrono::milliseconds kDefaultFlushInterval = std::chrono::seconds(1);
+
 	DataRecorder();
 	DataRecorder(const DataRecorder&) = delete;
 	DataRecorder& operator=(const DataRecorder&) = delete;
 	virtual ~DataRecorder();
 
 	/// 接收的行情数据
-	void DataSink(const MarketDepth& data);
+	virtual void DataSink(const MarketDepth& data);
+
+	/**
+	 * @brief 设置缓冲区容量及其已满时的处理方式, 需在 `DataSink` 前调用
+	 * @param capacity 缓冲区容量
+	 * @param policy 缓冲区已满时的处理方式
+	 * @param spill_file 转存文件, 仅 `BackpressurePolicy::SpillToDisk` 使用. 已存在时清空
+	 * @exception InvalidOperationError 缓冲区中仍有未写入的数据
+	 * @exception IOError 无法打开转存文件
+	 */
+	virtual void SetBackpressurePolicy(size_t capacity, BackpressurePolicy policy,
+									   const std::filesystem::path& spill_file = {});
+	/// 统计
+	virtual RecorderStatistics statistics() const;
+
+	/**
+	 * @brief 写完缓冲区及转存文件中的数据后停止记录线程, 之后收到的数据被丢弃
+	 * @note 子类应在其析构函数中调用, 基类析构时子类的 `WriteDB` 已不可用, 未写入的数据将被丢弃
+	 */
+	virtual void Stop();
 
 protected:
+	/// 不启动记录线程, 供自行管理写入线程的子类使用
+	struct NoWorker {};
+	explicit DataRecorder(NoWorker) : composite_(true) {}
+
 	/**
 	 * @brief 数据记录实现
 	 * @param data 新收到的行情数据
 	 */
 	virtual void WriteDB(const MarketDepth& data) = 0;
+	/**
+	 * @brief 批量数据记录实现. 默认逐笔调用 `WriteDB(const MarketDepth&)`, 子类可重载以合并为一次写入
+	 * @param data 按收到顺序排列的行情数据
+	 */
+	virtual void WriteDB(std::span<const MarketDepth> data);
+	/// 记录线程空闲超过 `flush_interval` (由 `set_flush_interval` 启用)及停止前调用, 子类可在此提交缓存的写入
+	virtual void Flush() {}
+	/**
+	 * @brief 提交已写入的全部数据并等待其持久化, 供 `JournaledDataRecorder` 确定可从日志中删除的数据
+	 * @return 是否已全部持久化. 默认调用 `Flush` 后返回 `true`
+	 */
+	virtual bool Sync() {
+		Flush();
+		return true;
+	}
+	/**
+	 * @brief 设置记录线程空闲多久后调用 `Flush`, 并启用空闲时的调用
+	 * @note 记录线程在基类构造时启动, 重载 `Flush` 的子类应在其构造函数最后调用, 避免 `Flush` 访问未构造完的对象
+	 */
+	virtual void set_flush_interval(std::chrono::milliseconds interval);
+	/// 是否由 `JournaledDataRecorder` 驱动. 此时写入失败的数据由日志补写, 不计入 `dropped`
+	bool journaled() const noexcept { return journaled_.load(std::memory_order_relaxed); }
+	/// 子类无法写入时调用, 计入 `dropped` 且不计入 `written`
+	void AddDropped(uint64_t count);
+
+private:
+	// 分发记录器与日志记录器在自己的线程中驱动数据记录器的 `Write` 与 `Flush`, 分片记录器转发设置
+	friend class FanoutDataRecorder;
+	friend class JournaledDataRecorder;
+	friend class ShardedDataRecorder;
+
+	std::thread worker_;
+	const bool composite_ = false;	///< 自行管理写入线程, 只能通过 `DataSink` 写入
+	mutable std::mutex mutex_;
+	std::condition_variable cv_;		  ///< 通知记录线程有新数据
+	std::condition_variable space_cv_;	  ///< 通知阻塞的写入方缓冲区已取走
+	bool working_ = true;
+	bool flush_on_stop_ = true;
+	std::chrono::milliseconds flush_interval_ = kDefaultFlushInterval;
+	bool flush_when_idle_ = false;	///< 子类构造完成, 空闲时可调用 `Flush`
+
+	// 环形缓冲区, 记录线程将其与 `batch_` 整体交换
+	std::vector<MarketDepth> pending_ = std::vector<MarketDepth>(kDefaultCapacity);
+	size_t head_ = 0;
+	size_t size_ = 0;
+	std::vector<MarketDepth> batch_ = std::vector<MarketDepth>(kDefaultCapacity);
+	size_t writing_ = 0;  ///< `batch_` 中正在写入的笔数
+	BackpressurePolicy policy_ = BackpressurePolicy::Block;
+
+	// 转存. 写入方持有 `mutex_` 时将已满的缓冲区与 `spill_chunk_` 交换, 由转存线程写入文件, 记录线程读取
+	std::thread spill_thread_;
+	std::condition_variable spill_cv_;	///< 通知转存线程有待写入的缓冲区
+	bool spilling_ = false;				///< 转存线程运行中, 由 `mutex_` 保护
+	std::vector<MarketDepth> spill_chunk_;
+	size_t spill_chunk_head_ = 0;
+	size_t spill_chunk_size_ = 0;  ///< 非0时 `spill_chunk_` 由转存线程使用, 由 `mutex_` 保护
+	uint64_t spill_enqueued_ = 0;  ///< 已交给转存线程的笔数, 由 `mutex_` 保护
+	size_t spill_backlog_ = 0;	   ///< 尚未补写的笔数, 由 `mutex_` 保护
+
+	// 转存文件, 由 `spill_mutex_` 保护. 文件中第一笔的序号为 `spill_base_`
+	std::mutex spill_mutex_;
+	std::condition_variable spilled_cv_;  ///< 通知记录线程转存文件已写入
+	std::fstream spill_;
+	std::filesystem::path spill_path_;
+	std::vector<MarketDepth> spill_buffer_;	 ///< 补写时的读取缓冲区, 仅记录线程使用
+	uint64_t spill_base_ = 0;
+	uint64_t spill_read_ = 0;	  ///< 已补写的笔数
+	uint64_t spill_written_ = 0;  ///< 已写入文件的笔数
+
+	RecorderStatistics statistics_;	 ///< 除 `written` 外由 `mutex_` 保护
+	std::atomic<uint64_t> written_ = 0;
+	std::atomic<bool> journaled_ = false;
+
+	void Process();
+	void StopWorker(bool flush);
+	void StopSpillThread();
+	void Spill();
+	void SpillLoop();
+	/// 补写序号 `limit` 之前转存的数据
+	void DrainSpill(uint64_t limit);
+	void Write(std::span<const MarketDepth> data);
+};
+
+/**
+ * @brief K线记录器基类, 通过其 `BarSink` 函数记录 `BarEngine` 发布的K线. 子类需实现 `WriteBars` 完成入库
+ * @details 发布线程只将K线追加进缓冲区, 记录线程每次加锁取走整个缓冲区后批量写入, K线的发布不等待写入.
+ *          通常以 `event_bus.Subscribe<Bar, &BarRecorder::BarSink>(&recorder)` 订阅K线
+ */
+class BarRecorder {
+public:
+	BarRecorder();
+	BarRecorder(const BarRecorder&) = delete;
+	BarRecorder& operator=(const BarRecorder&) = delete;
+	virtual ~BarRecorder();
+
+	/// 接收的K线
+	void BarSink(const Bar& bar);
+	/// 已写入的K线数量
+	uint64_t written() const { return written_.load(std::memory_order_relaxed); }
+
+	/**
+	 * @brief 写完缓冲区中的K线后停止记录线程, 之后收到的K线被丢弃
+	 * @note 子类应在其析构函数中调用, 基类析构时子类的 `WriteBars` 已不可用, 未写入的K线将被丢弃
+	 */
+	void Stop();
+
+protected:
+	/**
+	 * @brief 批量K线记录实现
+	 * @param bars 按完成顺序排列的K线
+	 */
+	virtual void WriteBars(std::span<const Bar> bars) = 0;
 
 private:
 	std::thread worker_;
 	std::mutex mutex_;
-	std::queue<MarketDepth> q_;
 	std::condition_variable cv_;
 	bool working_ = true;
+	bool flush_on_stop_ = true;
+	std::vector<Bar> pending_;
+	std::atomic<uint64_t> written_ = 0;
 
 	void Process();
+	void StopWorker(bool flush);
 };
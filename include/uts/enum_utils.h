@@ -2,6 +2,7 @@
 
 #include <nlohmann/json.hpp>
 #include <uts/data_struct.h>
+#include <uts/trading_utils.h>
 
 using nlohmann::json;
 
@@ -155,7 +156,9 @@ NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Order, account_name, broker_name, exchange, i
 
 inline void to_json(json& j, const MarketDepth& m) {
 	j = json{
-		{"instrument_id", m.instrument_id},
+		{"instrument_id", std::string(m.instrument_id)},
+		{"trading_day", m.trading_day},
+		{"update_time", FormatDateTime(m.exchange_time)},
 		{"open", m.ohlclvt.open},
 		{"high", m.ohlclvt.high},
 		{"low", m.ohlclvt.low},
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+
+#include <uts/data_struct.h>
+
+/**
+ * @brief 类型化事件总线
+ *
+ * 每种事件类型对应一个预分配的处理函数数组, 发布事件时不分配内存, 不加锁.
+ * 处理函数以函数指针加上下文指针保存, 通过 `Subscribe<Event, &Class::Method>(object)` 注册的成员函数在编译期绑定,
+ * 发布时不经过虚函数. 注册和注销加锁, 可与发布并发进行: 注销返回后, 该处理函数不会再被调用.
+ * @note 处理函数在发布者的线程中同步执行, 不可在处理函数中注销自身
+ * @tparam Events 事件类型
+ */
+template <typename... Events>
+class EventBus {
+public:
+	/// 每种事件可注册的处理函数数量
+	static constexpr size_t kMaxHandlers = 32;
+	/// 无效的订阅编号
+	static constexpr int kInvalidSubscription = -1;
+
+	/// 事件处理函数
+	template <typename Event>
+	using Handler = void (*)(void* context, const Event& event);
+
+	EventBus() = default;
+	EventBus(const EventBus&) = delete;
+	EventBus& operator=(const EventBus&) = delete;
+
+	/**
+	 * @brief 注册处理函数
+	 * @param handler 处理函数
+	 * @param context 调用处理函数时传入的上下文
+	 * @return 订阅编号, 用于注销
+	 * @exception std::length_error 该事件的处理函数已满
+	 */
+	template <typename Event>
+	int Subscribe(Handler<Event> handler, void* context) {
+		auto& channel = GetChannel<Event>();
+		std::scoped_lock _(mutex_);
+		for (size_t i = 0; i < kMaxHandlers; ++i) {
+			auto& slot = channel.slots[i];
+			if (slot.active.load(std::memory_order_relaxed)) { continue; }
+			slot.handler = handler;
+			slot.context = context;
+			slot.active.store(true, std::memory_order_release);
+			if (i >= channel.end.load(std::memory_order_relaxed)) {
+				channel.end.store(i + 1, std::memory_order_release);
+			}
+			return static_cast<int>(i);
+		}
+		throw std::length_error("EventBus: too many handlers for one event");
+	}
+
+	/**
+	 * @brief 注册成员函数为处理函数
+	 * @tparam Event 事件类型
+	 * @tparam Method 成员函数, 签名为 `void(const Event&)`
+	 * @param object 对象
+	 * @return 订阅编号, 用于注销
+	 */
+	template <typename Event, auto Method, typename Class>
+	int Subscribe(Class* object) {
+		return Subscribe<Event>([](void* context, const Event& event) { (static_cast<Class*>(context)->*Method)(event); },
+								object);
+	}
+
+	/**
+	 * @brief 注销处理函数. 返回时, 正在执行的该处理函数均已结束
+	 * @param subscription 订阅编号
+	 */
+	template <typename Event>
+	void Unsubscribe(int subscription) {
+		if ((subscription < 0) || (subscription >= static_cast<int>(kMaxHandlers))) { return; }
+		auto& slot = GetChannel<Event>().slots[static_cast<size_t>(subscription)];
+		std::scoped_lock _(mutex_);
+		slot.active.store(false, std::memory_order_seq_cst);
+		while (slot.in_flight.load(std::memory_order_seq_cst) != 0) { std::this_thread::yield(); }
+	}
+
+	/// 发布事件, 在当前线程依次调用处理函数
+	template <typename Event>
+	void Publish(const Event& event) noexcept {
+		auto& channel = GetChannel<Event>();
+		size_t end = channel.end.load(std::memory_order_acquire);
+		for (size_t i = 0; i < end; ++i) {
+			auto& slot = channel.slots[i];
+			if (!slot.active.load(std::memory_order_relaxed)) { continue; }
+			slot.in_flight.fetch_add(1, std::memory_order_seq_cst);
+			if (slot.active.load(std::memory_order_seq_cst)) { slot.handler(slot.context, event); }
+			slot.in_flight.fetch_sub(1, std::memory_order_release);
+		}
+	}
+
+	/// 已注册的处理函数数量
+	template <typename Event>
+	size_t subscriber_count() const {
+		auto& channel = std::get<Channel<Event>>(channels_);
+		size_t count = 0;
+		for (auto& slot : channel.slots) { count += slot.active.load(std::memory_order_relaxed); }
+		return count;
+	}
+
+private:
+	template <typename Event>
+	struct Channel {
+		struct alignas(64) Slot {
+			std::atomic<bool> active = false;
+			std::atomic<uint32_t> in_flight = 0;
+			Handler<Event> handler = nullptr;
+			void* context = nullptr;
+		};
+		std::array<Slot, kMaxHandlers> slots;
+		std::atomic<size_t> end = 0;  ///< 曾使用过的槽位上界
+	};
+
+	std::tuple<Channel<Events>...> channels_;
+	std::mutex mutex_;
+
+	template <typename Event>
+	Channel<Event>& GetChannel() {
+		static_assert((std::is_same_v<Event, Events> || ...), "Event type is not registered in this EventBus");
+		return std::get<Channel<Event>>(channels_);
+	}
+};
+
+/// 交易系统事件总线: 行情, K线, 委托回报, 成交回报, 资金, 行情告警
+using TradingEventBus = EventBus<MarketDepth, Bar, OrderRecord, TradingRecord, CapitalInfo, MarketDataAlert>;
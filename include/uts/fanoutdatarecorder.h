@@ -0,0 +1,143 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <uts/data_struct.h>
+#include <uts/datarecorder.h>
+
+/// 分发记录器中单个数据记录器的统计
+struct SinkStatistics {
+	uint64_t written = 0;  ///< 已写入的行情笔数
+	uint64_t dropped = 0;  ///< 日志已满时被跳过的笔数
+	uint64_t batches = 0;  ///< 批量写入的次数
+	size_t lag = 0;		   ///< 尚未取走的笔数
+	size_t max_lag = 0;	   ///< 尚未取走笔数的最大值
+};
+
+/**
+ * @brief 分发数据记录器，将收到的行情只保存一份，分发给多个数据记录器
+ * @details 行情追加至由定长数据块组成的共享日志, 每个数据记录器在各自的线程中以独立的读取位置按批调用其
+ *          `WriteDB(std::span<const MarketDepth>)`, 慢速的数据记录器不影响其他数据记录器. 数据块在所有数据记录器
+ *          都读过后回收. 内存中的日志达到容量上限时按 `BackpressurePolicy` 处理:
+ *           - `Block`: 阻塞写入方, 直至最慢的数据记录器读完最早的数据块
+ *           - `DropOldest`: 丢弃最早的数据块, 尚未读到的数据记录器跳过该块
+ *           - `SpillToDisk`: 将最早的数据块交给转存线程写入磁盘文件, 尚未读到的数据记录器稍后从文件中读取.
+ *             转存线程仍在写入上一个数据块时阻塞写入方
+ *
+ *          加入的数据记录器的记录线程被停止, 之后由分发记录器驱动, 其 `SetBackpressurePolicy` 不再生效.
+ *          数据记录器需在分发记录器析构后再析构
+ */
+class FanoutDataRecorder : public DataRecorder {
+public:
+	/// 日志数据块的行数
+	static constexpr size_t kChunkRows = 4096;
+	/// 默认单次批量写入的最大笔数
+	static constexpr size_t kDefaultBatchSize = 1024;
+
+	/**
+	 * @brief 构造函数
+	 * @param capacity 内存中日志的容量, 向上取整至数据块大小, 至少两个数据块
+	 * @param policy 日志已满时的处理方式
+	 * @param spill_file 转存文件, 仅 `BackpressurePolicy::SpillToDisk` 使用. 已存在时清空
+	 * @exception IOError 无法打开转存文件
+	 */
+	explicit FanoutDataRecorder(size_t capacity = 16 * kChunkRows,
+								BackpressurePolicy policy = BackpressurePolicy::Block,
+								const std::filesystem::path& spill_file = {});
+	~FanoutDataRecorder() override;
+
+	/**
+	 * @brief 加入数据记录器, 从之后收到的行情开始写入. 空闲时按该记录器的 `flush_interval` 调用其 `Flush`
+	 * @param sink 数据记录器
+	 * @param batch_size 单次批量写入的最大笔数
+	 * @return 数据记录器的序号
+	 * @exception InvalidOperationError 分发记录器已停止, 或数据记录器为分发, 分片, 轮换, 日志等自行管理写入线程的记录器
+	 */
+	size_t AddSink(DataRecorder* sink, size_t batch_size = kDefaultBatchSize);
+
+	void DataSink(const MarketDepth& data) override;
+	/**
+	 * @brief 设置内存中日志的容量及其已满时的处理方式, 需在日志中的数据全部写入后调用
+	 * @param capacity 内存中日志的容量, 向上取整至数据块大小, 至少两个数据块
+	 * @param policy 日志已满时的处理方式
+	 * @param spill_file 转存文件, 仅 `BackpressurePolicy::SpillToDisk` 使用. 已存在时清空
+	 * @exception InvalidOperationError 日志中仍有未写入的数据
+	 * @exception IOError 无法打开转存文件
+	 */
+	void SetBackpressurePolicy(size_t capacity, BackpressurePolicy policy,
+							   const std::filesystem::path& spill_file = {}) override;
+	/// 统计. `written` 为已写入全部数据记录器的笔数, `pending` 为最慢的数据记录器尚未写入的笔数
+	RecorderStatistics statistics() const override;
+	/// 某数据记录器的统计
+	SinkStatistics sink_statistics(size_t index) const;
+	/// 写完日志中的数据后停止所有数据记录器的写入线程, 之后收到的数据被丢弃
+	void Stop() override;
+
+protected:
+	void WriteDB(const MarketDepth&) override {}
+	/// 设置已加入的各数据记录器空闲多久后调用其 `Flush`
+	void set_flush_interval(std::chrono::milliseconds interval) override;
+
+private:
+	using Chunk = std::shared_ptr<MarketDepth[]>;
+
+	/// 数据记录器及其读取位置
+	struct Sink {
+		DataRecorder* recorder = nullptr;
+		size_t batch_size = kDefaultBatchSize;
+		std::chrono::milliseconds flush_interval{};
+		uint64_t cursor = 0;			///< 下一笔要取走的序号
+		bool reading_spill = false;		///< 正在读取转存文件
+		std::vector<MarketDepth> buffer;  ///< 转存数据的读取缓冲区
+		SinkStatistics statistics;
+		std::condition_variable cv;
+		std::thread worker;
+	};
+
+	mutable std::mutex mutex_;
+	std::condition_variable space_cv_;	///< 通知阻塞的写入方日志有空间
+	bool working_ = true;
+	std::vector<std::unique_ptr<Sink>> sinks_;
+
+	// 日志. 序号 `memory_begin_` 起的行情在内存中, 之前 `spill_rows_` 笔行情在转存文件中
+	std::deque<Chunk> chunks_;
+	Chunk spare_;  ///< 回收的数据块
+	size_t max_chunks_;
+	uint64_t head_ = 0;			 ///< 下一笔行情的序号
+	uint64_t memory_begin_ = 0;	 ///< 内存中第一笔行情的序号, 为数据块行数的整数倍
+	uint64_t spill_begin_ = 0;	 ///< 转存文件中第一笔行情的序号
+	size_t spill_rows_ = 0;
+	BackpressurePolicy policy_;
+
+	// 转存. 写入方持有 `mutex_` 时将最早的数据块交给转存线程写入文件, 写入线程读取
+	std::thread spill_thread_;
+	std::condition_variable spill_cv_;	///< 通知转存线程有待写入的数据块
+	bool spilling_ = false;				///< 转存线程运行中, 由 `mutex_` 保护
+	Chunk spill_chunk_;					///< 转存线程正在写入的数据块, 由 `mutex_` 保护
+
+	// 转存文件, 由 `spill_mutex_` 保护
+	std::mutex spill_mutex_;
+	std::condition_variable spilled_cv_;  ///< 通知写入线程转存文件已写入
+	std::fstream spill_;
+	std::filesystem::path spill_path_;
+	uint64_t spill_written_ = 0;  ///< 已写入文件的笔数
+
+	RecorderStatistics statistics_;
+
+	void Run(Sink& sink);
+	uint64_t MinCursor() const;
+	bool Reclaim();
+	void ReclaimSpill();
+	void Evict();
+	void StartSpillThread();
+	void SpillLoop();
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <uts/data_struct.h>
+#include <uts/datarecorder.h>
+#include <uts/tickjournal.h>
+
+/**
+ * @brief 带预写日志的数据记录器，行情先追加至 `TickJournal`，再由写入线程批量写入数据库
+ * @details 写入线程从日志的已提交序号处按批调用数据记录器的 `WriteDB`, 累计 `commit_rows` 行或超过
+ *          `commit_interval` 时调用其 `Sync`, 成功后推进日志的已提交序号. `Sync` 失败(如数据库断开)时
+ *          每隔 `retry_interval` 从已提交序号处重新写入, 恢复后日志中积压的行情一次性补写.
+ *          进程崩溃或被杀死后以同一日志目录重新构造即补写未提交的行情.
+ *          补写可能重复写入上次提交后已写入的数据, 以主键去重的数据库(如 `MariadbDataRecorder`)不受影响;
+ *          `SQLite3DataRecorder` 此时只在 `Sync` 中提交, 失败时整个事务回滚.
+ *          数据记录器的记录线程被停止, 之后由本记录器驱动; 数据记录器需在本记录器析构后再析构
+ */
+class JournaledDataRecorder : public DataRecorder {
+public:
+	/// 单次批量写入的最大笔数
+	static constexpr size_t kBatchRows = 4096;
+
+	/**
+	 * @brief 构造函数
+	 * @param directory 日志目录
+	 * @param sink 数据记录器
+	 * @param commit_rows 每次提交的最大行数
+	 * @param commit_interval 每次提交的最长间隔
+	 * @param retry_interval 提交失败后重试的间隔
+	 * @exception std::system_error 无法打开日志
+	 */
+	JournaledDataRecorder(const std::filesystem::path& directory, DataRecorder* sink, size_t commit_rows = 10000,
+						  std::chrono::milliseconds commit_interval = std::chrono::milliseconds(500),
+						  std::chrono::milliseconds retry_interval = std::chrono::seconds(5));
+	/// 构造函数, 数据记录器由本记录器持有, 如 `RotatingDataRecorder` 的各交易日各自带日志
+	JournaledDataRecorder(const std::filesystem::path& directory, std::unique_ptr<DataRecorder> sink,
+						  size_t commit_rows = 10000,
+						  std::chrono::milliseconds commit_interval = std::chrono::milliseconds(500),
+						  std::chrono::milliseconds retry_interval = std::chrono::seconds(5));
+	~JournaledDataRecorder() override;
+
+	void DataSink(const MarketDepth& data) override;
+	/// 统计. `pending` 为日志中尚未提交的笔数
+	RecorderStatistics statistics() const override;
+	/// 写入并提交日志中的全部数据后停止写入线程. 数据库不可用时保留在日志中, 下次构造时补写
+	void Stop() override;
+
+	/// 预写日志
+	const TickJournal& journal() const noexcept { return journal_; }
+
+protected:
+	void WriteDB(const MarketDepth&) override {}
+
+private:
+	std::unique_ptr<DataRecorder> owned_sink_;	///< 持有的数据记录器, 在 `journal_` 及写入线程之后析构
+	TickJournal journal_;
+	DataRecorder* sink_;
+	const size_t commit_rows_;
+	const std::chrono::milliseconds commit_interval_;
+	const std::chrono::milliseconds retry_interval_;
+
+	std::thread worker_;
+	mutable std::mutex mutex_;
+	std::condition_variable cv_;
+	std::atomic<bool> waiting_ = false;	 ///< 写入线程正在等待新数据
+	bool working_ = true;
+	std::atomic<uint64_t> received_ = 0;
+	std::atomic<uint64_t> dropped_ = 0;
+
+	void Apply();
+};
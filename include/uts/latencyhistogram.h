@@ -0,0 +1,94 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+
+/**
+ * @brief 无锁延迟直方图
+ *
+ * 按HDR直方图的对数线性方式分桶: 每个2的整数次幂区间再等分为 `kSubBuckets` 个子桶, 相对误差不超过 1/kSubBuckets.
+ * 桶数固定, 记录时只做一次位运算和几次relaxed原子加, 可由任意多个线程同时记录和读取.
+ * 超过 `kMaxValue` 的值计入最后一个桶, 负值计为0.
+ */
+class LatencyHistogram {
+public:
+	/// 每个2的整数次幂区间的子桶位数
+	static constexpr int kSubBucketBits = 5;
+	/// 每个2的整数次幂区间的子桶数
+	static constexpr uint64_t kSubBuckets = uint64_t{1} << kSubBucketBits;
+	/// 可区分的最大值的位数. 以纳秒计约为18分钟
+	static constexpr int kMaxValueBits = 40;
+	/// 可区分的最大值
+	static constexpr uint64_t kMaxValue = (uint64_t{1} << kMaxValueBits) - 1;
+	/// 桶数
+	static constexpr size_t kBucketCount = (kMaxValueBits - kSubBucketBits + 1) * kSubBuckets;
+
+	/// 记录一个值
+	void Record(int64_t value) noexcept {
+		uint64_t v = value < 0 ? 0 : static_cast<uint64_t>(value);
+		buckets_[BucketIndex(v)].fetch_add(1, std::memory_order_relaxed);
+		count_.fetch_add(1, std::memory_order_relaxed);
+		sum_.fetch_add(v, std::memory_order_relaxed);
+		uint64_t max = max_.load(std::memory_order_relaxed);
+		while ((v > max) && !max_.compare_exchange_weak(max, v, std::memory_order_relaxed)) {}
+	}
+
+	/// 记录数
+	uint64_t count() const noexcept { return count_.load(std::memory_order_relaxed); }
+	/// 最大值
+	uint64_t max() const noexcept { return max_.load(std::memory_order_relaxed); }
+	/// 平均值
+	uint64_t mean() const noexcept {
+		uint64_t n = count();
+		return n == 0 ? 0 : sum_.load(std::memory_order_relaxed) / n;
+	}
+	/**
+	 * @brief 分位数
+	 * @param quantile 分位, 取值[0, 1]
+	 * @return 分位数所在桶的上界, 不超过最大值. 无记录时为0
+	 */
+	uint64_t Percentile(double quantile) const noexcept {
+		uint64_t n = count();
+		if (n == 0) { return 0; }
+		uint64_t rank = static_cast<uint64_t>(quantile * static_cast<double>(n - 1)) + 1;
+		uint64_t seen = 0;
+		for (size_t i = 0; i < kBucketCount; ++i) {
+			seen += buckets_[i].load(std::memory_order_relaxed);
+			if (seen >= rank) { return std::min(BucketUpperBound(i), max()); }
+		}
+		return max();
+	}
+	/// 清空. 与记录并发时, 清空期间的记录可能部分保留
+	void Reset() noexcept {
+		for (auto& bucket : buckets_) { bucket.store(0, std::memory_order_relaxed); }
+		count_.store(0, std::memory_order_relaxed);
+		sum_.store(0, std::memory_order_relaxed);
+		max_.store(0, std::memory_order_relaxed);
+	}
+
+	/// 值所在的桶
+	static constexpr size_t BucketIndex(uint64_t value) noexcept {
+		if (value > kMaxValue) { value = kMaxValue; }
+		if (value < kSubBuckets) { return static_cast<size_t>(value); }
+		int msb = std::bit_width(value) - 1;
+		int shift = msb - kSubBucketBits;
+		return static_cast<size_t>((static_cast<uint64_t>(shift + 1) << kSubBucketBits) +
+								   ((value >> shift) - kSubBuckets));
+	}
+	/// 桶的上界(含)
+	static constexpr uint64_t BucketUpperBound(size_t index) noexcept {
+		if (index < kSubBuckets) { return index; }
+		int shift = static_cast<int>(index >> kSubBucketBits) - 1;
+		uint64_t lower = (kSubBuckets + (index & (kSubBuckets - 1))) << shift;
+		return lower + (uint64_t{1} << shift) - 1;
+	}
+
+private:
+	std::array<std::atomic<uint64_t>, kBucketCount> buckets_{};
+	std::atomic<uint64_t> count_ = 0;
+	std::atomic<uint64_t> sum_ = 0;
+	std::atomic<uint64_t> max_ = 0;
+};
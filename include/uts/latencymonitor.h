@@ -0,0 +1,103 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <uts/data_struct.h>
+#include <uts/latencyhistogram.h>
+
+/// 行情处理阶段. 各阶段的延迟均为该阶段完成时的本地时间与交易所时间之差
+enum class LatencyStage {
+	Callback,		  ///< 进入CTP行情回调
+	Normalized,		  ///< 转换为 `MarketDepth` 之后
+	Published,		  ///< 事件总线的处理函数返回之后
+	RecorderQueued,	  ///< 进入 `DataRecorder::DataSink`
+	RecorderWritten,  ///< `WriteDB` 返回之后
+};
+
+/**
+ * @brief 行情延迟监控
+ *
+ * 进程内唯一. 按处理阶段分别以交易所和前置为维度记录延迟直方图, 记录不加锁, 不分配内存.
+ * 默认关闭, 关闭时各记录点不读取时钟. 交易所由 `SetExchange` 登记, 未登记的合约计入 `Exchange::NA`.
+ * 前置序号与行情源的服务器地址顺序一致, 进程内有多个行情源时共用同一组前置直方图.
+ * @note 交易所时间只精确到毫秒(部分交易所为500毫秒快照), 且与本地时钟存在偏差, 延迟宜比较分布而非单笔
+ */
+class LatencyMonitor {
+public:
+	/// 阶段数量
+	static constexpr size_t kStageCount = static_cast<size_t>(LatencyStage::RecorderWritten) + 1;
+	/// 交易所数量
+	static constexpr size_t kExchangeCount = static_cast<size_t>(Exchange::HK) + 1;
+	/// 可分别统计的前置数量
+	static constexpr size_t kMaxFronts = 8;
+	/// 不区分前置
+	static constexpr size_t kNoFront = kMaxFronts;
+
+	/// 进程内唯一的延迟监控
+	static LatencyMonitor& Instance();
+
+	LatencyMonitor();
+	LatencyMonitor(const LatencyMonitor&) = delete;
+	LatencyMonitor& operator=(const LatencyMonitor&) = delete;
+	~LatencyMonitor();
+
+	/// 是否记录延迟
+	bool enabled() const noexcept { return enabled_.load(std::memory_order_relaxed); }
+	/// 开始或停止记录延迟
+	void Enable(bool enable = true) noexcept { enabled_.store(enable, std::memory_order_relaxed); }
+
+	/// 登记合约所属交易所
+	void SetExchange(SymbolID id, Exchange exchange) noexcept;
+	/// 合约所属交易所
+	Exchange exchange(SymbolID id) const noexcept;
+
+	/**
+	 * @brief 记录一笔延迟
+	 * @param stage 处理阶段
+	 * @param id 合约ID
+	 * @param latency 延迟(纳秒)
+	 * @param front 前置序号, 超出 `kMaxFronts` 时不计入前置直方图
+	 */
+	void Record(LatencyStage stage, SymbolID id, Timestamp latency, size_t front = kNoFront) noexcept;
+
+	/// 某阶段某交易所的延迟直方图
+	const LatencyHistogram& by_exchange(LatencyStage stage, Exchange exchange) const {
+		return by_exchange_[static_cast<size_t>(stage)][static_cast<size_t>(exchange)];
+	}
+	/// 某阶段某前置的延迟直方图
+	const LatencyHistogram& by_front(LatencyStage stage, size_t front) const {
+		return by_front_[static_cast<size_t>(stage)][front];
+	}
+
+	/// 清空所有直方图
+	void Reset() noexcept;
+	/// 各阶段有记录的直方图的统计摘要, 每个直方图一行, 时间单位为微秒
+	std::string Report() const;
+
+	/**
+	 * @brief 开始定期将统计摘要写入日志
+	 * @param interval 间隔
+	 * @param reset 写入后是否清空直方图
+	 */
+	void StartPeriodicDump(std::chrono::seconds interval, bool reset = false);
+	/// 停止定期写入日志
+	void StopPeriodicDump();
+
+private:
+	std::atomic<bool> enabled_ = false;
+	std::unique_ptr<std::atomic<Exchange>[]> exchanges_;  ///< 以合约ID为下标
+	std::array<std::array<LatencyHistogram, kExchangeCount>, kStageCount> by_exchange_;
+	std::array<std::array<LatencyHistogram, kMaxFronts>, kStageCount> by_front_;
+
+	std::thread dumper_;
+	std::mutex dump_mutex_;
+	std::condition_variable dump_cv_;
+	bool dumping_ = false;
+};
@@ -1,32 +1,94 @@
 ﻿#pragma once
 
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+
 #include <mariadb/conncpp.hpp>
 #include <uts/data_struct.h>
 #include <uts/datarecorder.h>
 
+/// Mariadb 数据记录器的写入方式
+enum class MariadbWriteMode {
+	MultiRowInsert,	 ///< 多行 `INSERT ... VALUES (...),(...)`
+	LoadDataInfile,	 ///< 写入临时文件后以 `LOAD DATA LOCAL INFILE` 导入, 适用于极大的数据量
+};
+
 /**
  * @brief Mariadb 数据记录器，将收到的 `MarketDepth` 信息写入 `CTPTick` 表中
+ * @details 记录线程将数据拼接为一批, 达到 `batch_rows` 行或该批开始已超过 `batch_interval` 时
+ *          交给发送线程, 一批只需一次往返. 发送线程独占数据库连接, 记录线程不等待数据库,
+ *          仅在已有 `kMaxQueuedBatches` 批尚未发送时阻塞, 此时由 `DataRecorder` 的缓冲区吸收数据.
+ *          主键 `(DateTime, ID)` 重复的行被忽略, 不影响同一批的其他行
  */
 class MariadbDataRecorder : public DataRecorder {
 public:
+	/// 等待发送的最大批数
+	static constexpr size_t kMaxQueuedBatches = 4;
+
 	/**
 	 * @brief 构造函数.
 	 * @param addr 数据库地址
 	 * @param db_name 数据库名称
 	 * @param user_name 数据库用户名
 	 * @param password 数据库密码
+	 * @param batch_rows 每批最多写入的行数
+	 * @param batch_interval 每批最长等待时间
+	 * @param mode 写入方式
 	 * @exception std::runtime_error 无法打开数据库错误
 	 */
 	MariadbDataRecorder(const IPAddress& addr, const std::string& db_name, const UserName& user_name,
-						const Password& password);
-	MariadbDataRecorder(const MySQLConnectionInfo& info);
+						const Password& password, size_t batch_rows = 1000,
+						std::chrono::milliseconds batch_interval = std::chrono::milliseconds(200),
+						MariadbWriteMode mode = MariadbWriteMode::MultiRowInsert);
+	MariadbDataRecorder(const MySQLConnectionInfo& info, size_t batch_rows = 1000,
+						std::chrono::milliseconds batch_interval = std::chrono::milliseconds(200),
+						MariadbWriteMode mode = MariadbWriteMode::MultiRowInsert);
 
 	virtual ~MariadbDataRecorder();
 
 protected:
+	/// 追加至当前批
 	void WriteDB(const MarketDepth&) override;
+	/// 一批数据追加至当前批, 达到行数或时长时交给发送线程
+	void WriteDB(std::span<const MarketDepth> data) override;
+	void Flush() override;
+	/// 交出当前批并等待发送线程发送完毕, 上次 `Sync` 后有批写入失败时返回 `false`
+	bool Sync() override;
 
 private:
+	/// 待发送的一批
+	struct Batch {
+		std::string sql;
+		std::filesystem::path file;	 ///< `LOAD DATA LOCAL INFILE` 的数据文件, 发送后删除
+		size_t rows = 0;
+	};
+
 	sql::Connection* conn_ = nullptr;
-	sql::PreparedStatement* insert_stmnt_ = nullptr;
+	const size_t batch_rows_;
+	const std::chrono::milliseconds batch_interval_;
+	const MariadbWriteMode mode_;
+
+	// 当前批, 仅记录线程使用
+	std::string batch_;
+	size_t batch_count_ = 0;
+	std::chrono::steady_clock::time_point batch_start_;
+	uint64_t file_count_ = 0;
+
+	std::thread sender_;
+	std::mutex send_mutex_;
+	std::condition_variable send_cv_;	  ///< 通知发送线程有新批
+	std::condition_variable queue_cv_;	  ///< 通知记录线程队列有空位
+	std::deque<Batch> queue_;
+	bool sending_ = true;
+	bool executing_ = false;	 ///< 发送线程正在发送一批
+	bool send_failed_ = false;	 ///< 上次 `Sync` 后有批写入失败
+
+	void Submit();
+	void Send();
+	bool Execute(const Batch& batch);
 };
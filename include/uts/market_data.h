@@ -6,43 +6,78 @@
 #include <vector>
 
 #include <uts/data_struct.h>
-#include <uts/observer.h>
+#include <uts/eventbus.h>
+#include <uts/snapshotstore.h>
+#include <uts/symboltable.h>
 
 /// 行情源基类. 行情相关类由此派生
 class MarketDataSource {
 public:
-	/// 构造函数
-	MarketDataSource(const std::vector<IPAddress>& server_addr) : server_addr_(server_addr) {}
+	/**
+	 * @brief 构造函数
+	 * @param server_addr 行情服务器地址
+	 * @param snapshot_capacity 行情快照仓库的槽位数量. 不保存行情的行情源可为0
+	 */
+	MarketDataSource(const std::vector<IPAddress>& server_addr, size_t snapshot_capacity = SymbolTable::kCapacity)
+		: server_addr_(server_addr), market_data_(snapshot_capacity) {}
 	virtual ~MarketDataSource() = default;
 
 	/// 是否已登录
 	bool is_logged_in() const { return status_ == ConnectionStatus::Connected; }
 	/// 已订阅合约
 	std::set<Ticker> subscribed_tickers() const { return subscribed_tickers_; }
-	/// 行情
-	std::map<Ticker, MarketDepth>& market_data() { return market_data_; }
+
+	/// 行情快照仓库, 以合约ID为下标, 可读取单个合约或遍历横截面
+	const SnapshotStore<MarketDepth>& snapshots() const { return market_data_; }
+	/**
+	 * @brief 读取单个合约的最新行情
+	 * @param id 合约ID
+	 * @param[out] data 最新行情
+	 * @return 是否有该合约的行情
+	 */
+	bool market_data(SymbolID id, MarketDepth& data) const {
+		return (id < market_data_.capacity()) && market_data_.Load(id, data);
+	}
+	/**
+	 * @brief 读取单个合约的最新行情
+	 * @param ticker 合约代码
+	 * @param[out] data 最新行情
+	 * @return 是否有该合约的行情
+	 */
+	bool market_data(const Ticker& ticker, MarketDepth& data) const {
+		return market_data(SymbolTable::Instance().Find(ticker), data);
+	}
+	/// 设置事件总线, 需在 `LogIn` 前设置. 收到的行情将发布至该总线
+	void SetEventBus(TradingEventBus* event_bus) { event_bus_ = event_bus; }
+
+	/// 最新行情横截面
+	std::map<Ticker, MarketDepth> market_data() const {
+		std::map<Ticker, MarketDepth> ret;
+		market_data_.ForEach([&](size_t, const MarketDepth& data) { ret.emplace(data.instrument_id, data); });
+		return ret;
+	}
 
 	/// 登录
 	virtual void LogIn() = 0;
 	/// 登出
 	virtual void LogOut() = 0;
 
-	/// 订阅合约
-	virtual void Subscribe(const std::vector<Ticker>& ticker_list) = 0;
-	/// 解除订阅
-	virtual void Unsubscribe(const std::vector<Ticker>& ticker_list) = 0;
+	/**
+	 * @brief 订阅合约
+	 * @return 订阅失败的合约
+	 */
+	virtual std::vector<Ticker> Subscribe(const std::vector<Ticker>& ticker_list) = 0;
+	/**
+	 * @brief 解除订阅
+	 * @return 解除订阅失败的合约
+	 */
+	virtual std::vector<Ticker> Unsubscribe(const std::vector<Ticker>& ticker_list) = 0;
 
 protected:
 	std::vector<IPAddress> server_addr_;						///< 行情服务器地址
 	ConnectionStatus status_ = ConnectionStatus::Disconnected;	///< 连接状态
 
-	std::set<Ticker> subscribed_tickers_;		 ///< 已订阅合约
-	std::map<Ticker, MarketDepth> market_data_;	 ///< 最新行情
-};
-
-///	可被观察的行情源
-class ObservableMarketDataSource : public MarketDataSource, public Observable {
-	/// 构造函数
-	ObservableMarketDataSource(const std::vector<IPAddress>& server_addr) : MarketDataSource(server_addr) {}
-	virtual ~ObservableMarketDataSource() = default;
+	std::set<Ticker> subscribed_tickers_;		///< 已订阅合约
+	SnapshotStore<MarketDepth> market_data_;	///< 最新行情, 以合约ID为下标
+	TradingEventBus* event_bus_ = nullptr;		///< 事件总线
 };
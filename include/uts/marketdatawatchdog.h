@@ -0,0 +1,165 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include <uts/data_struct.h>
+#include <uts/eventbus.h>
+#include <uts/market_data.h>
+#include <uts/timerwheel.h>
+
+/// 交易时段, 以北京时间的日内时刻(纳秒)表示. 收盘早于开盘时跨越午夜, 如夜盘21:00至次日02:30
+struct TradingSession {
+	Timestamp open;	  ///< 开盘
+	Timestamp close;  ///< 收盘
+
+	bool operator==(const TradingSession&) const = default;
+};
+/// 一个交易日的各交易时段. 为空时不区分时段, 任何时间都视为交易中
+using TradingSessions = std::vector<TradingSession>;
+
+/// 北京时间的日内时刻(纳秒)
+constexpr Timestamp TimeOfDay(int hour, int minute) { return (hour * 60LL + minute) * 60 * 1'000'000'000LL; }
+
+/// 商品期货日盘
+inline const TradingSessions kFuturesDaySessions = {{TimeOfDay(9, 0), TimeOfDay(10, 15)},
+													{TimeOfDay(10, 30), TimeOfDay(11, 30)},
+													{TimeOfDay(13, 30), TimeOfDay(15, 0)}};
+/// 股指期货
+inline const TradingSessions kIndexFuturesSessions = {{TimeOfDay(9, 30), TimeOfDay(11, 30)},
+													  {TimeOfDay(13, 0), TimeOfDay(15, 0)}};
+
+/**
+ * @brief 某时刻所在交易时段的开盘时间
+ * @details 只有周一至周五开盘, 跨越午夜的时段属于开盘当天. 不考虑节假日
+ * @return 开盘时间, 不在交易时段内时为空. 时段为空时返回 `Timestamp` 的最小值
+ */
+std::optional<Timestamp> SessionOpenTime(const TradingSessions& sessions, Timestamp ts) noexcept;
+/// 某时刻之后最近的开盘时间. 时段为空时返回 `ts`
+Timestamp NextSessionOpenTime(const TradingSessions& sessions, Timestamp ts) noexcept;
+
+/// 行情看门狗的合约监视规则
+struct WatchdogRule {
+	Timestamp max_interval = 60'000'000'000LL;		///< 交易时段内相邻两笔行情的最长间隔(纳秒)
+	TradingSessions sessions = kFuturesDaySessions;	///< 交易时段
+
+	bool operator==(const WatchdogRule&) const = default;
+};
+
+/**
+ * @brief 行情看门狗
+ *
+ * 从事件总线接收行情, 记录每个监视合约最近一笔行情的本地接收时间, 在交易时段内超过预期间隔没有行情时发布
+ * `MarketDataAlertType::InstrumentStale`, 重新收到行情时发布 `MarketDataAlertType::InstrumentResumed`.
+ * 整个行情源(或 `SetFrontCounters` 提供的各前置)在交易时段内超过 `front_timeout` 没有行情时发布前置告警.
+ *
+ * 每笔行情只写入该合约独占缓存行中的时间戳, 不加锁, 不触碰定时器. 各合约的检查时间挂在分层时间轮上,
+ * 到期时按最近行情时间推迟, 每个合约每个间隔至多重设一次定时器, 订阅上万个合约时也没有逐笔的堆操作.
+ * 检查由内部定时器按本地时钟进行, 也可调用 `Check` 按给定时间检查.
+ * @note 告警在持有内部锁时发布, 告警的处理函数不可回调本类. 合约恢复告警在行情线程中发布
+ */
+class MarketDataWatchdog {
+public:
+	/**
+	 * @brief 构造函数
+	 * @param event_bus 事件总线. 从其接收行情并向其发布告警
+	 * @param front_timeout 前置在交易时段内没有任何行情的最长时长(纳秒)
+	 * @param timer_interval 定时检查间隔(毫秒)
+	 */
+	MarketDataWatchdog(TradingEventBus& event_bus, Timestamp front_timeout = 10'000'000'000LL,
+					   int timer_interval = 100);
+	MarketDataWatchdog(const MarketDataWatchdog&) = delete;
+	MarketDataWatchdog& operator=(const MarketDataWatchdog&) = delete;
+	~MarketDataWatchdog();
+
+	/**
+	 * @brief 开始监视合约. 已监视的合约改用新规则
+	 * @param ticker 合约代码
+	 * @param rule 监视规则
+	 * @param now 开始监视的时间. 为0时取当前时间
+	 * @return 是否成功. 符号表已满时失败
+	 */
+	bool Watch(const Ticker& ticker, const WatchdogRule& rule = {}, Timestamp now = 0);
+	/**
+	 * @brief 监视行情源已订阅的所有合约
+	 * @return 无法监视的合约
+	 */
+	std::vector<Ticker> Watch(const MarketDataSource& source, const WatchdogRule& rule = {}, Timestamp now = 0);
+	/// 停止监视合约
+	void Unwatch(const Ticker& ticker);
+
+	/**
+	 * @brief 设置各前置的累计行情笔数, 用于分别判断各前置是否静默
+	 * @details 未设置时整个行情源视为序号为0的一个前置. 如冗余前置可传入读取 `front_statistics` 中 `ticks` 的函数
+	 * @param counters 返回各前置累计行情笔数的函数, 在检查线程中调用
+	 */
+	void SetFrontCounters(std::function<std::vector<uint64_t>()> counters);
+
+	/// 处理一笔行情. 通常由事件总线调用
+	void OnMarketData(const MarketDepth& md);
+	/**
+	 * @brief 检查到期的合约和前置
+	 * @param now 当前时间. 为0时取当前时间
+	 */
+	void Check(Timestamp now = 0);
+
+	/// 监视中的合约数量
+	size_t watched_count() const { return watched_count_.load(std::memory_order_relaxed); }
+	/// 处于告警状态的合约数量
+	size_t stale_count() const { return stale_count_.load(std::memory_order_relaxed); }
+	/// 合约是否处于告警状态
+	bool stale(SymbolID id) const {
+		return (id < SymbolTable::kCapacity) && states_[id].stale.load(std::memory_order_relaxed);
+	}
+
+private:
+	/// 单个合约的监视状态, 独占一条缓存行
+	struct alignas(64) InstrumentState {
+		std::atomic<Timestamp> last_tick = 0;  ///< 最近一笔行情的本地接收时间. 由行情线程写入
+		std::atomic<bool> watched = false;
+		std::atomic<bool> stale = false;
+		Timestamp armed = 0;  ///< 开始监视的时间
+		uint32_t rule = 0;	  ///< `rules_` 下标
+	};
+	/// 单个前置的监视状态
+	struct FrontState {
+		uint64_t ticks = 0;		 ///< 上次检查时的累计行情笔数
+		Timestamp last_tick = 0;  ///< 最近一次观察到行情的时间
+		bool silent = false;
+	};
+	/// 整个行情源的最近行情时间的写入粒度, 避免各行情线程逐笔写入同一缓存行
+	static constexpr Timestamp kFeedTickGranularity = 1'000'000LL;
+
+	TradingEventBus& event_bus_;
+	int subscription_;
+	const Timestamp front_timeout_;
+	const int timer_interval_;
+
+	std::unique_ptr<InstrumentState[]> states_;	 ///< 以合约ID为下标
+	std::atomic<size_t> watched_count_ = 0;
+	std::atomic<size_t> stale_count_ = 0;
+	alignas(64) std::atomic<Timestamp> feed_tick_ = 0;	///< 整个行情源的最近行情时间
+
+	std::mutex mutex_;
+	TimerWheel wheel_;
+	std::vector<WatchdogRule> rules_;
+	std::vector<FrontState> fronts_ = std::vector<FrontState>(1);
+	std::function<std::vector<uint64_t>()> front_counters_;
+
+	std::thread timer_;
+	std::condition_variable timer_cv_;
+	bool running_ = true;
+
+	void WatchLocked(SymbolID id, uint32_t rule, Timestamp now);
+	uint32_t RuleIndex(const WatchdogRule& rule);
+	void Expire(SymbolID id, Timestamp now);
+	void CheckFronts(Timestamp now);
+	void TimerLoop();
+};
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+#include <uts/data_struct.h>
+#include <uts/symboltable.h>
+
+/**
+ * @brief 按缓存行排布的定长盘口行情
+ *
+ * 可平凡复制, 按缓存行对齐. 最常读取的合约ID, 时间, 最新价和一档量价集中在第一条缓存行,
+ * 其余字段及第二档起的盘口排在之后. 价格和数量分列存放, 不因 `PriceVolume` 的对齐产生空洞.
+ * 不含合约代码, 需要时由 `SymbolTable` 根据合约ID查得.
+ * 多数期货只需一档行情, 以 `MarketDepthT<1>` 缓存全市场时, 每个合约只占3条缓存行.
+ * @tparam Levels 盘口档数
+ */
+template <size_t Levels>
+requires(Levels >= 1)
+struct alignas(64) MarketDepthT {
+	/// 盘口档数
+	static constexpr size_t kLevels = Levels;
+
+	SymbolID symbol_id;		  ///< 合约ID
+	int trading_day;		  ///< 交易日(YYYYMMDD)
+	Timestamp exchange_time;  ///< 交易所更新时间
+	Timestamp local_time;	  ///< 本地接收时间
+	Price last;				  ///< 最新价
+	Price bid_price1;		  ///< 买一价
+	Price ask_price1;		  ///< 卖一价
+	Volume bid_volume1;		  ///< 买一量
+	Volume ask_volume1;		  ///< 卖一量
+	Volume volume;			  ///< 区间成交量
+	Volume open_interest;	  ///< 持仓量
+
+	Turnover turnover;	  ///< 区间成交额
+	Price open;			  ///< 区间开盘价
+	Price high;			  ///< 区间最高价
+	Price low;			  ///< 区间最低价
+	Price close;		  ///< 收盘价
+	Price settle;		  ///< 结算价
+	Price average_price;  ///< 均价
+	Price upper_limit;	  ///< 涨停价
+	Price lower_limit;	  ///< 跌停价
+	Delta delta;		  ///< 期权Delta
+
+	std::array<Price, Levels - 1> bid_prices;	///< 买二价起
+	std::array<Price, Levels - 1> ask_prices;	///< 卖二价起
+	std::array<Volume, Levels - 1> bid_volumes;	///< 买二量起
+	std::array<Volume, Levels - 1> ask_volumes;	///< 卖二量起
+
+	/// 第 `level` 档竞买, 从0开始
+	PriceVolume bid(size_t level) const {
+		return level == 0 ? PriceVolume{bid_price1, bid_volume1}
+						  : PriceVolume{bid_prices[level - 1], bid_volumes[level - 1]};
+	}
+	/// 第 `level` 档竞卖, 从0开始
+	PriceVolume ask(size_t level) const {
+		return level == 0 ? PriceVolume{ask_price1, ask_volume1}
+						  : PriceVolume{ask_prices[level - 1], ask_volumes[level - 1]};
+	}
+
+	/// 由 `MarketDepth` 转换. 超出 `Levels` 的档位被舍弃
+	static MarketDepthT From(const MarketDepth& md) {
+		MarketDepthT ret{.symbol_id = md.symbol_id,
+						 .trading_day = md.trading_day,
+						 .exchange_time = md.exchange_time,
+						 .local_time = md.local_time,
+						 .last = md.ohlclvt.last,
+						 .bid_price1 = md.bid[0].price,
+						 .ask_price1 = md.ask[0].price,
+						 .bid_volume1 = md.bid[0].volume,
+						 .ask_volume1 = md.ask[0].volume,
+						 .volume = md.ohlclvt.volume,
+						 .open_interest = md.open_interest,
+						 .turnover = md.ohlclvt.turnover,
+						 .open = md.ohlclvt.open,
+						 .high = md.ohlclvt.high,
+						 .low = md.ohlclvt.low,
+						 .close = md.ohlclvt.close,
+						 .settle = md.settle,
+						 .average_price = md.average_price,
+						 .upper_limit = md.upper_limit,
+						 .lower_limit = md.lower_limit,
+						 .delta = md.delta,
+						 .bid_prices = {},
+						 .ask_prices = {},
+						 .bid_volumes = {},
+						 .ask_volumes = {}};
+		for (size_t level = 1; level < std::min(Levels, md.bid.size()); ++level) {
+			ret.bid_prices[level - 1] = md.bid[level].price;
+			ret.ask_prices[level - 1] = md.ask[level].price;
+			ret.bid_volumes[level - 1] = md.bid[level].volume;
+			ret.ask_volumes[level - 1] = md.ask[level].volume;
+		}
+		return ret;
+	}
+
+	/// 转换为 `MarketDepth`. 合约代码由 `SymbolTable` 查得, 不足的档位为0
+	MarketDepth ToMarketDepth() const {
+		MarketDepth md{};
+		if (symbol_id < SymbolTable::Instance().size()) {
+			const Ticker& name = SymbolTable::Instance().Name(symbol_id);
+			std::memcpy(md.instrument_id, name.data(), std::min(name.size(), sizeof(md.instrument_id) - 1));
+		}
+		md.symbol_id = symbol_id;
+		md.trading_day = trading_day;
+		md.exchange_time = exchange_time;
+		md.local_time = local_time;
+		md.ohlclvt = {.open = open,
+					  .high = high,
+					  .low = low,
+					  .close = close,
+					  .last = last,
+					  .volume = volume,
+					  .turnover = turnover};
+		md.settle = settle;
+		md.open_interest = open_interest;
+		md.average_price = average_price;
+		md.upper_limit = upper_limit;
+		md.lower_limit = lower_limit;
+		md.delta = delta;
+		for (size_t level = 0; level < std::min(Levels, md.bid.size()); ++level) {
+			md.bid[level] = bid(level);
+			md.ask[level] = ask(level);
+		}
+		return md;
+	}
+};
+
+using MarketDepthL1 = MarketDepthT<1>;	///< 一档行情
+using MarketDepthL5 = MarketDepthT<5>;	///< 五档行情
+
+static_assert(std::is_trivially_copyable_v<MarketDepthL1> && std::is_trivially_copyable_v<MarketDepthL5>);
+static_assert(offsetof(MarketDepthL1, turnover) == 64, "hot fields must fill exactly the first cache line");
+static_assert(sizeof(MarketDepthL1) == 192);
+static_assert(sizeof(MarketDepthL5) == 256);
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <uts/data_struct.h>
+
+/// 期权的隐含波动率和希腊字母. 无法计算时为NaN
+struct OptionGreeks {
+	double iv;	   ///< 隐含波动率(年化)
+	double delta;  ///< Delta
+	double gamma;  ///< Gamma, 标的价格变动1时Delta的变动
+	double vega;   ///< Vega, 波动率变动1(即100%)时期权价格的变动
+};
+
+/**
+ * @brief 同一标的同一到期日的一组期权, 按列存放
+ *
+ * 输入为标的价格, 剩余期限, 无风险利率, 以及每个期权的行权价, 方向和价格.
+ * `SolveOptionBatch` 对整列一次求解, 结果写回同一结构.
+ */
+struct OptionBatch {
+	double forward = 0;			///< 标的价格
+	double time_to_expiry = 0;	///< 剩余期限(年)
+	double rate = 0;			///< 无风险利率(连续复利)
+
+	std::vector<double> strike;	 ///< 行权价
+	std::vector<double> sign;	 ///< 看涨为1, 看跌为-1
+	std::vector<double> price;	 ///< 期权价格, 无价格时为NaN
+
+	std::vector<double> iv;		///< 隐含波动率
+	std::vector<double> delta;	///< Delta
+	std::vector<double> gamma;	///< Gamma
+	std::vector<double> vega;	///< Vega
+
+	/// 期权数量
+	size_t size() const { return strike.size(); }
+	/// 调整期权数量, 输出列同时调整
+	void resize(size_t n);
+};
+
+/**
+ * @brief 以Black-76模型批量求解隐含波动率和希腊字母
+ * @details 以Vega最大处的波动率为初值(平值期权取Brenner-Subrahmanyam近似), 所有期权同步进行牛顿迭代, 直至整列收敛或达到迭代上限.
+ *          各循环按列处理且无分支, 便于编译器向量化.
+ *          价格不高于内在价值, 不低于上界或缺失时, 该期权的结果为NaN
+ */
+void SolveOptionBatch(OptionBatch& batch);
+
+/**
+ * @brief 期权链索引
+ *
+ * 按 标的 - 到期日 - 行权价 组织期权合约, 每个到期日的期权按行权价排序, 看涨期权在前, 看跌期权在后, 连续存放于一个 `OptionBatch`.
+ * 合约ID到到期日及位置的映射以合约ID为下标, 行情更新为O(1).
+ * 行情只更新价格并标记所在到期日, `Recompute` 时每个有变化的到期日整列求解一次.
+ * 行情源可通过 `Enrich` 在发布期权行情前写入计算的Delta.
+ * @note 非线程安全. 通常在同一线程中依次调用 `OnMarketData` 和 `Recompute`
+ */
+class OptionChain {
+public:
+	/// 同一标的同一到期日的期权
+	struct Expiry {
+		SymbolID underlying;			///< 标的合约ID
+		int expire_date;				///< 到期日(YYYYMMDD)
+		Timestamp expire_time;			///< 到期时间, 到期日15:00
+		std::vector<Strike> strikes;	///< 行权价, 升序
+		std::vector<SymbolID> calls;	///< 各行权价的看涨期权, 缺失时为 `kInvalidSymbol`
+		std::vector<SymbolID> puts;		///< 各行权价的看跌期权, 缺失时为 `kInvalidSymbol`
+		OptionBatch batch;				///< 第i个行权价的看涨期权位于i, 看跌期权位于 strikes.size() + i
+		bool dirty = false;				///< 价格变化后尚未重新计算
+	};
+
+	/**
+	 * @brief 构造函数
+	 * @param rate 无风险利率(连续复利)
+	 */
+	explicit OptionChain(double rate = 0) : rate_(rate) {}
+
+	/// 登记期权合约. 非期权或缺少标的, 到期日的合约被忽略
+	void AddOption(const InstrumentInfo& info);
+	/// 登记所有期权合约
+	void AddOptions(const std::map<Ticker, InstrumentInfo>& instruments);
+
+	/**
+	 * @brief 处理一笔行情
+	 * @details 期权行情更新其价格, 标的行情更新其所有到期日的标的价格. 价格取买一卖一中间价, 缺少一侧时取最新价
+	 */
+	void OnMarketData(const MarketDepth& md);
+	/**
+	 * @brief 处理一笔行情, 期权行情立即重新计算其所在到期日, 并将计算的Delta写入 `md.delta`
+	 * @details 供行情源在保存快照和发布行情前调用. 标的行情只标记其到期日, 在下一笔期权行情或 `Recompute` 时计算.
+	 *          无法求解时保留 `md.delta` 原值
+	 */
+	void Enrich(MarketDepth& md);
+	/**
+	 * @brief 重新计算价格有变化的到期日
+	 * @param now 计算剩余期限的时间. 为0时取最近一笔行情的交易所时间
+	 * @return 重新计算的到期日数量
+	 */
+	size_t Recompute(Timestamp now = 0);
+
+	/**
+	 * @brief 读取期权最近一次计算的结果
+	 * @return 是否为已登记的期权
+	 */
+	bool greeks(SymbolID option, OptionGreeks& greeks) const;
+	/// 标的的所有到期日, 按到期日升序
+	std::vector<const Expiry*> expiries(SymbolID underlying) const;
+	/// 已登记的到期日数量
+	size_t expiry_count() const { return expiries_.size(); }
+
+private:
+	/// 合约在期权链中的位置
+	struct Slot {
+		static constexpr uint32_t kNone = std::numeric_limits<uint32_t>::max();
+		uint32_t expiry = kNone;	///< 期权所在到期日
+		uint32_t position = kNone;	///< 期权在到期日中的位置
+		std::vector<uint32_t> underlying_of;  ///< 以该合约为标的的到期日
+	};
+
+	double rate_;
+	Timestamp clock_ = 0;  ///< 最近一笔行情的交易所时间
+	std::vector<Expiry> expiries_;
+	std::map<std::pair<SymbolID, int>, uint32_t> expiry_index_;	 ///< (标的, 到期日) -> 到期日
+	std::vector<Slot> slots_;										 ///< 以合约ID为下标
+
+	Slot& slot(SymbolID id);
+	/// 按行权价重排到期日的价格列, 更新其期权的位置
+	void Reindex(uint32_t expiry_index);
+	void Solve(Expiry& expiry, Timestamp now);
+};
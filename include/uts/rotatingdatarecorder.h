@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
+#include <thread>
+
+#include <uts/data_struct.h>
+#include <uts/datarecorder.h>
+#include <uts/marketdatawatchdog.h>
+
+/// 按交易日记录行情的默认时段: 集合竞价至收盘后1分钟, 覆盖商品期货夜盘, 股指及国债期货
+inline const TradingSessions kRecordingSessions = {{TimeOfDay(20, 55), TimeOfDay(2, 31)},
+												   {TimeOfDay(8, 55), TimeOfDay(11, 31)},
+												   {TimeOfDay(13, 0), TimeOfDay(15, 16)}};
+
+/**
+ * @brief 按交易日轮换的数据记录器，每个交易日的行情写入各自的数据记录器(如各自的 `.sqlite3` 文件)
+ * @details 收到交易日更晚的行情时即以 `factory` 创建新交易日的数据记录器, 之后的行情直接写入新记录器, 切换时没有
+ *          空档. 前一交易日的记录器再保留 `compaction_delay` 以接收迟到的行情, 之后由后台整理线程写完其缓冲区并
+ *          析构, 再调用 `compactor` 整理该交易日的文件(如建立索引, `VACUUM`/`ANALYZE`, 转换为压缩格式).
+ *          整理线程以最低的 CPU 和 I/O 优先级运行(Linux), 不影响实时记录.
+ *          转发行情时只持有共享锁, `factory` 在锁外调用且每个交易日只调用一次, 统计和整理不阻塞行情.
+ *          交易时段之外的行情, 已整理的交易日的迟到行情被丢弃并计入 `dropped`, 已整理的交易日不再重新打开.
+ *          停止时当前交易日不整理, 重新启动后可继续追加
+ */
+class RotatingDataRecorder : public DataRecorder {
+public:
+	/// 创建某交易日的数据记录器
+	using RecorderFactory = std::function<std::unique_ptr<DataRecorder>(int trading_day)>;
+	/// 整理某交易日已关闭的文件
+	using Compactor = std::function<void(int trading_day)>;
+
+	/**
+	 * @brief 构造函数
+	 * @param factory 数据记录器的构造函数, 在 `DataSink` 的调用线程中持有创建锁, 不持有共享锁时调用
+	 * @param compactor 整理函数, 为空时只关闭前一交易日的记录器
+	 * @param compaction_delay 轮换后等待迟到行情的时间
+	 * @param sessions 记录的交易时段, 交易时段之外的行情被丢弃. 为空时不过滤
+	 */
+	explicit RotatingDataRecorder(const RecorderFactory& factory, const Compactor& compactor = {},
+								  std::chrono::milliseconds compaction_delay = std::chrono::minutes(1),
+								  TradingSessions sessions = kRecordingSessions);
+	~RotatingDataRecorder() override;
+
+	/// 当前交易日, 尚未收到行情时为0
+	int trading_day() const;
+
+	void DataSink(const MarketDepth& data) override;
+	/// 各交易日记录器统计之和, `dropped` 另含交易时段之外及已整理的交易日的行情
+	RecorderStatistics statistics() const override;
+	/// 停止当前交易日的记录器, 立即关闭并整理之前的交易日
+	void Stop() override;
+
+	/**
+	 * @brief 交易日的文件名称, 在扩展名前加入交易日, 如 `tick.sqlite3` 在 20210601 为 `tick_20210601.sqlite3`
+	 * @param filename 文件名称
+	 * @param trading_day 交易日(YYYYMMDD)
+	 */
+	static std::filesystem::path FileName(const std::filesystem::path& filename, int trading_day);
+
+protected:
+	void WriteDB(const MarketDepth&) override {}
+
+private:
+	/// 已轮换出的交易日
+	struct Retired {
+		int trading_day;
+		std::unique_ptr<DataRecorder> recorder;
+		std::chrono::steady_clock::time_point compact_time;	 ///< 开始整理的时间
+	};
+
+	const RecorderFactory factory_;
+	const Compactor compactor_;
+	const std::chrono::milliseconds compaction_delay_;
+	const TradingSessions sessions_;
+
+	/// 创建新交易日的记录器时持有, 保证每个交易日只调用一次 `factory`. 先于 `mutex_` 获取
+	std::mutex create_mutex_;
+	/// 保护以下成员. 转发行情和统计时持有共享锁, 轮换及取出待整理的记录器时持有独占锁
+	mutable std::shared_mutex mutex_;
+	int trading_day_ = 0;
+	std::unique_ptr<DataRecorder> current_;
+	std::deque<Retired> retired_;
+	std::set<int> compacted_;	 ///< 本进程中已整理的交易日
+	RecorderStatistics closed_;	 ///< 已关闭的记录器的统计之和
+	bool working_ = true;
+	std::atomic<uint64_t> dropped_ = 0;	 ///< 无法写入任何记录器而丢弃的行情
+
+	std::thread compaction_thread_;
+	std::condition_variable_any cv_;
+
+	/// 行情是否在其交易日的交易时段内
+	bool InSession(const MarketDepth& data) const;
+	/// 持有共享锁时写入当前或前一交易日的记录器, 需要轮换时返回 `false`
+	bool Forward(const MarketDepth& data);
+	void Drop(const char* reason, const MarketDepth& data);
+	std::unique_ptr<DataRecorder> Create(int trading_day);
+	void Rotate(int trading_day, std::unique_ptr<DataRecorder> recorder);
+	void CompactionLoop();
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include <uts/data_struct.h>
+#include <uts/datarecorder.h>
+
+/**
+ * @brief 分片数据记录器，按合约代码的哈希值将行情分发给多个数据记录器并行写入
+ * @details 每个分片是一个独立的数据记录器, 有各自的记录线程和输出(如各自的 `.sqlite3` 文件或归档目录).
+ *          同一合约总是写入同一分片, 因此合约内的行情保持收到的顺序. 分片由 `SymbolTable::Hash` 决定,
+ *          分片数不变时跨进程稳定, 可向已有的分片追加
+ */
+class ShardedDataRecorder : public DataRecorder {
+public:
+	/// 创建第 `shard` 个分片的数据记录器
+	using ShardFactory = std::function<std::unique_ptr<DataRecorder>(size_t shard)>;
+
+	/**
+	 * @brief 构造函数
+	 * @param shard_count 分片数, 通常不超过CPU核数
+	 * @param factory 分片数据记录器的构造函数
+	 * @exception std::invalid_argument 分片数为0
+	 */
+	ShardedDataRecorder(size_t shard_count, const ShardFactory& factory);
+	~ShardedDataRecorder() override;
+
+	/// 分片数
+	size_t shard_count() const noexcept { return shards_.size(); }
+	/// 合约所在的分片
+	size_t Shard(std::string_view instrument_id) const noexcept;
+	/// 第 `index` 个分片的数据记录器
+	DataRecorder& shard(size_t index) { return *shards_.at(index); }
+
+	void DataSink(const MarketDepth& data) override;
+	/**
+	 * @brief 设置各分片的缓冲区容量及其已满时的处理方式, 需在 `DataSink` 前调用
+	 * @param capacity 每个分片的缓冲区容量
+	 * @param policy 缓冲区已满时的处理方式
+	 * @param spill_file 转存文件, 仅 `BackpressurePolicy::SpillToDisk` 使用. 各分片使用 `ShardFileName` 的转存文件
+	 * @exception InvalidOperationError 分片的缓冲区中仍有未写入的数据
+	 * @exception IOError 无法打开转存文件
+	 */
+	void SetBackpressurePolicy(size_t capacity, BackpressurePolicy policy,
+							   const std::filesystem::path& spill_file = {}) override;
+	/// 各分片统计之和
+	RecorderStatistics statistics() const override;
+	/// 写完各分片缓冲区中的数据后停止各分片的记录线程
+	void Stop() override;
+
+	/**
+	 * @brief 分片的文件名称, 在扩展名前加入分片序号, 如 `ticks.sqlite3` 的第2个分片为 `ticks_2.sqlite3`
+	 * @param filename 合并后的文件名称
+	 * @param shard 分片序号
+	 */
+	static std::filesystem::path ShardFileName(const std::filesystem::path& filename, size_t shard);
+
+protected:
+	void WriteDB(const MarketDepth&) override {}
+	/// 设置各分片的记录线程空闲多久后调用 `Flush`
+	void set_flush_interval(std::chrono::milliseconds interval) override;
+
+private:
+	std::vector<std::unique_ptr<DataRecorder>> shards_;
+};
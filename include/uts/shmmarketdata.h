@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <uts/eventbus.h>
+#include <uts/market_data.h>
+#include <uts/shmtickring.h>
+
+/**
+ * @brief 行情网关
+ *
+ * 从事件总线接收行情并写入共享内存, 供同机的其他进程以 `ShmMarketData` 读取.
+ * 持有CTP行情连接的进程将行情源的事件总线交给本类, 其余进程不再各自登录和订阅.
+ * @note 多个行情线程(如冗余前置)并发发布时, 写入由内部锁串行化
+ */
+class ShmTickGateway {
+public:
+	/**
+	 * @brief 构造函数
+	 * @param event_bus 事件总线. 从其接收行情
+	 * @param name 共享内存名称, 不含 `/dev/shm/` 前缀
+	 * @param capacity 缓冲区行情笔数
+	 */
+	ShmTickGateway(TradingEventBus& event_bus, const std::string& name, size_t capacity = 1 << 16);
+	ShmTickGateway(const ShmTickGateway&) = delete;
+	ShmTickGateway& operator=(const ShmTickGateway&) = delete;
+	~ShmTickGateway();
+
+	/// 处理一笔行情. 通常由事件总线调用
+	void OnMarketData(const MarketDepth& md);
+	/// 已写入的行情笔数
+	uint64_t published() const noexcept { return writer_.write_sequence(); }
+
+private:
+	TradingEventBus& event_bus_;
+	int subscription_;
+	std::mutex mutex_;
+	ShmTickWriter writer_;
+};
+
+/**
+ * @brief 共享内存行情源
+ *
+ * 从 `ShmTickGateway` 写入的共享内存读取行情, 接口与其他行情源相同, 策略进程可直接替换 `CTPMarketData`.
+ * `LogIn` 映射共享内存并启动读取线程, 已订阅合约的行情存入快照仓库并发布至事件总线.
+ * `Subscribe` 只在本进程内过滤, 网关须已订阅所需合约.
+ * 读取线程被网关套圈时记录警告并跳至最新位置; 网关重启(包括崩溃后重启)后, 空闲时每秒检查一次并自动重新映射.
+ */
+class ShmMarketData : public MarketDataSource {
+public:
+	/**
+	 * @brief 构造函数
+	 * @param name 共享内存名称, 不含 `/dev/shm/` 前缀
+	 * @param idle_sleep 无新行情时的休眠时长(微秒), 为0时只让出CPU
+	 */
+	explicit ShmMarketData(const std::string& name, int idle_sleep = 50);
+	ShmMarketData(const ShmMarketData&) = delete;
+	ShmMarketData& operator=(const ShmMarketData&) = delete;
+	~ShmMarketData();
+
+	/**
+	 * @brief 映射共享内存并开始读取
+	 * @exception IOError 网关未启动
+	 */
+	void LogIn() override;
+	/// 停止读取
+	void LogOut() override;
+
+	std::vector<Ticker> Subscribe(const std::vector<Ticker>& ticker_list) override;
+	std::vector<Ticker> Unsubscribe(const std::vector<Ticker>& ticker_list) override;
+
+	/// 被网关套圈的次数
+	uint64_t lapped() const noexcept { return lapped_.load(std::memory_order_relaxed); }
+	/// 因被套圈而丢失的行情笔数
+	uint64_t dropped() const noexcept { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+	std::string name_;
+	const int idle_sleep_;
+	std::unique_ptr<ShmTickReader> reader_;
+	std::unique_ptr<std::atomic<bool>[]> subscribed_;  ///< 以合约ID为下标
+
+	std::thread poller_;
+	std::atomic<bool> running_ = false;
+	std::atomic<uint64_t> lapped_ = 0;
+	std::atomic<uint64_t> dropped_ = 0;
+
+	void PollLoop();
+};
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <uts/data_struct.h>
+#include <uts/marketdepth.h>
+
+/**
+ * @brief 共享内存行情环形缓冲区的布局
+ *
+ * 位于 `/dev/shm/<name>`, 由一个头部和 `capacity` 个槽位组成. 只有一个写进程, 可有任意多个读进程.
+ * 每个槽位由序号保护: 写入第n笔行情前将序号置为 2n+1, 写完后置为 2n+2. 读进程复制前后序号均为 2n+2 才算读到第n笔,
+ * 否则说明该槽位已被之后的行情覆盖, 即读进程被套圈. 写进程从不等待读进程.
+ * 合约ID只在进程内有效, 槽位同时保存合约代码, 由读进程登记到自己的 `SymbolTable`.
+ */
+namespace shm_tick {
+/// 魔数 "UTSTICK1"
+constexpr uint64_t kMagic = 0x314B434954535455ULL;
+/// 布局版本, 布局变化时递增
+constexpr uint32_t kVersion = 1;
+
+/// 头部, 独占一条缓存行
+struct alignas(64) Header {
+	std::atomic<uint64_t> magic;			///< 魔数, 其余字段就绪后最后写入
+	uint32_t version;						///< 布局版本
+	uint32_t slot_size;						///< 槽位大小
+	uint64_t capacity;						///< 槽位数量, 2的整数次幂
+	int64_t session;						///< 写进程创建缓冲区的时间, 用于识别写进程重启
+	std::atomic<uint64_t> write_sequence;	///< 已写入的行情笔数
+	std::atomic<uint32_t> closed;			///< 写进程是否已退出
+};
+
+/// 槽位
+struct alignas(64) Slot {
+	std::atomic<uint64_t> sequence;	 ///< 序号
+	char instrument_id[32];			 ///< 合约代码
+	MarketDepthL5 tick;				 ///< 行情
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+			  "atomics in shared memory must be lock free");
+static_assert(sizeof(Header) == 64);
+static_assert(sizeof(Slot) == 320);
+}  // namespace shm_tick
+
+/**
+ * @brief 共享内存行情写入端
+ *
+ * 创建(或重建) `/dev/shm/<name>` 并写入行情. 析构时标记已退出并删除该名称, 已映射的读进程可继续读完剩余行情.
+ * @note 非线程安全, 多个线程写入时需由调用方加锁
+ */
+class ShmTickWriter {
+public:
+	/**
+	 * @brief 构造函数
+	 * @param name 共享内存名称, 不含 `/dev/shm/` 前缀
+	 * @param capacity 槽位数量, 向上取整为2的整数次幂
+	 * @exception std::system_error 无法创建或映射共享内存
+	 */
+	ShmTickWriter(const std::string& name, size_t capacity);
+	ShmTickWriter(const ShmTickWriter&) = delete;
+	ShmTickWriter& operator=(const ShmTickWriter&) = delete;
+	~ShmTickWriter();
+
+	/// 写入一笔行情
+	void Publish(const MarketDepth& md) noexcept;
+
+	/// 槽位数量
+	size_t capacity() const noexcept { return capacity_; }
+	/// 已写入的行情笔数
+	uint64_t write_sequence() const noexcept { return header_->write_sequence.load(std::memory_order_relaxed); }
+
+private:
+	std::string name_;
+	size_t capacity_;
+	size_t mapped_size_;
+	shm_tick::Header* header_;
+	shm_tick::Slot* slots_;
+};
+
+/// 共享内存行情读取结果
+enum class ShmReadResult {
+	Ok,		 ///< 读到一笔行情
+	Empty,	 ///< 没有新行情
+	Lapped,	 ///< 被写进程套圈, 已跳至最新位置, 期间的行情丢失
+	Restarted,	///< 写进程已重建缓冲区, 已重新映射, 之后从新缓冲区的起点读取
+};
+
+/**
+ * @brief 共享内存行情读取端
+ *
+ * 映射写进程创建的共享内存并顺序读取. 读取不加锁, 不写共享内存, 因此不会阻塞写进程, 也不影响其他读进程.
+ * 读得太慢而被套圈时, 跳至写进程的最新位置继续读取, 丢失的笔数计入 `dropped`.
+ * 写进程重启时会以同一名称重建缓冲区. 没有新行情且距上次检查超过 `kReattachInterval` (写进程已退出时为其1/10)时,
+ * `Read` 以 `Reattach` 比较新缓冲区的 `session`, 不同则重新映射并返回 `ShmReadResult::Restarted`.
+ * @note 非线程安全, 每个读线程应使用各自的实例
+ */
+class ShmTickReader {
+public:
+	/**
+	 * @brief 构造函数
+	 * @param name 共享内存名称, 不含 `/dev/shm/` 前缀
+	 * @param from_start 是否从缓冲区中仍保留的最早一笔开始读取. 否则只读取之后写入的行情
+	 * @exception IOError 共享内存不存在
+	 * @exception std::system_error 无法映射共享内存或布局不匹配
+	 */
+	explicit ShmTickReader(const std::string& name, bool from_start = false);
+	ShmTickReader(const ShmTickReader&) = delete;
+	ShmTickReader& operator=(const ShmTickReader&) = delete;
+	~ShmTickReader();
+
+	/**
+	 * @brief 读取下一笔行情
+	 * @param[out] md 读到的行情, 合约ID为本进程 `SymbolTable` 中的ID. 只在返回 `ShmReadResult::Ok` 时写入
+	 */
+	ShmReadResult Read(MarketDepth& md);
+
+	/// 尚未读取的行情笔数. 大于 `capacity` 时已被套圈
+	uint64_t backlog() const noexcept { return header_->write_sequence.load(std::memory_order_acquire) - next_; }
+	/// 被套圈的次数
+	uint64_t lapped() const noexcept { return lapped_; }
+	/// 因被套圈而丢失的行情笔数
+	uint64_t dropped() const noexcept { return dropped_; }
+	/// 没有新行情时检查写进程是否重启的间隔
+	static constexpr std::chrono::milliseconds kReattachInterval{1000};
+	/**
+	 * @brief 写进程以同一名称重建了缓冲区时, 映射新的缓冲区并从其起点读取
+	 * @return 是否已重新映射. 缓冲区未重建或无法映射时保留原映射
+	 */
+	bool Reattach();
+	/// 写进程重启而重新映射的次数
+	uint64_t restarts() const noexcept { return restarts_; }
+
+	/// 写进程是否已退出
+	bool writer_closed() const noexcept { return header_->closed.load(std::memory_order_acquire) != 0; }
+	/// 写进程创建缓冲区的时间
+	Timestamp session() const noexcept { return header_->session; }
+	/// 槽位数量
+	size_t capacity() const noexcept { return capacity_; }
+
+private:
+	std::string path_;
+	size_t capacity_ = 0;
+	size_t mapped_size_ = 0;
+	const shm_tick::Header* header_ = nullptr;
+	const shm_tick::Slot* slots_ = nullptr;
+
+	uint64_t next_ = 0;	 ///< 下一笔要读的序号
+	uint64_t lapped_ = 0;
+	uint64_t dropped_ = 0;
+	uint64_t restarts_ = 0;
+	std::chrono::steady_clock::time_point last_check_;	///< 上次检查写进程是否重启的时间
+	std::vector<SymbolID> symbol_map_;	///< 写进程合约ID -> 本进程合约ID
+
+	/// 映射共享内存, 替换原映射. 失败时抛出异常, 保留原映射
+	void Map();
+	void Unmap() noexcept;
+	void Skip(uint64_t head) noexcept;
+};
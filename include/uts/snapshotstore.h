@@ -0,0 +1,126 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief 行情快照仓库
+ *
+ * 每个合约占用一个固定槽位, 槽位由稠密ID索引, 构造后不再扩容, 因此读线程不会遇到容器重排.
+ * 每个槽位由seqlock保护: 写线程(每个槽位只能有一个)不加锁直接覆盖, 读线程不加锁复制, 若复制期间被写入则重试.
+ * 读线程之间互不影响, 也不会阻塞写线程.
+ * 槽位首次写入时登记其ID, 遍历只访问登记过的槽位, 耗时与有过数据的合约数量成正比, 与容量无关.
+ * @tparam T 快照类型, 需可平凡复制
+ */
+template <typename T>
+requires std::is_trivially_copyable_v<T>
+class SnapshotStore {
+public:
+	/**
+	 * @brief 构造函数
+	 * @param capacity 槽位数量
+	 */
+	explicit SnapshotStore(size_t capacity)
+		: capacity_(capacity),
+		  slots_(std::make_unique<Slot[]>(capacity)),
+		  occupied_(std::make_unique<std::atomic<size_t>[]>(capacity)) {
+		for (size_t i = 0; i < capacity; ++i) { occupied_[i].store(kUnlisted, std::memory_order_relaxed); }
+	}
+	SnapshotStore(const SnapshotStore&) = delete;
+	SnapshotStore& operator=(const SnapshotStore&) = delete;
+
+	/// 槽位数量
+	size_t capacity() const { return capacity_; }
+
+	/**
+	 * @brief 写入快照. 同一槽位只允许一个写线程
+	 * @param id 槽位ID
+	 * @param data 快照
+	 */
+	void Store(size_t id, const T& data) noexcept {
+		Slot& slot = slots_[id];
+		if (!slot.listed.load(std::memory_order_relaxed) && !slot.listed.exchange(true, std::memory_order_relaxed)) {
+			occupied_[occupied_count_.fetch_add(1, std::memory_order_relaxed)].store(id, std::memory_order_release);
+		}
+		Write(slot, &data);
+	}
+
+	/// 清空槽位
+	void Clear(size_t id) noexcept { Write(slots_[id], nullptr); }
+
+	/**
+	 * @brief 读取快照
+	 * @param id 槽位ID
+	 * @param[out] data 快照
+	 * @return 槽位是否有数据
+	 */
+	bool Load(size_t id, T& data) const noexcept {
+		const Slot& slot = slots_[id];
+		bool valid;
+		uint64_t begin, end;
+		do {
+			begin = slot.seq.load(std::memory_order_acquire);
+			if (begin & 1) { continue; }
+			valid = slot.valid;
+			std::memcpy(&data, &slot.data, sizeof(T));
+			std::atomic_thread_fence(std::memory_order_acquire);
+			end = slot.seq.load(std::memory_order_relaxed);
+		} while ((begin & 1) || (begin != end));
+		return valid;
+	}
+
+	/// 写入过数据的槽位数量, 包括之后被清空的槽位
+	size_t occupied() const noexcept { return occupied_count_.load(std::memory_order_acquire); }
+
+	/**
+	 * @brief 按首次写入的顺序遍历所有有数据的槽位
+	 * @param func 回调函数, 签名为 `void(size_t id, const T& data)`
+	 */
+	template <typename Func>
+	void ForEach(Func&& func) const {
+		T data;
+		size_t count = occupied();
+		for (size_t i = 0; i < count; ++i) {
+			// 序号已分配而ID尚未写入的槽位同样尚无数据
+			size_t id = occupied_[i].load(std::memory_order_acquire);
+			if ((id != kUnlisted) && Load(id, data)) { func(id, data); }
+		}
+	}
+
+	/// 横截面快照
+	std::vector<T> CrossSection() const {
+		std::vector<T> ret;
+		ForEach([&](size_t, const T& data) { ret.push_back(data); });
+		return ret;
+	}
+
+private:
+	struct alignas(64) Slot {
+		std::atomic<uint64_t> seq{0};
+		bool valid = false;
+		std::atomic<bool> listed{false};  ///< ID是否已登记至 `occupied_`
+		T data;
+	};
+	static constexpr size_t kUnlisted = static_cast<size_t>(-1);
+
+	size_t capacity_;
+	std::unique_ptr<Slot[]> slots_;
+	std::unique_ptr<std::atomic<size_t>[]> occupied_;  ///< 按首次写入顺序登记的槽位ID
+	std::atomic<size_t> occupied_count_ = 0;
+
+	static void Write(Slot& slot, const T* data) noexcept {
+		uint64_t seq = slot.seq.load(std::memory_order_relaxed);
+		slot.seq.store(seq + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		if (data) {
+			std::memcpy(&slot.data, data, sizeof(T));
+			slot.valid = true;
+		} else {
+			slot.valid = false;
+		}
+		slot.seq.store(seq + 2, std::memory_order_release);
+	}
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+/**
+ * @brief 单生产者单消费者环形缓冲区
+ *
+ * 容量为2的整数次幂, 构造时一次性分配, 之后的读写均不分配内存也不加锁.
+ * 生产者和消费者的读写位置分处不同的缓存行, 并各自缓存对方的位置, 以减少缓存行在线程间往返.
+ * 消费者可通过 `WaitForData` 在无数据时休眠, 生产者只在消费者休眠时才发出唤醒.
+ * @tparam T 元素类型, 需可平凡复制
+ */
+template <typename T>
+requires std::is_trivially_copyable_v<T>
+class SPSCRing {
+public:
+	/**
+	 * @brief 构造函数
+	 * @param capacity 容量, 向上取整为2的整数次幂
+	 */
+	explicit SPSCRing(size_t capacity)
+		: capacity_(std::bit_ceil(capacity < 2 ? size_t{2} : capacity)),
+		  mask_(capacity_ - 1),
+		  buffer_(std::make_unique<T[]>(capacity_)) {}
+	SPSCRing(const SPSCRing&) = delete;
+	SPSCRing& operator=(const SPSCRing&) = delete;
+
+	/// 容量
+	size_t capacity() const noexcept { return capacity_; }
+	/// 当前元素数量. 由其他线程调用时为近似值
+	size_t size() const noexcept {
+		uint64_t read = read_.load(std::memory_order_acquire);
+		return static_cast<size_t>(write_.load(std::memory_order_acquire) - read);
+	}
+	/// 是否为空
+	bool empty() const noexcept { return size() == 0; }
+
+	/**
+	 * @brief 写入元素, 只能由生产者线程调用
+	 * @return 缓冲区已满时返回 `false`, 元素不写入
+	 */
+	bool TryPush(const T& item) noexcept {
+		uint64_t write = write_.load(std::memory_order_relaxed);
+		if (write - cached_read_ >= capacity_) {
+			cached_read_ = read_.load(std::memory_order_acquire);
+			if (write - cached_read_ >= capacity_) { return false; }
+		}
+		buffer_[write & mask_] = item;
+		write_.store(write + 1, std::memory_order_seq_cst);
+		if (sleeping_.load(std::memory_order_seq_cst)) { Wake(); }
+		return true;
+	}
+
+	/**
+	 * @brief 读取元素, 只能由消费者线程调用
+	 * @param[out] item 读出的元素
+	 * @return 缓冲区为空时返回 `false`
+	 */
+	bool TryPop(T& item) noexcept {
+		uint64_t read = read_.load(std::memory_order_relaxed);
+		if (read == cached_write_) {
+			cached_write_ = write_.load(std::memory_order_acquire);
+			if (read == cached_write_) { return false; }
+		}
+		item = buffer_[read & mask_];
+		read_.store(read + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * @brief 消费者休眠直至有新数据, 或 `Wake` 被调用, 或 `stop` 返回 `true`
+	 * @param stop 停止条件. 在 `Wake` 前被置位的条件一定会被观察到
+	 */
+	template <typename Pred>
+	void WaitForData(Pred&& stop) noexcept {
+		uint32_t bell = doorbell_.load(std::memory_order_acquire);
+		sleeping_.store(true, std::memory_order_seq_cst);
+		if ((write_.load(std::memory_order_seq_cst) == read_.load(std::memory_order_relaxed)) && !stop()) {
+			doorbell_.wait(bell, std::memory_order_acquire);
+		}
+		sleeping_.store(false, std::memory_order_relaxed);
+	}
+
+	/// 唤醒休眠中的消费者
+	void Wake() noexcept {
+		doorbell_.fetch_add(1, std::memory_order_release);
+		doorbell_.notify_one();
+	}
+
+private:
+	const size_t capacity_;
+	const size_t mask_;
+	std::unique_ptr<T[]> buffer_;
+
+	// 生产者
+	alignas(64) std::atomic<uint64_t> write_ = 0;
+	uint64_t cached_read_ = 0;
+	// 消费者
+	alignas(64) std::atomic<uint64_t> read_ = 0;
+	uint64_t cached_write_ = 0;
+	// 休眠与唤醒
+	alignas(64) std::atomic<bool> sleeping_ = false;
+	std::atomic<uint32_t> doorbell_ = 0;
+};
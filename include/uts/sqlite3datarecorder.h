@@ -1,25 +1,91 @@
 ﻿#pragma once
 
+#include <array>
+#include <chrono>
 #include <filesystem>
+#include <span>
 #include <sqlite3.h>
 
 #include <uts/datarecorder.h>
 
 /**
  * @brief SQLite3 数据记录器，将收到的 `MarketDepth` 信息写入 `.sqlite3` 文件
+ * @details 数据库以 `journal_mode=WAL` 和 `synchronous=NORMAL` 打开. 写入在事务中累积,
+ *          达到 `batch_rows` 行或事务开始已超过 `batch_interval` 时提交, 记录线程空闲时也会提交.
+ *          `(ID, DateTime)` 索引在析构时建立, 记录期间插入不维护索引
  */
 class SQLite3DataRecorder : public DataRecorder {
 public:
 	/**
 	 * @brief 构造函数.
 	 * @param db_name `.sqlite3` 文件名称
+	 * @param batch_rows 每个事务最多写入的行数
+	 * @param batch_interval 每个事务最长持续时间
 	 * @exception std::runtime_error 无法打开数据库错误
 	 */
-	SQLite3DataRecorder(const std::filesystem::path& db_name);
+	SQLite3DataRecorder(const std::filesystem::path& db_name, size_t batch_rows = 10000,
+						std::chrono::milliseconds batch_interval = std::chrono::milliseconds(500));
 	virtual ~SQLite3DataRecorder();
 
+	/**
+	 * @brief 将多个数据库文件(如 `ShardedDataRecorder` 的各分片)的 `tickdata` 表合并至一个数据库
+	 * @details 合并后的数据库在 `merged_shards` 表中按分片路径记录已合并的行, 重复合并只追加分片中新增的行.
+	 *          分片文件被删除重建后需换用新的名称
+	 * @param db_name 合并后的 `.sqlite3` 文件名称, 已存在时追加
+	 * @param shards 各分片的 `.sqlite3` 文件名称
+	 * @exception std::runtime_error 无法打开数据库或合并失败
+	 */
+	static void MergeShards(const std::filesystem::path& db_name, std::span<const std::filesystem::path> shards);
+	/**
+	 * @brief 整理已关闭的数据库: 建立 `(ID, DateTime)` 索引, `ANALYZE`, `VACUUM` 并清空 WAL 文件.
+	 *        供 `RotatingDataRecorder` 在交易日结束后调用, 耗时较长, 期间不能写入该数据库
+	 * @param db_name `.sqlite3` 文件名称
+	 * @exception std::runtime_error 文件不存在, 无法打开数据库或整理失败
+	 */
+	static void Compact(const std::filesystem::path& db_name);
+
 protected:
 	void WriteDB(const MarketDepth&) override;
+	/// 一批数据写入当前事务, 达到行数或时长时提交. 由 `JournaledDataRecorder` 驱动时只在 `Sync` 中提交
+	void WriteDB(std::span<const MarketDepth> data) override;
+	void Flush() override;
+	/// 提交当前事务. 上次 `Sync` 后有插入失败或提交失败时回滚并返回 `false`
+	bool Sync() override;
+
+private:
+	sqlite3* conn_ = nullptr;
+	sqlite3_stmt* stmt_ = nullptr;
+
+	static constexpr size_t kColumnCount = 13;
+	std::array<int, kColumnCount> param_index_{};  ///< 插入语句各参数的序号, 构造时解析
+
+	const size_t batch_rows_;
+	const std::chrono::milliseconds batch_interval_;
+	bool in_transaction_ = false;
+	size_t transaction_rows_ = 0;
+	std::chrono::steady_clock::time_point transaction_start_;
+	bool insert_failed_ = false;  ///< 上次 `Sync` 后有插入失败
+
+	bool Commit();
+	bool Exec(const char* sql);
+};
+
+/**
+ * @brief SQLite3 K线记录器，将收到的 `Bar` 写入 `.sqlite3` 文件的 `bardata` 表
+ * @details 每批K线在一个事务中写入. `Period` 列为 `BarPeriod` 的数值, 交易日K线的时间为首笔和末笔行情时间
+ */
+class SQLite3BarRecorder : public BarRecorder {
+public:
+	/**
+	 * @brief 构造函数.
+	 * @param db_name `.sqlite3` 文件名称, 可与 `SQLite3DataRecorder` 共用
+	 * @exception std::runtime_error 无法打开数据库错误
+	 */
+	explicit SQLite3BarRecorder(const std::filesystem::path& db_name);
+	~SQLite3BarRecorder() override;
+
+protected:
+	void WriteBars(std::span<const Bar> bars) override;
 
 private:
 	sqlite3* conn_ = nullptr;
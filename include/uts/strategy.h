@@ -1,18 +1,20 @@
 ﻿#pragma once
 
+#include <array>
 #include <map>
 #include <string>
 #include <string_view>
 
-#include <uts/ctpmarketdata.h>
-#include <uts/observer.h>
+#include <uts/eventbus.h>
 #include <uts/tradingaccount.h>
 
 // no capital management is implemented. assuming all capital in the account is used for the strategy.
-class Strategy : public Observer {
+class Strategy {
 public:
 	Strategy(std::string_view name) : name_(name) {}
-	virtual ~Strategy() override = default;
+	Strategy(const Strategy&) = delete;
+	Strategy& operator=(const Strategy&) = delete;
+	virtual ~Strategy() { Detach(); }
 
 	enum class AccountOrderPolicy {
 		Random,
@@ -21,10 +23,39 @@ public:
 	};
 
 	virtual void AddAccount(TradingAccount* account) = 0;
-	void SetMarketData(ObservableCTPMarketDataBase* md_source) { Register(md_source); }
+	/**
+	 * @brief 接入事件总线, 接收行情, 委托回报, 成交回报和资金更新
+	 * @details 行情源和交易账户通过 `SetEventBus` 连接到同一总线. 策略也可通过 `event_bus_` 发布事件
+	 * @note 处理函数在发布者线程中调用. 派生类应在其析构函数中调用 `Detach`, 以免析构期间仍收到事件
+	 */
+	void Attach(TradingEventBus* event_bus) {
+		Detach();
+		event_bus_ = event_bus;
+		subscriptions_ = {event_bus_->Subscribe<MarketDepth, &Strategy::OnMarketData>(this),
+						  event_bus_->Subscribe<OrderRecord, &Strategy::OnOrder>(this),
+						  event_bus_->Subscribe<TradingRecord, &Strategy::OnTrade>(this),
+						  event_bus_->Subscribe<CapitalInfo, &Strategy::OnCapital>(this)};
+	}
+	/// 断开事件总线
+	void Detach() {
+		if (event_bus_ == nullptr) { return; }
+		event_bus_->Unsubscribe<MarketDepth>(subscriptions_[0]);
+		event_bus_->Unsubscribe<OrderRecord>(subscriptions_[1]);
+		event_bus_->Unsubscribe<TradingRecord>(subscriptions_[2]);
+		event_bus_->Unsubscribe<CapitalInfo>(subscriptions_[3]);
+		event_bus_ = nullptr;
+	}
 	void Start() {}
 
 	virtual void OnSnapshot() = 0;
+	/// 新行情
+	virtual void OnMarketData(const MarketDepth&) {}
+	/// 委托回报
+	virtual void OnOrder(const OrderRecord&) {}
+	/// 成交回报
+	virtual void OnTrade(const TradingRecord&) {}
+	/// 资金更新
+	virtual void OnCapital(const CapitalInfo&) {}
 
 	TradingAccount* NextAccount() {
 		switch (policy_) {
@@ -35,7 +66,11 @@ public:
 		}
 	}
 
+protected:
+	TradingEventBus* event_bus_ = nullptr;	///< 事件总线
+
 private:
 	std::string name_;
 	AccountOrderPolicy policy_;
+	std::array<int, 4> subscriptions_{};
 };
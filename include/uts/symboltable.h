@@ -0,0 +1,55 @@
+﻿#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string_view>
+
+#include <uts/data_struct.h>
+
+/**
+ * @brief 合约代码符号表
+ *
+ * 进程内唯一. 将合约代码映射为从0开始的稠密整数ID, 热路径上的数据结构均以该ID为下标.
+ * 合约代码在首次出现时登记(通常为 `QueryInstruments` 时), 之后的查找不加锁, 不分配内存,
+ * 可直接使用CTP回调中的 `InstrumentID` 字符数组.
+ */
+class SymbolTable {
+public:
+	/// 可登记的合约数量
+	static constexpr size_t kCapacity = 1 << 15;
+
+	/// 进程内唯一的符号表
+	static SymbolTable& Instance();
+
+	SymbolTable();
+	SymbolTable(const SymbolTable&) = delete;
+	SymbolTable& operator=(const SymbolTable&) = delete;
+
+	/**
+	 * @brief 登记合约代码
+	 * @param ticker 合约代码
+	 * @return 合约ID. 已登记的合约返回原ID, 符号表已满时返回 `kInvalidSymbol`
+	 */
+	SymbolID Intern(std::string_view ticker);
+	/**
+	 * @brief 查找合约ID
+	 * @param ticker 合约代码
+	 * @return 合约ID, 未登记时返回 `kInvalidSymbol`
+	 */
+	SymbolID Find(std::string_view ticker) const noexcept;
+	/// 合约ID对应的合约代码
+	const Ticker& Name(SymbolID id) const { return names_[id]; }
+	/// 已登记的合约数量
+	size_t size() const noexcept { return size_.load(std::memory_order_acquire); }
+	/// 合约代码的哈希值(FNV-1a), 不随进程和平台变化
+	static size_t Hash(std::string_view ticker) noexcept;
+
+private:
+	static constexpr size_t kBuckets = kCapacity * 2;
+
+	std::unique_ptr<Ticker[]> names_;
+	std::unique_ptr<std::atomic<SymbolID>[]> buckets_;	// 存放 ID + 1, 0 表示空桶
+	std::atomic<size_t> size_ = 0;
+	std::mutex mutex_;
+};
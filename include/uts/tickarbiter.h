@@ -0,0 +1,165 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <uts/data_struct.h>
+#include <uts/symboltable.h>
+
+/**
+ * @brief 多前置行情仲裁
+ *
+ * 同一合约的行情由多个前置同时推送时, 以(合约, 交易所时间, 累计成交量)识别同一笔行情, 只转发最先到达的一笔.
+ * 较晚到达的重复行情记录其相对首笔的延迟; 比已转发行情更旧的行情视为过期, 直接丢弃.
+ * 每个合约的仲裁状态按缓存行对齐, 不同合约的仲裁互不阻塞. 各前置的统计计数同样独占缓存行.
+ */
+class TickArbiter {
+public:
+	/// 仲裁结果
+	enum class Verdict {
+		First,		///< 首次到达, 已转发
+		Duplicate,	///< 其他前置已转发过同一笔行情
+		Stale,		///< 比已转发的行情更旧
+	};
+
+	/// 单个前置的统计
+	struct FrontStatistics {
+		uint64_t ticks = 0;		  ///< 收到的行情笔数
+		uint64_t wins = 0;		  ///< 最先到达的笔数
+		uint64_t duplicates = 0;  ///< 晚于其他前置到达的笔数
+		uint64_t stale = 0;		  ///< 过期的笔数
+		Timestamp mean_delay = 0;  ///< 重复行情相对首笔的平均延迟(纳秒)
+		Timestamp max_delay = 0;   ///< 重复行情相对首笔的最大延迟(纳秒)
+
+		/// 最先到达的比例
+		double win_rate() const { return ticks == 0 ? 0 : static_cast<double>(wins) / static_cast<double>(ticks); }
+	};
+
+	/**
+	 * @brief 构造函数
+	 * @param front_count 前置数量
+	 * @param capacity 合约ID上界
+	 */
+	explicit TickArbiter(size_t front_count, size_t capacity = SymbolTable::kCapacity)
+		: instruments_(capacity), fronts_(front_count) {}
+	TickArbiter(const TickArbiter&) = delete;
+	TickArbiter& operator=(const TickArbiter&) = delete;
+
+	/// 前置数量
+	size_t front_count() const { return fronts_.size(); }
+
+	/**
+	 * @brief 仲裁一笔行情
+	 * @details 仲裁锁只保护判定, 判定后释放再调用 `forward`, 下游处理不会阻塞其他前置的判定.
+	 *          同一合约的转发由转发锁依次进行, 转发前再次确认本笔行情比已转发的行情新, 否则按过期处理.
+	 *          不同合约可在各前置的线程中并行转发
+	 * @param front 前置序号
+	 * @param id 合约ID
+	 * @param exchange_time 交易所时间
+	 * @param volume 累计成交量
+	 * @param local_time 本地接收时间
+	 * @param forward 首次到达时的处理函数
+	 * @return 仲裁结果
+	 */
+	template <typename Forward>
+	Verdict Arbitrate(size_t front, SymbolID id, Timestamp exchange_time, Volume volume, Timestamp local_time,
+					  Forward&& forward) {
+		FrontCounters& counters = fronts_[front];
+		counters.ticks.fetch_add(1, std::memory_order_relaxed);
+		InstrumentState& state = instruments_[id];
+		if (Verdict verdict = Decide(state, counters, exchange_time, volume, local_time); verdict != Verdict::First) {
+			return verdict;
+		}
+
+		std::scoped_lock _(state.forward_mutex);
+		if (!IsNewer(exchange_time, volume, state.forwarded_time, state.forwarded_volume)) {
+			// 等待转发期间其他前置已转发了更新的行情
+			counters.stale.fetch_add(1, std::memory_order_relaxed);
+			return Verdict::Stale;
+		}
+		state.forwarded_time = exchange_time;
+		state.forwarded_volume = volume;
+		counters.wins.fetch_add(1, std::memory_order_relaxed);
+		forward();
+		return Verdict::First;
+	}
+
+	/// 单个前置的统计
+	FrontStatistics statistics(size_t front) const {
+		const FrontCounters& counters = fronts_[front];
+		FrontStatistics ret{.ticks = counters.ticks.load(std::memory_order_relaxed),
+							.wins = counters.wins.load(std::memory_order_relaxed),
+							.duplicates = counters.duplicates.load(std::memory_order_relaxed),
+							.stale = counters.stale.load(std::memory_order_relaxed),
+							.max_delay = counters.delay_max.load(std::memory_order_relaxed)};
+		if (ret.duplicates > 0) {
+			ret.mean_delay = counters.delay_sum.load(std::memory_order_relaxed) / static_cast<Timestamp>(ret.duplicates);
+		}
+		return ret;
+	}
+
+private:
+	/// 单个合约的仲裁状态
+	struct alignas(64) InstrumentState {
+		std::atomic_flag lock;		  ///< 仲裁锁, 保护以下三项
+		Timestamp exchange_time = 0;  ///< 最近判定为首次到达的行情
+		Volume volume = 0;
+		Timestamp first_arrival = 0;  ///< 最近判定为首次到达的行情的本地接收时间
+		std::mutex forward_mutex;	  ///< 转发锁, 保护以下两项
+		Timestamp forwarded_time = 0;  ///< 最近转发的行情
+		Volume forwarded_volume = 0;
+	};
+	/// 单个前置的统计计数
+	struct alignas(64) FrontCounters {
+		std::atomic<uint64_t> ticks = 0;
+		std::atomic<uint64_t> wins = 0;
+		std::atomic<uint64_t> duplicates = 0;
+		std::atomic<uint64_t> stale = 0;
+		std::atomic<Timestamp> delay_sum = 0;
+		std::atomic<Timestamp> delay_max = 0;
+	};
+	/// 合约仲裁锁. 临界区只有几次比较, 自旋等待
+	class SpinLock {
+	public:
+		explicit SpinLock(std::atomic_flag& flag) : flag_(flag) {
+			while (flag_.test_and_set(std::memory_order_acquire)) { std::this_thread::yield(); }
+		}
+		~SpinLock() { flag_.clear(std::memory_order_release); }
+
+	private:
+		std::atomic_flag& flag_;
+	};
+
+	static bool IsNewer(Timestamp exchange_time, Volume volume, Timestamp last_time, Volume last_volume) {
+		return (exchange_time > last_time) || ((exchange_time == last_time) && (volume > last_volume));
+	}
+
+	/// 在仲裁锁内判定, 并记录重复和过期行情的统计
+	static Verdict Decide(InstrumentState& state, FrontCounters& counters, Timestamp exchange_time, Volume volume,
+						  Timestamp local_time) {
+		SpinLock _(state.lock);
+		if (IsNewer(exchange_time, volume, state.exchange_time, state.volume)) {
+			state.exchange_time = exchange_time;
+			state.volume = volume;
+			state.first_arrival = local_time;
+			return Verdict::First;
+		}
+		if ((exchange_time == state.exchange_time) && (volume == state.volume)) {
+			Timestamp delay = local_time - state.first_arrival;
+			counters.duplicates.fetch_add(1, std::memory_order_relaxed);
+			counters.delay_sum.fetch_add(delay, std::memory_order_relaxed);
+			Timestamp max_delay = counters.delay_max.load(std::memory_order_relaxed);
+			while ((delay > max_delay) &&
+				   !counters.delay_max.compare_exchange_weak(max_delay, delay, std::memory_order_relaxed)) {}
+			return Verdict::Duplicate;
+		}
+		counters.stale.fetch_add(1, std::memory_order_relaxed);
+		return Verdict::Stale;
+	}
+
+	std::vector<InstrumentState> instruments_;	///< 以合约ID为下标
+	std::vector<FrontCounters> fronts_;
+};
@@ -0,0 +1,241 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <uts/data_struct.h>
+
+/**
+ * @brief 列式行情归档文件的布局
+ *
+ * 每个交易日一个文件, 由文件头和之后依次追加的数据块组成, 没有文件尾索引. 每个数据块只含一个合约至多
+ * `kBlockRows` 笔按收到顺序排列的行情, 块头之后按 `TickColumn` 的顺序存放各列的字节流, 各块可独立解码.
+ * 读取时顺序扫描块头建立索引, 写入中途退出而截断的文件仍可读出完整的块.
+ *
+ * 各列的编码:
+ *  - 时间戳: 二阶差分(delta-of-delta), zig-zag varint
+ *  - 价格: 以块头中的最小变动价位为单位的整数, 一阶差分, zig-zag varint, 最低位为0.
+ *    不是最小变动价位整数倍的值(如无效价格 -1, 均价, Delta)最低位为1, 之后为8字节原始值
+ *  - 数量: 一阶差分, zig-zag varint
+ *
+ * 多字节字段均为小端序, 仅支持小端序的平台. 合约ID只在进程内有效, 不归档; 交易日记录在文件头.
+ */
+namespace tick_archive {
+/// 魔数 "UTSARCH1"
+constexpr uint64_t kMagic = 0x3148435241535455ULL;
+/// 块头魔数 "UTSB"
+constexpr uint32_t kBlockMagic = 0x42535455U;
+/// 布局版本, 布局变化时递增
+constexpr uint32_t kVersion = 1;
+/// 每个数据块的最大行数
+constexpr uint32_t kBlockRows = 4096;
+
+/// 归档的列
+enum class TickColumn : uint8_t {
+	ExchangeTime,
+	LocalTime,
+	Open,
+	High,
+	Low,
+	Close,
+	Last,
+	Settle,
+	AveragePrice,
+	UpperLimit,
+	LowerLimit,
+	Delta,
+	Turnover,
+	Volume,
+	OpenInterest,
+	BidPrice1,
+	BidPrice2,
+	BidPrice3,
+	BidPrice4,
+	BidPrice5,
+	AskPrice1,
+	AskPrice2,
+	AskPrice3,
+	AskPrice4,
+	AskPrice5,
+	BidVolume1,
+	BidVolume2,
+	BidVolume3,
+	BidVolume4,
+	BidVolume5,
+	AskVolume1,
+	AskVolume2,
+	AskVolume3,
+	AskVolume4,
+	AskVolume5,
+};
+/// 列数
+constexpr size_t kColumnCount = static_cast<size_t>(TickColumn::AskVolume5) + 1;
+
+/// 列编码
+enum class ColumnEncoding : uint8_t {
+	Timestamp,	///< 二阶差分, 解码为 `int64_t`
+	Price,		///< 最小变动价位的整数倍, 解码为 `double`
+	Integer,	///< 一阶差分, 解码为 `int64_t`
+};
+/// 列的编码
+ColumnEncoding Encoding(TickColumn column) noexcept;
+
+/// 文件头
+struct FileHeader {
+	uint64_t magic;		///< 魔数
+	uint32_t version;	///< 布局版本
+	int32_t trading_day;  ///< 交易日(YYYYMMDD)
+};
+
+/// 块头, 之后紧接各列的字节流
+struct BlockHeader {
+	uint32_t magic;							 ///< 块头魔数
+	uint32_t rows;							 ///< 行数
+	char instrument_id[32];					 ///< 合约代码
+	double price_tick;						 ///< 价格列的单位. 为0时价格列全部存放原始值
+	std::array<uint32_t, kColumnCount> column_sizes;  ///< 各列字节数
+};
+
+static_assert(sizeof(FileHeader) == 16);
+static_assert(sizeof(BlockHeader) == 192);
+}  // namespace tick_archive
+
+/**
+ * @brief 列式行情归档写入器
+ *
+ * 按合约分别编码, 某合约攒满 `tick_archive::kBlockRows` 笔时写出一个数据块, `Flush` 和 `Close` 时写出所有未满的块.
+ * 文件已存在时追加数据块.
+ * @note 非线程安全
+ */
+class TickArchiveWriter {
+public:
+	/**
+	 * @brief 构造函数
+	 * @param filename 文件名称
+	 * @param trading_day 交易日(YYYYMMDD)
+	 * @param price_ticks 各合约的最小变动价位. 未列出的合约的价格存放原始值
+	 * @exception IOError 无法打开文件
+	 * @exception std::runtime_error 已存在的文件不是归档文件或交易日不符
+	 */
+	TickArchiveWriter(const std::filesystem::path& filename, int trading_day,
+					  std::unordered_map<Ticker, Price> price_ticks = {});
+	TickArchiveWriter(const TickArchiveWriter&) = delete;
+	TickArchiveWriter& operator=(const TickArchiveWriter&) = delete;
+	~TickArchiveWriter();
+
+	/// 交易日
+	int trading_day() const noexcept { return trading_day_; }
+
+	/// 追加一笔行情
+	void Append(const MarketDepth& md);
+	/// 写出所有未满的块并同步至磁盘, 进程崩溃时不丢失已追加的行情. 之后的行情从新块开始
+	void Flush();
+	/// 写出所有未满的块并关闭文件
+	void Close();
+
+private:
+	/// 单个合约正在编码的块
+	struct PendingBlock {
+		tick_archive::BlockHeader header{};
+		std::array<std::vector<uint8_t>, tick_archive::kColumnCount> columns;
+		std::array<int64_t, tick_archive::kColumnCount> previous{};	 ///< 各列上一行的值
+		std::array<int64_t, tick_archive::kColumnCount> previous_delta{};	 ///< 时间戳列上一行的差分
+	};
+
+	std::ofstream out_;
+	const std::filesystem::path filename_;
+	const int trading_day_;
+	std::unordered_map<Ticker, Price> price_ticks_;
+	std::unordered_map<std::string, PendingBlock> blocks_;
+
+	void WriteBlock(PendingBlock& block);
+};
+
+/// 归档文件中的一个数据块
+struct TickBlock {
+	std::string_view instrument_id;	 ///< 合约代码
+	uint32_t rows;					 ///< 行数
+	double price_tick;				 ///< 价格列的单位
+	std::array<std::span<const uint8_t>, tick_archive::kColumnCount> columns;  ///< 各列的字节流
+};
+
+/**
+ * @brief 列式行情归档读取器
+ *
+ * 以只读方式映射整个文件, 构造时顺序扫描块头建立索引, 之后按列解码时直接读取映射的内存, 不复制文件内容.
+ * 行情按数据块顺序给出, 同一合约内按收到顺序排列, 不同合约之间不按时间排序.
+ */
+class TickArchiveReader {
+public:
+	/**
+	 * @brief 构造函数
+	 * @param filename 文件名称
+	 * @exception IOError 文件不存在
+	 * @exception std::system_error 无法映射文件
+	 * @exception std::runtime_error 不是归档文件或版本不符
+	 */
+	explicit TickArchiveReader(const std::filesystem::path& filename);
+	TickArchiveReader(const TickArchiveReader&) = delete;
+	TickArchiveReader& operator=(const TickArchiveReader&) = delete;
+	~TickArchiveReader();
+
+	/// 交易日
+	int trading_day() const noexcept { return trading_day_; }
+	/// 所有数据块
+	std::span<const TickBlock> blocks() const noexcept { return blocks_; }
+	/// 总行数
+	size_t size() const noexcept { return rows_; }
+	/// 文件末尾是否有不完整的数据块
+	bool truncated() const noexcept { return truncated_; }
+	/// 文件中的合约代码, 按首次出现的顺序
+	std::vector<Ticker> instruments() const;
+
+	/**
+	 * @brief 解码一个时间戳列或数量列
+	 * @param out 输出, 长度至少为块的行数
+	 * @exception std::invalid_argument 列不是时间戳列或数量列, 或输出长度不足
+	 */
+	void DecodeColumn(const TickBlock& block, tick_archive::TickColumn column, std::span<int64_t> out) const;
+	/**
+	 * @brief 解码一个价格列
+	 * @param out 输出, 长度至少为块的行数
+	 * @exception std::invalid_argument 列不是价格列, 或输出长度不足
+	 */
+	void DecodeColumn(const TickBlock& block, tick_archive::TickColumn column, std::span<double> out) const;
+	/**
+	 * @brief 解码整个数据块
+	 * @param[out] out 解码的行情追加至其后, 合约ID为本进程 `SymbolTable` 中的ID
+	 */
+	void DecodeBlock(const TickBlock& block, std::vector<MarketDepth>& out) const;
+	/// 读取某合约的全部行情
+	std::vector<MarketDepth> Read(const Ticker& ticker) const;
+
+	/**
+	 * @brief 依次处理文件中的全部行情
+	 * @param f 处理函数, 签名为 `void(const MarketDepth&)`
+	 */
+	template <typename F>
+	void ForEach(F&& f) const {
+		std::vector<MarketDepth> rows;
+		for (const TickBlock& block : blocks_) {
+			rows.clear();
+			DecodeBlock(block, rows);
+			for (const MarketDepth& md : rows) { f(md); }
+		}
+	}
+
+private:
+	const uint8_t* data_ = nullptr;
+	size_t mapped_size_ = 0;
+	int trading_day_ = 0;
+	size_t rows_ = 0;
+	bool truncated_ = false;
+	std::vector<TickBlock> blocks_;
+};
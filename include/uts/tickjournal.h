@@ -0,0 +1,143 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <span>
+#include <thread>
+
+#include <uts/data_struct.h>
+
+/**
+ * @brief 行情预写日志的布局
+ *
+ * 日志目录中有若干段文件 `{first_sequence:020}.journal` 和记录已提交序号的 `committed` 文件.
+ * 每个段由 `SegmentHeader` 和固定数量的定长 `Record` 组成, 记录按序号连续存放, 段之间序号连续.
+ * 段创建时即扩展至完整大小, 未写入的记录全为0, 校验和不符或序号不连续处即为日志末尾.
+ * 多字节字段均为本机字节序, 日志只在同一台机器上重放.
+ */
+namespace tick_journal {
+/// 段文件魔数 "UTSJRNL1"
+constexpr uint64_t kMagic = 0x314C4E524A535455ULL;
+/// 已提交序号文件魔数 "UTSJCMT1"
+constexpr uint64_t kCommittedMagic = 0x31544D434A535455ULL;
+/// 布局版本, `MarketDepth` 或布局变化时递增
+constexpr uint32_t kVersion = 1;
+
+/// 段头
+struct SegmentHeader {
+	uint64_t magic;			  ///< 魔数
+	uint32_t version;		  ///< 布局版本
+	uint32_t record_size;	  ///< `sizeof(Record)`
+	uint64_t first_sequence;  ///< 第一条记录的序号
+	uint64_t capacity;		  ///< 记录数
+};
+
+/// 一条记录
+struct Record {
+	uint64_t sequence;	///< 序号
+	uint32_t checksum;	///< `sequence` 和 `data` 的 CRC-32C, 最后写入
+	uint32_t reserved;
+	MarketDepth data;
+};
+
+/// 已提交序号文件
+struct Committed {
+	uint64_t magic;		///< 魔数
+	uint64_t sequence;	///< 此序号之前的记录已写入数据库
+};
+
+static_assert(sizeof(SegmentHeader) == 32);
+
+/// 记录的校验和
+uint32_t Checksum(const Record& record) noexcept;
+}  // namespace tick_journal
+
+/**
+ * @brief 内存映射的行情预写日志
+ *
+ * 行情先以 `Append` 追加至映射的段文件, 进程被杀死时已追加的行情仍在页缓存中; 后台线程每隔 `sync_interval`
+ * 以 `msync` 将新追加的记录及已提交序号刷入磁盘, 操作系统崩溃时至多丢失这段时间内的行情.
+ * 消费方以 `Read` 从已提交序号处读取, 写入数据库后以 `Commit` 推进已提交序号, 已提交的整段文件被删除.
+ * 重新打开时从最后一段找到日志末尾, 已提交序号之后的记录可重新读取.
+ * @note `Append` 可在多个线程调用; `Read` 与 `Commit` 只应由同一个消费线程调用
+ */
+class TickJournal {
+public:
+	/// 默认每段的记录数
+	static constexpr size_t kDefaultSegmentRecords = 1 << 16;
+
+	/**
+	 * @brief 打开或创建日志
+	 * @param directory 日志目录, 不存在时创建
+	 * @param segment_records 新建段的记录数
+	 * @param sync_interval 刷盘间隔
+	 * @exception std::system_error 无法创建或映射段文件
+	 * @exception std::runtime_error 段文件不是日志文件或版本不符
+	 */
+	explicit TickJournal(const std::filesystem::path& directory, size_t segment_records = kDefaultSegmentRecords,
+						 std::chrono::milliseconds sync_interval = std::chrono::milliseconds(100));
+	TickJournal(const TickJournal&) = delete;
+	TickJournal& operator=(const TickJournal&) = delete;
+	~TickJournal();
+
+	/**
+	 * @brief 追加一笔行情
+	 * @return 行情的序号
+	 * @exception std::system_error 无法创建新段
+	 */
+	uint64_t Append(const MarketDepth& data);
+	/// 下一笔行情的序号
+	uint64_t head() const noexcept { return head_.load(); }
+	/// 已提交序号
+	uint64_t committed() const noexcept { return committed_.load(); }
+
+	/**
+	 * @brief 从 `sequence` 开始读取连续的记录
+	 * @param out 输出
+	 * @return 读取的笔数, 遇到日志末尾或校验和不符时停止
+	 */
+	size_t Read(uint64_t sequence, std::span<MarketDepth> out) const;
+	/// 推进已提交序号, 删除已全部提交的段
+	void Commit(uint64_t sequence);
+	/// 立即将已追加的记录及已提交序号刷入磁盘
+	void Sync();
+
+private:
+	/// 映射的段文件
+	struct Segment {
+		std::filesystem::path filename;
+		tick_journal::SegmentHeader* header = nullptr;
+		size_t mapped_size = 0;
+		uint64_t synced = 0;  ///< 已刷盘的记录数
+
+		tick_journal::Record* records() const { return reinterpret_cast<tick_journal::Record*>(header + 1); }
+		uint64_t end() const { return header->first_sequence + header->capacity; }
+	};
+
+	const std::filesystem::path directory_;
+	const size_t segment_records_;
+	int committed_fd_ = -1;
+
+	mutable std::mutex mutex_;	///< 保护 `segments_` 及追加
+	std::deque<Segment> segments_;
+	std::atomic<uint64_t> head_ = 0;
+	std::atomic<uint64_t> committed_ = 0;
+	uint64_t synced_committed_ = 0;	 ///< 已刷盘的已提交序号, 仅刷盘时使用
+
+	std::mutex sync_mutex_;	 ///< 刷盘与删除段互斥, 先于 `mutex_` 加锁
+
+	std::thread sync_thread_;
+	std::mutex thread_mutex_;
+	std::condition_variable sync_cv_;
+	const std::chrono::milliseconds sync_interval_;
+	bool syncing_ = true;
+
+	Segment OpenSegment(uint64_t first_sequence, bool create);
+	void Recover();
+	void SyncLoop();
+};
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <uts/data_struct.h>
+#include <uts/tickarchive.h>
+
+/// 稀疏时间索引的一项, 对应一个数据块
+struct TickBlockIndex {
+	uint32_t block;			///< 在 `TickArchiveReader::blocks()` 中的下标
+	Timestamp first_time;	///< 块内最早的交易所时间
+	Timestamp last_time;	///< 块内最晚的交易所时间
+	Timestamp latest_time;	///< 该合约至此块(含)为止最晚的交易所时间, 单调不减, 用于二分查找
+};
+
+/**
+ * @brief 带索引的归档文件
+ *
+ * 构造时只解码各数据块的交易所时间列, 建立合约目录(合约代码 -> 该合约的数据块)和每个合约以数据块为粒度的
+ * 稀疏时间索引. 查询时先以索引排除不相交的数据块, 只解码可能命中的块.
+ * @note 构造后只读, 可在多个线程中同时查询
+ */
+class TickArchiveIndex {
+public:
+	/**
+	 * @brief 构造函数
+	 * @param filename 归档文件名称
+	 * @exception IOError 文件不存在
+	 * @exception std::system_error 无法映射文件
+	 * @exception std::runtime_error 不是归档文件或版本不符
+	 */
+	explicit TickArchiveIndex(const std::filesystem::path& filename);
+
+	/// 文件名称
+	const std::filesystem::path& filename() const noexcept { return filename_; }
+	/// 归档读取器
+	const TickArchiveReader& reader() const noexcept { return reader_; }
+	/// 交易日
+	int trading_day() const noexcept { return reader_.trading_day(); }
+	/// 文件内最早的交易所时间. 空文件时为 `Timestamp` 的最大值
+	Timestamp first_time() const noexcept { return first_time_; }
+	/// 文件内最晚的交易所时间. 空文件时为 `Timestamp` 的最小值
+	Timestamp last_time() const noexcept { return last_time_; }
+	/// 文件中的合约代码, 按首次出现的顺序
+	std::span<const std::string_view> instruments() const noexcept { return instruments_; }
+
+	/// 某合约的全部数据块, 按文件中的顺序. 不在文件中时为空
+	std::span<const TickBlockIndex> Find(std::string_view ticker) const;
+	/**
+	 * @brief 某合约可能含有交易所时间在 [begin, end) 内的行情的数据块
+	 * @param[out] out 命中的数据块追加至其后
+	 */
+	void Find(std::string_view ticker, Timestamp begin, Timestamp end, std::vector<TickBlockIndex>& out) const;
+
+private:
+	const std::filesystem::path filename_;
+	TickArchiveReader reader_;
+	/// 合约目录, 键指向映射的文件内容
+	std::unordered_map<std::string_view, std::vector<TickBlockIndex>> directory_;
+	std::vector<std::string_view> instruments_;
+	Timestamp first_time_;
+	Timestamp last_time_;
+};
+
+/**
+ * @brief 行情区间查询引擎
+ *
+ * 打开若干归档文件或目录(目录中的全部 `.utstick` 文件), 并行建立各文件的索引. 支持两类查询:
+ *  - 合约集合 × 时间区间 -> 行情流: `ForEach` 按文件(交易日)和块的顺序逐块给出区间内的行情,
+ *    各块在线程池中并行解码, 之后按顺序交给回调; `Query` 收集全部结果并按交易所时间排序.
+ *  - 截面: `Snapshot` 给出各合约在某一时刻(含)的最新行情, 每个合约只解码一个数据块.
+ * 合约集合为空时表示全部合约. 时间均为交易所时间.
+ * @note 构造后只读, 可在多个线程中同时查询
+ */
+class TickQueryEngine {
+public:
+	/// 逐块处理行情的回调. 参数在回调返回后失效
+	using BlockCallback = std::function<void(std::span<const MarketDepth>)>;
+
+	/**
+	 * @brief 构造函数
+	 * @param paths 归档文件或目录
+	 * @param threads 并行线程数, 0 时为硬件线程数
+	 * @exception IOError 文件不存在
+	 * @exception std::runtime_error 不是归档文件或版本不符
+	 */
+	explicit TickQueryEngine(std::span<const std::filesystem::path> paths, size_t threads = 0);
+	/// 打开单个归档文件或目录
+	explicit TickQueryEngine(const std::filesystem::path& path, size_t threads = 0);
+
+	/// 已打开的文件, 按最早的交易所时间排序
+	std::span<const std::unique_ptr<TickArchiveIndex>> files() const noexcept { return files_; }
+	/// 全部文件中的合约代码, 按字典序
+	std::vector<Ticker> instruments() const;
+
+	/**
+	 * @brief 逐块处理合约集合在 [begin, end) 内的行情
+	 * @param tickers 合约代码, 为空时表示全部合约
+	 * @param f 回调, 在调用线程中按文件和块的顺序调用, 每次给出一个数据块中命中的行情
+	 */
+	void ForEach(std::span<const Ticker> tickers, Timestamp begin, Timestamp end, const BlockCallback& f) const;
+	/**
+	 * @brief 合约集合在 [begin, end) 内的全部行情
+	 * @param tickers 合约代码, 为空时表示全部合约
+	 * @return 按交易所时间排序的行情, 时间相同时保持文件中的顺序
+	 */
+	std::vector<MarketDepth> Query(std::span<const Ticker> tickers, Timestamp begin, Timestamp end) const;
+	/**
+	 * @brief 截面查询
+	 * @param time 时刻
+	 * @param tickers 合约代码, 为空时表示全部合约
+	 * @return 各合约交易所时间不晚于 `time` 的最新一笔行情, 按合约代码排序. 没有行情的合约不出现
+	 */
+	std::vector<MarketDepth> Snapshot(Timestamp time, std::span<const Ticker> tickers = {}) const;
+
+private:
+	std::vector<std::unique_ptr<TickArchiveIndex>> files_;
+	size_t threads_;
+
+	/// 依次调用 `f(0)` 至 `f(count - 1)`, 在至多 `threads_` 个线程中并行, 重新抛出第一个异常
+	void ParallelFor(size_t count, const std::function<void(size_t)>& f) const;
+};
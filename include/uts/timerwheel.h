@@ -0,0 +1,202 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <uts/data_struct.h>
+
+/**
+ * @brief 分层时间轮
+ *
+ * 定时器以稠密整数ID标识, 节点预分配并以双向链表挂在槽位上, 设置, 重设和取消均为O(1), 不分配内存.
+ * 共 `kLevels` 层, 每层 `kSlots` 个槽位, 第k层每个槽位覆盖 `kSlots^k` 个刻度; 第0层到期时回调,
+ * 较高层的槽位在时间轮转入其范围时下移一层. 超出最高层范围的定时器先挂在最远的槽位, 到期时重新设置.
+ * 一次推进超过全部范围(如休市后)时直接跳至目标刻度, 将全部定时器重新挂入一次, 不逐刻度推进.
+ * @note 非线程安全
+ */
+class TimerWheel {
+public:
+	/// 层数
+	static constexpr size_t kLevels = 4;
+	/// 每层槽位数量
+	static constexpr size_t kSlots = 64;
+
+	/**
+	 * @brief 构造函数
+	 * @param capacity 定时器ID上界
+	 * @param resolution 刻度长度(纳秒)
+	 */
+	TimerWheel(size_t capacity, Timestamp resolution) : nodes_(capacity), resolution_(resolution) { heads_.fill(kNil); }
+
+	/// 刻度长度(纳秒)
+	Timestamp resolution() const noexcept { return resolution_; }
+	/// 是否已设定起始时间
+	bool started() const noexcept { return started_; }
+	/// 设定起始时间, 需在设置定时器前调用
+	void Start(Timestamp now) noexcept {
+		current_ = now / resolution_;
+		started_ = true;
+	}
+
+	/// 定时器是否已设置
+	bool scheduled(uint32_t id) const noexcept { return nodes_[id].slot != kNil; }
+	/// 已设置的定时器数量
+	size_t size() const noexcept { return size_; }
+
+	/**
+	 * @brief 设置定时器. 已设置的定时器改为新的到期时间
+	 * @param id 定时器ID
+	 * @param deadline 到期时间. 早于当前刻度时在下一次 `Advance` 到期
+	 */
+	void Schedule(uint32_t id, Timestamp deadline) noexcept {
+		if (scheduled(id)) {
+			Unlink(id);
+		} else {
+			++size_;
+		}
+		nodes_[id].deadline = deadline;
+		Link(id);
+	}
+
+	/// 取消定时器
+	void Cancel(uint32_t id) noexcept {
+		if (!scheduled(id)) { return; }
+		Unlink(id);
+		--size_;
+	}
+
+	/**
+	 * @brief 推进时间轮至 `now`, 依次回调到期的定时器
+	 * @param now 当前时间
+	 * @param on_expire 回调, 签名为 `void(uint32_t id, Timestamp deadline)`, 可在其中重新设置定时器
+	 */
+	template <typename OnExpire>
+	void Advance(Timestamp now, OnExpire&& on_expire) {
+		int64_t target = now / resolution_;
+		if (target - current_ >= kRange) {
+			Jump(target, on_expire);
+			return;
+		}
+		for (; current_ <= target; ++current_) {
+			// 每层转完一圈时, 将上一层对应槽位下移
+			for (size_t level = 1; level < kLevels; ++level) {
+				if ((current_ & ((int64_t{1} << (kSlotBits * level)) - 1)) != 0) { break; }
+				Cascade(level);
+			}
+			// 先全部取下再回调, 回调中可重新设置同一槽位上的其他定时器
+			expired_.clear();
+			for (uint32_t id = Detach(SlotIndex(0, current_)); id != kNil;) {
+				Node& node = nodes_[id];
+				uint32_t next = node.next;
+				node.slot = kNil;
+				--size_;
+				expired_.push_back(id);
+				id = next;
+			}
+			for (uint32_t id : expired_) {
+				if (scheduled(id)) { continue; }
+				on_expire(id, nodes_[id].deadline);
+			}
+		}
+	}
+
+private:
+	static constexpr uint32_t kNil = std::numeric_limits<uint32_t>::max();
+	static constexpr size_t kSlotBits = 6;
+	static_assert(kSlots == (size_t{1} << kSlotBits));
+	static constexpr int64_t kRange = int64_t{1} << (kSlotBits * kLevels);
+
+	struct Node {
+		uint32_t prev = kNil;
+		uint32_t next = kNil;
+		uint32_t slot = kNil;  ///< 所在槽位, 未设置时为 `kNil`
+		Timestamp deadline = 0;
+	};
+
+	std::vector<Node> nodes_;  ///< 以定时器ID为下标
+	std::array<uint32_t, kLevels * kSlots> heads_;
+	std::vector<uint32_t> expired_;  ///< 本刻度到期的定时器
+	const Timestamp resolution_;
+	int64_t current_ = 0;  ///< 下一个待处理的刻度
+	size_t size_ = 0;
+	bool started_ = false;
+
+	int64_t Tick(Timestamp deadline) const noexcept { return (deadline + resolution_ - 1) / resolution_; }
+	static uint32_t SlotIndex(size_t level, int64_t tick) noexcept {
+		return static_cast<uint32_t>(level * kSlots + ((tick >> (kSlotBits * level)) & (kSlots - 1)));
+	}
+
+	void Link(uint32_t id) noexcept {
+		int64_t tick = Tick(nodes_[id].deadline);
+		if (tick < current_) { tick = current_; }
+		if (tick - current_ >= kRange) { tick = current_ + kRange - 1; }
+		int64_t delta = tick - current_;
+		size_t level = 0;
+		while ((level + 1 < kLevels) && (delta >= (int64_t{1} << (kSlotBits * (level + 1))))) { ++level; }
+
+		uint32_t slot = SlotIndex(level, tick);
+		Node& node = nodes_[id];
+		node.slot = slot;
+		node.prev = kNil;
+		node.next = heads_[slot];
+		if (node.next != kNil) { nodes_[node.next].prev = id; }
+		heads_[slot] = id;
+	}
+
+	void Unlink(uint32_t id) noexcept {
+		Node& node = nodes_[id];
+		if (node.prev != kNil) {
+			nodes_[node.prev].next = node.next;
+		} else {
+			heads_[node.slot] = node.next;
+		}
+		if (node.next != kNil) { nodes_[node.next].prev = node.prev; }
+		node.slot = kNil;
+	}
+
+	/// 取下槽位上的整条链表
+	uint32_t Detach(uint32_t slot) noexcept {
+		uint32_t head = heads_[slot];
+		heads_[slot] = kNil;
+		return head;
+	}
+
+	/// 跳至刻度 `target` 之后, 按到期时间回调不晚于 `target` 的定时器, 其余的重新挂入
+	template <typename OnExpire>
+	void Jump(int64_t target, OnExpire& on_expire) {
+		expired_.clear();
+		for (uint32_t slot = 0; slot < heads_.size(); ++slot) {
+			for (uint32_t id = Detach(slot); id != kNil; id = nodes_[id].next) { expired_.push_back(id); }
+		}
+		current_ = target + 1;
+		size_t count = 0;
+		for (uint32_t id : expired_) {
+			if (Tick(nodes_[id].deadline) <= target) {
+				nodes_[id].slot = kNil;
+				--size_;
+				expired_[count++] = id;
+			} else {
+				Link(id);
+			}
+		}
+		expired_.resize(count);
+		std::stable_sort(expired_.begin(), expired_.end(),
+						 [this](uint32_t lhs, uint32_t rhs) { return nodes_[lhs].deadline < nodes_[rhs].deadline; });
+		for (uint32_t id : expired_) {
+			if (scheduled(id)) { continue; }
+			on_expire(id, nodes_[id].deadline);
+		}
+	}
+
+	void Cascade(size_t level) noexcept {
+		uint32_t id = Detach(SlotIndex(level, current_));
+		while (id != kNil) {
+			uint32_t next = nodes_[id].next;
+			Link(id);
+			id = next;
+		}
+	}
+};
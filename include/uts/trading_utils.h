@@ -59,6 +59,47 @@ inline long HashOptionTicker(const OptionTicker& ticker) {
 	long month = atoi(StockIndexOptionYearMonth(ticker).c_str());
 	return month * 10000 + k;
 }
+/// 一天的纳秒数
+constexpr Timestamp kNanosecondsPerDay = 86400LL * 1'000'000'000LL;
+/// 北京时间与UTC的时差(纳秒)
+constexpr Timestamp kChinaTimeOffset = 8LL * 3600 * 1'000'000'000LL;
+
+/// 当前时间戳
+inline Timestamp Now() noexcept {
+	using namespace std::chrono;
+	return duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief 由北京时间的日期和日内时刻构造时间戳
+ * @param date 日期(YYYYMMDD)
+ * @param time_of_day 日内时刻, 自0点起的纳秒数
+ */
+inline Timestamp MakeTimestamp(int date, Timestamp time_of_day) noexcept {
+	using namespace std::chrono;
+	year_month_day ymd{year{date / 10000}, month{static_cast<unsigned>(date / 100 % 100)},
+					   day{static_cast<unsigned>(date % 100)}};
+	return sys_days{ymd}.time_since_epoch().count() * kNanosecondsPerDay + time_of_day - kChinaTimeOffset;
+}
+
+/// 时间戳对应的北京时间日期(YYYYMMDD)
+int TimestampToDate(Timestamp ts) noexcept;
+
+/**
+ * @brief 将时间戳格式化为北京时间 `YYYY-MM-DD hh:mm:ss.mmm`, 不分配内存
+ * @param ts 时间戳
+ * @param[out] buffer 输出缓冲区, 至少 `kDateTimeStrLength + 1` 字节, 结尾补 `\0`
+ * @return 写入的字符数(不含结尾的 `\0`)
+ */
+size_t FormatDateTime(Timestamp ts, char* buffer) noexcept;
+/// `FormatDateTime` 的长度
+constexpr size_t kDateTimeStrLength = 23;
+/// 将时间戳格式化为北京时间 `YYYY-MM-DD hh:mm:ss.mmm`
+inline DateTimeStr FormatDateTime(Timestamp ts) {
+	char buffer[kDateTimeStrLength + 1];
+	return DateTimeStr(buffer, FormatDateTime(ts, buffer));
+}
+
 /**
  * @brief 生成最近的期货闭市时间
  */
@@ -5,6 +5,7 @@
 
 #include <nlohmann/json.hpp>
 #include <uts/data_struct.h>
+#include <uts/eventbus.h>
 
 /**
  * @brief 交易账户基类, 所有交易相关的类由此派生
@@ -79,6 +80,9 @@ public:
 	/// Json化账户数据
 	virtual nlohmann::json CurrentInfoJson() const = 0;
 
+	/// 设置事件总线, 需在登录前设置. 委托回报, 成交回报和资金更新将发布至该总线
+	void SetEventBus(TradingEventBus* event_bus) { event_bus_ = event_bus; }
+
 protected:
 	ConnectionStatus connection_status_ = ConnectionStatus::Uninitialized;	///< 连接状态
 
@@ -93,4 +97,6 @@ protected:
 	std::map<InstrumentIndex, HoldingRecord> holding_;	///< 持仓记录
 	std::vector<TradingRecord> trades_;					///< 成交记录
 	std::map<OrderIndex, OrderRecord> orders_;			///< 委托记录
+
+	TradingEventBus* event_bus_ = nullptr;	///< 事件总线
 };
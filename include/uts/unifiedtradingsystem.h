@@ -68,14 +68,14 @@ public:
 	// queries
 	void QueryInstruments();
 	void QueryCommissionRate();
-	/// 订阅市场上的所有合约
-	void SubscribeInstruments();
-	/// 订阅指定合约
-	void SubscribeInstruments(const std::vector<Ticker>& tickers);
+	/// 订阅市场上的所有合约, 返回订阅失败的合约
+	std::vector<Ticker> SubscribeInstruments();
+	/// 订阅指定合约, 返回订阅失败的合约
+	std::vector<Ticker> SubscribeInstruments(const std::vector<Ticker>& tickers);
 	/// 筛选指定品种的所有合约
 	std::vector<Ticker> ListProducts(std::vector<ProductID> product_ids);
-	/// 订阅指定品种的所有合约
-	void SubscribeProducts(const std::vector<ProductID>& product_ids);
+	/// 订阅指定品种的所有合约, 返回订阅失败的合约
+	std::vector<Ticker> SubscribeProducts(const std::vector<ProductID>& product_ids);
 
 	// place orders
 	/// ASync下单
@@ -103,7 +103,6 @@ private:
 
 	std::map<Ticker, InstrumentInfo> instrument_info_;
 	MarketDataSource* market_data_source_ = nullptr;
-	std::map<Ticker, MarketDepth>* market_data_ = nullptr;
 	std::set<Ticker> no_close_today_tickers_;
 
 	// helper func
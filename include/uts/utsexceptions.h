@@ -26,6 +26,7 @@ protected:
 
 /// 误操作错误
 class InvalidOperationError : public UTSExceptions {
+public:
 	InvalidOperationError(const std::string& msg) { msg_ = msg; }
 };
 
@@ -0,0 +1,48 @@
+#include "archivedatarecorder.h"
+
+#include <exception>
+
+#include <spdlog/spdlog.h>
+
+ArchiveDataRecorder::ArchiveDataRecorder(const std::filesystem::path& directory,
+										 const std::map<Ticker, InstrumentInfo>& instruments)
+	: directory_(directory) {
+	std::filesystem::create_directories(directory_);
+	for (const auto& [ticker, info] : instruments) { price_ticks_.emplace(ticker, info.price_ticker); }
+	set_flush_interval(kDefaultFlushInterval);
+}
+
+ArchiveDataRecorder::~ArchiveDataRecorder() {
+	Stop();
+	writer_.reset();
+}
+
+std::filesystem::path ArchiveDataRecorder::FileName(const std::filesystem::path& directory, int trading_day) {
+	return directory / fmt::format("tick_{}.utstick", trading_day);
+}
+
+void ArchiveDataRecorder::WriteDB(const MarketDepth& data) {
+	if (!writer_ || (writer_->trading_day() != data.trading_day)) {
+		if (data.trading_day == failed_day_) {
+			AddDropped(1);
+			return;
+		}
+		writer_.reset();
+		std::filesystem::path filename = FileName(directory_, data.trading_day);
+		try {
+			writer_ = std::make_unique<TickArchiveWriter>(filename, data.trading_day, price_ticks_);
+		} catch (const std::exception& e) {
+			spdlog::error("ArchiveDataRecorder: cannot open {}: {}, ticks of trading day {} are dropped.",
+						  filename.string(), e.what(), data.trading_day);
+			failed_day_ = data.trading_day;
+			AddDropped(1);
+			return;
+		}
+		spdlog::info("ArchiveDataRecorder: recording trading day {} into {}.", data.trading_day, filename.string());
+	}
+	writer_->Append(data);
+}
+
+void ArchiveDataRecorder::Flush() {
+	if (writer_) { writer_->Flush(); }
+}
@@ -1,6 +1,5 @@
 #include "asyncquerymanager.h"
 
-#include <ranges>
 #include <thread>
 
 using std::function, std::chrono::milliseconds, std::unique_lock;
@@ -13,22 +12,26 @@ ASyncQueryManager::ASyncQueryManager(function<void()> func, milliseconds timeout
 ASyncQueryManager::~ASyncQueryManager() {}
 
 QueryCondition ASyncQueryManager::query(uint num_tries) {
-	for (uint _ : std::views::iota(num_tries)) {
-		std::cv_status cv_status;
+	for (uint i = 0; (num_tries == kRetryForever) || (i < num_tries); ++i) {
+		// func_ 可能同步调用 done, 因此不在持锁时调用
+		condition_ = QueryCondition::OnGoing;
+		func_();
+		bool responded;
 		{
 			unique_lock lock(mutex_);
-			condition_ = QueryCondition::OnGoing;
-			func_();
-			cv_status = cv_.wait_for(lock, timeout_);
+			responded = cv_.wait_for(lock, timeout_, [this]() { return condition_ != QueryCondition::OnGoing; });
 		}
-		if (cv_status == std::cv_status::timeout) { condition_ = QueryCondition::Timeout; }
+		if (!responded) { condition_ = QueryCondition::Timeout; }
 		if (condition_ == QueryCondition::Succcess) { return condition_; }
-		std::this_thread::sleep_for(wait_time_);
+		if ((num_tries == kRetryForever) || (i + 1 < num_tries)) { std::this_thread::sleep_for(wait_time_); }
 	}
 	return condition_;
 }
 
 void ASyncQueryManager::done(bool success) {
-	condition_ = success ? QueryCondition::Succcess : QueryCondition::Failed;
+	{
+		std::scoped_lock _(mutex_);
+		condition_ = success ? QueryCondition::Succcess : QueryCondition::Failed;
+	}
 	cv_.notify_one();
 }
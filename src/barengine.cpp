@@ -0,0 +1,140 @@
+#include "barengine.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "trading_utils.h"
+
+BarEngine::BarEngine(TradingEventBus& event_bus, Timestamp grace_period, int timer_interval)
+	: event_bus_(event_bus), grace_period_(grace_period), timer_interval_(timer_interval) {
+	subscription_ = event_bus_.Subscribe<MarketDepth, &BarEngine::OnMarketData>(this);
+	timer_ = std::thread(&BarEngine::TimerLoop, this);
+}
+
+BarEngine::~BarEngine() {
+	event_bus_.Unsubscribe<MarketDepth>(subscription_);
+	{
+		std::scoped_lock _(mutex_);
+		running_ = false;
+	}
+	timer_cv_.notify_one();
+	timer_.join();
+}
+
+void BarEngine::OnMarketData(const MarketDepth& md) {
+	if (md.symbol_id == kInvalidSymbol) { return; }
+	std::unique_lock lock(mutex_);
+	if (md.symbol_id >= states_.size()) { states_.resize(md.symbol_id + 1); }
+	InstrumentState& state = states_[md.symbol_id];
+	if (!state.seen) {
+		state.seen = true;
+		instruments_.push_back(md.symbol_id);
+	}
+	if (md.local_time != 0) { state.clock_offset = md.exchange_time - md.local_time; }
+
+	for (size_t period = 0; period < kPeriodCount; ++period) { Update(state, period, md); }
+	PublishFinished(lock);
+}
+
+void BarEngine::Update(InstrumentState& state, size_t period, const MarketDepth& md) {
+	Bar& bar = state.bars[period];
+	Timestamp length = kPeriodLength[period];
+	Timestamp start = md.exchange_time;
+	Timestamp end = md.exchange_time;
+	if (length > 0) {
+		start = md.exchange_time - ((md.exchange_time % length) + length) % length;
+		end = start + length;
+		if (end <= state.closed[period]) {
+			late_ticks_.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		if (state.open[period] && (bar.start_time != start)) { Close(state, period); }
+	} else if (state.open[period] && (bar.trading_day != md.trading_day)) {
+		Close(state, period);
+	}
+
+	Price last = md.ohlclvt.last;
+	if (!state.open[period]) {
+		state.open[period] = true;
+		bar = Bar{.symbol_id = md.symbol_id,
+				  .period = static_cast<BarPeriod>(period),
+				  .trading_day = md.trading_day,
+				  .start_time = start,
+				  .end_time = end,
+				  .open = last,
+				  .high = last,
+				  .low = last,
+				  .close = last,
+				  .volume = 0,
+				  .turnover = 0,
+				  .open_interest = md.open_interest,
+				  .tick_count = 0};
+	} else {
+		// 区间最高最低价包含两笔行情之间的成交
+		bar.high = std::max({bar.high, last, md.ohlclvt.high});
+		if (md.ohlclvt.low > 0) { bar.low = std::min({bar.low, last, md.ohlclvt.low}); }
+		bar.close = last;
+	}
+	if (length == 0) { bar.end_time = end; }
+	bar.volume += md.ohlclvt.volume;
+	bar.turnover += md.ohlclvt.turnover;
+	bar.open_interest = md.open_interest;
+	++bar.tick_count;
+}
+
+void BarEngine::Close(InstrumentState& state, size_t period) {
+	state.open[period] = false;
+	state.closed[period] = state.bars[period].end_time;
+	finished_.push_back(state.bars[period]);
+}
+
+void BarEngine::PublishFinished(std::unique_lock<std::mutex>& lock) {
+	// 同一时刻只有一个线程发布, 其他线程完成的K线由其按完成顺序一并发布
+	if (publishing_) { return; }
+	publishing_ = true;
+	std::vector<Bar> bars;
+	while (!finished_.empty()) {
+		bars.swap(finished_);
+		lock.unlock();
+		for (const Bar& bar : bars) { event_bus_.Publish(bar); }
+		bars.clear();
+		lock.lock();
+	}
+	publishing_ = false;
+}
+
+void BarEngine::CloseExpiredBars(Timestamp exchange_time) {
+	std::unique_lock lock(mutex_);
+	Timestamp local_time = Now();
+	for (SymbolID id : instruments_) {
+		InstrumentState& state = states_[id];
+		Timestamp now = exchange_time != 0 ? exchange_time : local_time + state.clock_offset;
+		for (size_t period = 0; period < kPeriodCount; ++period) {
+			if ((kPeriodLength[period] > 0) && state.open[period] &&
+				(now >= state.bars[period].end_time + grace_period_)) {
+				Close(state, period);
+			}
+		}
+	}
+	PublishFinished(lock);
+}
+
+void BarEngine::CloseSession() {
+	constexpr size_t session = static_cast<size_t>(BarPeriod::Session);
+	std::unique_lock lock(mutex_);
+	for (SymbolID id : instruments_) {
+		if (states_[id].open[session]) { Close(states_[id], session); }
+	}
+	PublishFinished(lock);
+}
+
+void BarEngine::TimerLoop() {
+	while (true) {
+		{
+			std::unique_lock lock(mutex_);
+			timer_cv_.wait_for(lock, std::chrono::milliseconds(timer_interval_), [this]() { return !running_; });
+			if (!running_) { return; }
+		}
+		CloseExpiredBars();
+	}
+}
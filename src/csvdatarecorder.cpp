@@ -1,23 +1,46 @@
 #include "csvdatarecorder.h"
 
-#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <string>
 
-CSVDataRecorder::CSVDataRecorder(const std::filesystem::path& filename) {
-	bool existed = std::filesystem::exists(filename);
-	out_ = std::ofstream(filename);
-	if (!existed) {
-		out_ << "DateTime, ID, Open, High, Low, Latest, TurnOver, Volume, OpenInterest, "
-				"BidPrice1, BidVolume1, AskPrice1, AskVolume1\n";
+#include "trading_utils.h"
+
+CSVDataRecorder::CSVDataRecorder(const std::filesystem::path& filename, size_t depth_levels, bool direct_io)
+	: writer_(filename, direct_io, CSVWriter::kDefaultBufferSize, ", "),
+	  depth_levels_(std::clamp<size_t>(depth_levels, 1, MarketDepth{}.bid.size())) {
+	if (writer_.new_file()) {
+		for (const char* column : {"DateTime", "ID", "Open", "High", "Low", "Latest", "TurnOver", "Volume",
+								   "OpenInterest", "BidPrice1", "BidVolume1", "AskPrice1", "AskVolume1"}) {
+			writer_.Write(column);
+		}
+		for (size_t level = 2; level <= depth_levels_; ++level) {
+			for (const char* column : {"BidPrice", "BidVolume", "AskPrice", "AskVolume"}) {
+				writer_.Write(column + std::to_string(level));
+			}
+		}
+		writer_.EndRow();
 	}
+	set_flush_interval(kDefaultFlushInterval);
 }
 
 void CSVDataRecorder::WriteDB(const MarketDepth& data) {
-	out_ << data.update_time << ", ";
-	out_ << data.instrument_id << ", " << data.ohlclvt.open << ", " << data.ohlclvt.high << ", " << data.ohlclvt.low
-		 << ", " << data.ohlclvt.last << ", ";
-	out_ << data.ohlclvt.turnover << ", " << data.ohlclvt.volume << ", ";
-	out_ << data.open_interest << ", ";
-	out_ << data.bid[0].price << ", " << data.bid[0].volume << ", " << data.ask[0].price << ", " << data.ask[0].volume
-		 << "\n";
-	spdlog::trace("market data processed.");
+	char datetime[kDateTimeStrLength + 1];
+	writer_.Write(std::string_view(datetime, FormatDateTime(data.exchange_time, datetime)));
+	writer_.Write(std::string_view(data.instrument_id));
+	writer_.Write(data.ohlclvt.open);
+	writer_.Write(data.ohlclvt.high);
+	writer_.Write(data.ohlclvt.low);
+	writer_.Write(data.ohlclvt.last);
+	writer_.Write(data.ohlclvt.turnover);
+	writer_.Write(data.ohlclvt.volume);
+	writer_.Write(data.open_interest);
+	for (size_t level = 0; level < depth_levels_; ++level) {
+		writer_.Write(data.bid[level].price);
+		writer_.Write(data.bid[level].volume);
+		writer_.Write(data.ask[level].price);
+		writer_.Write(data.ask[level].volume);
+	}
+	writer_.EndRow();
 }
+
+void CSVDataRecorder::Flush() { writer_.Flush(); }
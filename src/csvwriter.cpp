@@ -0,0 +1,132 @@
+#include "csvwriter.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#include <fcntl.h>
+#include <spdlog/spdlog.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "utsexceptions.h"
+
+namespace {
+size_t AlignUp(size_t length) {
+	return (length + CSVWriter::kAlignment - 1) / CSVWriter::kAlignment * CSVWriter::kAlignment;
+}
+
+#ifdef _WIN32
+int OpenFile(const std::filesystem::path& filename, bool) {
+	return _wopen(filename.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE);
+}
+long long WriteSome(int fd, const char* data, size_t length) {
+	return _write(fd, data, static_cast<unsigned int>(std::min<size_t>(length, 1 << 30)));
+}
+void CloseFile(int fd) { _close(fd); }
+bool DisableDirectIO(int) { return true; }
+#else
+int OpenFile(const std::filesystem::path& filename, bool direct_io) {
+	int flags = O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC;
+#ifdef O_DIRECT
+	if (direct_io) { flags |= O_DIRECT; }
+#endif
+	return open(filename.c_str(), flags, 0644);
+}
+long long WriteSome(int fd, const char* data, size_t length) { return write(fd, data, length); }
+void CloseFile(int fd) { close(fd); }
+bool DisableDirectIO([[maybe_unused]] int fd) {
+#ifdef O_DIRECT
+	return fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT) == 0;
+#else
+	return true;
+#endif
+}
+#endif
+}  // namespace
+
+CSVWriter::CSVWriter(const std::filesystem::path& filename, bool direct_io, size_t buffer_size,
+					 std::string_view separator)
+	: separator_(separator), capacity_(AlignUp(std::max(buffer_size, kAlignment))) {
+	std::error_code ec;
+	uintmax_t size = std::filesystem::file_size(filename, ec);
+	new_file_ = ec || (size == 0);
+#ifdef O_DIRECT
+	// `O_DIRECT` 要求写入位置对齐
+	direct_io_ = direct_io && (new_file_ || (size % kAlignment == 0));
+#endif
+	fd_ = OpenFile(filename, direct_io_);
+	if ((fd_ < 0) && direct_io_) {
+		spdlog::warn("CSVWriter: {} does not support O_DIRECT, fall back to buffered writes.", filename.string());
+		direct_io_ = false;
+		fd_ = OpenFile(filename, false);
+	}
+	if (fd_ < 0) { throw IOError(filename); }
+
+	buffer_.reset(static_cast<char*>(::operator new[](capacity_, std::align_val_t{kAlignment})));
+	pos_ = buffer_.get();
+	end_ = buffer_.get() + capacity_;
+}
+
+CSVWriter::~CSVWriter() { Close(); }
+
+void CSVWriter::Flush() {
+	if (fd_ < 0) { return; }
+	size_t length = pos_ - buffer_.get();
+	if (direct_io_) {
+		size_t aligned = length / kAlignment * kAlignment;
+		if (aligned == 0) { return; }
+		WriteFile(buffer_.get(), aligned);
+		std::memmove(buffer_.get(), buffer_.get() + aligned, length - aligned);
+		pos_ = buffer_.get() + (length - aligned);
+	} else {
+		WriteFile(buffer_.get(), length);
+		pos_ = buffer_.get();
+	}
+}
+
+void CSVWriter::Close() {
+	if (fd_ < 0) { return; }
+	Flush();
+	if (pos_ != buffer_.get()) {
+		// 不足一块的尾部以普通方式写入
+		if (DisableDirectIO(fd_)) { direct_io_ = false; }
+		WriteFile(buffer_.get(), pos_ - buffer_.get());
+		pos_ = buffer_.get();
+	}
+	CloseFile(fd_);
+	fd_ = -1;
+}
+
+void CSVWriter::Drain(size_t length) {
+	Flush();
+	size_t used = pos_ - buffer_.get();
+	if (capacity_ - used >= length) { return; }
+	// 单个字段超过缓冲区大小
+	size_t capacity = AlignUp(used + length);
+	std::unique_ptr<char[], AlignedDelete> buffer(
+		static_cast<char*>(::operator new[](capacity, std::align_val_t{kAlignment})));
+	std::memcpy(buffer.get(), buffer_.get(), used);
+	buffer_ = std::move(buffer);
+	capacity_ = capacity;
+	pos_ = buffer_.get() + used;
+	end_ = buffer_.get() + capacity_;
+}
+
+void CSVWriter::WriteFile(const char* data, size_t length) {
+	while (length > 0) {
+		long long written = WriteSome(fd_, data, length);
+		if (written < 0) {
+			if (errno == EINTR) { continue; }
+			spdlog::error("CSVWriter: write failed: {}, {} bytes dropped.", std::strerror(errno), length);
+			return;
+		}
+		data += written;
+		length -= static_cast<size_t>(written);
+	}
+}
@@ -1,12 +1,16 @@
 ﻿#include "ctp_utils.h"
 
+#include <chrono>
 #include <codecvt>
 #include <locale>
 #include <random>
 #include <string>
+#include <string_view>
 
 #include <spdlog/spdlog.h>
 
+#include "symboltable.h"
+#include "trading_utils.h"
 #include "utsexceptions.h"
 
 using std::string, std::string_view;
@@ -72,10 +76,54 @@ void RequestSendingConfirm(int code, string_view task) {
 	}
 }
 
+Timestamp ParseCTPDateTime(const char* action_day, const char* update_time, int millisec,
+						   Timestamp local_time) noexcept {
+	auto two_digits = [](const char* p) { return (p[0] - '0') * 10 + (p[1] - '0'); };
+	// hh:mm:ss
+	Timestamp seconds = two_digits(update_time) * 3600 + two_digits(update_time + 3) * 60 + two_digits(update_time + 6);
+	Timestamp time_of_day = seconds * 1'000'000'000LL + millisec * 1'000'000LL;
+
+	if (local_time == 0) { return MakeTimestamp(CTPDateToInt(action_day), time_of_day); }
+
+	Timestamp local_day = (local_time + kChinaTimeOffset) / kNanosecondsPerDay;
+	Timestamp ret = local_day * kNanosecondsPerDay + time_of_day - kChinaTimeOffset;
+	if (ret - local_time > kNanosecondsPerDay / 2) {
+		ret -= kNanosecondsPerDay;
+	} else if (local_time - ret > kNanosecondsPerDay / 2) {
+		ret += kNanosecondsPerDay;
+	}
+	return ret;
+}
+
+int NormalizeTradingDay(int trading_day, Timestamp exchange_time) noexcept {
+	constexpr Timestamp kEvening = 18LL * 3600 * 1'000'000'000LL;
+	Timestamp local = exchange_time + kChinaTimeOffset;
+	if (local % kNanosecondsPerDay < kEvening) { return trading_day; }
+
+	int date = TimestampToDate(exchange_time);
+	if (trading_day > date) { return trading_day; }
+
+	using namespace std::chrono;
+	sys_days next_day = sys_days{days{local / kNanosecondsPerDay}} + days{1};
+	while (weekday{next_day}.iso_encoding() > 5) { next_day += days{1}; }
+	return TimestampToDate(next_day.time_since_epoch().count() * kNanosecondsPerDay);
+}
+
+Exchange ParseCTPExchange(const char* exchange_id) noexcept {
+	std::string_view id(exchange_id);
+	if (id == "SHFE") { return Exchange::SHF; }
+	if (id == "DCE") { return Exchange::DCE; }
+	if (id == "CZCE") { return Exchange::CZC; }
+	if (id == "CFFEX") { return Exchange::CFE; }
+	if (id == "INE") { return Exchange::INE; }
+	return Exchange::NA;
+}
+
 InstrumentInfo TranslateInstrumentInfo(const CThostFtdcInstrumentField* const pInstrument) {
 	InstrumentInfo info{
 		.is_trading = (pInstrument->IsTrading == '1'),
 		.instrument_id = pInstrument->InstrumentID,
+		.symbol_id = SymbolTable::Instance().Intern(pInstrument->InstrumentID),
 		.instrument_name = GB2312ToUTF8(pInstrument->InstrumentName),
 		.exchange = kExchangeTranslator.at(pInstrument->ExchangeID),
 		.product_id = pInstrument->ProductID,
@@ -111,6 +159,7 @@ TradingRecord TradeField2TradingRecord(CThostFtdcTradeField* pTrade) {
 		.order_ref = atol(pTrade->OrderRef),
 		.exchange = kExchangeTranslator.at(pTrade->ExchangeID),
 		.instrument_id = pTrade->InstrumentID,
+		.symbol_id = SymbolTable::Instance().Intern(pTrade->InstrumentID),
 		.open_close = kOpenCloseTranslator.at(pTrade->OffsetFlag),
 		.direction = (pTrade->Direction == THOST_FTDC_D_Buy) ? Direction::Long : Direction::Short,
 		.hedge_flag = kHedgeFlagTranslator.at(pTrade->HedgeFlag),
@@ -128,6 +177,7 @@ OrderRecord OrderField2OrderRecord(CThostFtdcOrderField* pOrder) {
 		.order_ref = atol(pOrder->OrderRef),
 		.exchange = kExchangeTranslator.at(pOrder->ExchangeID),
 		.instrument_id = pOrder->InstrumentID,
+		.symbol_id = SymbolTable::Instance().Intern(pOrder->InstrumentID),
 		.open_close = kOpenCloseTranslator.at(pOrder->CombOffsetFlag[0]),
 		.direction = (pOrder->Direction == THOST_FTDC_D_Buy) ? Direction::Long : Direction::Short,
 		.hedge_flag = kHedgeFlagTranslator.at(pOrder->CombHedgeFlag[0]),
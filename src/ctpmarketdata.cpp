@@ -1,22 +1,65 @@
 ﻿#include "ctpmarketdata.h"
 
+#include <algorithm>
 #include <chrono>
+#include <cstring>
+#include <map>
+#include <optional>
+#include <ranges>
+#include <thread>
 
 #include <spdlog/spdlog.h>
 
 #include "ctp_utils.h"
+#include "latencymonitor.h"
+#include "symboltable.h"
+#include "trading_utils.h"
 #include "utsexceptions.h"
 
 using std::vector, std::string;
-using std::chrono_literals::operator""s;
+
+namespace {
+/// 记录进入行情回调时的延迟, 并从行情中登记合约所属交易所
+void RecordCallbackLatency(size_t front, SymbolID id, CThostFtdcDepthMarketDataField* pDepthMarketData,
+						   Timestamp exchange_time, Timestamp local_time) {
+	LatencyMonitor& monitor = LatencyMonitor::Instance();
+	if ((pDepthMarketData->ExchangeID[0] != '\0') && (monitor.exchange(id) == Exchange::NA)) {
+		monitor.SetExchange(id, ParseCTPExchange(pDepthMarketData->ExchangeID));
+	}
+	monitor.Record(LatencyStage::Callback, id, local_time - exchange_time, front);
+}
+}  // namespace
+
+/// 冗余行情中第二个及以后的前置. 使用独立的API实例, 收到的行情交给所属的行情源仲裁, 自身不保存行情快照
+class CTPMarketDataBase::RedundantFront final : public CTPMarketDataBase {
+public:
+	RedundantFront(CTPMarketDataBase* owner, size_t index, const IPAddress& server_addr)
+		: CTPMarketDataBase(vector<IPAddress>{server_addr}, 0), owner_(owner), index_(index) {
+		// 不可用的冗余前置只尝试一次, 不阻塞登录
+		log_in_tries_ = 1;
+		arbitrated_ = true;
+	}
+	~RedundantFront() override { LogOut(); }
+
+protected:
+	void ProcessDepthMarketData(CThostFtdcDepthMarketDataField* pDepthMarketData, Timestamp local_time) override {
+		owner_->ArbitrateDepthMarketData(index_, pDepthMarketData, local_time);
+	}
+
+private:
+	CTPMarketDataBase* owner_;
+	size_t index_;
+};
 
 /**
  * @brief 构造CTPMarketData
  * @details 构造期间会在系统临时文件夹创建一个缓存文件.
  * @param server_addr CTP行情服务器地址. 需注明协议和端口, 如: "ctp://1.2.3.4:5678"
+ * @param snapshot_capacity 行情快照仓库的槽位数量
  * @exception FlowFolderCreationError 临时文件夹无法建立时抛出
  */
-CTPMarketDataBase::CTPMarketDataBase(const vector<IPAddress>& server_addr) : MarketDataSource(server_addr) {
+CTPMarketDataBase::CTPMarketDataBase(const vector<IPAddress>& server_addr, size_t snapshot_capacity)
+	: MarketDataSource(server_addr, snapshot_capacity) {
 	try {
 		cache_path_ = CreateTempFlowFolder("_md_flow");
 		spdlog::trace("CTPM: market data cache is ready, cache folder name: {}.", cache_path_.string());
@@ -27,6 +70,8 @@ CTPMarketDataBase::CTPMarketDataBase(const vector<IPAddress>& server_addr) : Mar
 }
 
 CTPMarketDataBase::~CTPMarketDataBase() {
+	// 派生类已析构, 环形缓冲区中剩余的行情直接丢弃
+	discard_ring_ = true;
 	CTPMarketDataBase::LogOut();
 	DeleteTempFlowFolder(cache_path_);
 }
@@ -37,7 +82,8 @@ CTPMarketDataBase::~CTPMarketDataBase() {
  * @exception LoginError 登录失败
  */
 void CTPMarketDataBase::LogIn() {
-	QueryCondition c = log_in_query_manager_.query();
+	StartRingDispatch();
+	QueryCondition c = log_in_query_manager_.query(log_in_tries_);
 	if (c == QueryCondition::Timeout) {
 		throw NetworkError("Market info");
 	} else if (status_ == ConnectionStatus::Connected) {
@@ -46,11 +92,14 @@ void CTPMarketDataBase::LogIn() {
 		spdlog::info("CTPM: Failed to log in CTP market data server.");
 		throw LoginError();
 	}
+	LogInRedundantFronts();
 }
 void CTPMarketDataBase::LogInASync() noexcept {
 	md_api_ = CThostFtdcMdApi::CreateFtdcMdApi(cache_path_.string().c_str());
 	md_api_->RegisterSpi(this);
-	for (IPAddress& addr : server_addr_) {
+	// 冗余行情模式下本实例只连接第一个前置, 其余前置各自使用独立的API实例
+	size_t front_count = arbiter_ ? 1 : server_addr_.size();
+	for (IPAddress& addr : server_addr_ | std::views::take(front_count)) {
 		if (addr.substr(4, 2) != "//") { addr = "tcp://" + addr; }
 		md_api_->RegisterFront(const_cast<char*>(addr.c_str()));
 	}
@@ -75,6 +124,7 @@ void CTPMarketDataBase::OnRspUserLogin(CThostFtdcRspUserLoginField*, CThostFtdcR
  * @brief 登出
  */
 void CTPMarketDataBase::LogOut() noexcept {
+	LogOutRedundantFronts();
 	if (is_logged_in()) {
 		if (subscribed_tickers_.size() != 0) {
 			vector<Ticker> tickers(subscribed_tickers_.begin(), subscribed_tickers_.end());
@@ -87,11 +137,14 @@ void CTPMarketDataBase::LogOut() noexcept {
 		if (c == QueryCondition::Timeout) { spdlog::error("CTPM: logging out timeout."); }
 		status_ = ConnectionStatus::Disconnected;
 		spdlog::debug("CTPM:Log off market info.");
-
+	}
+	// 登录失败或已断开的API仍会回调, 析构前须解除回调对象并释放
+	if (md_api_ != nullptr) {
 		md_api_->RegisterSpi(nullptr);
 		md_api_->Release();
 		md_api_ = nullptr;
 	}
+	StopRingDispatch();
 }
 void CTPMarketDataBase::LogOutASync() noexcept {
 	CThostFtdcUserLogoutField a{};
@@ -112,156 +165,359 @@ void CTPMarketDataBase::OnRspUserLogout(CThostFtdcUserLogoutField*, CThostFtdcRs
 /**
  * @brief 订阅合约
  * @param ticker_list 新订阅的Ticker序列
- * @note 该函数每100个ticker发送一次订阅请求.
- * @exception NetworkError 网络错误, 无法连接服务器
+ * @return 订阅失败或超时的合约
+ * @note 请求每100个ticker一批连续发送, 所有批次共用一次等待. 回报按合约逐个核销
+ * @exception NetworkError 网络错误, 所有合约均未收到回报
  */
-void CTPMarketDataBase::Subscribe(const vector<Ticker>& ticker_list) {
-	size_t count = 0;
-	size_t list_size = ticker_list.size();
-	char** instruments = new char*[list_size];
-	for (const auto& ticker : ticker_list) {
-		if (!subscribed_tickers_.contains(ticker)) {
-			instruments[count] = const_cast<char*>(ticker.c_str());
-			++count;
-		}
-	}
-	spdlog::trace("CTPM: Asked to subscribe {} ticker, {} not in current subscribe list", list_size, count);
-
-	flexible_query_manager_.set_timeout(1s);
-	if (count > 0) {
-		const size_t increment = 100;
-		for (size_t start_index = 0; start_index < count; start_index += increment) {
-			size_t num = std::min(increment, count - start_index);
-
-			auto func = [&]() {
-				int rt = md_api_->SubscribeMarketData(instruments + start_index, static_cast<int>(num));
-				RequestSendingConfirm(rt, "Subscribe market data");
-				if (rt != 0) { flexible_query_manager_.done(false); }
-			};
-			flexible_query_manager_.set_func(func);
-
-			QueryCondition c = flexible_query_manager_.query();
-			if (c == QueryCondition::Timeout) {
-				delete[] instruments;
-				throw NetworkError("market data");
-			}
-		}
-		spdlog::trace("CTPM: CTPMarketData: request to subscribe {} contracts, {} contracts currently subscribed",
-					  count, subscribed_tickers_.size());
-	}
-	delete[] instruments;
+vector<Ticker> CTPMarketDataBase::Subscribe(const vector<Ticker>& ticker_list) {
+	return RequestAllFronts(ticker_list, true);
 }
 void CTPMarketDataBase::OnRspSubMarketData(CThostFtdcSpecificInstrumentField* pSpecificInstrument,
-										   CThostFtdcRspInfoField*, int, bool bIsLast) {
-	subscribed_tickers_.insert(Ticker(pSpecificInstrument->InstrumentID));
-	if (bIsLast) { flexible_query_manager_.done(true); }
+										   CThostFtdcRspInfoField* pRspInfo, int, bool) {
+	OnSubscriptionResponse(pSpecificInstrument, pRspInfo, true);
 }
 
 /**
  * @brief 取消合约订阅
- * @param ticker_list 新订阅的Ticker序列
- * @note 该函数每100个ticker发送一次取消订阅请求.
- * @exception NetworkError 网络错误, 无法连接服务器
+ * @param ticker_list 取消订阅的Ticker序列
+ * @return 取消订阅失败或超时的合约
+ * @note 请求每100个ticker一批连续发送, 所有批次共用一次等待. 回报按合约逐个核销
+ * @exception NetworkError 网络错误, 所有合约均未收到回报
+ */
+vector<Ticker> CTPMarketDataBase::Unsubscribe(const vector<Ticker>& ticker_list) {
+	return RequestAllFronts(ticker_list, false);
+}
+void CTPMarketDataBase::OnRspUnSubMarketData(CThostFtdcSpecificInstrumentField* pSpecificInstrument,
+											 CThostFtdcRspInfoField* pRspInfo, int, bool) {
+	OnSubscriptionResponse(pSpecificInstrument, pRspInfo, false);
+}
+
+/**
+ * @brief 在所有前置上(解除)订阅. 各前置同时发送请求并等待回报, 总耗时不超过一次等待
+ * @note 合约在任一前置成功即视为成功, 所有前置均无回报时抛出 `NetworkError`
  */
-void CTPMarketDataBase::Unsubscribe(const vector<Ticker>& ticker_list) {
-	size_t count = 0;
-	size_t list_size = ticker_list.size();
-	char** instruments = new char*[list_size];
-	for (const auto& ticker : ticker_list) {
-		if (subscribed_tickers_.contains(ticker)) {
-			instruments[count] = const_cast<char*>(ticker.c_str());
-			++count;
+vector<Ticker> CTPMarketDataBase::RequestAllFronts(const vector<Ticker>& ticker_list, bool subscribe) {
+	if (fronts_.empty()) { return RequestSubscription(ticker_list, subscribe); }
+
+	size_t front_count = fronts_.size() + 1;
+	// 各前置失败的合约, 无回报时为空
+	vector<std::optional<vector<Ticker>>> results(front_count);
+	auto request = [&](CTPMarketDataBase& front, size_t i) {
+		try {
+			results[i] = front.RequestSubscription(ticker_list, subscribe);
+		} catch (const NetworkError&) {}
+	};
+	{
+		vector<std::jthread> threads;
+		threads.reserve(fronts_.size());
+		for (size_t i = 0; i < fronts_.size(); ++i) { threads.emplace_back(request, std::ref(*fronts_[i]), i + 1); }
+		request(*this, 0);
+	}
+
+	size_t timeout_count = 0;
+	std::map<Ticker, size_t> failures;
+	for (const auto& result : results) {
+		if (!result) { ++timeout_count; }
+		for (const auto& ticker : result ? *result : ticker_list) { ++failures[ticker]; }
+	}
+	if (timeout_count == front_count) { throw NetworkError("market data"); }
+
+	vector<Ticker> failed;
+	for (const auto& [ticker, count] : failures) {
+		if (count >= front_count) { failed.push_back(ticker); }
+	}
+	return failed;
+}
+
+vector<Ticker> CTPMarketDataBase::RequestSubscription(const vector<Ticker>& ticker_list, bool subscribe) {
+	const char* task = subscribe ? "Subscribe market data" : "Unsubscribe market data";
+	vector<Ticker> requested;
+	{
+		std::scoped_lock _(subscription_mutex_);
+		for (const auto& ticker : ticker_list) {
+			if ((subscribed_tickers_.contains(ticker) != subscribe) && pending_tickers_.insert(ticker).second) {
+				requested.push_back(ticker);
+			}
 		}
 	}
-	spdlog::trace("CTPM: Asked to unsubscribe {} ticker, {} in current subscribe list", list_size, count);
-	flexible_query_manager_.set_timeout(1s);
-	if (count > 0) {
-		const size_t increment = 100;
-		for (size_t start_index = 0; start_index < count; start_index += increment) {
-			size_t num = std::min(increment, count - start_index);
-
-			auto func = [&]() {
-				int rt = md_api_->UnSubscribeMarketData(instruments + start_index, static_cast<int>(num));
-				RequestSendingConfirm(rt, "Unsubscribe market data");
-				if (rt != 0) { flexible_query_manager_.done(false); }
-			};
-			flexible_query_manager_.set_func(func);
-
-			QueryCondition c = flexible_query_manager_.query();
-			if (c == QueryCondition::Timeout) {
-				delete[] instruments;
-				throw NetworkError("market data");
+	spdlog::trace("CTPM: {}: asked for {} tickers, {} to be requested", task, ticker_list.size(), requested.size());
+	if (requested.empty()) { return {}; }
+
+	// CTP行情接口的(取消)订阅请求不带请求编号, 回报按合约代码核销
+	vector<char*> instruments;
+	instruments.reserve(requested.size());
+	for (auto& ticker : requested) { instruments.push_back(ticker.data()); }
+	vector<Ticker> failed;
+	for (size_t start_index = 0; start_index < instruments.size(); start_index += kSubscriptionBatchSize) {
+		int num = static_cast<int>(std::min(kSubscriptionBatchSize, instruments.size() - start_index));
+		int rt = subscribe ? md_api_->SubscribeMarketData(instruments.data() + start_index, num)
+						   : md_api_->UnSubscribeMarketData(instruments.data() + start_index, num);
+		RequestSendingConfirm(rt, task);
+		if (rt != 0) {
+			std::scoped_lock _(subscription_mutex_);
+			for (int i = 0; i < num; ++i) {
+				pending_tickers_.erase(requested[start_index + i]);
+				failed.push_back(requested[start_index + i]);
 			}
-			spdlog::trace("CTPM: Unsubscribe tickers successful.");
 		}
 	}
-	delete[] instruments;
+
+	size_t timeout_count = 0;
+	{
+		std::unique_lock lock(subscription_mutex_);
+		auto all_responded = [&]() {
+			return std::ranges::none_of(requested, [&](const Ticker& t) { return pending_tickers_.contains(t); });
+		};
+		subscription_cv_.wait_for(lock, subscription_timeout_, all_responded);
+		for (const auto& ticker : requested) {
+			if (pending_tickers_.erase(ticker) > 0) {
+				++timeout_count;
+				failed.push_back(ticker);
+			} else if (rejected_tickers_.erase(ticker) > 0) {
+				failed.push_back(ticker);
+			}
+		}
+	}
+	if (timeout_count == requested.size()) { throw NetworkError("market data"); }
+	if (!failed.empty()) { spdlog::warn("CTPM: {}: {} of {} tickers failed.", task, failed.size(), requested.size()); }
+	spdlog::trace("CTPM: {}: {} contracts currently subscribed", task, subscribed_tickers_.size());
+	return failed;
 }
 
-void CTPMarketDataBase::OnRspUnSubMarketData(CThostFtdcSpecificInstrumentField* pSpecificInstrument,
-											 CThostFtdcRspInfoField*, int, bool bIsLast) {
+void CTPMarketDataBase::OnSubscriptionResponse(CThostFtdcSpecificInstrumentField* pSpecificInstrument,
+											   CThostFtdcRspInfoField* pRspInfo, bool subscribe) {
+	if (pSpecificInstrument == nullptr) { return; }
 	Ticker ticker(pSpecificInstrument->InstrumentID);
-	subscribed_tickers_.erase(ticker);
-	market_data_.erase(ticker);
-	if (bIsLast) { flexible_query_manager_.done(true); }
+	bool success = (pRspInfo == nullptr) || (pRspInfo->ErrorID == 0);
+	if (!success) { ErrorResponse(pRspInfo); }
+
+	if (success && subscribe) {
+		if (SymbolTable::Instance().Intern(ticker) == kInvalidSymbol) {
+			spdlog::error("CTPM: symbol table is full, {} will not be cached.", ticker);
+		}
+	} else if (success) {
+		// 冗余前置不保存行情快照
+		SymbolID id = SymbolTable::Instance().Find(ticker);
+		if (id < market_data_.capacity()) { market_data_.Clear(id); }
+	}
+
+	bool notify;
+	{
+		std::scoped_lock _(subscription_mutex_);
+		if (success && subscribe) {
+			subscribed_tickers_.insert(ticker);
+		} else if (success) {
+			subscribed_tickers_.erase(ticker);
+		}
+		notify = pending_tickers_.erase(ticker) > 0;
+		if (notify && !success) { rejected_tickers_.insert(ticker); }
+	}
+	if (notify) { subscription_cv_.notify_all(); }
 }
 
-void CTPMarketData::OnRtnDepthMarketData(CThostFtdcDepthMarketDataField* pDepthMarketData) {
-	MarketDepth md = CTPMarketData2MarketDepth(pDepthMarketData);
-	market_data_[md.instrument_id] = md;
+void CTPMarketDataBase::EnableRingDispatch(size_t capacity) {
+	if (is_logged_in()) {
+		spdlog::error("CTPM: ring dispatch has to be enabled before logging in.");
+		return;
+	}
+	ring_ = std::make_unique<SPSCRing<RawDepthMarketData>>(capacity);
+	spdlog::debug("CTPM: ring dispatch enabled, capacity: {}.", ring_->capacity());
+}
+
+void CTPMarketDataBase::OnRtnDepthMarketData(CThostFtdcDepthMarketDataField* pDepthMarketData) {
+	Timestamp local_time = Now();
+	if (arbiter_) {
+		ArbitrateDepthMarketData(0, pDepthMarketData, local_time);
+		return;
+	}
+	if (!arbitrated_ && LatencyMonitor::Instance().enabled()) {
+		RecordCallbackLatency(0, SymbolTable::Instance().Find(pDepthMarketData->InstrumentID), pDepthMarketData,
+							  ParseCTPDateTime(pDepthMarketData->ActionDay, pDepthMarketData->UpdateTime,
+											   pDepthMarketData->UpdateMillisec, local_time),
+							  local_time);
+	}
+	DeliverDepthMarketData(pDepthMarketData, local_time);
+}
+
+void CTPMarketDataBase::DeliverDepthMarketData(CThostFtdcDepthMarketDataField* pDepthMarketData,
+											   Timestamp local_time) {
+	if (!ring_) {
+		ProcessDepthMarketData(pDepthMarketData, local_time);
+		return;
+	}
+	std::unique_lock lock(ring_producer_mutex_, std::defer_lock);
+	if (arbiter_) { lock.lock(); }
+	if (!ring_->TryPush({*pDepthMarketData, local_time})) { ring_overruns_.fetch_add(1, std::memory_order_relaxed); }
+}
+
+void CTPMarketDataBase::EnableRedundantFronts() {
+	if (is_logged_in()) {
+		spdlog::error("CTPM: redundant fronts have to be enabled before logging in.");
+		return;
+	}
+	if (server_addr_.size() < 2) {
+		spdlog::warn("CTPM: only one market data server is given, redundant fronts are not enabled.");
+		return;
+	}
+	arbiter_ = std::make_unique<TickArbiter>(server_addr_.size());
+	spdlog::debug("CTPM: redundant fronts enabled, {} fronts.", server_addr_.size());
+}
+
+vector<TickArbiter::FrontStatistics> CTPMarketDataBase::front_statistics() const {
+	vector<TickArbiter::FrontStatistics> ret;
+	if (arbiter_) {
+		for (size_t i = 0; i < arbiter_->front_count(); ++i) { ret.push_back(arbiter_->statistics(i)); }
+	}
+	return ret;
+}
+
+void CTPMarketDataBase::LogInRedundantFronts() {
+	if (!arbiter_) { return; }
+	// 各前置同时登录
+	vector<std::unique_ptr<RedundantFront>> fronts(server_addr_.size());
+	{
+		vector<std::jthread> threads;
+		threads.reserve(server_addr_.size() - 1);
+		for (size_t i = 1; i < server_addr_.size(); ++i) {
+			threads.emplace_back([this, &fronts, i]() {
+				try {
+					auto front = std::make_unique<RedundantFront>(this, i, server_addr_[i]);
+					front->LogIn();
+					fronts[i] = std::move(front);
+				} catch (const std::exception& e) {
+					spdlog::warn("CTPM: redundant front {} is not available: {}", server_addr_[i], e.what());
+				}
+			});
+		}
+	}
+	for (auto& front : fronts) {
+		if (front) { fronts_.push_back(std::move(front)); }
+	}
+	spdlog::info("CTPM: {} of {} market data fronts logged in.", fronts_.size() + 1, server_addr_.size());
+}
+
+void CTPMarketDataBase::LogOutRedundantFronts() noexcept {
+	if (fronts_.empty()) { return; }
+	fronts_.clear();
+	vector<TickArbiter::FrontStatistics> statistics = front_statistics();
+	for (size_t i = 0; i < statistics.size(); ++i) {
+		const auto& front = statistics[i];
+		spdlog::info("CTPM: front {}: {} ticks, win rate {:.1f}%, {} stale, delay mean {}us max {}us.",
+					 server_addr_[i], front.ticks, front.win_rate() * 100, front.stale, front.mean_delay / 1000,
+					 front.max_delay / 1000);
+	}
 }
 
-MarketDepth CTPMarketData::CTPMarketData2MarketDepth(CThostFtdcDepthMarketDataField* pDepthMarketData) {
-	MarketDepth md;
+void CTPMarketDataBase::ArbitrateDepthMarketData(size_t front, CThostFtdcDepthMarketDataField* pDepthMarketData,
+												 Timestamp local_time) {
+	SymbolID id = SymbolTable::Instance().Find(pDepthMarketData->InstrumentID);
+	if (id == kInvalidSymbol) {
+		// 未登记的合约无法去重, 只采用第一个前置的行情
+		if (front == 0) { DeliverDepthMarketData(pDepthMarketData, local_time); }
+		return;
+	}
+	Timestamp exchange_time = ParseCTPDateTime(pDepthMarketData->ActionDay, pDepthMarketData->UpdateTime,
+											   pDepthMarketData->UpdateMillisec, local_time);
+	if (LatencyMonitor::Instance().enabled()) {
+		RecordCallbackLatency(front, id, pDepthMarketData, exchange_time, local_time);
+	}
+	arbiter_->Arbitrate(front, id, exchange_time, pDepthMarketData->Volume, local_time,
+						[&]() { DeliverDepthMarketData(pDepthMarketData, local_time); });
+}
 
-	auto id = pDepthMarketData->InstrumentID;
-	md.instrument_id = id;
+void CTPMarketDataBase::StartRingDispatch() {
+	if (!ring_ || dispatcher_.joinable()) { return; }
+	dispatching_ = true;
+	dispatcher_ = std::thread(&CTPMarketDataBase::Dispatch, this);
+}
 
-	string dt(pDepthMarketData->ActionDay);
-	md.update_time = dt.substr(0, 4) + '-' + dt.substr(4, 2) + '-' + dt.substr(6, 2) + ' ' +
-					 pDepthMarketData->UpdateTime + '.' + std::to_string(pDepthMarketData->UpdateMillisec);
+void CTPMarketDataBase::StopRingDispatch() {
+	if (!dispatcher_.joinable()) { return; }
+	dispatching_ = false;
+	ring_->Wake();
+	dispatcher_.join();
+	if (uint64_t overruns = ring_overruns(); overruns > 0) {
+		spdlog::warn("CTPM: {} ticks dropped due to full ring buffer.", overruns);
+	}
+}
 
-	md.settle = SanitizeData(pDepthMarketData->SettlementPrice);
-	md.average_price = pDepthMarketData->AveragePrice;
-	md.upper_limit = pDepthMarketData->UpperLimitPrice;
-	md.lower_limit = pDepthMarketData->LowerLimitPrice;
+void CTPMarketDataBase::Dispatch() {
+	RawDepthMarketData data;
+	while (!discard_ring_.load(std::memory_order_relaxed)) {
+		if (ring_->TryPop(data)) {
+			ProcessDepthMarketData(&data.field, data.local_time);
+		} else if (dispatching_) {
+			ring_->WaitForData([this]() { return !dispatching_; });
+		} else {
+			break;
+		}
+	}
+}
 
-	double open = pre_latest_[id];
+void CTPMarketData::ProcessDepthMarketData(CThostFtdcDepthMarketDataField* pDepthMarketData, Timestamp local_time) {
+	MarketDepth md = CTPMarketData2MarketDepth(pDepthMarketData, local_time);
+	if (option_chain_) {
+		std::scoped_lock _(option_chain_mutex_);
+		option_chain_->Enrich(md);
+	}
+	LatencyMonitor& monitor = LatencyMonitor::Instance();
+	bool monitored = monitor.enabled();
+	if (monitored) { monitor.Record(LatencyStage::Normalized, md.symbol_id, Now() - md.exchange_time); }
+	if (md.symbol_id != kInvalidSymbol) { market_data_.Store(md.symbol_id, md); }
+	if (event_bus_) {
+		event_bus_->Publish(md);
+		if (monitored) { monitor.Record(LatencyStage::Published, md.symbol_id, Now() - md.exchange_time); }
+	}
+}
+
+MarketDepth CTPMarketData::CTPMarketData2MarketDepth(CThostFtdcDepthMarketDataField* pDepthMarketData,
+													 Timestamp local_time) {
+	MarketDepth md{};
+
+	std::strncpy(md.instrument_id, pDepthMarketData->InstrumentID, sizeof(md.instrument_id) - 1);
+	md.symbol_id = SymbolTable::Instance().Intern(pDepthMarketData->InstrumentID);
+
+	md.local_time = local_time;
+	md.exchange_time = ParseCTPDateTime(pDepthMarketData->ActionDay, pDepthMarketData->UpdateTime,
+										pDepthMarketData->UpdateMillisec, local_time);
+	md.trading_day = NormalizeTradingDay(CTPDateToInt(pDepthMarketData->TradingDay), md.exchange_time);
+
+	if (md.symbol_id == kInvalidSymbol) {
+		// 符号表已满而无法登记的合约没有派生状态, 不计算区间成交量和成交额
+		double last = SanitizeData(pDepthMarketData->LastPrice);
+		md.ohlclvt = {.open = last, .high = last, .low = last, .last = pDepthMarketData->LastPrice};
+		md.open_interest = static_cast<int>(pDepthMarketData->OpenInterest);
+		NormalizeDepthMarketData(*pDepthMarketData, md);
+		return md;
+	}
+
+	DerivationState& state = derivation_state_[md.symbol_id];
+	// 新交易日或累计成交量回退(行情前置重启)时, 以本笔行情为起点重新计算
+	if ((state.trading_day != md.trading_day) || (pDepthMarketData->Volume < state.volume)) {
+		state = {.trading_day = md.trading_day, .latest = pDepthMarketData->LastPrice};
+	}
+
+	double open = state.latest;
 	double close = pDepthMarketData->LastPrice;
 	double high =
-		pDepthMarketData->HighestPrice > pre_high_[id] ? pDepthMarketData->HighestPrice : std::max(open, close);
-	double low = pDepthMarketData->LowestPrice < pre_low_[id] ? pDepthMarketData->LowestPrice : std::min(open, close);
-	double turnover = pDepthMarketData->Turnover - pre_turnover_[id];
-	int volume = pDepthMarketData->Volume - pre_volume_[id];
+		pDepthMarketData->HighestPrice > state.high ? pDepthMarketData->HighestPrice : std::max(open, close);
+	double low = pDepthMarketData->LowestPrice < state.low ? pDepthMarketData->LowestPrice : std::min(open, close);
+	double turnover = pDepthMarketData->Turnover - state.turnover;
+	int volume = pDepthMarketData->Volume - state.volume;
 
-	pre_latest_[id] = close;
-	pre_high_[id] = pDepthMarketData->HighestPrice;
-	pre_low_[id] = pDepthMarketData->LowestPrice;
-	pre_turnover_[id] = pDepthMarketData->Turnover;
-	pre_volume_[id] = pDepthMarketData->Volume;
+	state.volume = pDepthMarketData->Volume;
+	state.latest = close;
+	state.high = pDepthMarketData->HighestPrice;
+	state.low = pDepthMarketData->LowestPrice;
+	state.turnover = pDepthMarketData->Turnover;
 
 	md.ohlclvt = {.open = SanitizeData(open),
 				  .high = SanitizeData(high),
 				  .low = SanitizeData(low),
-				  .close = SanitizeData(pDepthMarketData->ClosePrice),
 				  .last = pDepthMarketData->LastPrice,
 				  .volume = volume,
 				  .turnover = turnover};
 	md.open_interest = static_cast<int>(pDepthMarketData->OpenInterest);
-	md.delta = SanitizeData(pDepthMarketData->CurrDelta);
-	md.ask = {
-		PriceVolume{SanitizeData(pDepthMarketData->AskPrice1), pDepthMarketData->AskVolume1},
-		PriceVolume{SanitizeData(pDepthMarketData->AskPrice2), pDepthMarketData->AskVolume2},
-		PriceVolume{SanitizeData(pDepthMarketData->AskPrice3), pDepthMarketData->AskVolume3},
-		PriceVolume{SanitizeData(pDepthMarketData->AskPrice4), pDepthMarketData->AskVolume4},
-		PriceVolume{SanitizeData(pDepthMarketData->AskPrice5), pDepthMarketData->AskVolume5},
-	};
-	md.bid = {
-		PriceVolume{SanitizeData(pDepthMarketData->BidPrice1), pDepthMarketData->BidVolume1},
-		PriceVolume{SanitizeData(pDepthMarketData->BidPrice2), pDepthMarketData->BidVolume2},
-		PriceVolume{SanitizeData(pDepthMarketData->BidPrice3), pDepthMarketData->BidVolume3},
-		PriceVolume{SanitizeData(pDepthMarketData->BidPrice4), pDepthMarketData->BidVolume4},
-		PriceVolume{SanitizeData(pDepthMarketData->BidPrice5), pDepthMarketData->BidVolume5},
-	};
+	NormalizeDepthMarketData(*pDepthMarketData, md);
 	return md;
 }
@@ -2,11 +2,21 @@
 
 #include <spdlog/spdlog.h>
 
-void CTPMarketDataRecorder::OnRtnDepthMarketData(CThostFtdcDepthMarketDataField* pDepthMarketData) {
+#include "latencymonitor.h"
+#include "trading_utils.h"
+
+void CTPMarketDataRecorder::ProcessDepthMarketData(CThostFtdcDepthMarketDataField* pDepthMarketData,
+												   Timestamp local_time) {
 	spdlog::trace("new market data received.");
-	if (data_recorder_) {
-		data_recorder_->DataSink(CTPMarketData2MarketDepth(pDepthMarketData));
-	} else {
+	if (!data_recorder_ && !event_bus_) {
 		spdlog::warn("No data recorder is specified. Data ignored!!!");
+		return;
+	}
+	MarketDepth md = CTPMarketData2MarketDepth(pDepthMarketData, local_time);
+	if (LatencyMonitor::Instance().enabled()) {
+		LatencyMonitor::Instance().Record(LatencyStage::Normalized, md.symbol_id, Now() - md.exchange_time);
 	}
+	if (data_recorder_) { data_recorder_->DataSink(md); }
+	// 发布至事件总线供 `BarEngine` 合成K线
+	if (event_bus_) { event_bus_->Publish(md); }
 }
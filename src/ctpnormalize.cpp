@@ -0,0 +1,88 @@
+#include <cstddef>
+
+#include "ctp_utils.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define UTS_AVX2_KERNEL
+#endif
+
+using Field = CThostFtdcDepthMarketDataField;
+
+// 向量化实现按CTP行情的内存布局成块读取: 收盘价至跌停价相邻,
+// 每档为 买价, 买量, 卖价, 卖量 共32字节, 买量和卖量之后的填充与 `PriceVolume` 一致
+static_assert(offsetof(Field, SettlementPrice) == offsetof(Field, ClosePrice) + 8);
+static_assert(offsetof(Field, UpperLimitPrice) == offsetof(Field, ClosePrice) + 16);
+static_assert(offsetof(Field, LowerLimitPrice) == offsetof(Field, ClosePrice) + 24);
+static_assert(offsetof(Field, BidVolume1) == offsetof(Field, BidPrice1) + offsetof(PriceVolume, volume));
+static_assert(offsetof(Field, AskPrice1) == offsetof(Field, BidPrice1) + sizeof(PriceVolume));
+static_assert(offsetof(Field, AskVolume1) == offsetof(Field, AskPrice1) + offsetof(PriceVolume, volume));
+static_assert(offsetof(Field, BidPrice2) == offsetof(Field, BidPrice1) + 2 * sizeof(PriceVolume));
+static_assert(offsetof(Field, BidPrice5) == offsetof(Field, BidPrice1) + 8 * sizeof(PriceVolume));
+static_assert(sizeof(PriceVolume) == 16);
+
+void NormalizeDepthMarketDataScalar(const Field& field, MarketDepth& md) noexcept {
+	md.ohlclvt.close = SanitizeData(field.ClosePrice);
+	md.settle = SanitizeData(field.SettlementPrice);
+	md.upper_limit = SanitizeData(field.UpperLimitPrice);
+	md.lower_limit = SanitizeData(field.LowerLimitPrice);
+	md.average_price = SanitizeData(field.AveragePrice);
+	md.delta = SanitizeData(field.CurrDelta);
+	md.bid = {
+		PriceVolume{SanitizeData(field.BidPrice1), field.BidVolume1},
+		PriceVolume{SanitizeData(field.BidPrice2), field.BidVolume2},
+		PriceVolume{SanitizeData(field.BidPrice3), field.BidVolume3},
+		PriceVolume{SanitizeData(field.BidPrice4), field.BidVolume4},
+		PriceVolume{SanitizeData(field.BidPrice5), field.BidVolume5},
+	};
+	md.ask = {
+		PriceVolume{SanitizeData(field.AskPrice1), field.AskVolume1},
+		PriceVolume{SanitizeData(field.AskPrice2), field.AskVolume2},
+		PriceVolume{SanitizeData(field.AskPrice3), field.AskVolume3},
+		PriceVolume{SanitizeData(field.AskPrice4), field.AskVolume4},
+		PriceVolume{SanitizeData(field.AskPrice5), field.AskVolume5},
+	};
+}
+
+#ifdef UTS_AVX2_KERNEL
+/// 将不小于1e308(含NaN)的值替换为 -1, 只处理 `lanes` 中置位的通道
+template <int lanes>
+__attribute__((target("avx2"))) static inline __m256d Sanitize(__m256d v) noexcept {
+	__m256d valid = _mm256_cmp_pd(v, _mm256_set1_pd(1e308), _CMP_LT_OQ);
+	return _mm256_blend_pd(v, _mm256_blendv_pd(_mm256_set1_pd(-1.0), v, valid), lanes);
+}
+
+__attribute__((target("avx2"))) void NormalizeDepthMarketDataAVX2(const Field& field, MarketDepth& md) noexcept {
+	const char* base = reinterpret_cast<const char*>(&field);
+
+	alignas(32) double prices[4];
+	_mm256_store_pd(prices, Sanitize<0b1111>(_mm256_loadu_pd(&field.ClosePrice)));
+	md.ohlclvt.close = prices[0];
+	md.settle = prices[1];
+	md.upper_limit = prices[2];
+	md.lower_limit = prices[3];
+	md.average_price = SanitizeData(field.AveragePrice);
+	md.delta = SanitizeData(field.CurrDelta);
+
+	// 每档 [买价, 买量, 卖价, 卖量] 一次读入, 只替换价格通道, 量按位原样复制
+	const char* level = base + offsetof(Field, BidPrice1);
+	for (size_t i = 0; i < md.bid.size(); ++i, level += 2 * sizeof(PriceVolume)) {
+		__m256d v = Sanitize<0b0101>(_mm256_loadu_pd(reinterpret_cast<const double*>(level)));
+		_mm_storeu_pd(reinterpret_cast<double*>(&md.bid[i]), _mm256_castpd256_pd128(v));
+		_mm_storeu_pd(reinterpret_cast<double*>(&md.ask[i]), _mm256_extractf128_pd(v, 1));
+	}
+}
+
+bool CPUSupportsAVX2() noexcept { return __builtin_cpu_supports("avx2"); }
+#else
+void NormalizeDepthMarketDataAVX2(const Field& field, MarketDepth& md) noexcept {
+	NormalizeDepthMarketDataScalar(field, md);
+}
+
+bool CPUSupportsAVX2() noexcept { return false; }
+#endif
+
+void NormalizeDepthMarketData(const Field& field, MarketDepth& md) noexcept {
+	static const auto normalize = CPUSupportsAVX2() ? &NormalizeDepthMarketDataAVX2 : &NormalizeDepthMarketDataScalar;
+	normalize(field, md);
+}
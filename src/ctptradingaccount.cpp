@@ -8,6 +8,7 @@
 
 #include "ctp_utils.h"
 #include "enum_utils.h"
+#include "symboltable.h"
 #include "trading_utils.h"
 #include "utsexceptions.h"
 
@@ -492,9 +493,10 @@ void CTPTradingAccount::QueryCapitalASync() noexcept {
 }
 void CTPTradingAccount::OnRspQryTradingAccount(CThostFtdcTradingAccountField* pTradingAccount, CThostFtdcRspInfoField*,
 											   int, bool) {
+	CapitalInfo capital;
 	{
 		scoped_lock _(capital_mutex_);
-		capital_ = CapitalInfo{
+		capital = capital_ = CapitalInfo{
 			.balance = pTradingAccount->Balance,
 			.margin_used = pTradingAccount->CurrMargin,
 			.available = pTradingAccount->Balance - pTradingAccount->CurrMargin,
@@ -504,6 +506,7 @@ void CTPTradingAccount::OnRspQryTradingAccount(CThostFtdcTradingAccountField* pT
 		spdlog::trace("CTPTS: {}: balance: {:.2f}, margin: {:.2f}, conmmission: {:.2f}", id_, capital_.balance,
 					  capital_.margin_used, capital_.commission);
 	}
+	if (event_bus_) { event_bus_->Publish(capital); }
 	query_capital_query_manager_.done(true);
 }
 
@@ -535,7 +538,8 @@ void CTPTradingAccount::OnRspQryInvestorPosition(CThostFtdcInvestorPositionField
 		Direction direction =
 			(pInvestorPosition->PosiDirection == THOST_FTDC_PD_Long ? Direction::Long : Direction::Short);
 		HedgeFlagType hedge_flag = kHedgeFlagTranslator.at(pInvestorPosition->HedgeFlag);
-		InstrumentIndex index{instrument_id, direction, hedge_flag};
+		SymbolID symbol_id = SymbolTable::Instance().Intern(instrument_id);
+		InstrumentIndex index{symbol_id, instrument_id, direction, hedge_flag};
 		if (holding_.contains(index)) {
 			auto& loc = holding_.at(index);
 			loc.total_quantity += pInvestorPosition->YdPosition;
@@ -544,6 +548,7 @@ void CTPTradingAccount::OnRspQryInvestorPosition(CThostFtdcInvestorPositionField
 			HoldingRecord rec{
 				.exchange = kExchangeTranslator.at(pInvestorPosition->ExchangeID),
 				.instrument_id = instrument_id,
+				.symbol_id = symbol_id,
 				.direction = direction,
 				.hedge_flag = hedge_flag,
 				.total_quantity = pInvestorPosition->YdPosition,
@@ -562,14 +567,18 @@ void CTPTradingAccount::OnRspQryInvestorPosition(CThostFtdcInvestorPositionField
 /// 接收成交情况
 void CTPTradingAccount::OnRtnTrade(CThostFtdcTradeField* pTrade) {
 	spdlog::trace("CTPTS: New return trade.");
-	auto trade = TradeField2TradingRecord(pTrade);
+	TradingRecord trade = TradeField2TradingRecord(pTrade);
+	UpdateHolding(trade);
+	if (event_bus_) { event_bus_->Publish(trade); }
+}
 
+void CTPTradingAccount::UpdateHolding(TradingRecord trade) {
 	scoped_lock _(trades_mutex_, holding_mutex_);
 	trades_.push_back(trade);
 
 	if (trade.open_close != OpenCloseType::Open) { trade.direction = ReverseDirection(trade.direction); }
 
-	InstrumentIndex index{trade.instrument_id, trade.direction, trade.hedge_flag};
+	InstrumentIndex index{trade.symbol_id, trade.instrument_id, trade.direction, trade.hedge_flag};
 	if (holding_.contains(index)) {
 		auto& loc = holding_.at(index);
 		loc.total_quantity += EnumToPositiveOrNegative<OpenCloseType>(trade.open_close) * trade.volume;
@@ -616,6 +625,7 @@ void CTPTradingAccount::OnRtnTrade(CThostFtdcTradeField* pTrade) {
 		// new openings
 		HoldingRecord rec{.exchange = trade.exchange,
 						  .instrument_id = trade.instrument_id,
+						  .symbol_id = trade.symbol_id,
 						  .direction = trade.direction,
 						  .hedge_flag = trade.hedge_flag,
 						  .total_quantity = trade.volume,
@@ -649,6 +659,7 @@ void CTPTradingAccount::OnRtnOrder(CThostFtdcOrderField* pOrder) {
 	spdlog::trace("CTPTS: Order Aquired.");
 	OrderRef order_ref = atol(pOrder->OrderRef);
 	OrderIndex index{pOrder->FrontID, pOrder->SessionID, order_ref};
+	OrderRecord record;
 	{
 		scoped_lock lock(order_mutex_);
 		auto loc = orders_.find(index);
@@ -670,7 +681,9 @@ void CTPTradingAccount::OnRtnOrder(CThostFtdcOrderField* pOrder) {
 			}
 		}
 		FilterCancelableOrders(loc);
+		if (event_bus_) { record = loc->second; }
 	}
+	if (event_bus_) { event_bus_->Publish(record); }
 	spdlog::trace("CTPTS: Return Order processed.");
 }
 
@@ -1,42 +1,346 @@
 #include "datarecorder.h"
 
+#include <algorithm>
+#include <utility>
+
 #include <spdlog/spdlog.h>
 
+#include "latencymonitor.h"
+#include "trading_utils.h"
+#include "utsexceptions.h"
+
+namespace {
+/// 当前线程正在 `Write` 的数据记录器及其间丢弃的笔数
+thread_local const DataRecorder* writing_recorder = nullptr;
+thread_local uint64_t dropped_in_write = 0;
+}  // namespace
+
 DataRecorder::DataRecorder() { worker_ = std::thread(&DataRecorder::Process, this); }
 
 DataRecorder::~DataRecorder() {
 	spdlog::trace("destroying data recorder");
-	working_ = false;
-	cv_.notify_one();
-	worker_.join();
+	StopWorker(false);
+}
+
+void DataRecorder::Stop() { StopWorker(true); }
+
+void DataRecorder::StopWorker(bool flush) {
+	if (worker_.joinable()) {
+		{
+			std::scoped_lock _(mutex_);
+			working_ = false;
+			flush_on_stop_ = flush;
+		}
+		cv_.notify_one();
+		space_cv_.notify_all();
+		worker_.join();
+	}
+	// 记录线程补写完转存文件后再停止转存线程
+	StopSpillThread();
+}
+
+void DataRecorder::StopSpillThread() {
+	if (!spill_thread_.joinable()) { return; }
+	{
+		std::scoped_lock _(mutex_);
+		spilling_ = false;
+	}
+	spill_cv_.notify_one();
+	spill_thread_.join();
+}
+
+void DataRecorder::SetBackpressurePolicy(size_t capacity, BackpressurePolicy policy,
+										 const std::filesystem::path& spill_file) {
+	{
+		std::scoped_lock _(mutex_);
+		if ((size_ != 0) || (writing_ != 0) || (spill_backlog_ != 0)) {
+			throw InvalidOperationError("DataRecorder: backpressure policy changed with pending data");
+		}
+	}
+	// 先打开转存文件, 失败时保留原来的设置
+	std::fstream spill;
+	if (policy == BackpressurePolicy::SpillToDisk) {
+		spill.open(spill_file, std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc);
+		if (!spill) { throw IOError(spill_file); }
+	}
+	StopSpillThread();
+
+	std::scoped_lock _(mutex_);
+	capacity = std::max<size_t>(capacity, 1);
+	pending_.assign(capacity, MarketDepth{});
+	batch_.assign(capacity, MarketDepth{});
+	head_ = 0;
+	policy_ = policy;
+	spill_chunk_.clear();
+	spill_chunk_size_ = 0;
+	spill_enqueued_ = 0;
+
+	std::scoped_lock spill_lock(spill_mutex_);
+	spill_ = std::move(spill);
+	spill_base_ = 0;
+	spill_read_ = 0;
+	spill_written_ = 0;
+	spill_path_ = spill_file;
+	spill_buffer_.clear();
+	if (policy_ == BackpressurePolicy::SpillToDisk) {
+		spill_chunk_.resize(capacity);
+		spill_buffer_.resize(capacity);
+		spilling_ = true;
+		spill_thread_ = std::thread(&DataRecorder::SpillLoop, this);
+	}
+}
+
+RecorderStatistics DataRecorder::statistics() const {
+	std::scoped_lock _(mutex_);
+	RecorderStatistics ret = statistics_;
+	ret.written = written_.load(std::memory_order_relaxed);
+	ret.pending = size_ + writing_ + spill_backlog_;
+	return ret;
 }
 
 void DataRecorder::DataSink(const MarketDepth& data) {
+	if (LatencyMonitor::Instance().enabled()) {
+		LatencyMonitor::Instance().Record(LatencyStage::RecorderQueued, data.symbol_id, Now() - data.exchange_time);
+	}
+	bool was_empty = false;
+	{
+		std::unique_lock lock(mutex_);
+		++statistics_.received;
+		size_t capacity = pending_.size();
+		if (size_ == capacity) {
+			switch (policy_) {
+				case BackpressurePolicy::Block:
+					++statistics_.blocked;
+					space_cv_.wait(lock, [this, capacity]() { return (size_ < capacity) || !working_; });
+					break;
+				case BackpressurePolicy::DropOldest:
+					head_ = (head_ + 1) % capacity;
+					--size_;
+					++statistics_.dropped;
+					break;
+				case BackpressurePolicy::SpillToDisk:
+					// 转存线程仍在写入上一次转存的缓冲区时等待
+					if (spill_chunk_size_ != 0) {
+						++statistics_.blocked;
+						space_cv_.wait(lock, [this, capacity]() {
+							return (size_ < capacity) || (spill_chunk_size_ == 0) || !working_;
+						});
+					}
+					if ((size_ == capacity) && (spill_chunk_size_ == 0)) { Spill(); }
+					break;
+			}
+		}
+		// 记录线程停止后不再接收
+		if (!working_ || (size_ == capacity)) {
+			++statistics_.dropped;
+			return;
+		}
+		was_empty = (size_ == 0);
+		pending_[(head_ + size_) % capacity] = data;
+		++size_;
+	}
+	// 记录线程只在缓冲区为空时等待
+	if (was_empty) { cv_.notify_one(); }
+}
+
+void DataRecorder::Spill() {
+	// 只交换缓冲区, 由转存线程写入文件, 写入方不等待磁盘
+	std::swap(pending_, spill_chunk_);
+	spill_chunk_head_ = head_;
+	spill_chunk_size_ = size_;
+	statistics_.spilled += size_;
+	spill_backlog_ += size_;
+	spill_enqueued_ += size_;
+	head_ = 0;
+	size_ = 0;
+	spill_cv_.notify_one();
+}
+
+void DataRecorder::SpillLoop() {
+	std::unique_lock lock(mutex_);
+	while (true) {
+		spill_cv_.wait(lock, [this]() { return (spill_chunk_size_ != 0) || !spilling_; });
+		if (spill_chunk_size_ == 0) { break; }
+		size_t head = spill_chunk_head_;
+		size_t size = spill_chunk_size_;
+		lock.unlock();
+		{
+			std::scoped_lock spill_lock(spill_mutex_);
+			size_t first = std::min(size, spill_chunk_.size() - head);
+			spill_.seekp(static_cast<std::streamoff>((spill_written_ - spill_base_) * sizeof(MarketDepth)));
+			spill_.write(reinterpret_cast<const char*>(&spill_chunk_[head]),
+						 static_cast<std::streamsize>(first * sizeof(MarketDepth)));
+			spill_.write(reinterpret_cast<const char*>(spill_chunk_.data()),
+						 static_cast<std::streamsize>((size - first) * sizeof(MarketDepth)));
+			spill_.flush();
+			if (!spill_) { spdlog::error("DataRecorder: failed to write spill file {}.", spill_path_.string()); }
+			spill_written_ += size;
+		}
+		spilled_cv_.notify_all();
+		lock.lock();
+		spill_chunk_size_ = 0;
+		space_cv_.notify_all();
+	}
+}
+
+void DataRecorder::DrainSpill(uint64_t limit) {
+	std::unique_lock spill_lock(spill_mutex_);
+	while (spill_read_ < limit) {
+		// 交换前转存的数据可能仍在转存线程中
+		spilled_cv_.wait(spill_lock, [this]() { return spill_written_ > spill_read_; });
+		size_t count = std::min<uint64_t>(std::min(spill_written_, limit) - spill_read_, spill_buffer_.size());
+		spill_.seekg(static_cast<std::streamoff>((spill_read_ - spill_base_) * sizeof(MarketDepth)));
+		spill_.read(reinterpret_cast<char*>(spill_buffer_.data()),
+					static_cast<std::streamsize>(count * sizeof(MarketDepth)));
+		bool read = static_cast<bool>(spill_);
+		if (!read) {
+			// 跳过无法读取的数据, 计入丢弃
+			spdlog::error("DataRecorder: failed to read spill file {}.", spill_path_.string());
+			spill_.clear();
+		}
+		spill_read_ += count;
+		// 补写时不持有锁, 转存线程可继续写入
+		spill_lock.unlock();
+		if (read) { Write(std::span<const MarketDepth>(spill_buffer_.data(), count)); }
+		{
+			std::scoped_lock _(mutex_);
+			spill_backlog_ -= count;
+			if (!read) { statistics_.dropped += count; }
+		}
+		spill_lock.lock();
+	}
+	// 全部补写后清空文件, 之后转存的数据从文件开头写起
+	if ((spill_written_ > spill_base_) && (spill_read_ == spill_written_)) {
+		spill_.close();
+		spill_.open(spill_path_, std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc);
+		spill_base_ = spill_written_;
+	}
+}
+
+void DataRecorder::set_flush_interval(std::chrono::milliseconds interval) {
+	std::scoped_lock _(mutex_);
+	flush_interval_ = interval;
+	flush_when_idle_ = true;
+}
+
+void DataRecorder::AddDropped(uint64_t count) {
 	{
 		std::scoped_lock _(mutex_);
-		q_.push(data);
+		statistics_.dropped += count;
+	}
+	// `Write` 中丢弃的由 `Write` 扣除, 其他(如异步发送失败)丢弃的已计入 `written`
+	if (writing_recorder == this) {
+		dropped_in_write += count;
+	} else {
+		written_.fetch_sub(count, std::memory_order_relaxed);
+	}
+}
+
+void DataRecorder::WriteDB(std::span<const MarketDepth> data) {
+	for (const MarketDepth& md : data) { WriteDB(md); }
+}
+
+void DataRecorder::Write(std::span<const MarketDepth> data) {
+	if (data.empty()) { return; }
+	const DataRecorder* outer = std::exchange(writing_recorder, this);
+	uint64_t outer_dropped = std::exchange(dropped_in_write, 0);
+	WriteDB(data);
+	// 丢弃的笔数可能包括之前已计入 `written` 的缓存数据
+	uint64_t dropped = std::min<uint64_t>(dropped_in_write, data.size());
+	written_.fetch_add(data.size() - dropped, std::memory_order_relaxed);
+	if (dropped_in_write > dropped) { written_.fetch_sub(dropped_in_write - dropped, std::memory_order_relaxed); }
+	writing_recorder = outer;
+	dropped_in_write = outer_dropped;
+	if (LatencyMonitor::Instance().enabled()) {
+		Timestamp now = Now();
+		for (const MarketDepth& md : data) {
+			LatencyMonitor::Instance().Record(LatencyStage::RecorderWritten, md.symbol_id, now - md.exchange_time);
+		}
 	}
-	cv_.notify_one();
 }
 
 void DataRecorder::Process() {
-	MarketDepth data;
-	while (working_) {
-		spdlog::trace("still working.");
+	while (true) {
+		size_t head = 0;
+		size_t size = 0;
+		bool spilled = false;
+		uint64_t spill_limit = 0;
+		bool idle = false;
+		bool flush = false;
 		{
-			spdlog::trace("waiting.");
-			std::unique_lock lock_(mutex_);
-			if (q_.empty()) { cv_.wait(lock_); }
-			spdlog::trace("woke up.");
-		}
-		while (!q_.empty()) {
-			{
-				std::scoped_lock _(mutex_);
-				data = q_.front();
-				q_.pop();
-			}
-			WriteDB(data);
+			std::unique_lock lock(mutex_);
+			idle = !cv_.wait_for(lock, flush_interval_,
+								 [this]() { return (size_ != 0) || (spill_backlog_ != 0) || !working_; });
+			flush = flush_when_idle_;
+		}
+		// 空闲超过 `flush_interval_` 时让子类提交已写入的数据, 子类构造完成前不调用
+		if (idle) {
+			if (flush) { Flush(); }
+			continue;
+		}
+		{
+			std::unique_lock lock(mutex_);
+			if (!working_ && (!flush_on_stop_ || ((size_ == 0) && (spill_backlog_ == 0)))) { break; }
+			std::swap(pending_, batch_);
+			std::swap(head_, head);
+			std::swap(size_, size);
+			writing_ = size;
+			spilled = (spill_backlog_ != 0);
+			spill_limit = spill_enqueued_;
 		}
+		space_cv_.notify_all();
+
+		// 交换前转存的数据早于本批数据, 先行补写. 之后转存的数据晚于本批数据, 留待下一轮
+		if (spilled) { DrainSpill(spill_limit); }
+		size_t first = std::min(size, batch_.size() - head);
+		Write(std::span<const MarketDepth>(batch_.data() + head, first));
+		Write(std::span<const MarketDepth>(batch_.data(), size - first));
+		std::scoped_lock _(mutex_);
+		writing_ = 0;
 	}
+	if (flush_on_stop_) { Flush(); }
 	spdlog::trace("no longer working");
 }
+
+BarRecorder::BarRecorder() { worker_ = std::thread(&BarRecorder::Process, this); }
+
+BarRecorder::~BarRecorder() { StopWorker(false); }
+
+void BarRecorder::Stop() { StopWorker(true); }
+
+void BarRecorder::StopWorker(bool flush) {
+	if (!worker_.joinable()) { return; }
+	{
+		std::scoped_lock _(mutex_);
+		working_ = false;
+		flush_on_stop_ = flush;
+	}
+	cv_.notify_one();
+	worker_.join();
+}
+
+void BarRecorder::BarSink(const Bar& bar) {
+	bool was_empty;
+	{
+		std::scoped_lock _(mutex_);
+		if (!working_) { return; }
+		was_empty = pending_.empty();
+		pending_.push_back(bar);
+	}
+	if (was_empty) { cv_.notify_one(); }
+}
+
+void BarRecorder::Process() {
+	std::vector<Bar> bars;
+	std::unique_lock lock(mutex_);
+	while (true) {
+		cv_.wait(lock, [this]() { return !pending_.empty() || !working_; });
+		if (!working_ && (!flush_on_stop_ || pending_.empty())) { break; }
+		bars.swap(pending_);
+		lock.unlock();
+		WriteBars(bars);
+		written_.fetch_add(bars.size(), std::memory_order_relaxed);
+		bars.clear();
+		lock.lock();
+	}
+}
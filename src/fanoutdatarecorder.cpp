@@ -0,0 +1,332 @@
+#include "fanoutdatarecorder.h"
+
+#include <algorithm>
+#include <span>
+
+#include <spdlog/spdlog.h>
+
+#include "latencymonitor.h"
+#include "trading_utils.h"
+#include "utsexceptions.h"
+
+FanoutDataRecorder::FanoutDataRecorder(size_t capacity, BackpressurePolicy policy,
+									   const std::filesystem::path& spill_file)
+	: DataRecorder(NoWorker{}),
+	  max_chunks_(std::max<size_t>(2, (capacity + kChunkRows - 1) / kChunkRows)),
+	  policy_(policy),
+	  spill_path_(spill_file) {
+	if (policy_ == BackpressurePolicy::SpillToDisk) {
+		spill_.open(spill_path_, std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc);
+		if (!spill_) { throw IOError(spill_path_); }
+		StartSpillThread();
+	}
+}
+
+FanoutDataRecorder::~FanoutDataRecorder() { Stop(); }
+
+size_t FanoutDataRecorder::AddSink(DataRecorder* sink, size_t batch_size) {
+	// 组合记录器不经 `Write` 写入, 其 `WriteDB` 为空
+	if (sink->composite_) { throw InvalidOperationError("FanoutDataRecorder: composite recorder added as sink"); }
+	// 停止其记录线程, 之后只由分发记录器调用其写入函数
+	sink->Stop();
+	std::chrono::milliseconds flush_interval;
+	{
+		std::scoped_lock _(sink->mutex_);
+		flush_interval = sink->flush_interval_;
+	}
+
+	std::scoped_lock _(mutex_);
+	if (!working_) { throw InvalidOperationError("FanoutDataRecorder: sink added after stop"); }
+	Sink& ret = *sinks_.emplace_back(std::make_unique<Sink>());
+	ret.recorder = sink;
+	ret.batch_size = std::max<size_t>(batch_size, 1);
+	ret.flush_interval = flush_interval;
+	ret.cursor = head_;
+	if (policy_ == BackpressurePolicy::SpillToDisk) { ret.buffer.resize(ret.batch_size); }
+	ret.worker = std::thread(&FanoutDataRecorder::Run, this, std::ref(ret));
+	return sinks_.size() - 1;
+}
+
+void FanoutDataRecorder::SetBackpressurePolicy(size_t capacity, BackpressurePolicy policy,
+											   const std::filesystem::path& spill_file) {
+	std::scoped_lock _(mutex_);
+	Reclaim();
+	if ((MinCursor() != head_) || (spill_rows_ != 0)) {
+		throw InvalidOperationError("FanoutDataRecorder: backpressure policy changed with pending data");
+	}
+	// 先打开转存文件, 失败时保留原来的设置
+	std::fstream spill;
+	if (policy == BackpressurePolicy::SpillToDisk) {
+		spill.open(spill_file, std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc);
+		if (!spill) { throw IOError(spill_file); }
+	}
+	max_chunks_ = std::max<size_t>(2, (capacity + kChunkRows - 1) / kChunkRows);
+	policy_ = policy;
+
+	std::scoped_lock spill_lock(spill_mutex_);
+	spill_ = std::move(spill);
+	spill_written_ = 0;
+	spill_path_ = spill_file;
+	if (policy_ == BackpressurePolicy::SpillToDisk) { StartSpillThread(); }
+	// 写入线程只在读取转存文件时使用读取缓冲区, 此时没有写入线程在读取
+	for (auto& sink : sinks_) {
+		sink->buffer.resize(policy_ == BackpressurePolicy::SpillToDisk ? sink->batch_size : 0);
+	}
+}
+
+void FanoutDataRecorder::set_flush_interval(std::chrono::milliseconds interval) {
+	std::scoped_lock _(mutex_);
+	for (auto& sink : sinks_) {
+		sink->flush_interval = interval;
+		sink->cv.notify_one();
+	}
+}
+
+void FanoutDataRecorder::Stop() {
+	{
+		std::scoped_lock _(mutex_);
+		working_ = false;
+		for (auto& sink : sinks_) { sink->cv.notify_one(); }
+	}
+	space_cv_.notify_all();
+	for (auto& sink : sinks_) {
+		if (sink->worker.joinable()) { sink->worker.join(); }
+	}
+	// 写入线程补写转存数据时需要转存线程, 最后停止
+	if (spill_thread_.joinable()) {
+		{
+			std::scoped_lock _(mutex_);
+			spilling_ = false;
+		}
+		spill_cv_.notify_one();
+		spill_thread_.join();
+	}
+}
+
+void FanoutDataRecorder::StartSpillThread() {
+	if (spill_thread_.joinable()) { return; }
+	spilling_ = true;
+	spill_thread_ = std::thread(&FanoutDataRecorder::SpillLoop, this);
+}
+
+void FanoutDataRecorder::DataSink(const MarketDepth& data) {
+	if (LatencyMonitor::Instance().enabled()) {
+		LatencyMonitor::Instance().Record(LatencyStage::RecorderQueued, data.symbol_id, Now() - data.exchange_time);
+	}
+	std::unique_lock lock(mutex_);
+	++statistics_.received;
+	if (!working_) {
+		++statistics_.dropped;
+		return;
+	}
+	// 最后一个数据块已满
+	if (head_ == memory_begin_ + chunks_.size() * kChunkRows) {
+		if (chunks_.size() == max_chunks_) { Reclaim(); }
+		if (chunks_.size() == max_chunks_) {
+			if (policy_ == BackpressurePolicy::Block) {
+				++statistics_.blocked;
+				space_cv_.wait(lock, [this]() { return (chunks_.size() < max_chunks_) || !working_; });
+				if (!working_) {
+					++statistics_.dropped;
+					return;
+				}
+			} else {
+				// 转存线程仍在写入上一个数据块时等待
+				if ((policy_ == BackpressurePolicy::SpillToDisk) && spill_chunk_) {
+					++statistics_.blocked;
+					space_cv_.wait(lock, [this]() {
+						return (chunks_.size() < max_chunks_) || !spill_chunk_ || !working_;
+					});
+					if (!working_) {
+						++statistics_.dropped;
+						return;
+					}
+				}
+				if (chunks_.size() == max_chunks_) { Evict(); }
+			}
+		}
+		chunks_.push_back(spare_ ? std::move(spare_) : std::make_shared<MarketDepth[]>(kChunkRows));
+	}
+	chunks_.back()[head_ % kChunkRows] = data;
+	++head_;
+	for (auto& sink : sinks_) {
+		size_t lag = head_ - sink->cursor;
+		sink->statistics.max_lag = std::max(sink->statistics.max_lag, lag);
+		// 写入线程只在读完日志时等待
+		if (lag == 1) { sink->cv.notify_one(); }
+	}
+}
+
+RecorderStatistics FanoutDataRecorder::statistics() const {
+	std::scoped_lock _(mutex_);
+	RecorderStatistics ret = statistics_;
+	if (!sinks_.empty()) {
+		ret.written = sinks_.front()->statistics.written;
+		for (const auto& sink : sinks_) { ret.written = std::min(ret.written, sink->statistics.written); }
+	}
+	ret.pending = head_ - MinCursor();
+	return ret;
+}
+
+SinkStatistics FanoutDataRecorder::sink_statistics(size_t index) const {
+	std::scoped_lock _(mutex_);
+	const Sink& sink = *sinks_.at(index);
+	SinkStatistics ret = sink.statistics;
+	ret.lag = head_ - sink.cursor;
+	return ret;
+}
+
+uint64_t FanoutDataRecorder::MinCursor() const {
+	uint64_t ret = head_;
+	for (const auto& sink : sinks_) { ret = std::min(ret, sink->cursor); }
+	return ret;
+}
+
+bool FanoutDataRecorder::Reclaim() {
+	uint64_t min_cursor = MinCursor();
+	bool ret = false;
+	while (!chunks_.empty() && (memory_begin_ + kChunkRows <= min_cursor)) {
+		// 仍在被写入线程读取的数据块由其持有, 读完后释放
+		if (chunks_.front().use_count() == 1) { spare_ = std::move(chunks_.front()); }
+		chunks_.pop_front();
+		memory_begin_ += kChunkRows;
+		ret = true;
+	}
+	ReclaimSpill();
+	return ret;
+}
+
+void FanoutDataRecorder::ReclaimSpill() {
+	if ((spill_rows_ == 0) || (MinCursor() < memory_begin_)) { return; }
+	for (const auto& sink : sinks_) {
+		if (sink->reading_spill) { return; }
+	}
+	std::scoped_lock _(spill_mutex_);
+	spill_.close();
+	spill_.open(spill_path_, std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc);
+	spill_written_ = 0;
+	spill_rows_ = 0;
+}
+
+void FanoutDataRecorder::Evict() {
+	uint64_t end = memory_begin_ + kChunkRows;
+	bool dropped = true;
+	if ((policy_ == BackpressurePolicy::SpillToDisk) && !spill_chunk_) {
+		// 只交出数据块, 由转存线程写入文件, 写入方不等待磁盘
+		if (spill_rows_ == 0) { spill_begin_ = memory_begin_; }
+		spill_chunk_ = std::move(chunks_.front());
+		spill_rows_ += kChunkRows;
+		statistics_.spilled += kChunkRows;
+		dropped = false;
+		spill_cv_.notify_one();
+	}
+	if (dropped) {
+		statistics_.dropped += end - std::max(MinCursor(), memory_begin_);
+		for (auto& sink : sinks_) {
+			if (sink->cursor < end) {
+				sink->statistics.dropped += end - sink->cursor;
+				sink->cursor = end;
+			}
+		}
+	}
+	chunks_.pop_front();
+	memory_begin_ = end;
+}
+
+void FanoutDataRecorder::Run(Sink& sink) {
+	while (true) {
+		Chunk chunk;
+		const MarketDepth* data = nullptr;
+		size_t count = 0;
+		uint64_t spill_offset = 0;
+		bool from_spill = false;
+		bool reclaimed = false;
+		{
+			std::unique_lock lock(mutex_);
+			bool idle = !sink.cv.wait_for(lock, sink.flush_interval,
+										  [this, &sink]() { return (sink.cursor < head_) || !working_; });
+			// 空闲超过 `flush_interval` 时让数据记录器提交已写入的数据
+			if (idle) {
+				lock.unlock();
+				sink.recorder->Flush();
+				continue;
+			}
+			if (sink.cursor == head_) { break; }
+
+			uint64_t begin = sink.cursor;
+			if (begin < memory_begin_) {
+				from_spill = true;
+				count = std::min<uint64_t>(memory_begin_ - begin, sink.batch_size);
+				spill_offset = begin - spill_begin_;
+				sink.reading_spill = true;
+			} else {
+				size_t offset = begin - memory_begin_;
+				chunk = chunks_[offset / kChunkRows];
+				offset %= kChunkRows;
+				count = std::min<uint64_t>({head_ - begin, kChunkRows - offset, sink.batch_size});
+				data = chunk.get() + offset;
+			}
+			// 取走后即可回收, 数据块由 `chunk` 持有至写完
+			sink.cursor += count;
+			reclaimed = Reclaim();
+		}
+		if (reclaimed) { space_cv_.notify_all(); }
+
+		bool read = true;
+		if (from_spill) {
+			std::unique_lock spill_lock(spill_mutex_);
+			// 取走的数据可能仍在转存线程中
+			spilled_cv_.wait(spill_lock,
+							 [this, spill_offset, count]() { return spill_written_ >= spill_offset + count; });
+			spill_.seekg(static_cast<std::streamoff>(spill_offset * sizeof(MarketDepth)));
+			spill_.read(reinterpret_cast<char*>(sink.buffer.data()),
+						static_cast<std::streamsize>(count * sizeof(MarketDepth)));
+			if (!spill_) {
+				spdlog::error("FanoutDataRecorder: failed to read spill file {}.", spill_path_.string());
+				spill_.clear();
+				read = false;
+			}
+			data = sink.buffer.data();
+		}
+		if (read) { sink.recorder->Write(std::span<const MarketDepth>(data, count)); }
+		chunk.reset();
+
+		std::scoped_lock _(mutex_);
+		if (read) {
+			sink.statistics.written += count;
+			++sink.statistics.batches;
+		} else {
+			sink.statistics.dropped += count;
+		}
+		if (from_spill) {
+			sink.reading_spill = false;
+			ReclaimSpill();
+		}
+	}
+	sink.recorder->Flush();
+}
+
+void FanoutDataRecorder::SpillLoop() {
+	std::unique_lock lock(mutex_);
+	while (true) {
+		spill_cv_.wait(lock, [this]() { return spill_chunk_ || !spilling_; });
+		if (!spill_chunk_) { break; }
+		Chunk chunk = spill_chunk_;
+		lock.unlock();
+		{
+			std::scoped_lock spill_lock(spill_mutex_);
+			spill_.seekp(static_cast<std::streamoff>(spill_written_ * sizeof(MarketDepth)));
+			spill_.write(reinterpret_cast<const char*>(chunk.get()),
+						 static_cast<std::streamsize>(kChunkRows * sizeof(MarketDepth)));
+			spill_.flush();
+			// 写入失败的数据在读取时计入丢弃
+			if (!spill_) { spdlog::error("FanoutDataRecorder: failed to write spill file {}.", spill_path_.string()); }
+			spill_written_ += kChunkRows;
+		}
+		spilled_cv_.notify_all();
+		lock.lock();
+		spill_chunk_.reset();
+		if (!spare_ && (chunk.use_count() == 1)) { spare_ = std::move(chunk); }
+		space_cv_.notify_all();
+	}
+}
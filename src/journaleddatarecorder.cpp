@@ -0,0 +1,129 @@
+#include "journaleddatarecorder.h"
+
+#include <span>
+#include <system_error>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "latencymonitor.h"
+#include "trading_utils.h"
+
+JournaledDataRecorder::JournaledDataRecorder(const std::filesystem::path& directory, DataRecorder* sink,
+											 size_t commit_rows, std::chrono::milliseconds commit_interval,
+											 std::chrono::milliseconds retry_interval)
+	: DataRecorder(NoWorker{}),
+	  journal_(directory),
+	  sink_(sink),
+	  commit_rows_(commit_rows),
+	  commit_interval_(commit_interval),
+	  retry_interval_(retry_interval) {
+	// 停止其记录线程, 之后只由写入线程调用其写入函数
+	sink_->Stop();
+	sink_->journaled_ = true;
+	worker_ = std::thread(&JournaledDataRecorder::Apply, this);
+}
+
+JournaledDataRecorder::JournaledDataRecorder(const std::filesystem::path& directory,
+											 std::unique_ptr<DataRecorder> sink, size_t commit_rows,
+											 std::chrono::milliseconds commit_interval,
+											 std::chrono::milliseconds retry_interval)
+	: JournaledDataRecorder(directory, sink.get(), commit_rows, commit_interval, retry_interval) {
+	owned_sink_ = std::move(sink);
+}
+
+JournaledDataRecorder::~JournaledDataRecorder() { Stop(); }
+
+void JournaledDataRecorder::Stop() {
+	if (!worker_.joinable()) { return; }
+	{
+		std::scoped_lock _(mutex_);
+		working_ = false;
+	}
+	cv_.notify_one();
+	worker_.join();
+}
+
+void JournaledDataRecorder::DataSink(const MarketDepth& data) {
+	if (LatencyMonitor::Instance().enabled()) {
+		LatencyMonitor::Instance().Record(LatencyStage::RecorderQueued, data.symbol_id, Now() - data.exchange_time);
+	}
+	++received_;
+	try {
+		journal_.Append(data);
+	} catch (const std::system_error& e) {
+		++dropped_;
+		spdlog::error("JournaledDataRecorder: failed to append to journal: {}", e.what());
+		return;
+	}
+	// 写入线程先置 `waiting_` 再检查日志末尾, 此处先追加再检查 `waiting_`, 不会漏掉通知
+	if (waiting_) {
+		std::scoped_lock _(mutex_);
+		cv_.notify_one();
+	}
+}
+
+RecorderStatistics JournaledDataRecorder::statistics() const {
+	RecorderStatistics ret;
+	ret.received = received_;
+	ret.dropped = dropped_;
+	ret.written = sink_->statistics().written;
+	ret.pending = journal_.head() - journal_.committed();
+	return ret;
+}
+
+void JournaledDataRecorder::Apply() {
+	std::vector<MarketDepth> batch(kBatchRows);
+	uint64_t applied = journal_.committed();
+	size_t uncommitted = 0;
+	std::chrono::steady_clock::time_point commit_start;
+	bool failed = false;
+	while (true) {
+		bool stopping = false;
+		{
+			std::unique_lock lock(mutex_);
+			if (failed) {
+				cv_.wait_for(lock, retry_interval_, [this]() { return !working_; });
+			} else if (journal_.head() == applied) {
+				waiting_ = true;
+				cv_.wait_for(lock, commit_interval_,
+							 [this, applied]() { return (journal_.head() != applied) || !working_; });
+				waiting_ = false;
+			}
+			stopping = !working_;
+		}
+		// 从已提交序号处重新写入
+		if (failed) {
+			failed = false;
+			applied = journal_.committed();
+			uncommitted = 0;
+		}
+
+		size_t count = journal_.Read(applied, batch);
+		if (count > 0) {
+			if (uncommitted == 0) { commit_start = std::chrono::steady_clock::now(); }
+			sink_->Write(std::span<const MarketDepth>(batch.data(), count));
+			applied += count;
+			uncommitted += count;
+		}
+		if ((count == 0) && (applied < journal_.head())) {
+			// 跳过损坏的记录
+			++applied;
+			++dropped_;
+		}
+		bool caught_up = (applied == journal_.head());
+		if ((uncommitted > 0) &&
+			((uncommitted >= commit_rows_) || (std::chrono::steady_clock::now() - commit_start >= commit_interval_) ||
+			 (stopping && caught_up))) {
+			if (sink_->Sync()) {
+				journal_.Commit(applied);
+				uncommitted = 0;
+			} else {
+				failed = true;
+				spdlog::warn("JournaledDataRecorder: commit failed, {} ticks kept in journal, retry in {} ms.",
+							 journal_.head() - journal_.committed(), retry_interval_.count());
+			}
+		}
+		if (stopping && (failed || (caught_up && (uncommitted == 0)))) { break; }
+	}
+}
@@ -0,0 +1,89 @@
+#include "latencymonitor.h"
+
+#include <spdlog/spdlog.h>
+
+#include "symboltable.h"
+
+namespace {
+constexpr std::array<const char*, LatencyMonitor::kStageCount> kStageNames = {"callback", "normalized", "published",
+																			 "recorder_queued", "recorder_written"};
+constexpr std::array<const char*, LatencyMonitor::kExchangeCount> kExchangeNames = {
+	"NA", "SHF", "DCE", "CZC", "CFE", "INE", "SH", "SZ", "SGE", "OC", "HK"};
+
+void AppendSummary(std::string& report, const char* stage, const std::string& source,
+				   const LatencyHistogram& histogram) {
+	if (histogram.count() == 0) { return; }
+	report += fmt::format("{:<17}{:<9} count {:>10} mean {:>9} p50 {:>9} p99 {:>9} p99.9 {:>9} max {:>9}\n", stage,
+						  source, histogram.count(), histogram.mean() / 1000, histogram.Percentile(0.5) / 1000,
+						  histogram.Percentile(0.99) / 1000, histogram.Percentile(0.999) / 1000,
+						  histogram.max() / 1000);
+}
+}  // namespace
+
+LatencyMonitor& LatencyMonitor::Instance() {
+	static LatencyMonitor monitor;
+	return monitor;
+}
+
+LatencyMonitor::LatencyMonitor() : exchanges_(std::make_unique<std::atomic<Exchange>[]>(SymbolTable::kCapacity)) {}
+
+LatencyMonitor::~LatencyMonitor() { StopPeriodicDump(); }
+
+void LatencyMonitor::SetExchange(SymbolID id, Exchange exchange) noexcept {
+	if (id < SymbolTable::kCapacity) { exchanges_[id].store(exchange, std::memory_order_relaxed); }
+}
+
+Exchange LatencyMonitor::exchange(SymbolID id) const noexcept {
+	return id < SymbolTable::kCapacity ? exchanges_[id].load(std::memory_order_relaxed) : Exchange::NA;
+}
+
+void LatencyMonitor::Record(LatencyStage stage, SymbolID id, Timestamp latency, size_t front) noexcept {
+	size_t stage_index = static_cast<size_t>(stage);
+	by_exchange_[stage_index][static_cast<size_t>(exchange(id))].Record(latency);
+	if (front < kMaxFronts) { by_front_[stage_index][front].Record(latency); }
+}
+
+void LatencyMonitor::Reset() noexcept {
+	for (auto& stage : by_exchange_) {
+		for (auto& histogram : stage) { histogram.Reset(); }
+	}
+	for (auto& stage : by_front_) {
+		for (auto& histogram : stage) { histogram.Reset(); }
+	}
+}
+
+std::string LatencyMonitor::Report() const {
+	std::string report;
+	for (size_t stage = 0; stage < kStageCount; ++stage) {
+		for (size_t exchange = 0; exchange < kExchangeCount; ++exchange) {
+			AppendSummary(report, kStageNames[stage], kExchangeNames[exchange], by_exchange_[stage][exchange]);
+		}
+		for (size_t front = 0; front < kMaxFronts; ++front) {
+			AppendSummary(report, kStageNames[stage], fmt::format("front{}", front), by_front_[stage][front]);
+		}
+	}
+	return report;
+}
+
+void LatencyMonitor::StartPeriodicDump(std::chrono::seconds interval, bool reset) {
+	StopPeriodicDump();
+	dumping_ = true;
+	dumper_ = std::thread([this, interval, reset]() {
+		std::unique_lock lock(dump_mutex_);
+		while (!dump_cv_.wait_for(lock, interval, [this]() { return !dumping_; })) {
+			std::string report = Report();
+			if (!report.empty()) { spdlog::info("Market data latency (us):\n{}", report); }
+			if (reset) { Reset(); }
+		}
+	});
+}
+
+void LatencyMonitor::StopPeriodicDump() {
+	if (!dumper_.joinable()) { return; }
+	{
+		std::scoped_lock _(dump_mutex_);
+		dumping_ = false;
+	}
+	dump_cv_.notify_one();
+	dumper_.join();
+}
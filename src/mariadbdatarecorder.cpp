@@ -1,16 +1,75 @@
 ﻿#include "mariadbdatarecorder.h"
 
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
 #include <stdexcept>
+#include <string_view>
 
 #include <spdlog/spdlog.h>
 
+#include "trading_utils.h"
+
+namespace {
+constexpr const char* kColumns =
+	"(DateTime, ID, Open, High, Low, Latest, TurnOver, Volume, OpenInterest, BidPrice1, BidVolume1, AskPrice1, "
+	"AskVolume1)";
+
+/// 以反斜杠转义追加字符串, 结果可用于 SQL 字符串常量及 `LOAD DATA` 数据文件的字段
+void AppendEscaped(std::string& out, std::string_view str) {
+	for (char c : str) {
+		switch (c) {
+			case '\0': out += "\\0"; break;
+			case '\n': out += "\\n"; break;
+			case '\r': out += "\\r"; break;
+			case '\\':
+			case '\'':
+			case '"':
+			case ',':
+				out += '\\';
+				out += c;
+				break;
+			default: out += c;
+		}
+	}
+}
+
+/// 追加一行, 为 `LOAD DATA` 数据文件的一行或 `VALUES` 中的一组
+void AppendRow(std::string& out, const MarketDepth& data, bool infile) {
+	char datetime[kDateTimeStrLength + 1];
+	FormatDateTime(data.exchange_time, datetime);
+	// 合约代码来自行情源, 转义后再拼入语句
+	std::string_view instrument_id(data.instrument_id, strnlen(data.instrument_id, sizeof(data.instrument_id)));
+	auto iter = std::back_inserter(out);
+	if (infile) {
+		fmt::format_to(iter, "{},", datetime);
+		AppendEscaped(out, instrument_id);
+		out += ',';
+	} else {
+		fmt::format_to(iter, "('{}','", datetime);
+		AppendEscaped(out, instrument_id);
+		out += "',";
+	}
+	fmt::format_to(iter, "{},{},{},{},{},{},{},{},{},{},{}", data.ohlclvt.open, data.ohlclvt.high, data.ohlclvt.low,
+				   data.ohlclvt.last, data.ohlclvt.turnover, data.ohlclvt.volume, data.open_interest, data.bid[0].price,
+				   data.bid[0].volume, data.ask[0].price, data.ask[0].volume);
+	out += infile ? '\n' : ')';
+}
+}  // namespace
+
 MariadbDataRecorder::MariadbDataRecorder(const IPAddress& addr, const std::string& db_name, const UserName& user_name,
-										 const Password& password) {
+										 const Password& password, size_t batch_rows,
+										 std::chrono::milliseconds batch_interval, MariadbWriteMode mode)
+	: batch_rows_(batch_rows), batch_interval_(batch_interval), mode_(mode) {
 	// TODO: C++20 fmt replace
 	std::string url = "jdbc:mariadb://" + addr + "/" + db_name;
 	//	std::string url = std::format("jdbc:mariadb://{}/{}", addr, db_name);
 
-	conn_ = sql::DriverManager::getConnection(url, user_name, password);
+	sql::Properties properties({{"user", user_name}, {"password", password}});
+	if (mode_ == MariadbWriteMode::LoadDataInfile) { properties["allowLocalInfile"] = "true"; }
+	conn_ = sql::DriverManager::getConnection(url, properties);
 
 	sql::Statement* create_stmnt = conn_->createStatement();
 	try {
@@ -40,38 +99,140 @@ MariadbDataRecorder::MariadbDataRecorder(const IPAddress& addr, const std::strin
 	}
 	delete create_stmnt;
 
-	const char* query =
-		//                            1,  2,    3,    4,   5,      6,        7,      8,            9,        10,
-		"INSERT INTO tickdata (DateTime, ID, Open, High, Low, Latest, TurnOver, Volume, OpenInterest, BidPrice1, "
-		//       11,        12,         13
-		"BidVolume1, AskPrice1, AskVolume1) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?);";
-	insert_stmnt_ = conn_->prepareStatement(query);
+	sender_ = std::thread(&MariadbDataRecorder::Send, this);
+	set_flush_interval(batch_interval_);
 }
 
-MariadbDataRecorder::MariadbDataRecorder(const MySQLConnectionInfo& info)
-	: MariadbDataRecorder(info.addr, info.db_name, info.user_name, info.password) {}
+MariadbDataRecorder::MariadbDataRecorder(const MySQLConnectionInfo& info, size_t batch_rows,
+										 std::chrono::milliseconds batch_interval, MariadbWriteMode mode)
+	: MariadbDataRecorder(info.addr, info.db_name, info.user_name, info.password, batch_rows, batch_interval, mode) {}
 
 MariadbDataRecorder::~MariadbDataRecorder() {
-	delete insert_stmnt_;
+	Stop();
+	{
+		std::scoped_lock _(send_mutex_);
+		sending_ = false;
+	}
+	send_cv_.notify_one();
+	sender_.join();
 	conn_->close();
 }
 
 void MariadbDataRecorder::WriteDB(const MarketDepth& data) {
-	insert_stmnt_->setDateTime(1, data.update_time);
-	insert_stmnt_->setString(2, data.instrument_id);
-	insert_stmnt_->setDouble(3, data.ohlclvt.open);
-	insert_stmnt_->setDouble(4, data.ohlclvt.high);
-	insert_stmnt_->setDouble(5, data.ohlclvt.low);
-	insert_stmnt_->setDouble(6, data.ohlclvt.last);
-	insert_stmnt_->setDouble(7, data.ohlclvt.turnover);
-	insert_stmnt_->setDouble(8, data.ohlclvt.volume);
-	insert_stmnt_->setDouble(9, data.open_interest);
-	insert_stmnt_->setDouble(10, data.bid[0].price);
-	insert_stmnt_->setDouble(11, data.bid[0].volume);
-	insert_stmnt_->setDouble(12, data.ask[0].price);
-	insert_stmnt_->setDouble(13, data.ask[0].volume);
+	if (batch_count_ == 0) {
+		batch_start_ = std::chrono::steady_clock::now();
+		if (mode_ == MariadbWriteMode::MultiRowInsert) {
+			// 主键重复时只忽略该行, 否则整批失败
+			batch_ = "INSERT IGNORE INTO tickdata ";
+			batch_ += kColumns;
+			batch_ += " VALUES ";
+		}
+	} else if (mode_ == MariadbWriteMode::MultiRowInsert) {
+		batch_ += ',';
+	}
+	AppendRow(batch_, data, mode_ == MariadbWriteMode::LoadDataInfile);
+	++batch_count_;
+}
+
+void MariadbDataRecorder::WriteDB(std::span<const MarketDepth> data) {
+	for (const MarketDepth& md : data) {
+		WriteDB(md);
+		if (batch_count_ >= batch_rows_) { Submit(); }
+	}
+	if ((batch_count_ > 0) && (std::chrono::steady_clock::now() - batch_start_ >= batch_interval_)) { Submit(); }
+}
 
+void MariadbDataRecorder::Flush() { Submit(); }
+
+bool MariadbDataRecorder::Sync() {
+	Submit();
+	std::unique_lock lock(send_mutex_);
+	queue_cv_.wait(lock, [this]() { return queue_.empty() && !executing_; });
+	bool ret = !send_failed_;
+	send_failed_ = false;
+	return ret;
+}
+
+void MariadbDataRecorder::Submit() {
+	if (batch_count_ == 0) { return; }
+	Batch batch{.rows = batch_count_};
+	if (mode_ == MariadbWriteMode::LoadDataInfile) {
+		batch.file = std::filesystem::temp_directory_path() /
+					 fmt::format("uts_tickdata_{}_{}.csv", reinterpret_cast<uintptr_t>(this), file_count_++);
+		std::ofstream file(batch.file, std::ios::binary | std::ios::trunc);
+		file.write(batch_.data(), static_cast<std::streamsize>(batch_.size()));
+		if (!file) {
+			spdlog::error("MariadbDataRecorder: cannot write {}, {} rows dropped.", batch.file.string(), batch_count_);
+			if (!journaled()) { AddDropped(batch_count_); }
+			batch_.clear();
+			batch_count_ = 0;
+			std::scoped_lock _(send_mutex_);
+			send_failed_ = true;
+			return;
+		}
+		std::string path;
+		AppendEscaped(path, batch.file.generic_string());
+		batch.sql = fmt::format(
+			"LOAD DATA LOCAL INFILE '{}' IGNORE INTO TABLE tickdata FIELDS TERMINATED BY ',' LINES TERMINATED BY '\\n' "
+			"{};",
+			path, kColumns);
+	} else {
+		batch.sql = std::move(batch_);
+	}
+	batch_.clear();
+	batch_count_ = 0;
+
+	{
+		std::unique_lock lock(send_mutex_);
+		queue_cv_.wait(lock, [this]() { return queue_.size() < kMaxQueuedBatches; });
+		queue_.push_back(std::move(batch));
+	}
+	send_cv_.notify_one();
+}
+
+void MariadbDataRecorder::Send() {
+	while (true) {
+		Batch batch;
+		{
+			std::unique_lock lock(send_mutex_);
+			send_cv_.wait(lock, [this]() { return !queue_.empty() || !sending_; });
+			// 停止前发送完队列中的数据
+			if (queue_.empty()) { return; }
+			batch = std::move(queue_.front());
+			queue_.pop_front();
+			executing_ = true;
+		}
+		queue_cv_.notify_one();
+		bool succeeded = Execute(batch);
+		// 由日志驱动时失败的批在重试时补写, 否则丢弃
+		if (!succeeded && !journaled()) { AddDropped(batch.rows); }
+		{
+			std::scoped_lock _(send_mutex_);
+			executing_ = false;
+			if (!succeeded) { send_failed_ = true; }
+		}
+		queue_cv_.notify_one();
+	}
+}
+
+bool MariadbDataRecorder::Execute(const Batch& batch) {
+	bool ret = true;
 	try {
-		insert_stmnt_->executeUpdate();
-	} catch (sql::SQLException& e) { spdlog::error("Error adding contact to database: {}", e.what()); }
+		std::unique_ptr<sql::Statement> stmnt(conn_->createStatement());
+		stmnt->executeUpdate(batch.sql);
+	} catch (const sql::SQLException& e) {
+		spdlog::error("MariadbDataRecorder: error writing {} rows to database: {}", batch.rows, e.what());
+		ret = false;
+		// 连接断开时重连, 之后的批可继续写入
+		try {
+			if (!conn_->isValid()) { conn_->reconnect(); }
+		} catch (const sql::SQLException& reconnect_error) {
+			spdlog::warn("MariadbDataRecorder: reconnect failed: {}", reconnect_error.what());
+		}
+	}
+	if (!batch.file.empty()) {
+		std::error_code ec;
+		std::filesystem::remove(batch.file, ec);
+	}
+	return ret;
 }
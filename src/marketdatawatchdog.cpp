@@ -0,0 +1,259 @@
+#include "marketdatawatchdog.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+#include <spdlog/spdlog.h>
+
+#include "symboltable.h"
+#include "trading_utils.h"
+
+using std::vector;
+
+namespace {
+/// 时间轮刻度. 四层共覆盖约46小时
+constexpr Timestamp kWheelResolution = 10'000'000LL;
+
+/// 北京时间的自然日序号, 1970-01-01为0
+int64_t ChinaDay(Timestamp ts) noexcept {
+	Timestamp local = ts + kChinaTimeOffset;
+	return local >= 0 ? local / kNanosecondsPerDay : (local + 1) / kNanosecondsPerDay - 1;
+}
+
+/// 周一至周五开盘. 1970-01-01为周四
+bool IsWeekday(int64_t day) noexcept {
+	int64_t weekday = ((day + 4) % 7 + 7) % 7;
+	return (weekday >= 1) && (weekday <= 5);
+}
+
+Timestamp DayStart(int64_t day) noexcept { return day * kNanosecondsPerDay - kChinaTimeOffset; }
+}  // namespace
+
+std::optional<Timestamp> SessionOpenTime(const TradingSessions& sessions, Timestamp ts) noexcept {
+	if (sessions.empty()) { return std::numeric_limits<Timestamp>::min(); }
+	int64_t today = ChinaDay(ts);
+	// 跨越午夜的时段可能开始于前一天
+	for (int64_t day = today - 1; day <= today; ++day) {
+		if (!IsWeekday(day)) { continue; }
+		for (const TradingSession& session : sessions) {
+			Timestamp open = DayStart(day) + session.open;
+			Timestamp close = DayStart(day) + session.close;
+			if (session.close <= session.open) { close += kNanosecondsPerDay; }
+			if ((open <= ts) && (ts < close)) { return open; }
+		}
+	}
+	return std::nullopt;
+}
+
+Timestamp NextSessionOpenTime(const TradingSessions& sessions, Timestamp ts) noexcept {
+	if (sessions.empty()) { return ts; }
+	int64_t today = ChinaDay(ts);
+	for (int64_t day = today; day <= today + 7; ++day) {
+		if (!IsWeekday(day)) { continue; }
+		Timestamp next = std::numeric_limits<Timestamp>::max();
+		for (const TradingSession& session : sessions) {
+			Timestamp open = DayStart(day) + session.open;
+			if (open > ts) { next = std::min(next, open); }
+		}
+		if (next != std::numeric_limits<Timestamp>::max()) { return next; }
+	}
+	return ts;
+}
+
+MarketDataWatchdog::MarketDataWatchdog(TradingEventBus& event_bus, Timestamp front_timeout, int timer_interval)
+	: event_bus_(event_bus),
+	  front_timeout_(front_timeout),
+	  timer_interval_(timer_interval),
+	  states_(std::make_unique<InstrumentState[]>(SymbolTable::kCapacity)),
+	  wheel_(SymbolTable::kCapacity, kWheelResolution) {
+	subscription_ = event_bus_.Subscribe<MarketDepth, &MarketDataWatchdog::OnMarketData>(this);
+	timer_ = std::thread(&MarketDataWatchdog::TimerLoop, this);
+}
+
+MarketDataWatchdog::~MarketDataWatchdog() {
+	event_bus_.Unsubscribe<MarketDepth>(subscription_);
+	{
+		std::scoped_lock _(mutex_);
+		running_ = false;
+	}
+	timer_cv_.notify_one();
+	timer_.join();
+}
+
+bool MarketDataWatchdog::Watch(const Ticker& ticker, const WatchdogRule& rule, Timestamp now) {
+	SymbolID id = SymbolTable::Instance().Intern(ticker);
+	if (id == kInvalidSymbol) { return false; }
+	std::scoped_lock _(mutex_);
+	WatchLocked(id, RuleIndex(rule), now != 0 ? now : Now());
+	return true;
+}
+
+vector<Ticker> MarketDataWatchdog::Watch(const MarketDataSource& source, const WatchdogRule& rule, Timestamp now) {
+	vector<Ticker> failed;
+	if (now == 0) { now = Now(); }
+	std::scoped_lock _(mutex_);
+	uint32_t rule_index = RuleIndex(rule);
+	for (const Ticker& ticker : source.subscribed_tickers()) {
+		SymbolID id = SymbolTable::Instance().Intern(ticker);
+		if (id == kInvalidSymbol) {
+			failed.push_back(ticker);
+			continue;
+		}
+		WatchLocked(id, rule_index, now);
+	}
+	spdlog::info("Watchdog: watching {} instruments.", watched_count());
+	return failed;
+}
+
+void MarketDataWatchdog::Unwatch(const Ticker& ticker) {
+	SymbolID id = SymbolTable::Instance().Find(ticker);
+	if (id == kInvalidSymbol) { return; }
+	std::scoped_lock _(mutex_);
+	InstrumentState& state = states_[id];
+	if (!state.watched.exchange(false, std::memory_order_relaxed)) { return; }
+	if (state.stale.exchange(false, std::memory_order_relaxed)) { stale_count_.fetch_sub(1, std::memory_order_relaxed); }
+	wheel_.Cancel(id);
+	watched_count_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void MarketDataWatchdog::SetFrontCounters(std::function<vector<uint64_t>()> counters) {
+	std::scoped_lock _(mutex_);
+	front_counters_ = std::move(counters);
+	fronts_.clear();
+}
+
+void MarketDataWatchdog::WatchLocked(SymbolID id, uint32_t rule, Timestamp now) {
+	if (!wheel_.started()) {
+		wheel_.Start(now);
+		for (FrontState& front : fronts_) { front.last_tick = now; }
+	}
+	InstrumentState& state = states_[id];
+	state.armed = now;
+	state.rule = rule;
+	if (!state.watched.exchange(true, std::memory_order_relaxed)) {
+		watched_count_.fetch_add(1, std::memory_order_relaxed);
+	}
+	wheel_.Schedule(id, now + rules_[rule].max_interval);
+}
+
+uint32_t MarketDataWatchdog::RuleIndex(const WatchdogRule& rule) {
+	auto iter = std::find(rules_.begin(), rules_.end(), rule);
+	if (iter != rules_.end()) { return static_cast<uint32_t>(iter - rules_.begin()); }
+	rules_.push_back(rule);
+	return static_cast<uint32_t>(rules_.size() - 1);
+}
+
+void MarketDataWatchdog::OnMarketData(const MarketDepth& md) {
+	Timestamp local_time = md.local_time != 0 ? md.local_time : Now();
+	if (local_time - feed_tick_.load(std::memory_order_relaxed) > kFeedTickGranularity) {
+		feed_tick_.store(local_time, std::memory_order_relaxed);
+	}
+	if (md.symbol_id >= SymbolTable::kCapacity) { return; }
+	InstrumentState& state = states_[md.symbol_id];
+	if (!state.watched.load(std::memory_order_relaxed)) { return; }
+	Timestamp last_tick = state.last_tick.load(std::memory_order_relaxed);
+	if (local_time > last_tick) { state.last_tick.store(local_time, std::memory_order_relaxed); }
+	if (state.stale.load(std::memory_order_relaxed) && state.stale.exchange(false, std::memory_order_relaxed)) {
+		stale_count_.fetch_sub(1, std::memory_order_relaxed);
+		event_bus_.Publish(MarketDataAlert{.type = MarketDataAlertType::InstrumentResumed,
+										   .symbol_id = md.symbol_id,
+										   .front = 0,
+										   .last_tick = last_tick,
+										   .time = local_time});
+	}
+}
+
+void MarketDataWatchdog::Check(Timestamp now) {
+	if (now == 0) { now = Now(); }
+	std::scoped_lock _(mutex_);
+	if (!wheel_.started()) { return; }
+	wheel_.Advance(now, [this, now](uint32_t id, Timestamp) { Expire(id, now); });
+	CheckFronts(now);
+}
+
+void MarketDataWatchdog::Expire(SymbolID id, Timestamp now) {
+	InstrumentState& state = states_[id];
+	if (!state.watched.load(std::memory_order_relaxed)) { return; }
+	const WatchdogRule& rule = rules_[state.rule];
+	std::optional<Timestamp> open = SessionOpenTime(rule.sessions, now);
+	if (!open) {
+		wheel_.Schedule(id, NextSessionOpenTime(rule.sessions, now) + rule.max_interval);
+		return;
+	}
+
+	// 开盘后重新计时, 休市期间没有行情不算静默
+	Timestamp last_tick = std::max(state.last_tick.load(std::memory_order_relaxed), state.armed);
+	Timestamp since = std::max(last_tick, *open);
+	if (now - since < rule.max_interval) {
+		wheel_.Schedule(id, since + rule.max_interval);
+		return;
+	}
+	wheel_.Schedule(id, now + rule.max_interval);
+	if (state.stale.exchange(true, std::memory_order_relaxed)) { return; }
+	stale_count_.fetch_add(1, std::memory_order_relaxed);
+	spdlog::warn("Watchdog: {} has no market data since {}.", SymbolTable::Instance().Name(id),
+				 FormatDateTime(last_tick));
+	event_bus_.Publish(MarketDataAlert{.type = MarketDataAlertType::InstrumentStale,
+									   .symbol_id = id,
+									   .front = 0,
+									   .last_tick = last_tick,
+									   .time = now});
+}
+
+void MarketDataWatchdog::CheckFronts(Timestamp now) {
+	if ((watched_count() == 0) || rules_.empty()) { return; }
+	// 任一监视合约处于交易时段时, 前置应有行情
+	std::optional<Timestamp> market_open;
+	for (const WatchdogRule& rule : rules_) {
+		std::optional<Timestamp> open = SessionOpenTime(rule.sessions, now);
+		if (open && (!market_open || (*open < *market_open))) { market_open = open; }
+	}
+
+	vector<uint64_t> counters;
+	if (front_counters_) {
+		counters = front_counters_();
+		if (fronts_.size() < counters.size()) { fronts_.resize(counters.size(), FrontState{.last_tick = now}); }
+	}
+	for (size_t front = 0; front < fronts_.size(); ++front) {
+		FrontState& state = fronts_[front];
+		Timestamp last_tick = state.last_tick;
+		if (front_counters_) {
+			if ((front < counters.size()) && (counters[front] != state.ticks)) {
+				state.ticks = counters[front];
+				state.last_tick = now;
+			}
+		} else {
+			state.last_tick = std::max(state.last_tick, feed_tick_.load(std::memory_order_relaxed));
+		}
+
+		if (state.silent && (state.last_tick > last_tick)) {
+			state.silent = false;
+			spdlog::info("Watchdog: front {} resumed.", front);
+			event_bus_.Publish(MarketDataAlert{.type = MarketDataAlertType::FrontResumed,
+											   .symbol_id = kInvalidSymbol,
+											   .front = front,
+											   .last_tick = last_tick,
+											   .time = now});
+		} else if (!state.silent && market_open && (now - std::max(state.last_tick, *market_open) >= front_timeout_)) {
+			state.silent = true;
+			spdlog::warn("Watchdog: front {} has no market data since {}.", front, FormatDateTime(state.last_tick));
+			event_bus_.Publish(MarketDataAlert{.type = MarketDataAlertType::FrontSilent,
+											   .symbol_id = kInvalidSymbol,
+											   .front = front,
+											   .last_tick = state.last_tick,
+											   .time = now});
+		}
+	}
+}
+
+void MarketDataWatchdog::TimerLoop() {
+	while (true) {
+		{
+			std::unique_lock lock(mutex_);
+			timer_cv_.wait_for(lock, std::chrono::milliseconds(timer_interval_), [this]() { return !running_; });
+			if (!running_) { return; }
+		}
+		Check();
+	}
+}
@@ -0,0 +1,222 @@
+#include "optionchain.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numbers>
+#include <string>
+
+#include "symboltable.h"
+#include "trading_utils.h"
+
+namespace {
+constexpr double kNaN = std::numeric_limits<double>::quiet_NaN();
+constexpr double kMinVolatility = 1e-4;
+constexpr double kMaxVolatility = 5.0;
+constexpr double kTolerance = 1e-8;
+constexpr int kMaxIterations = 20;
+constexpr Timestamp kNanosecondsPerYear = 365 * kNanosecondsPerDay;
+
+/// 标准正态分布函数
+inline double NormCDF(double x) { return 0.5 * std::erfc(-x * std::numbers::sqrt2 / 2); }
+/// 标准正态密度函数
+inline double NormPDF(double x) { return std::exp(-0.5 * x * x) * (std::numbers::inv_sqrtpi / std::numbers::sqrt2); }
+
+/// 盘口中间价, 缺少一侧时取最新价
+Price ReferencePrice(const MarketDepth& md) {
+	Price bid = md.bid[0].price;
+	Price ask = md.ask[0].price;
+	if ((bid > 0) && (ask > 0) && (md.bid[0].volume > 0) && (md.ask[0].volume > 0)) { return (bid + ask) / 2; }
+	return md.ohlclvt.last > 0 ? md.ohlclvt.last : kNaN;
+}
+}  // namespace
+
+void OptionBatch::resize(size_t n) {
+	for (auto* column : {&strike, &sign, &price, &iv, &delta, &gamma, &vega}) { column->resize(n, kNaN); }
+}
+
+void SolveOptionBatch(OptionBatch& batch) {
+	const size_t n = batch.size();
+	const double forward = batch.forward;
+	const double t = batch.time_to_expiry;
+	if (!(forward > 0) || !(t > 0)) {
+		for (auto* column : {&batch.iv, &batch.delta, &batch.gamma, &batch.vega}) { std::ranges::fill(*column, kNaN); }
+		return;
+	}
+	const double sqrt_t = std::sqrt(t);
+	const double discount = std::exp(-batch.rate * t);
+	const double* strike = batch.strike.data();
+	const double* sign = batch.sign.data();
+	const double* price = batch.price.data();
+	double* iv = batch.iv.data();
+
+	// 以Vega最大处 sqrt(2|ln(F/K)|/T) 为初值时牛顿迭代单调收敛(Manaster-Koehler), 平值期权取Brenner-Subrahmanyam近似
+	const double guess_scale = std::sqrt(2 * std::numbers::pi / t) / (discount * forward);
+	for (size_t i = 0; i < n; ++i) {
+		double max_vega = std::sqrt(2 * std::abs(std::log(forward / strike[i])) / t);
+		double atm = price[i] * guess_scale;
+		iv[i] = std::clamp(max_vega > 1e-3 ? max_vega : atm, kMinVolatility, kMaxVolatility);
+	}
+
+	for (int iteration = 0; iteration < kMaxIterations; ++iteration) {
+		double max_step = 0;
+		for (size_t i = 0; i < n; ++i) {
+			double sigma_sqrt_t = iv[i] * sqrt_t;
+			double d1 = (std::log(forward / strike[i]) + 0.5 * sigma_sqrt_t * sigma_sqrt_t) / sigma_sqrt_t;
+			double d2 = d1 - sigma_sqrt_t;
+			double model = discount * sign[i] * (forward * NormCDF(sign[i] * d1) - strike[i] * NormCDF(sign[i] * d2));
+			double vega = discount * forward * NormPDF(d1) * sqrt_t;
+			double step = (model - price[i]) / std::max(vega, 1e-12);
+			iv[i] = std::clamp(iv[i] - step, kMinVolatility, kMaxVolatility);
+			max_step = std::max(max_step, std::abs(step));
+		}
+		if (max_step < kTolerance) { break; }
+	}
+
+	for (size_t i = 0; i < n; ++i) {
+		// 无套利区间: 高于内在价值, 低于标的(看涨)或行权价(看跌)的现值
+		double intrinsic = discount * std::max(sign[i] * (forward - strike[i]), 0.0);
+		double upper = discount * (sign[i] > 0 ? forward : strike[i]);
+		bool valid = (price[i] > intrinsic) && (price[i] < upper);
+
+		double sigma_sqrt_t = iv[i] * sqrt_t;
+		double d1 = (std::log(forward / strike[i]) + 0.5 * sigma_sqrt_t * sigma_sqrt_t) / sigma_sqrt_t;
+		double pdf = NormPDF(d1);
+		batch.iv[i] = valid ? iv[i] : kNaN;
+		batch.delta[i] = valid ? discount * sign[i] * NormCDF(sign[i] * d1) : kNaN;
+		batch.gamma[i] = valid ? discount * pdf / (forward * sigma_sqrt_t) : kNaN;
+		batch.vega[i] = valid ? discount * forward * pdf * sqrt_t : kNaN;
+	}
+}
+
+void OptionChain::AddOptions(const std::map<Ticker, InstrumentInfo>& instruments) {
+	for (const auto& [ticker, info] : instruments) { AddOption(info); }
+}
+
+void OptionChain::AddOption(const InstrumentInfo& info) {
+	if ((info.option_type == OptionType::NotApplicable) || info.underlying_instrument_id.empty() ||
+		(info.expire_date.size() != 8)) {
+		return;
+	}
+	SymbolID option = info.symbol_id != kInvalidSymbol ? info.symbol_id
+														: SymbolTable::Instance().Intern(info.instrument_id);
+	SymbolID underlying = SymbolTable::Instance().Intern(info.underlying_instrument_id);
+	if ((option == kInvalidSymbol) || (underlying == kInvalidSymbol) || (slot(option).expiry != Slot::kNone)) { return; }
+
+	int expire_date = std::stoi(info.expire_date);
+	auto [it, inserted] = expiry_index_.try_emplace({underlying, expire_date}, static_cast<uint32_t>(expiries_.size()));
+	if (inserted) {
+		expiries_.push_back(Expiry{.underlying = underlying,
+								   .expire_date = expire_date,
+								   .expire_time = MakeTimestamp(expire_date, 15 * 3600 * 1'000'000'000LL),
+								   .strikes = {},
+								   .calls = {},
+								   .puts = {},
+								   .batch = {},
+								   .dirty = false});
+		expiries_.back().batch.rate = rate_;
+		slot(underlying).underlying_of.push_back(it->second);
+		// 同一标的的到期日按日期排序
+		auto& underlying_of = slot(underlying).underlying_of;
+		std::ranges::sort(underlying_of, {}, [this](uint32_t e) { return expiries_[e].expire_date; });
+	}
+
+	Expiry& expiry = expiries_[it->second];
+	auto pos = std::ranges::lower_bound(expiry.strikes, info.strike_price);
+	size_t index = static_cast<size_t>(pos - expiry.strikes.begin());
+	if ((pos == expiry.strikes.end()) || (*pos != info.strike_price)) {
+		expiry.strikes.insert(pos, info.strike_price);
+		expiry.calls.insert(expiry.calls.begin() + static_cast<std::ptrdiff_t>(index), kInvalidSymbol);
+		expiry.puts.insert(expiry.puts.begin() + static_cast<std::ptrdiff_t>(index), kInvalidSymbol);
+	}
+	(info.option_type == OptionType::Call ? expiry.calls : expiry.puts)[index] = option;
+	Reindex(it->second);
+}
+
+void OptionChain::Reindex(uint32_t expiry_index) {
+	Expiry& expiry = expiries_[expiry_index];
+	size_t n = expiry.strikes.size();
+	OptionBatch& batch = expiry.batch;
+	// 只遍历本到期日的期权, 已登记期权的原位置仍记录在各自的槽位中
+	std::vector<double> old_price = batch.price;
+	batch.resize(2 * n);
+	for (size_t i = 0; i < 2 * n; ++i) {
+		SymbolID id = i < n ? expiry.calls[i] : expiry.puts[i - n];
+		batch.strike[i] = expiry.strikes[i % n];
+		batch.sign[i] = i < n ? 1.0 : -1.0;
+		batch.price[i] = kNaN;
+		if (id == kInvalidSymbol) { continue; }
+		// 保留已收到的价格
+		Slot& s = slot(id);
+		if ((s.expiry == expiry_index) && (s.position < old_price.size())) { batch.price[i] = old_price[s.position]; }
+		s.expiry = expiry_index;
+		s.position = static_cast<uint32_t>(i);
+	}
+	expiry.dirty = true;
+}
+
+OptionChain::Slot& OptionChain::slot(SymbolID id) {
+	if (id >= slots_.size()) { slots_.resize(id + 1); }
+	return slots_[id];
+}
+
+void OptionChain::OnMarketData(const MarketDepth& md) {
+	if ((md.symbol_id == kInvalidSymbol) || (md.symbol_id >= slots_.size())) { return; }
+	clock_ = std::max(clock_, md.exchange_time);
+	Slot& s = slots_[md.symbol_id];
+	Price price = ReferencePrice(md);
+	if (s.expiry != Slot::kNone) {
+		Expiry& expiry = expiries_[s.expiry];
+		expiry.batch.price[s.position] = price;
+		expiry.dirty = true;
+	}
+	for (uint32_t e : s.underlying_of) {
+		expiries_[e].batch.forward = price;
+		expiries_[e].dirty = true;
+	}
+}
+
+void OptionChain::Enrich(MarketDepth& md) {
+	OnMarketData(md);
+	if ((md.symbol_id == kInvalidSymbol) || (md.symbol_id >= slots_.size())) { return; }
+	const Slot& s = slots_[md.symbol_id];
+	if (s.expiry == Slot::kNone) { return; }
+	Expiry& expiry = expiries_[s.expiry];
+	if (expiry.dirty) { Solve(expiry, clock_); }
+	// 无法求解时保留行情中原有的Delta
+	if (double delta = expiry.batch.delta[s.position]; !std::isnan(delta)) { md.delta = delta; }
+}
+
+size_t OptionChain::Recompute(Timestamp now) {
+	if (now == 0) { now = clock_; }
+	size_t count = 0;
+	for (Expiry& expiry : expiries_) {
+		if (!expiry.dirty) { continue; }
+		Solve(expiry, now);
+		++count;
+	}
+	return count;
+}
+
+void OptionChain::Solve(Expiry& expiry, Timestamp now) {
+	expiry.batch.time_to_expiry =
+		static_cast<double>(expiry.expire_time - now) / static_cast<double>(kNanosecondsPerYear);
+	SolveOptionBatch(expiry.batch);
+	expiry.dirty = false;
+}
+
+bool OptionChain::greeks(SymbolID option, OptionGreeks& greeks) const {
+	if ((option >= slots_.size()) || (slots_[option].expiry == Slot::kNone)) { return false; }
+	const OptionBatch& batch = expiries_[slots_[option].expiry].batch;
+	size_t i = slots_[option].position;
+	greeks = {.iv = batch.iv[i], .delta = batch.delta[i], .gamma = batch.gamma[i], .vega = batch.vega[i]};
+	return true;
+}
+
+std::vector<const OptionChain::Expiry*> OptionChain::expiries(SymbolID underlying) const {
+	std::vector<const Expiry*> ret;
+	if (underlying < slots_.size()) {
+		for (uint32_t e : slots_[underlying].underlying_of) { ret.push_back(&expiries_[e]); }
+	}
+	return ret;
+}
@@ -0,0 +1,219 @@
+#include "rotatingdatarecorder.h"
+
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include <spdlog/spdlog.h>
+
+#include "trading_utils.h"
+
+namespace {
+/// 将调用线程的 CPU 和 I/O 优先级降至最低. Linux 的 nice 值和 I/O 优先级均按线程设置
+void LowerThreadPriority() {
+#ifdef __linux__
+	constexpr int kIoprioWhoProcess = 1;
+	constexpr int kIoprioClassIdle = 3;
+	constexpr int kIoprioClassShift = 13;
+	auto tid = static_cast<pid_t>(syscall(SYS_gettid));
+	if (setpriority(PRIO_PROCESS, static_cast<id_t>(tid), 19) != 0) {
+		spdlog::warn("RotatingDataRecorder: failed to lower compaction thread priority.");
+	}
+	if (syscall(SYS_ioprio_set, kIoprioWhoProcess, tid, kIoprioClassIdle << kIoprioClassShift) != 0) {
+		spdlog::warn("RotatingDataRecorder: failed to set idle I/O priority for compaction thread.");
+	}
+#endif
+}
+
+void Accumulate(RecorderStatistics& total, const RecorderStatistics& stats) {
+	total.received += stats.received;
+	total.written += stats.written;
+	total.dropped += stats.dropped;
+	total.spilled += stats.spilled;
+	total.blocked += stats.blocked;
+	total.pending += stats.pending;
+}
+}  // namespace
+
+RotatingDataRecorder::RotatingDataRecorder(const RecorderFactory& factory, const Compactor& compactor,
+										   std::chrono::milliseconds compaction_delay, TradingSessions sessions)
+	: DataRecorder(NoWorker{}),
+	  factory_(factory),
+	  compactor_(compactor),
+	  compaction_delay_(compaction_delay),
+	  sessions_(std::move(sessions)) {
+	compaction_thread_ = std::thread(&RotatingDataRecorder::CompactionLoop, this);
+}
+
+RotatingDataRecorder::~RotatingDataRecorder() { Stop(); }
+
+int RotatingDataRecorder::trading_day() const {
+	std::shared_lock _(mutex_);
+	return trading_day_;
+}
+
+bool RotatingDataRecorder::InSession(const MarketDepth& data) const {
+	if (sessions_.empty() || (data.trading_day <= 0)) { return true; }
+	// 夜盘开始于前一工作日, 所在时段不晚于交易日当天即属于该交易日
+	std::optional<Timestamp> open = SessionOpenTime(sessions_, data.exchange_time);
+	return open && (*open < MakeTimestamp(data.trading_day, kNanosecondsPerDay));
+}
+
+void RotatingDataRecorder::DataSink(const MarketDepth& data) {
+	if (!InSession(data)) {
+		Drop("out-of-session", data);
+		return;
+	}
+	while (true) {
+		{
+			std::shared_lock _(mutex_);
+			if (!working_ || Forward(data)) { return; }
+		}
+		// 新交易日的记录器只创建一次: 持有创建锁后再次检查, 其他线程已换入时直接转发
+		std::scoped_lock create_lock(create_mutex_);
+		{
+			std::shared_lock _(mutex_);
+			if (!working_ || Forward(data)) { return; }
+		}
+		std::unique_ptr<DataRecorder> recorder = Create(data.trading_day);
+		std::scoped_lock _(mutex_);
+		if (working_) { Rotate(data.trading_day, std::move(recorder)); }
+	}
+}
+
+bool RotatingDataRecorder::Forward(const MarketDepth& data) {
+	if ((data.trading_day == trading_day_) || (data.trading_day <= 0)) {
+		if (current_) {
+			current_->DataSink(data);
+		} else {
+			++dropped_;
+		}
+		return true;
+	}
+	if (data.trading_day > trading_day_) {
+		// 交易日只向后轮换, 已整理的交易日不再重新打开
+		if (!compacted_.contains(data.trading_day)) { return false; }
+	} else {
+		// 前一交易日迟到的行情
+		for (Retired& retired : retired_) {
+			if (retired.trading_day == data.trading_day) {
+				retired.recorder->DataSink(data);
+				return true;
+			}
+		}
+	}
+	Drop("late", data);
+	return true;
+}
+
+void RotatingDataRecorder::Drop(const char* reason, const MarketDepth& data) {
+	if (dropped_++ == 0) {
+		spdlog::warn("RotatingDataRecorder: dropping {} tick of {} on trading day {}.", reason, data.instrument_id,
+					 data.trading_day);
+	}
+}
+
+std::unique_ptr<DataRecorder> RotatingDataRecorder::Create(int trading_day) {
+	try {
+		std::unique_ptr<DataRecorder> ret = factory_(trading_day);
+		spdlog::info("RotatingDataRecorder: recording trading day {}.", trading_day);
+		return ret;
+	} catch (const std::exception& e) {
+		// 与 `ArchiveDataRecorder` 相同, 丢弃无法打开的交易日的行情
+		spdlog::error("RotatingDataRecorder: cannot create recorder for trading day {}: {}", trading_day, e.what());
+		return nullptr;
+	}
+}
+
+void RotatingDataRecorder::Rotate(int trading_day, std::unique_ptr<DataRecorder> recorder) {
+	if (current_) {
+		retired_.push_back({.trading_day = trading_day_,
+							.recorder = std::move(current_),
+							.compact_time = std::chrono::steady_clock::now() + compaction_delay_});
+		cv_.notify_one();
+	}
+	trading_day_ = trading_day;
+	current_ = std::move(recorder);
+}
+
+RecorderStatistics RotatingDataRecorder::statistics() const {
+	std::shared_lock _(mutex_);
+	RecorderStatistics ret = closed_;
+	if (current_) { Accumulate(ret, current_->statistics()); }
+	for (const Retired& retired : retired_) { Accumulate(ret, retired.recorder->statistics()); }
+	uint64_t dropped = dropped_;
+	ret.received += dropped;
+	ret.dropped += dropped;
+	return ret;
+}
+
+void RotatingDataRecorder::Stop() {
+	{
+		std::scoped_lock _(mutex_);
+		if (!working_) { return; }
+		working_ = false;
+	}
+	cv_.notify_one();
+	compaction_thread_.join();
+	std::shared_lock _(mutex_);
+	if (current_) { current_->Stop(); }
+}
+
+void RotatingDataRecorder::CompactionLoop() {
+	LowerThreadPriority();
+	std::unique_lock lock(mutex_);
+	while (true) {
+		if (retired_.empty()) {
+			if (!working_) { break; }
+			cv_.wait(lock);
+			continue;
+		}
+		// 停止时不再等待迟到的行情
+		if (working_ && (std::chrono::steady_clock::now() < retired_.front().compact_time)) {
+			cv_.wait_until(lock, retired_.front().compact_time);
+			continue;
+		}
+		// 取出后不再有行情写入该记录器, 该交易日也不再重新打开
+		Retired retired = std::move(retired_.front());
+		retired_.pop_front();
+		compacted_.insert(retired.trading_day);
+		lock.unlock();
+
+		// 写完缓冲区并关闭文件. `SQLite3DataRecorder` 等在析构时建立索引, 也在本线程中以低优先级进行
+		retired.recorder->Stop();
+		RecorderStatistics stats = retired.recorder->statistics();
+		retired.recorder.reset();
+		lock.lock();
+		Accumulate(closed_, stats);
+		lock.unlock();
+
+		if (compactor_) {
+			auto start = std::chrono::steady_clock::now();
+			try {
+				compactor_(retired.trading_day);
+				spdlog::info("RotatingDataRecorder: compacted trading day {} in {} s.", retired.trading_day,
+							 std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - start)
+								 .count());
+			} catch (const std::exception& e) {
+				spdlog::error("RotatingDataRecorder: failed to compact trading day {}: {}", retired.trading_day,
+							  e.what());
+			}
+		}
+		lock.lock();
+	}
+}
+
+std::filesystem::path RotatingDataRecorder::FileName(const std::filesystem::path& filename, int trading_day) {
+	std::filesystem::path ret = filename;
+	ret.replace_filename(filename.stem().string() + "_" + std::to_string(trading_day) +
+						 filename.extension().string());
+	return ret;
+}
@@ -0,0 +1,58 @@
+#include "shardeddatarecorder.h"
+
+#include <stdexcept>
+#include <string>
+
+#include "symboltable.h"
+
+ShardedDataRecorder::ShardedDataRecorder(size_t shard_count, const ShardFactory& factory)
+	: DataRecorder(NoWorker{}) {
+	if (shard_count == 0) { throw std::invalid_argument("ShardedDataRecorder: shard count must be positive"); }
+	shards_.reserve(shard_count);
+	for (size_t i = 0; i < shard_count; ++i) { shards_.push_back(factory(i)); }
+}
+
+ShardedDataRecorder::~ShardedDataRecorder() { Stop(); }
+
+size_t ShardedDataRecorder::Shard(std::string_view instrument_id) const noexcept {
+	return SymbolTable::Hash(instrument_id) % shards_.size();
+}
+
+void ShardedDataRecorder::DataSink(const MarketDepth& data) { shards_[Shard(data.instrument_id)]->DataSink(data); }
+
+void ShardedDataRecorder::SetBackpressurePolicy(size_t capacity, BackpressurePolicy policy,
+												const std::filesystem::path& spill_file) {
+	for (size_t i = 0; i < shards_.size(); ++i) {
+		shards_[i]->SetBackpressurePolicy(capacity, policy,
+										  spill_file.empty() ? spill_file : ShardFileName(spill_file, i));
+	}
+}
+
+void ShardedDataRecorder::set_flush_interval(std::chrono::milliseconds interval) {
+	for (auto& shard : shards_) { shard->set_flush_interval(interval); }
+}
+
+RecorderStatistics ShardedDataRecorder::statistics() const {
+	RecorderStatistics ret;
+	for (const auto& shard : shards_) {
+		RecorderStatistics stats = shard->statistics();
+		ret.received += stats.received;
+		ret.written += stats.written;
+		ret.dropped += stats.dropped;
+		ret.spilled += stats.spilled;
+		ret.blocked += stats.blocked;
+		ret.pending += stats.pending;
+	}
+	return ret;
+}
+
+void ShardedDataRecorder::Stop() {
+	// 各分片的记录线程并行写完, 依次等待即可
+	for (auto& shard : shards_) { shard->Stop(); }
+}
+
+std::filesystem::path ShardedDataRecorder::ShardFileName(const std::filesystem::path& filename, size_t shard) {
+	std::filesystem::path ret = filename;
+	ret.replace_filename(filename.stem().string() + "_" + std::to_string(shard) + filename.extension().string());
+	return ret;
+}
@@ -0,0 +1,103 @@
+#include "shmmarketdata.h"
+
+#include <chrono>
+
+#include <spdlog/spdlog.h>
+
+#include "utsexceptions.h"
+
+using std::vector;
+
+ShmTickGateway::ShmTickGateway(TradingEventBus& event_bus, const std::string& name, size_t capacity)
+	: event_bus_(event_bus), writer_(name, capacity) {
+	subscription_ = event_bus_.Subscribe<MarketDepth, &ShmTickGateway::OnMarketData>(this);
+	spdlog::info("SHM: gateway publishing to /dev/shm/{} with {} slots.", name, writer_.capacity());
+}
+
+ShmTickGateway::~ShmTickGateway() { event_bus_.Unsubscribe<MarketDepth>(subscription_); }
+
+void ShmTickGateway::OnMarketData(const MarketDepth& md) {
+	if (md.symbol_id == kInvalidSymbol) { return; }
+	std::scoped_lock _(mutex_);
+	writer_.Publish(md);
+}
+
+ShmMarketData::ShmMarketData(const std::string& name, int idle_sleep)
+	: MarketDataSource({}),
+	  name_(name),
+	  idle_sleep_(idle_sleep),
+	  subscribed_(std::make_unique<std::atomic<bool>[]>(SymbolTable::kCapacity)) {}
+
+ShmMarketData::~ShmMarketData() { LogOut(); }
+
+void ShmMarketData::LogIn() {
+	if (is_logged_in()) { return; }
+	reader_ = std::make_unique<ShmTickReader>(name_);
+	status_ = ConnectionStatus::Connected;
+	running_ = true;
+	poller_ = std::thread(&ShmMarketData::PollLoop, this);
+	spdlog::info("SHM: attached to /dev/shm/{}.", name_);
+}
+
+void ShmMarketData::LogOut() {
+	if (!is_logged_in()) { return; }
+	running_ = false;
+	if (poller_.joinable()) { poller_.join(); }
+	reader_.reset();
+	status_ = ConnectionStatus::Disconnected;
+	spdlog::debug("SHM: detached from /dev/shm/{}.", name_);
+}
+
+vector<Ticker> ShmMarketData::Subscribe(const vector<Ticker>& ticker_list) {
+	vector<Ticker> failed;
+	for (const Ticker& ticker : ticker_list) {
+		SymbolID id = SymbolTable::Instance().Intern(ticker);
+		if (id == kInvalidSymbol) {
+			failed.push_back(ticker);
+			continue;
+		}
+		subscribed_[id].store(true, std::memory_order_relaxed);
+		subscribed_tickers_.insert(ticker);
+	}
+	return failed;
+}
+
+vector<Ticker> ShmMarketData::Unsubscribe(const vector<Ticker>& ticker_list) {
+	for (const Ticker& ticker : ticker_list) {
+		SymbolID id = SymbolTable::Instance().Find(ticker);
+		if (id != kInvalidSymbol) { subscribed_[id].store(false, std::memory_order_relaxed); }
+		subscribed_tickers_.erase(ticker);
+	}
+	return {};
+}
+
+void ShmMarketData::PollLoop() {
+	MarketDepth md;
+	while (running_.load(std::memory_order_relaxed)) {
+		uint64_t dropped = reader_->dropped();
+		switch (reader_->Read(md)) {
+			case ShmReadResult::Ok:
+				if ((md.symbol_id == kInvalidSymbol) || !subscribed_[md.symbol_id].load(std::memory_order_relaxed)) {
+					break;
+				}
+				market_data_.Store(md.symbol_id, md);
+				if (event_bus_) { event_bus_->Publish(md); }
+				break;
+			case ShmReadResult::Lapped:
+				lapped_.fetch_add(1, std::memory_order_relaxed);
+				dropped_.fetch_add(reader_->dropped() - dropped, std::memory_order_relaxed);
+				spdlog::warn("SHM: reader lapped by gateway, {} ticks dropped.", reader_->dropped() - dropped);
+				break;
+			case ShmReadResult::Restarted:
+				spdlog::info("SHM: gateway restarted, reattached to /dev/shm/{}.", name_);
+				break;
+			case ShmReadResult::Empty:
+				if (idle_sleep_ > 0) {
+					std::this_thread::sleep_for(std::chrono::microseconds(idle_sleep_));
+				} else {
+					std::this_thread::yield();
+				}
+				break;
+		}
+	}
+}
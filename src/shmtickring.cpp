@@ -0,0 +1,191 @@
+#include "shmtickring.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <system_error>
+
+#include "symboltable.h"
+#include "trading_utils.h"
+#include "utsexceptions.h"
+
+namespace {
+std::string ShmPath(const std::string& name) { return "/" + name; }
+
+[[noreturn]] void ThrowSystemError(const std::string& what) {
+	throw std::system_error(errno, std::generic_category(), what);
+}
+
+/// 槽位 2n+2 表示第n笔已写完
+constexpr uint64_t CompletedSequence(uint64_t n) noexcept { return 2 * n + 2; }
+}  // namespace
+
+ShmTickWriter::ShmTickWriter(const std::string& name, size_t capacity)
+	: name_(ShmPath(name)), capacity_(std::bit_ceil(capacity < 2 ? size_t{2} : capacity)) {
+	mapped_size_ = sizeof(shm_tick::Header) + capacity_ * sizeof(shm_tick::Slot);
+	// 删除旧的同名缓冲区, 仍映射着旧缓冲区的读进程不受影响
+	shm_unlink(name_.c_str());
+	int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+	if (fd < 0) { ThrowSystemError("shm_open " + name_); }
+	if (ftruncate(fd, static_cast<off_t>(mapped_size_)) != 0) {
+		close(fd);
+		shm_unlink(name_.c_str());
+		ThrowSystemError("ftruncate " + name_);
+	}
+	void* addr = mmap(nullptr, mapped_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (addr == MAP_FAILED) {
+		shm_unlink(name_.c_str());
+		ThrowSystemError("mmap " + name_);
+	}
+
+	// ftruncate 后内容为0, 槽位序号0不对应任何一笔
+	header_ = static_cast<shm_tick::Header*>(addr);
+	slots_ = reinterpret_cast<shm_tick::Slot*>(static_cast<char*>(addr) + sizeof(shm_tick::Header));
+	header_->version = shm_tick::kVersion;
+	header_->slot_size = sizeof(shm_tick::Slot);
+	header_->capacity = capacity_;
+	header_->session = Now();
+	header_->write_sequence.store(0, std::memory_order_relaxed);
+	header_->closed.store(0, std::memory_order_relaxed);
+	header_->magic.store(shm_tick::kMagic, std::memory_order_release);
+}
+
+ShmTickWriter::~ShmTickWriter() {
+	header_->closed.store(1, std::memory_order_release);
+	munmap(header_, mapped_size_);
+	shm_unlink(name_.c_str());
+}
+
+void ShmTickWriter::Publish(const MarketDepth& md) noexcept {
+	uint64_t n = header_->write_sequence.load(std::memory_order_relaxed);
+	shm_tick::Slot& slot = slots_[n & (capacity_ - 1)];
+	slot.sequence.store(CompletedSequence(n) - 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	std::memcpy(slot.instrument_id, md.instrument_id, sizeof(slot.instrument_id));
+	slot.tick = MarketDepthL5::From(md);
+	slot.sequence.store(CompletedSequence(n), std::memory_order_release);
+	header_->write_sequence.store(n + 1, std::memory_order_release);
+}
+
+ShmTickReader::ShmTickReader(const std::string& name, bool from_start) : path_(ShmPath(name)) {
+	Map();
+	uint64_t head = header_->write_sequence.load(std::memory_order_acquire);
+	next_ = !from_start ? head : (head > capacity_ ? head - capacity_ : 0);
+	last_check_ = std::chrono::steady_clock::now();
+}
+
+ShmTickReader::~ShmTickReader() { Unmap(); }
+
+void ShmTickReader::Map() {
+	int fd = shm_open(path_.c_str(), O_RDONLY, 0);
+	if (fd < 0) {
+		if (errno == ENOENT) { throw IOError("/dev/shm" + path_); }
+		ThrowSystemError("shm_open " + path_);
+	}
+	struct stat st;
+	if ((fstat(fd, &st) != 0) || (static_cast<size_t>(st.st_size) < sizeof(shm_tick::Header))) {
+		close(fd);
+		throw std::system_error(std::make_error_code(std::errc::invalid_argument), "truncated " + path_);
+	}
+	size_t mapped_size = static_cast<size_t>(st.st_size);
+	void* addr = mmap(nullptr, mapped_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (addr == MAP_FAILED) { ThrowSystemError("mmap " + path_); }
+
+	const auto* header = static_cast<const shm_tick::Header*>(addr);
+	size_t capacity = header->capacity;
+	if ((header->magic.load(std::memory_order_acquire) != shm_tick::kMagic) ||
+		(header->version != shm_tick::kVersion) || (header->slot_size != sizeof(shm_tick::Slot)) ||
+		!std::has_single_bit(capacity) ||
+		(sizeof(shm_tick::Header) + capacity * sizeof(shm_tick::Slot) > mapped_size)) {
+		munmap(addr, mapped_size);
+		throw std::system_error(std::make_error_code(std::errc::invalid_argument), "layout mismatch " + path_);
+	}
+	Unmap();
+	header_ = header;
+	slots_ = reinterpret_cast<const shm_tick::Slot*>(static_cast<const char*>(addr) + sizeof(shm_tick::Header));
+	capacity_ = capacity;
+	mapped_size_ = mapped_size;
+}
+
+void ShmTickReader::Unmap() noexcept {
+	if (header_ != nullptr) { munmap(const_cast<shm_tick::Header*>(header_), mapped_size_); }
+	header_ = nullptr;
+}
+
+bool ShmTickReader::Reattach() {
+	last_check_ = std::chrono::steady_clock::now();
+	Timestamp session = header_->session;
+	// 缓冲区未重建时只是重新映射同一缓冲区. 映射失败(如写进程正在重建)时保留原映射, 下次再试
+	try {
+		Map();
+	} catch (const std::exception&) {
+		return false;
+	}
+	if (header_->session == session) { return false; }
+	next_ = 0;
+	symbol_map_.clear();
+	++restarts_;
+	return true;
+}
+
+void ShmTickReader::Skip(uint64_t head) noexcept {
+	++lapped_;
+	dropped_ += head - next_;
+	next_ = head;
+}
+
+ShmReadResult ShmTickReader::Read(MarketDepth& md) {
+	uint64_t head = header_->write_sequence.load(std::memory_order_acquire);
+	if (next_ >= head) {
+		// 写进程崩溃时不会设置 `closed`, 因此空闲时也定期检查. 已退出时检查得更频繁
+		auto interval = writer_closed() ? kReattachInterval / 10 : kReattachInterval;
+		if ((std::chrono::steady_clock::now() - last_check_ >= interval) && Reattach()) {
+			return ShmReadResult::Restarted;
+		}
+		return ShmReadResult::Empty;
+	}
+	if (head - next_ > capacity_) {
+		Skip(head);
+		return ShmReadResult::Lapped;
+	}
+
+	const shm_tick::Slot& slot = slots_[next_ & (capacity_ - 1)];
+	char instrument_id[sizeof(slot.instrument_id)];
+	MarketDepthL5 tick;
+	uint64_t begin = slot.sequence.load(std::memory_order_acquire);
+	std::memcpy(instrument_id, slot.instrument_id, sizeof(instrument_id));
+	std::memcpy(&tick, &slot.tick, sizeof(tick));
+	std::atomic_thread_fence(std::memory_order_acquire);
+	uint64_t end = slot.sequence.load(std::memory_order_relaxed);
+	// 第next_笔已发布, 序号不符只能是已被之后的行情覆盖
+	if ((begin != CompletedSequence(next_)) || (end != begin)) {
+		Skip(header_->write_sequence.load(std::memory_order_acquire));
+		return ShmReadResult::Lapped;
+	}
+	++next_;
+
+	instrument_id[sizeof(instrument_id) - 1] = '\0';
+	SymbolID writer_id = tick.symbol_id;
+	SymbolID local_id = kInvalidSymbol;
+	if (writer_id < SymbolTable::kCapacity) {
+		if (writer_id >= symbol_map_.size()) { symbol_map_.resize(writer_id + 1, kInvalidSymbol); }
+		if (symbol_map_[writer_id] == kInvalidSymbol) {
+			symbol_map_[writer_id] = SymbolTable::Instance().Intern(instrument_id);
+		}
+		local_id = symbol_map_[writer_id];
+	} else {
+		local_id = SymbolTable::Instance().Intern(instrument_id);
+	}
+	tick.symbol_id = local_id;
+	md = tick.ToMarketDepth();
+	std::memcpy(md.instrument_id, instrument_id, sizeof(md.instrument_id));
+	return ShmReadResult::Ok;
+}
@@ -1,62 +1,289 @@
 #include "sqlite3datarecorder.h"
 
 #include <stdexcept>
+#include <string>
 
-SQLite3DataRecorder::SQLite3DataRecorder(const std::filesystem::path& db_name) {
+#include <spdlog/spdlog.h>
+
+#include "symboltable.h"
+#include "trading_utils.h"
+
+namespace {
+/// 插入语句的参数
+namespace column {
+enum {
+	DateTime,
+	ID,
+	Open,
+	High,
+	Low,
+	Latest,
+	TurnOver,
+	Volume,
+	OpenInterest,
+	BidPrice1,
+	BidVolume1,
+	AskPrice1,
+	AskVolume1,
+};
+}  // namespace column
+constexpr const char* kCreateTable =
+	"CREATE TABLE IF NOT EXISTS tickdata ( \
+	DateTime DATETIME NOT NULL, \
+	ID VARCHAR(20) NOT NULL, \
+	Open DECIMAL(6,3) NULL DEFAULT NULL, \
+	High DECIMAL(6,3) NULL DEFAULT NULL, \
+	Low DECIMAL(6,3) NULL DEFAULT NULL, \
+	Latest DECIMAL(6,3) NULL DEFAULT NULL, \
+	TurnOver BIGINT(20) NULL DEFAULT NULL, \
+	Volume BIGINT(20) NULL DEFAULT NULL, \
+	OpenInterest BIGINT(20) NULL DEFAULT NULL, \
+	BidPrice1 DECIMAL(6,3) NULL DEFAULT NULL, \
+	BidVolume1 INT(11) NULL DEFAULT NULL, \
+	AskPrice1 DECIMAL(6,3) NULL DEFAULT NULL, \
+	AskVolume1 INT(11) NULL DEFAULT NULL \
+	)";
+constexpr const char* kCreateIndex = "CREATE INDEX IF NOT EXISTS tickdata_id_datetime ON tickdata (ID, DateTime);";
+/// 合并后的数据库中记录各分片已合并至的 `rowid`
+constexpr const char* kCreateMergedShards =
+	"CREATE TABLE IF NOT EXISTS merged_shards (name TEXT PRIMARY KEY, last_rowid INTEGER NOT NULL);";
+
+constexpr const char* kParameterNames[] = {":DateTime",	   ":ID",		  ":Open",		":High",		 ":Low",
+										   ":Latest",	   ":TurnOver",	  ":Volume",	":OpenInterest", ":BidPrice1",
+										   ":BidVolume1", ":AskPrice1", ":AskVolume1"};
+
+constexpr const char* kCreateBarTable =
+	"CREATE TABLE IF NOT EXISTS bardata ( \
+	TradingDay INT NOT NULL, \
+	ID VARCHAR(20) NOT NULL, \
+	Period INT NOT NULL, \
+	StartTime DATETIME NOT NULL, \
+	EndTime DATETIME NOT NULL, \
+	Open DECIMAL(6,3) NULL DEFAULT NULL, \
+	High DECIMAL(6,3) NULL DEFAULT NULL, \
+	Low DECIMAL(6,3) NULL DEFAULT NULL, \
+	Close DECIMAL(6,3) NULL DEFAULT NULL, \
+	TurnOver BIGINT(20) NULL DEFAULT NULL, \
+	Volume BIGINT(20) NULL DEFAULT NULL, \
+	OpenInterest BIGINT(20) NULL DEFAULT NULL, \
+	TickCount INT NULL DEFAULT NULL \
+	)";
+
+sqlite3* OpenOrThrow(const std::filesystem::path& db_name) {
+	sqlite3* conn = nullptr;
+	int error_code = sqlite3_open(db_name.string().c_str(), &conn);
+	if (error_code != SQLITE_OK) {
+		auto msg = sqlite3_errstr(error_code);
+		sqlite3_close(conn);
+		throw std::runtime_error(msg);
+	}
+	return conn;
+}
+
+/// 执行失败时关闭连接并抛出异常
+void ExecOrThrow(sqlite3* conn, const char* sql) {
+	char* error = nullptr;
+	if (sqlite3_exec(conn, sql, nullptr, nullptr, &error) != SQLITE_OK) {
+		std::string msg = fmt::format("SQLite3DataRecorder: {} failed: {}", sql, error ? error : "");
+		sqlite3_free(error);
+		sqlite3_close(conn);
+		throw std::runtime_error(msg);
+	}
+}
+}  // namespace
+
+SQLite3DataRecorder::SQLite3DataRecorder(const std::filesystem::path& db_name, size_t batch_rows,
+										 std::chrono::milliseconds batch_interval)
+	: batch_rows_(batch_rows), batch_interval_(batch_interval) {
 	int error_code = sqlite3_open(db_name.string().c_str(), &conn_);
 	if (error_code != SQLITE_OK) {
 		auto msg = sqlite3_errstr(error_code);
 		sqlite3_close(conn_);
 		throw std::runtime_error(msg);
 	}
-	const char* create_table_query =
-		"CREATE TABLE IF NOT EXISTS tickdata ( \
-		DateTime DATETIME NOT NULL, \
-		ID VARCHAR(20) NOT NULL, \
-		Open DECIMAL(6,3) NULL DEFAULT NULL, \
-		High DECIMAL(6,3) NULL DEFAULT NULL, \
-		Low DECIMAL(6,3) NULL DEFAULT NULL, \
-		Latest DECIMAL(6,3) NULL DEFAULT NULL, \
-		TurnOver BIGINT(20) NULL DEFAULT NULL, \
-		Volume BIGINT(20) NULL DEFAULT NULL, \
-		OpenInterest BIGINT(20) NULL DEFAULT NULL, \
-		BidPrice1 DECIMAL(6,3) NULL DEFAULT NULL, \
-		BidVolume1 INT(11) NULL DEFAULT NULL, \
-		AskPrice1 DECIMAL(6,3) NULL DEFAULT NULL, \
-		AskVolume1 INT(11) NULL DEFAULT NULL \
-		)";
-	sqlite3_exec(conn_, create_table_query, nullptr, nullptr, nullptr);
+	// WAL模式下提交只追加日志, synchronous=NORMAL 时提交不再fsync, 只在检查点同步
+	Exec("PRAGMA journal_mode=WAL;");
+	Exec("PRAGMA synchronous=NORMAL;");
+	Exec(kCreateTable);
 
 	const char* query =
 		"INSERT INTO tickdata (DateTime, ID, Open, High, Low, Latest, TurnOver, Volume, OpenInterest, BidPrice1, "
 		"BidVolume1, AskPrice1, AskVolume1) VALUES (:DateTime, :ID, :Open, :High, :Low, :Latest, :TurnOver, :Volume, "
 		":OpenInterest, :BidPrice1, :BidVolume1, :AskPrice1, :AskVolume1);";
 	sqlite3_prepare_v2(conn_, query, -1, &stmt_, nullptr);
+	for (size_t i = 0; i < kColumnCount; ++i) {
+		param_index_[i] = sqlite3_bind_parameter_index(stmt_, kParameterNames[i]);
+	}
+	set_flush_interval(batch_interval_);
 }
 
 SQLite3DataRecorder::~SQLite3DataRecorder() {
+	Stop();
 	if (conn_) {
+		// 记录结束后一次性建立索引, 比逐行维护快得多
+		Exec(kCreateIndex);
 		sqlite3_finalize(stmt_);
 		sqlite3_close(conn_);
 	}
 }
 
+bool SQLite3DataRecorder::Exec(const char* sql) {
+	char* error = nullptr;
+	if (sqlite3_exec(conn_, sql, nullptr, nullptr, &error) != SQLITE_OK) {
+		spdlog::error("SQLite3DataRecorder: {} failed: {}", sql, error ? error : "");
+		sqlite3_free(error);
+		return false;
+	}
+	return true;
+}
+
+void SQLite3DataRecorder::MergeShards(const std::filesystem::path& db_name,
+									   std::span<const std::filesystem::path> shards) {
+	sqlite3* conn = OpenOrThrow(db_name);
+	ExecOrThrow(conn, "PRAGMA journal_mode=WAL;");
+	ExecOrThrow(conn, kCreateTable);
+	ExecOrThrow(conn, kCreateMergedShards);
+	for (const std::filesystem::path& shard : shards) {
+		char* attach = sqlite3_mprintf("ATTACH DATABASE %Q AS shard;", shard.string().c_str());
+		std::string sql = attach;
+		sqlite3_free(attach);
+		ExecOrThrow(conn, sql.c_str());
+		// 只复制上次合并后新增的行, 与推进记录在同一事务中, 重复合并不产生重复的行
+		std::string name = std::filesystem::absolute(shard).lexically_normal().string();
+		char* merge = sqlite3_mprintf(
+			"BEGIN TRANSACTION;"
+			"INSERT OR IGNORE INTO merged_shards (name, last_rowid) VALUES (%Q, 0);"
+			"INSERT INTO tickdata SELECT * FROM shard.tickdata "
+			"WHERE rowid > (SELECT last_rowid FROM merged_shards WHERE name = %Q) ORDER BY rowid;"
+			"UPDATE merged_shards SET last_rowid = MAX(last_rowid, IFNULL((SELECT MAX(rowid) FROM shard.tickdata), 0)) "
+			"WHERE name = %Q;"
+			"COMMIT;",
+			name.c_str(), name.c_str(), name.c_str());
+		sql = merge;
+		sqlite3_free(merge);
+		ExecOrThrow(conn, sql.c_str());
+		ExecOrThrow(conn, "DETACH DATABASE shard;");
+	}
+	ExecOrThrow(conn, kCreateIndex);
+	sqlite3_close(conn);
+}
+
+void SQLite3DataRecorder::Compact(const std::filesystem::path& db_name) {
+	if (!std::filesystem::exists(db_name)) { throw std::runtime_error(db_name.string() + " does not exist"); }
+	sqlite3* conn = OpenOrThrow(db_name);
+	ExecOrThrow(conn, kCreateIndex);
+	// 为查询规划收集索引统计, 之后重建文件回收空闲页并按索引顺序重排, 最后清空 WAL
+	ExecOrThrow(conn, "ANALYZE;");
+	ExecOrThrow(conn, "VACUUM;");
+	ExecOrThrow(conn, "PRAGMA wal_checkpoint(TRUNCATE);");
+	sqlite3_close(conn);
+}
+
 void SQLite3DataRecorder::WriteDB(const MarketDepth& data) {
 	sqlite3_reset(stmt_);
-	sqlite3_clear_bindings(stmt_);
-	sqlite3_bind_text(stmt_, sqlite3_bind_parameter_index(stmt_, ":DateTime"), data.update_time.c_str(), -1, nullptr);
-	sqlite3_bind_text(stmt_, sqlite3_bind_parameter_index(stmt_, ":ID"), data.instrument_id.c_str(), -1, nullptr);
-	sqlite3_bind_double(stmt_, sqlite3_bind_parameter_index(stmt_, ":Open"), data.ohlclvt.open);
-	sqlite3_bind_double(stmt_, sqlite3_bind_parameter_index(stmt_, ":High"), data.ohlclvt.high);
-	sqlite3_bind_double(stmt_, sqlite3_bind_parameter_index(stmt_, ":Low"), data.ohlclvt.low);
-	sqlite3_bind_double(stmt_, sqlite3_bind_parameter_index(stmt_, ":Latest"), data.ohlclvt.last);
-	sqlite3_bind_double(stmt_, sqlite3_bind_parameter_index(stmt_, ":TurnOver"), data.ohlclvt.turnover);
-	sqlite3_bind_double(stmt_, sqlite3_bind_parameter_index(stmt_, ":Volume"), data.ohlclvt.volume);
-	sqlite3_bind_double(stmt_, sqlite3_bind_parameter_index(stmt_, ":OpenInterest"), data.open_interest);
-	sqlite3_bind_double(stmt_, sqlite3_bind_parameter_index(stmt_, ":BidPrice1"), data.bid[0].price);
-	sqlite3_bind_double(stmt_, sqlite3_bind_parameter_index(stmt_, ":BidVolume1"), data.bid[0].volume);
-	sqlite3_bind_double(stmt_, sqlite3_bind_parameter_index(stmt_, ":AskPrice1"), data.ask[0].price);
-	sqlite3_bind_double(stmt_, sqlite3_bind_parameter_index(stmt_, ":AskVolume1"), data.ask[0].volume);
-
-	sqlite3_step(stmt_);
+	char datetime[kDateTimeStrLength + 1];
+	FormatDateTime(data.exchange_time, datetime);
+	sqlite3_bind_text(stmt_, param_index_[column::DateTime], datetime, kDateTimeStrLength, SQLITE_TRANSIENT);
+	sqlite3_bind_text(stmt_, param_index_[column::ID], data.instrument_id, -1, SQLITE_STATIC);
+	sqlite3_bind_double(stmt_, param_index_[column::Open], data.ohlclvt.open);
+	sqlite3_bind_double(stmt_, param_index_[column::High], data.ohlclvt.high);
+	sqlite3_bind_double(stmt_, param_index_[column::Low], data.ohlclvt.low);
+	sqlite3_bind_double(stmt_, param_index_[column::Latest], data.ohlclvt.last);
+	sqlite3_bind_double(stmt_, param_index_[column::TurnOver], data.ohlclvt.turnover);
+	sqlite3_bind_double(stmt_, param_index_[column::Volume], data.ohlclvt.volume);
+	sqlite3_bind_double(stmt_, param_index_[column::OpenInterest], data.open_interest);
+	sqlite3_bind_double(stmt_, param_index_[column::BidPrice1], data.bid[0].price);
+	sqlite3_bind_double(stmt_, param_index_[column::BidVolume1], data.bid[0].volume);
+	sqlite3_bind_double(stmt_, param_index_[column::AskPrice1], data.ask[0].price);
+	sqlite3_bind_double(stmt_, param_index_[column::AskVolume1], data.ask[0].volume);
+
+	if (sqlite3_step(stmt_) != SQLITE_DONE) {
+		spdlog::error("SQLite3DataRecorder: insert failed: {}", sqlite3_errmsg(conn_));
+		insert_failed_ = true;
+	}
+}
+
+void SQLite3DataRecorder::WriteDB(std::span<const MarketDepth> data) {
+	for (const MarketDepth& md : data) {
+		if (!in_transaction_) {
+			Exec("BEGIN TRANSACTION;");
+			in_transaction_ = true;
+			transaction_rows_ = 0;
+			transaction_start_ = std::chrono::steady_clock::now();
+		}
+		WriteDB(md);
+		++transaction_rows_;
+		// 由日志驱动时只在 `Sync` 中提交, 否则失败后从日志重新写入时会重复已提交的行
+		if (!journaled() && (transaction_rows_ >= batch_rows_)) { Commit(); }
+	}
+	if (!journaled() && in_transaction_ && (std::chrono::steady_clock::now() - transaction_start_ >= batch_interval_)) {
+		Commit();
+	}
+}
+
+void SQLite3DataRecorder::Flush() { Commit(); }
+
+bool SQLite3DataRecorder::Sync() {
+	bool ret = !insert_failed_ && Commit();
+	insert_failed_ = false;
+	// 部分插入失败时整个事务回滚, 由日志重新写入
+	if (!ret) {
+		in_transaction_ = false;
+		if (!sqlite3_get_autocommit(conn_)) { Exec("ROLLBACK;"); }
+	}
+	return ret;
+}
+
+bool SQLite3DataRecorder::Commit() {
+	if (!in_transaction_) { return true; }
+	in_transaction_ = false;
+	return Exec("COMMIT;");
+}
+
+SQLite3BarRecorder::SQLite3BarRecorder(const std::filesystem::path& db_name) {
+	conn_ = OpenOrThrow(db_name);
+	ExecOrThrow(conn_, "PRAGMA journal_mode=WAL;");
+	ExecOrThrow(conn_, "PRAGMA synchronous=NORMAL;");
+	ExecOrThrow(conn_, kCreateBarTable);
+	const char* query =
+		"INSERT INTO bardata (TradingDay, ID, Period, StartTime, EndTime, Open, High, Low, Close, TurnOver, Volume, "
+		"OpenInterest, TickCount) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?);";
+	sqlite3_prepare_v2(conn_, query, -1, &stmt_, nullptr);
+}
+
+SQLite3BarRecorder::~SQLite3BarRecorder() {
+	Stop();
+	sqlite3_finalize(stmt_);
+	sqlite3_close(conn_);
+}
+
+void SQLite3BarRecorder::WriteBars(std::span<const Bar> bars) {
+	sqlite3_exec(conn_, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+	char start_time[kDateTimeStrLength + 1];
+	char end_time[kDateTimeStrLength + 1];
+	for (const Bar& bar : bars) {
+		sqlite3_reset(stmt_);
+		FormatDateTime(bar.start_time, start_time);
+		FormatDateTime(bar.end_time, end_time);
+		const Ticker& ticker = SymbolTable::Instance().Name(bar.symbol_id);
+		sqlite3_bind_int(stmt_, 1, bar.trading_day);
+		sqlite3_bind_text(stmt_, 2, ticker.c_str(), static_cast<int>(ticker.size()), SQLITE_STATIC);
+		sqlite3_bind_int(stmt_, 3, static_cast<int>(bar.period));
+		sqlite3_bind_text(stmt_, 4, start_time, kDateTimeStrLength, SQLITE_TRANSIENT);
+		sqlite3_bind_text(stmt_, 5, end_time, kDateTimeStrLength, SQLITE_TRANSIENT);
+		sqlite3_bind_double(stmt_, 6, bar.open);
+		sqlite3_bind_double(stmt_, 7, bar.high);
+		sqlite3_bind_double(stmt_, 8, bar.low);
+		sqlite3_bind_double(stmt_, 9, bar.close);
+		sqlite3_bind_double(stmt_, 10, bar.turnover);
+		sqlite3_bind_int64(stmt_, 11, bar.volume);
+		sqlite3_bind_int64(stmt_, 12, bar.open_interest);
+		sqlite3_bind_int(stmt_, 13, bar.tick_count);
+		if (sqlite3_step(stmt_) != SQLITE_DONE) {
+			spdlog::error("SQLite3BarRecorder: insert failed: {}", sqlite3_errmsg(conn_));
+		}
+	}
+	if (sqlite3_exec(conn_, "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+		spdlog::error("SQLite3BarRecorder: commit failed: {}", sqlite3_errmsg(conn_));
+	}
 }
@@ -0,0 +1,54 @@
+﻿#include "symboltable.h"
+
+#include <spdlog/spdlog.h>
+
+SymbolTable& SymbolTable::Instance() {
+	static SymbolTable table;
+	return table;
+}
+
+SymbolTable::SymbolTable()
+	: names_(std::make_unique<Ticker[]>(kCapacity)), buckets_(std::make_unique<std::atomic<SymbolID>[]>(kBuckets)) {}
+
+SymbolID SymbolTable::Intern(std::string_view ticker) {
+	SymbolID id = Find(ticker);
+	if (id != kInvalidSymbol) { return id; }
+
+	std::scoped_lock _(mutex_);
+	id = Find(ticker);
+	if (id != kInvalidSymbol) { return id; }
+
+	size_t count = size_.load(std::memory_order_relaxed);
+	if (count >= kCapacity) {
+		spdlog::error("Symbol table is full, {} is not registered.", ticker);
+		return kInvalidSymbol;
+	}
+	id = static_cast<SymbolID>(count);
+	names_[id] = ticker;
+
+	size_t bucket = Hash(ticker) & (kBuckets - 1);
+	while (buckets_[bucket].load(std::memory_order_relaxed) != 0) { bucket = (bucket + 1) & (kBuckets - 1); }
+	buckets_[bucket].store(id + 1, std::memory_order_release);
+	size_.store(count + 1, std::memory_order_release);
+	return id;
+}
+
+SymbolID SymbolTable::Find(std::string_view ticker) const noexcept {
+	size_t bucket = Hash(ticker) & (kBuckets - 1);
+	while (true) {
+		SymbolID value = buckets_[bucket].load(std::memory_order_acquire);
+		if (value == 0) { return kInvalidSymbol; }
+		if (names_[value - 1] == ticker) { return value - 1; }
+		bucket = (bucket + 1) & (kBuckets - 1);
+	}
+}
+
+// FNV-1a
+size_t SymbolTable::Hash(std::string_view ticker) noexcept {
+	uint64_t hash = 14695981039346656037ull;
+	for (char c : ticker) {
+		hash ^= static_cast<unsigned char>(c);
+		hash *= 1099511628211ull;
+	}
+	return static_cast<size_t>(hash);
+}
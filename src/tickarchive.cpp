@@ -0,0 +1,485 @@
+#include "tickarchive.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#include <spdlog/spdlog.h>
+
+#include "symboltable.h"
+#include "utsexceptions.h"
+
+using namespace tick_archive;
+
+// 文件头, 块头及原始值按本机字节序直接读写, 格式规定为小端序
+static_assert(std::endian::native == std::endian::little, "tick archive format requires a little-endian host");
+
+namespace {
+[[noreturn]] void ThrowSystemError(const std::string& what) {
+	throw std::system_error(errno, std::generic_category(), what);
+}
+
+/// 各列在 `MarketDepth` 中的位置
+struct ColumnLayout {
+	ColumnEncoding encoding;
+	size_t offset;
+};
+
+constexpr size_t BidPrice(size_t level) {
+	return offsetof(MarketDepth, bid) + level * sizeof(PriceVolume) + offsetof(PriceVolume, price);
+}
+constexpr size_t AskPrice(size_t level) {
+	return offsetof(MarketDepth, ask) + level * sizeof(PriceVolume) + offsetof(PriceVolume, price);
+}
+constexpr size_t BidVolume(size_t level) {
+	return offsetof(MarketDepth, bid) + level * sizeof(PriceVolume) + offsetof(PriceVolume, volume);
+}
+constexpr size_t AskVolume(size_t level) {
+	return offsetof(MarketDepth, ask) + level * sizeof(PriceVolume) + offsetof(PriceVolume, volume);
+}
+constexpr size_t OHLCLVTField(size_t offset) { return offsetof(MarketDepth, ohlclvt) + offset; }
+
+constexpr ColumnEncoding kTime = ColumnEncoding::Timestamp;
+constexpr ColumnEncoding kPrice = ColumnEncoding::Price;
+constexpr ColumnEncoding kInteger = ColumnEncoding::Integer;
+
+/// 以 `TickColumn` 为下标
+constexpr std::array<ColumnLayout, kColumnCount> kLayout = {{
+	{kTime, offsetof(MarketDepth, exchange_time)},
+	{kTime, offsetof(MarketDepth, local_time)},
+	{kPrice, OHLCLVTField(offsetof(OHLCLVT, open))},
+	{kPrice, OHLCLVTField(offsetof(OHLCLVT, high))},
+	{kPrice, OHLCLVTField(offsetof(OHLCLVT, low))},
+	{kPrice, OHLCLVTField(offsetof(OHLCLVT, close))},
+	{kPrice, OHLCLVTField(offsetof(OHLCLVT, last))},
+	{kPrice, offsetof(MarketDepth, settle)},
+	{kPrice, offsetof(MarketDepth, average_price)},
+	{kPrice, offsetof(MarketDepth, upper_limit)},
+	{kPrice, offsetof(MarketDepth, lower_limit)},
+	{kPrice, offsetof(MarketDepth, delta)},
+	{kPrice, OHLCLVTField(offsetof(OHLCLVT, turnover))},
+	{kInteger, OHLCLVTField(offsetof(OHLCLVT, volume))},
+	{kInteger, offsetof(MarketDepth, open_interest)},
+	{kPrice, BidPrice(0)},
+	{kPrice, BidPrice(1)},
+	{kPrice, BidPrice(2)},
+	{kPrice, BidPrice(3)},
+	{kPrice, BidPrice(4)},
+	{kPrice, AskPrice(0)},
+	{kPrice, AskPrice(1)},
+	{kPrice, AskPrice(2)},
+	{kPrice, AskPrice(3)},
+	{kPrice, AskPrice(4)},
+	{kInteger, BidVolume(0)},
+	{kInteger, BidVolume(1)},
+	{kInteger, BidVolume(2)},
+	{kInteger, BidVolume(3)},
+	{kInteger, BidVolume(4)},
+	{kInteger, AskVolume(0)},
+	{kInteger, AskVolume(1)},
+	{kInteger, AskVolume(2)},
+	{kInteger, AskVolume(3)},
+	{kInteger, AskVolume(4)},
+}};
+static_assert(std::is_same_v<Timestamp, int64_t> && std::is_same_v<Price, double> &&
+			  std::is_same_v<Turnover, double> && std::is_same_v<Delta, double> && std::is_same_v<Volume, int>);
+
+template <typename T>
+T Load(const MarketDepth& md, size_t offset) noexcept {
+	T value;
+	std::memcpy(&value, reinterpret_cast<const char*>(&md) + offset, sizeof(T));
+	return value;
+}
+template <typename T>
+void Store(MarketDepth& md, size_t offset, T value) noexcept {
+	std::memcpy(reinterpret_cast<char*>(&md) + offset, &value, sizeof(T));
+}
+
+constexpr uint64_t ZigZag(int64_t v) noexcept {
+	return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+constexpr int64_t UnZigZag(uint64_t v) noexcept { return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1); }
+/// 按补码回绕的减法, 避免有符号溢出
+constexpr int64_t Sub(int64_t a, int64_t b) noexcept {
+	return static_cast<int64_t>(static_cast<uint64_t>(a) - static_cast<uint64_t>(b));
+}
+constexpr int64_t Add(int64_t a, int64_t b) noexcept {
+	return static_cast<int64_t>(static_cast<uint64_t>(a) + static_cast<uint64_t>(b));
+}
+
+void PutVarint(std::vector<uint8_t>& out, uint64_t v) {
+	while (v >= 0x80) {
+		out.push_back(static_cast<uint8_t>(v) | 0x80);
+		v >>= 7;
+	}
+	out.push_back(static_cast<uint8_t>(v));
+}
+
+void PutRaw(std::vector<uint8_t>& out, double v) {
+	uint8_t bytes[sizeof(double)];
+	std::memcpy(bytes, &v, sizeof(double));
+	out.insert(out.end(), bytes, bytes + sizeof(double));
+}
+
+/// 顺序读取一列的字节流
+class ByteReader {
+public:
+	explicit ByteReader(std::span<const uint8_t> data) : pos_(data.data()), end_(data.data() + data.size()) {}
+
+	uint64_t Varint() {
+		uint64_t v = 0;
+		for (int shift = 0; shift < 64; shift += 7) {
+			if (pos_ == end_) { Corrupted(); }
+			uint8_t byte = *pos_++;
+			v |= static_cast<uint64_t>(byte & 0x7F) << shift;
+			if ((byte & 0x80) == 0) { return v; }
+		}
+		Corrupted();
+	}
+	double Raw() {
+		if (end_ - pos_ < static_cast<ptrdiff_t>(sizeof(double))) { Corrupted(); }
+		double v;
+		std::memcpy(&v, pos_, sizeof(double));
+		pos_ += sizeof(double);
+		return v;
+	}
+
+private:
+	const uint8_t* pos_;
+	const uint8_t* end_;
+
+	[[noreturn]] static void Corrupted() { throw std::runtime_error("TickArchive: corrupted column"); }
+};
+
+/**
+ * @brief 价格与最小变动价位整数倍的换算
+ * @details 最小变动价位的倒数为整数时(如0.2, 0.01)以除法换算, 结果与十进制字面值的 `double` 完全一致
+ */
+class PriceScale {
+public:
+	explicit PriceScale(double tick) : tick_(tick) {
+		if (!std::isfinite(tick) || (tick <= 0)) { return; }
+		valid_ = true;
+		double inverse = 1 / tick;
+		double rounded = std::round(inverse);
+		if ((rounded >= 1) && (std::abs(inverse - rounded) <= 1e-9 * rounded)) { divisor_ = rounded; }
+	}
+
+	double ToPrice(int64_t ticks) const noexcept {
+		return divisor_ != 0 ? static_cast<double>(ticks) / divisor_ : static_cast<double>(ticks) * tick_;
+	}
+	/// 价格是否恰为最小变动价位的整数倍, 且换算回的值逐位相同
+	bool ToTicks(double price, int64_t& ticks) const noexcept {
+		if (!valid_) { return false; }
+		double scaled = divisor_ != 0 ? price * divisor_ : price / tick_;
+		if (!(std::abs(scaled) < 0x1p52)) { return false; }
+		ticks = std::llround(scaled);
+		return std::bit_cast<uint64_t>(ToPrice(ticks)) == std::bit_cast<uint64_t>(price);
+	}
+
+private:
+	double tick_;
+	double divisor_ = 0;
+	bool valid_ = false;
+};
+}  // namespace
+
+ColumnEncoding tick_archive::Encoding(TickColumn column) noexcept {
+	return kLayout[static_cast<size_t>(column)].encoding;
+}
+
+TickArchiveWriter::TickArchiveWriter(const std::filesystem::path& filename, int trading_day,
+									 std::unordered_map<Ticker, Price> price_ticks)
+	: filename_(filename), trading_day_(trading_day), price_ticks_(std::move(price_ticks)) {
+	std::error_code ec;
+	uintmax_t size = std::filesystem::file_size(filename, ec);
+	bool existed = !ec && (size > 0);
+	if (existed) {
+		std::ifstream in(filename, std::ios::binary);
+		FileHeader header{};
+		in.read(reinterpret_cast<char*>(&header), sizeof(header));
+		if (!in || (header.magic != kMagic) || (header.version != kVersion)) {
+			throw std::runtime_error(filename.string() + " is not a tick archive");
+		}
+		if (header.trading_day != trading_day) {
+			throw std::runtime_error(filename.string() + " belongs to trading day " +
+									 std::to_string(header.trading_day));
+		}
+		// 上次写入中途退出时截去不完整的块, 否则之后追加的块无法读出
+		uintmax_t offset = sizeof(FileHeader);
+		BlockHeader block_header;
+		while (in.seekg(static_cast<std::streamoff>(offset)) &&
+			   in.read(reinterpret_cast<char*>(&block_header), sizeof(block_header)) &&
+			   (block_header.magic == kBlockMagic)) {
+			uintmax_t end = offset + sizeof(BlockHeader);
+			for (uint32_t column_size : block_header.column_sizes) { end += column_size; }
+			if (end > size) { break; }
+			offset = end;
+		}
+		if (offset != size) {
+			spdlog::warn("TickArchiveWriter: truncating {} incomplete bytes at the end of {}.", size - offset,
+						 filename.string());
+			in.close();
+			std::filesystem::resize_file(filename, offset);
+		}
+	}
+	out_.open(filename, std::ios::binary | std::ios::app);
+	if (!out_) { throw IOError(filename); }
+	if (!existed) {
+		FileHeader header{.magic = kMagic, .version = kVersion, .trading_day = trading_day};
+		out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	}
+}
+
+TickArchiveWriter::~TickArchiveWriter() { Close(); }
+
+void TickArchiveWriter::Append(const MarketDepth& md) {
+	PendingBlock& block = blocks_[md.instrument_id];
+	BlockHeader& header = block.header;
+	if (header.rows == 0) {
+		// 每块从零开始差分, 可独立解码
+		header.magic = kBlockMagic;
+		std::memcpy(header.instrument_id, md.instrument_id, sizeof(header.instrument_id));
+		header.instrument_id[sizeof(header.instrument_id) - 1] = '\0';
+		auto iter = price_ticks_.find(header.instrument_id);
+		header.price_tick = iter != price_ticks_.end() ? iter->second : 0;
+		block.previous.fill(0);
+		block.previous_delta.fill(0);
+	}
+	PriceScale scale(header.price_tick);
+
+	for (size_t column = 0; column < kColumnCount; ++column) {
+		std::vector<uint8_t>& out = block.columns[column];
+		int64_t& previous = block.previous[column];
+		switch (kLayout[column].encoding) {
+			case ColumnEncoding::Timestamp: {
+				int64_t value = Load<Timestamp>(md, kLayout[column].offset);
+				int64_t delta = Sub(value, previous);
+				PutVarint(out, ZigZag(Sub(delta, block.previous_delta[column])));
+				block.previous_delta[column] = delta;
+				previous = value;
+				break;
+			}
+			case ColumnEncoding::Price: {
+				double value = Load<Price>(md, kLayout[column].offset);
+				int64_t ticks;
+				if (scale.ToTicks(value, ticks)) {
+					PutVarint(out, ZigZag(ticks - previous) << 1);
+					previous = ticks;
+				} else {
+					PutVarint(out, 1);
+					PutRaw(out, value);
+				}
+				break;
+			}
+			case ColumnEncoding::Integer: {
+				int64_t value = Load<Volume>(md, kLayout[column].offset);
+				PutVarint(out, ZigZag(value - previous));
+				previous = value;
+				break;
+			}
+		}
+	}
+	if (++header.rows == kBlockRows) { WriteBlock(block); }
+}
+
+void TickArchiveWriter::WriteBlock(PendingBlock& block) {
+	for (size_t column = 0; column < kColumnCount; ++column) {
+		block.header.column_sizes[column] = static_cast<uint32_t>(block.columns[column].size());
+	}
+	out_.write(reinterpret_cast<const char*>(&block.header), sizeof(block.header));
+	for (std::vector<uint8_t>& column : block.columns) {
+		out_.write(reinterpret_cast<const char*>(column.data()), static_cast<std::streamsize>(column.size()));
+		column.clear();
+	}
+	if (!out_) {
+		spdlog::error("TickArchiveWriter: failed to write {} rows of {}.", block.header.rows,
+					  block.header.instrument_id);
+	}
+	block.header.rows = 0;
+}
+
+void TickArchiveWriter::Flush() {
+	if (!out_.is_open()) { return; }
+	for (auto& [_, block] : blocks_) {
+		if (block.header.rows > 0) { WriteBlock(block); }
+	}
+	out_.flush();
+	// `std::ofstream` 不提供文件描述符, 另行打开同一文件同步
+	int fd = open(filename_.c_str(), O_WRONLY | O_CLOEXEC);
+	if ((fd < 0) || (fsync(fd) != 0)) {
+		spdlog::error("TickArchiveWriter: failed to sync {}: {}", filename_.string(), std::strerror(errno));
+	}
+	if (fd >= 0) { close(fd); }
+}
+
+void TickArchiveWriter::Close() {
+	if (!out_.is_open()) { return; }
+	for (auto& [_, block] : blocks_) {
+		if (block.header.rows > 0) { WriteBlock(block); }
+	}
+	blocks_.clear();
+	out_.close();
+}
+
+TickArchiveReader::TickArchiveReader(const std::filesystem::path& filename) {
+	if (!std::filesystem::exists(filename)) { throw IOError(filename); }
+	int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) { ThrowSystemError("open " + filename.string()); }
+	struct stat st {};
+	if (fstat(fd, &st) != 0) {
+		close(fd);
+		ThrowSystemError("fstat " + filename.string());
+	}
+	mapped_size_ = static_cast<size_t>(st.st_size);
+	if (mapped_size_ < sizeof(FileHeader)) {
+		close(fd);
+		throw std::runtime_error(filename.string() + " is not a tick archive");
+	}
+	void* addr = mmap(nullptr, mapped_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (addr == MAP_FAILED) { ThrowSystemError("mmap " + filename.string()); }
+	// 按列解码是顺序扫描
+	madvise(addr, mapped_size_, MADV_SEQUENTIAL);
+	data_ = static_cast<const uint8_t*>(addr);
+
+	FileHeader header;
+	std::memcpy(&header, data_, sizeof(header));
+	if ((header.magic != kMagic) || (header.version != kVersion)) {
+		munmap(addr, mapped_size_);
+		throw std::runtime_error(filename.string() + " is not a tick archive of version " + std::to_string(kVersion));
+	}
+	trading_day_ = header.trading_day;
+
+	size_t offset = sizeof(FileHeader);
+	while (offset + sizeof(BlockHeader) <= mapped_size_) {
+		BlockHeader block_header;
+		std::memcpy(&block_header, data_ + offset, sizeof(block_header));
+		if (block_header.magic != kBlockMagic) { break; }
+		size_t payload = 0;
+		for (uint32_t size : block_header.column_sizes) { payload += size; }
+		if (payload > mapped_size_ - offset - sizeof(BlockHeader)) { break; }
+
+		const char* instrument_id =
+			reinterpret_cast<const char*>(data_ + offset + offsetof(BlockHeader, instrument_id));
+		TickBlock block{.instrument_id = {instrument_id, strnlen(instrument_id, sizeof(block_header.instrument_id))},
+						.rows = block_header.rows,
+						.price_tick = block_header.price_tick,
+						.columns = {}};
+		const uint8_t* column = data_ + offset + sizeof(BlockHeader);
+		for (size_t i = 0; i < kColumnCount; ++i) {
+			block.columns[i] = {column, block_header.column_sizes[i]};
+			column += block_header.column_sizes[i];
+		}
+		blocks_.push_back(block);
+		rows_ += block.rows;
+		offset += sizeof(BlockHeader) + payload;
+	}
+	if (offset != mapped_size_) {
+		truncated_ = true;
+		spdlog::warn("TickArchiveReader: {} has {} trailing bytes that are not a complete block.", filename.string(),
+					 mapped_size_ - offset);
+	}
+}
+
+TickArchiveReader::~TickArchiveReader() { munmap(const_cast<uint8_t*>(data_), mapped_size_); }
+
+std::vector<Ticker> TickArchiveReader::instruments() const {
+	std::vector<Ticker> ret;
+	for (const TickBlock& block : blocks_) {
+		if (std::find(ret.begin(), ret.end(), block.instrument_id) == ret.end()) {
+			ret.emplace_back(block.instrument_id);
+		}
+	}
+	return ret;
+}
+
+void TickArchiveReader::DecodeColumn(const TickBlock& block, TickColumn column, std::span<int64_t> out) const {
+	ColumnEncoding encoding = Encoding(column);
+	if (encoding == ColumnEncoding::Price) { throw std::invalid_argument("TickArchive: not an integer column"); }
+	if (out.size() < block.rows) { throw std::invalid_argument("TickArchive: output is shorter than the block"); }
+	ByteReader reader(block.columns[static_cast<size_t>(column)]);
+	int64_t previous = 0;
+	int64_t previous_delta = 0;
+	for (uint32_t row = 0; row < block.rows; ++row) {
+		int64_t diff = UnZigZag(reader.Varint());
+		if (encoding == ColumnEncoding::Timestamp) {
+			previous_delta = Add(previous_delta, diff);
+			previous = Add(previous, previous_delta);
+		} else {
+			previous = Add(previous, diff);
+		}
+		out[row] = previous;
+	}
+}
+
+void TickArchiveReader::DecodeColumn(const TickBlock& block, TickColumn column, std::span<double> out) const {
+	if (Encoding(column) != ColumnEncoding::Price) { throw std::invalid_argument("TickArchive: not a price column"); }
+	if (out.size() < block.rows) { throw std::invalid_argument("TickArchive: output is shorter than the block"); }
+	ByteReader reader(block.columns[static_cast<size_t>(column)]);
+	PriceScale scale(block.price_tick);
+	int64_t previous = 0;
+	for (uint32_t row = 0; row < block.rows; ++row) {
+		uint64_t v = reader.Varint();
+		if (v & 1) {
+			out[row] = reader.Raw();
+		} else {
+			previous = Add(previous, UnZigZag(v >> 1));
+			out[row] = scale.ToPrice(previous);
+		}
+	}
+}
+
+void TickArchiveReader::DecodeBlock(const TickBlock& block, std::vector<MarketDepth>& out) const {
+	size_t first = out.size();
+	out.resize(first + block.rows, MarketDepth{});
+	std::span<MarketDepth> rows(out.data() + first, block.rows);
+
+	MarketDepth prototype{};
+	std::memcpy(prototype.instrument_id, block.instrument_id.data(), block.instrument_id.size());
+	prototype.symbol_id = SymbolTable::Instance().Intern(Ticker(block.instrument_id));
+	prototype.trading_day = trading_day_;
+	std::fill(rows.begin(), rows.end(), prototype);
+
+	std::vector<int64_t> integers(block.rows);
+	std::vector<double> prices(block.rows);
+	for (size_t column = 0; column < kColumnCount; ++column) {
+		const ColumnLayout& layout = kLayout[column];
+		switch (layout.encoding) {
+			case ColumnEncoding::Timestamp:
+				DecodeColumn(block, static_cast<TickColumn>(column), integers);
+				for (uint32_t row = 0; row < block.rows; ++row) {
+					Store<Timestamp>(rows[row], layout.offset, integers[row]);
+				}
+				break;
+			case ColumnEncoding::Price:
+				DecodeColumn(block, static_cast<TickColumn>(column), prices);
+				for (uint32_t row = 0; row < block.rows; ++row) { Store<Price>(rows[row], layout.offset, prices[row]); }
+				break;
+			case ColumnEncoding::Integer:
+				DecodeColumn(block, static_cast<TickColumn>(column), integers);
+				for (uint32_t row = 0; row < block.rows; ++row) {
+					Store<Volume>(rows[row], layout.offset, static_cast<Volume>(integers[row]));
+				}
+				break;
+		}
+	}
+}
+
+std::vector<MarketDepth> TickArchiveReader::Read(const Ticker& ticker) const {
+	std::vector<MarketDepth> ret;
+	for (const TickBlock& block : blocks_) {
+		if (block.instrument_id == ticker) { DecodeBlock(block, ret); }
+	}
+	return ret;
+}
@@ -0,0 +1,279 @@
+#include "tickjournal.h"
+
+#include <fcntl.h>
+#include <spdlog/spdlog.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+using tick_journal::Record;
+using tick_journal::SegmentHeader;
+
+namespace {
+[[noreturn]] void ThrowSystemError(const std::string& what) {
+	throw std::system_error(errno, std::generic_category(), what);
+}
+
+/// CRC-32C(Castagnoli) 查找表
+constexpr std::array<uint32_t, 256> kCrcTable = []() {
+	std::array<uint32_t, 256> ret{};
+	for (uint32_t i = 0; i < 256; ++i) {
+		uint32_t crc = i;
+		for (int bit = 0; bit < 8; ++bit) { crc = (crc >> 1) ^ ((crc & 1) ? 0x82F63B78U : 0); }
+		ret[i] = crc;
+	}
+	return ret;
+}();
+
+uint32_t Crc32c(uint32_t crc, const void* data, size_t length) noexcept {
+	const auto* bytes = static_cast<const uint8_t*>(data);
+	for (size_t i = 0; i < length; ++i) { crc = kCrcTable[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8); }
+	return crc;
+}
+
+bool Valid(const Record& record, uint64_t sequence) noexcept {
+	return (record.sequence == sequence) && (record.checksum == tick_journal::Checksum(record));
+}
+
+std::string SegmentName(uint64_t first_sequence) { return fmt::format("{:020}.journal", first_sequence); }
+
+size_t PageSize() {
+	static const size_t ret = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	return ret;
+}
+}  // namespace
+
+uint32_t tick_journal::Checksum(const Record& record) noexcept {
+	uint32_t crc = Crc32c(~0U, &record.sequence, sizeof(record.sequence));
+	return ~Crc32c(crc, &record.data, sizeof(record.data));
+}
+
+TickJournal::TickJournal(const std::filesystem::path& directory, size_t segment_records,
+						 std::chrono::milliseconds sync_interval)
+	: directory_(directory), segment_records_(std::max<size_t>(segment_records, 1)), sync_interval_(sync_interval) {
+	Recover();
+	sync_thread_ = std::thread(&TickJournal::SyncLoop, this);
+}
+
+TickJournal::~TickJournal() {
+	{
+		std::scoped_lock _(thread_mutex_);
+		syncing_ = false;
+	}
+	sync_cv_.notify_one();
+	sync_thread_.join();
+	Sync();
+	for (Segment& segment : segments_) { munmap(segment.header, segment.mapped_size); }
+	close(committed_fd_);
+}
+
+TickJournal::Segment TickJournal::OpenSegment(uint64_t first_sequence, bool create) {
+	Segment ret;
+	ret.filename = directory_ / SegmentName(first_sequence);
+	int fd = open(ret.filename.c_str(), O_RDWR | O_CLOEXEC | (create ? O_CREAT | O_TRUNC : 0), 0644);
+	if (fd < 0) { ThrowSystemError("open " + ret.filename.string()); }
+	size_t capacity = segment_records_;
+	if (create) {
+		ret.mapped_size = sizeof(SegmentHeader) + capacity * sizeof(Record);
+		if (ftruncate(fd, static_cast<off_t>(ret.mapped_size)) != 0) {
+			close(fd);
+			ThrowSystemError("ftruncate " + ret.filename.string());
+		}
+	} else {
+		SegmentHeader header{};
+		if (pread(fd, &header, sizeof(header), 0) != sizeof(header) || (header.magic != tick_journal::kMagic)) {
+			close(fd);
+			throw std::runtime_error("TickJournal: " + ret.filename.string() + " is not a journal segment");
+		}
+		struct stat st {};
+		fstat(fd, &st);
+		capacity = header.capacity;
+		ret.mapped_size = sizeof(SegmentHeader) + capacity * sizeof(Record);
+		if ((header.version != tick_journal::kVersion) || (header.record_size != sizeof(Record)) ||
+			(header.first_sequence != first_sequence) || (static_cast<size_t>(st.st_size) < ret.mapped_size)) {
+			close(fd);
+			throw std::runtime_error("TickJournal: " + ret.filename.string() + " has a different layout");
+		}
+	}
+	void* addr = mmap(nullptr, ret.mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (addr == MAP_FAILED) { ThrowSystemError("mmap " + ret.filename.string()); }
+	ret.header = static_cast<SegmentHeader*>(addr);
+	if (create) {
+		*ret.header = {.magic = tick_journal::kMagic,
+					   .version = tick_journal::kVersion,
+					   .record_size = sizeof(Record),
+					   .first_sequence = first_sequence,
+					   .capacity = capacity};
+	}
+	return ret;
+}
+
+void TickJournal::Recover() {
+	std::filesystem::create_directories(directory_);
+	std::filesystem::path committed_file = directory_ / "committed";
+	committed_fd_ = open(committed_file.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (committed_fd_ < 0) { ThrowSystemError("open " + committed_file.string()); }
+	tick_journal::Committed committed{};
+	if ((pread(committed_fd_, &committed, sizeof(committed), 0) == sizeof(committed)) &&
+		(committed.magic == tick_journal::kCommittedMagic)) {
+		committed_ = committed.sequence;
+	}
+	synced_committed_ = committed_;
+
+	std::vector<uint64_t> firsts;
+	for (const auto& entry : std::filesystem::directory_iterator(directory_)) {
+		if (entry.path().extension() != ".journal") { continue; }
+		std::string stem = entry.path().stem().string();
+		uint64_t first = 0;
+		auto [ptr, ec] = std::from_chars(stem.data(), stem.data() + stem.size(), first);
+		if ((ec == std::errc()) && (ptr == stem.data() + stem.size())) { firsts.push_back(first); }
+	}
+	std::sort(firsts.begin(), firsts.end());
+	for (uint64_t first : firsts) {
+		Segment segment = OpenSegment(first, false);
+		// 已全部提交的段
+		if (segment.end() <= committed_) {
+			munmap(segment.header, segment.mapped_size);
+			std::filesystem::remove(segment.filename);
+			continue;
+		}
+		if (!segments_.empty() && (segments_.back().end() != first)) {
+			munmap(segment.header, segment.mapped_size);
+			throw std::runtime_error("TickJournal: segments in " + directory_.string() + " are not contiguous");
+		}
+		segments_.push_back(segment);
+	}
+	for (Segment& segment : segments_) { segment.synced = segment.header->capacity; }
+
+	if (segments_.empty()) {
+		head_ = committed_.load();
+		return;
+	}
+	// 提交后尚未刷盘时删除的段
+	if (committed_ < segments_.front().header->first_sequence) {
+		committed_ = segments_.front().header->first_sequence;
+	}
+	// 之前的段均已写满, 在最后一段中找到末尾
+	Segment& last = segments_.back();
+	uint64_t first = last.header->first_sequence;
+	uint64_t head = std::max(first, committed_.load());
+	while ((head < last.end()) && Valid(last.records()[head - first], head)) { ++head; }
+	head_ = head;
+	last.synced = head - first;
+	if (head_ > committed_) {
+		spdlog::info("TickJournal: {} ticks in {} are not committed yet.", head_ - committed_, directory_.string());
+	}
+}
+
+uint64_t TickJournal::Append(const MarketDepth& data) {
+	std::scoped_lock _(mutex_);
+	uint64_t sequence = head_.load(std::memory_order_relaxed);
+	if (segments_.empty() || (segments_.back().end() == sequence)) { segments_.push_back(OpenSegment(sequence, true)); }
+	const Segment& segment = segments_.back();
+	Record& record = segment.records()[sequence - segment.header->first_sequence];
+	record.sequence = sequence;
+	record.data = data;
+	uint32_t checksum = tick_journal::Checksum(record);
+	// 进程中途被杀死时不完整的记录校验和不符
+	std::atomic_signal_fence(std::memory_order_release);
+	record.checksum = checksum;
+	head_.store(sequence + 1);
+	return sequence;
+}
+
+size_t TickJournal::Read(uint64_t sequence, std::span<MarketDepth> out) const {
+	uint64_t head = head_.load();
+	size_t count = 0;
+	while ((count < out.size()) && (sequence < head)) {
+		const Record* records = nullptr;
+		uint64_t first = 0;
+		uint64_t end = 0;
+		{
+			std::scoped_lock _(mutex_);
+			auto it = std::find_if(segments_.begin(), segments_.end(), [sequence](const Segment& segment) {
+				return (segment.header->first_sequence <= sequence) && (sequence < segment.end());
+			});
+			if (it == segments_.end()) { break; }
+			records = it->records();
+			first = it->header->first_sequence;
+			end = std::min(it->end(), head);
+		}
+		// 段只由消费线程删除, 解锁后仍可读取
+		for (; (sequence < end) && (count < out.size()); ++sequence) {
+			const Record& record = records[sequence - first];
+			if (!Valid(record, sequence)) {
+				spdlog::error("TickJournal: record {} in {} is corrupted.", sequence, directory_.string());
+				return count;
+			}
+			out[count++] = record.data;
+		}
+	}
+	return count;
+}
+
+void TickJournal::Commit(uint64_t sequence) {
+	committed_ = sequence;
+	tick_journal::Committed committed{.magic = tick_journal::kCommittedMagic, .sequence = sequence};
+	if (pwrite(committed_fd_, &committed, sizeof(committed), 0) != sizeof(committed)) {
+		spdlog::error("TickJournal: failed to write committed sequence {}.", sequence);
+	}
+
+	std::scoped_lock lock(sync_mutex_, mutex_);
+	while (!segments_.empty() && (segments_.front().end() <= sequence)) {
+		Segment& segment = segments_.front();
+		munmap(segment.header, segment.mapped_size);
+		std::error_code ec;
+		std::filesystem::remove(segment.filename, ec);
+		segments_.pop_front();
+	}
+}
+
+void TickJournal::Sync() {
+	std::scoped_lock _(sync_mutex_);
+	uint64_t head = head_.load();
+	std::vector<Segment*> segments;
+	{
+		std::scoped_lock lock(mutex_);
+		for (Segment& segment : segments_) { segments.push_back(&segment); }
+	}
+	// 持有 `sync_mutex_` 时段不会被删除, 刷盘时不阻塞追加
+	for (Segment* segment : segments) {
+		uint64_t first = segment->header->first_sequence;
+		if (head <= first) { break; }
+		uint64_t written = std::min<uint64_t>(head - first, segment->header->capacity);
+		if (written <= segment->synced) { continue; }
+		size_t begin = (segment->synced == 0) ? 0 : sizeof(SegmentHeader) + segment->synced * sizeof(Record);
+		begin = begin / PageSize() * PageSize();
+		size_t end = sizeof(SegmentHeader) + written * sizeof(Record);
+		if (msync(reinterpret_cast<char*>(segment->header) + begin, end - begin, MS_SYNC) != 0) {
+			spdlog::error("TickJournal: msync {} failed: {}", segment->filename.string(), std::strerror(errno));
+			continue;
+		}
+		segment->synced = written;
+	}
+	uint64_t committed = committed_.load();
+	if (committed != synced_committed_) {
+		fdatasync(committed_fd_);
+		synced_committed_ = committed;
+	}
+}
+
+void TickJournal::SyncLoop() {
+	std::unique_lock lock(thread_mutex_);
+	while (syncing_) {
+		sync_cv_.wait_for(lock, sync_interval_, [this]() { return !syncing_; });
+		lock.unlock();
+		Sync();
+		lock.lock();
+	}
+}
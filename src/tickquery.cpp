@@ -0,0 +1,280 @@
+#include "tickquery.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+#include "utsexceptions.h"
+
+using tick_archive::TickColumn;
+
+TickArchiveIndex::TickArchiveIndex(const std::filesystem::path& filename)
+	: filename_(filename),
+	  reader_(filename),
+	  first_time_(std::numeric_limits<Timestamp>::max()),
+	  last_time_(std::numeric_limits<Timestamp>::min()) {
+	std::vector<int64_t> times;
+	std::span<const TickBlock> blocks = reader_.blocks();
+	for (uint32_t i = 0; i < blocks.size(); ++i) {
+		const TickBlock& block = blocks[i];
+		if (block.rows == 0) { continue; }
+		times.resize(block.rows);
+		reader_.DecodeColumn(block, TickColumn::ExchangeTime, times);
+		auto [min, max] = std::minmax_element(times.begin(), times.end());
+		first_time_ = std::min(first_time_, *min);
+		last_time_ = std::max(last_time_, *max);
+
+		auto [it, inserted] = directory_.try_emplace(block.instrument_id);
+		if (inserted) { instruments_.push_back(block.instrument_id); }
+		std::vector<TickBlockIndex>& index = it->second;
+		Timestamp latest = index.empty() ? *max : std::max(index.back().latest_time, *max);
+		index.push_back({.block = i, .first_time = *min, .last_time = *max, .latest_time = latest});
+	}
+}
+
+std::span<const TickBlockIndex> TickArchiveIndex::Find(std::string_view ticker) const {
+	auto it = directory_.find(ticker);
+	if (it == directory_.end()) { return {}; }
+	return it->second;
+}
+
+void TickArchiveIndex::Find(std::string_view ticker, Timestamp begin, Timestamp end,
+							std::vector<TickBlockIndex>& out) const {
+	std::span<const TickBlockIndex> index = Find(ticker);
+	// 之前的块最晚的时间都早于 `begin`
+	auto it = std::partition_point(index.begin(), index.end(),
+								   [begin](const TickBlockIndex& entry) { return entry.latest_time < begin; });
+	for (; it != index.end(); ++it) {
+		if ((it->first_time < end) && (it->last_time >= begin)) { out.push_back(*it); }
+	}
+}
+
+TickQueryEngine::TickQueryEngine(std::span<const std::filesystem::path> paths, size_t threads)
+	: threads_(threads == 0 ? std::max(std::thread::hardware_concurrency(), 1U) : threads) {
+	std::vector<std::filesystem::path> filenames;
+	for (const std::filesystem::path& path : paths) {
+		if (!std::filesystem::exists(path)) { throw IOError(path); }
+		if (!std::filesystem::is_directory(path)) {
+			filenames.push_back(path);
+			continue;
+		}
+		std::vector<std::filesystem::path> directory_files;
+		for (const auto& entry : std::filesystem::directory_iterator(path)) {
+			if (entry.is_regular_file() && (entry.path().extension() == ".utstick")) {
+				directory_files.push_back(entry.path());
+			}
+		}
+		std::sort(directory_files.begin(), directory_files.end());
+		filenames.insert(filenames.end(), directory_files.begin(), directory_files.end());
+	}
+
+	files_.resize(filenames.size());
+	ParallelFor(filenames.size(), [this, &filenames](size_t i) {
+		files_[i] = std::make_unique<TickArchiveIndex>(filenames[i]);
+	});
+	std::stable_sort(files_.begin(), files_.end(), [](const auto& lhs, const auto& rhs) {
+		return lhs->first_time() < rhs->first_time();
+	});
+}
+
+TickQueryEngine::TickQueryEngine(const std::filesystem::path& path, size_t threads)
+	: TickQueryEngine(std::span<const std::filesystem::path>(&path, 1), threads) {}
+
+std::vector<Ticker> TickQueryEngine::instruments() const {
+	std::vector<Ticker> ret;
+	for (const auto& file : files_) { ret.insert(ret.end(), file->instruments().begin(), file->instruments().end()); }
+	std::sort(ret.begin(), ret.end());
+	ret.erase(std::unique(ret.begin(), ret.end()), ret.end());
+	return ret;
+}
+
+void TickQueryEngine::ForEach(std::span<const Ticker> tickers, Timestamp begin, Timestamp end,
+							  const BlockCallback& f) const {
+	/// 待解码的数据块
+	struct Task {
+		const TickArchiveIndex* file;
+		uint32_t block;
+	};
+	std::vector<Task> tasks;
+	std::vector<TickBlockIndex> hits;
+	for (const auto& file : files_) {
+		if ((file->first_time() >= end) || (file->last_time() < begin)) { continue; }
+		hits.clear();
+		if (tickers.empty()) {
+			for (std::string_view ticker : file->instruments()) { file->Find(ticker, begin, end, hits); }
+		} else {
+			for (const Ticker& ticker : tickers) { file->Find(ticker, begin, end, hits); }
+		}
+		// 按块在文件中的顺序
+		std::sort(hits.begin(), hits.end(),
+				  [](const TickBlockIndex& lhs, const TickBlockIndex& rhs) { return lhs.block < rhs.block; });
+		for (const TickBlockIndex& hit : hits) { tasks.push_back({file.get(), hit.block}); }
+	}
+
+	if (tasks.empty()) { return; }
+	// 一次并行解码全部数据块, 调用线程按顺序交给回调. 至多 `window` 块已解码而尚未交给回调, 内存占用与结果总量无关
+	size_t window = std::min(tasks.size(), threads_ * 4);
+	std::vector<std::vector<MarketDepth>> decoded(window);
+	std::vector<char> ready(window, 0);
+	std::mutex mutex;
+	std::condition_variable cv;
+	size_t delivered = 0;  // 已交给回调的块数
+	bool cancelled = false;
+	std::exception_ptr error;
+	{
+		std::jthread decoder([&]() {
+			try {
+				ParallelFor(tasks.size(), [&](size_t i) {
+					{
+						std::unique_lock lock(mutex);
+						cv.wait(lock, [&]() { return (i < delivered + window) || cancelled; });
+						if (cancelled) { return; }
+					}
+					const Task& task = tasks[i];
+					std::vector<MarketDepth>& rows = decoded[i % window];
+					rows.clear();
+					task.file->reader().DecodeBlock(task.file->reader().blocks()[task.block], rows);
+					std::erase_if(rows, [begin, end](const MarketDepth& md) {
+						return (md.exchange_time < begin) || (md.exchange_time >= end);
+					});
+					{
+						std::scoped_lock _(mutex);
+						ready[i % window] = 1;
+					}
+					cv.notify_all();
+				});
+			} catch (...) {
+				std::scoped_lock _(mutex);
+				error = std::current_exception();
+				cancelled = true;
+			}
+			cv.notify_all();
+		});
+		try {
+			for (size_t i = 0; i < tasks.size(); ++i) {
+				{
+					std::unique_lock lock(mutex);
+					cv.wait(lock, [&]() { return ready[i % window] || cancelled; });
+					if (!ready[i % window]) { break; }
+				}
+				if (!decoded[i % window].empty()) { f(decoded[i % window]); }
+				{
+					std::scoped_lock _(mutex);
+					ready[i % window] = 0;
+					++delivered;
+				}
+				cv.notify_all();
+			}
+		} catch (...) {
+			// 回调抛出异常时停止解码, 等待解码线程退出后重新抛出
+			{
+				std::scoped_lock _(mutex);
+				cancelled = true;
+			}
+			cv.notify_all();
+			throw;
+		}
+	}
+	if (error) { std::rethrow_exception(error); }
+}
+
+std::vector<MarketDepth> TickQueryEngine::Query(std::span<const Ticker> tickers, Timestamp begin,
+												Timestamp end) const {
+	std::vector<MarketDepth> ret;
+	ForEach(tickers, begin, end,
+			[&ret](std::span<const MarketDepth> rows) { ret.insert(ret.end(), rows.begin(), rows.end()); });
+	std::stable_sort(ret.begin(), ret.end(), [](const MarketDepth& lhs, const MarketDepth& rhs) {
+		return lhs.exchange_time < rhs.exchange_time;
+	});
+	return ret;
+}
+
+std::vector<MarketDepth> TickQueryEngine::Snapshot(Timestamp time, std::span<const Ticker> tickers) const {
+	std::vector<Ticker> all_tickers;
+	if (tickers.empty()) {
+		all_tickers = instruments();
+		tickers = all_tickers;
+	}
+	std::vector<MarketDepth> results(tickers.size());
+	std::vector<char> found(tickers.size(), 0);
+	ParallelFor(tickers.size(), [&](size_t i) {
+		const TickArchiveIndex* best_file = nullptr;
+		uint32_t best_block = 0;
+		uint32_t best_row = 0;
+		Timestamp best_time = std::numeric_limits<Timestamp>::min();
+		std::vector<int64_t> times;
+		// 从最晚的文件和块向前找, 只解码可能有更晚行情的块的时间列
+		for (auto file = files_.rbegin(); file != files_.rend(); ++file) {
+			if (((*file)->first_time() > time) || ((*file)->last_time() <= best_time)) { continue; }
+			std::span<const TickBlockIndex> index = (*file)->Find(tickers[i]);
+			for (auto entry = index.rbegin(); entry != index.rend(); ++entry) {
+				if ((entry->first_time > time) || (entry->last_time <= best_time)) { continue; }
+				const TickBlock& block = (*file)->reader().blocks()[entry->block];
+				times.resize(block.rows);
+				(*file)->reader().DecodeColumn(block, TickColumn::ExchangeTime, times);
+				// 块内取不晚于 `time` 的最晚一笔, 时间相同时取后收到的; 块之间时间相同时取后写入的块
+				Timestamp block_time = std::numeric_limits<Timestamp>::min();
+				uint32_t block_row = 0;
+				for (uint32_t row = 0; row < block.rows; ++row) {
+					if ((times[row] <= time) && (times[row] >= block_time)) {
+						block_time = times[row];
+						block_row = row;
+					}
+				}
+				if (block_time > best_time) {
+					best_file = file->get();
+					best_block = entry->block;
+					best_row = block_row;
+					best_time = block_time;
+				}
+			}
+		}
+		if (best_file == nullptr) { return; }
+		std::vector<MarketDepth> rows;
+		best_file->reader().DecodeBlock(best_file->reader().blocks()[best_block], rows);
+		results[i] = rows[best_row];
+		found[i] = 1;
+	});
+
+	std::vector<MarketDepth> ret;
+	for (size_t i = 0; i < tickers.size(); ++i) {
+		if (found[i]) { ret.push_back(results[i]); }
+	}
+	std::sort(ret.begin(), ret.end(), [](const MarketDepth& lhs, const MarketDepth& rhs) {
+		return std::string_view(lhs.instrument_id) < std::string_view(rhs.instrument_id);
+	});
+	return ret;
+}
+
+void TickQueryEngine::ParallelFor(size_t count, const std::function<void(size_t)>& f) const {
+	size_t threads = std::min(threads_, count);
+	if (threads <= 1) {
+		for (size_t i = 0; i < count; ++i) { f(i); }
+		return;
+	}
+	std::atomic<size_t> next = 0;
+	std::mutex error_mutex;
+	std::exception_ptr error;
+	auto work = [&]() {
+		for (size_t i = next++; i < count; i = next++) {
+			try {
+				f(i);
+			} catch (...) {
+				std::scoped_lock _(error_mutex);
+				if (!error) { error = std::current_exception(); }
+				next = count;
+			}
+		}
+	};
+	{
+		std::vector<std::jthread> thread_pool;
+		thread_pool.reserve(threads - 1);
+		for (size_t i = 1; i < threads; ++i) { thread_pool.emplace_back(work); }
+		work();
+	}
+	if (error) { std::rethrow_exception(error); }
+}
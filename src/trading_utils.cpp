@@ -4,6 +4,7 @@
 #include <iomanip>
 #include <random>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "utsexceptions.h"
@@ -35,6 +36,59 @@ vector<Order> GenerateRandomOrders(const AccountName& account_name, const Broker
 	return ret;
 }
 
+/// 北京时间的日序号(1970-01-01 为0)和日内纳秒数
+static std::pair<Timestamp, Timestamp> SplitChinaDay(Timestamp ts) noexcept {
+	Timestamp local = ts + kChinaTimeOffset;
+	Timestamp day = local / kNanosecondsPerDay;
+	Timestamp time_of_day = local % kNanosecondsPerDay;
+	if (time_of_day < 0) {
+		--day;
+		time_of_day += kNanosecondsPerDay;
+	}
+	return {day, time_of_day};
+}
+
+/// 日序号转日期(YYYYMMDD)
+static int DayToDate(Timestamp day) noexcept {
+	using namespace std::chrono;
+	year_month_day ymd{sys_days{days{day}}};
+	return static_cast<int>(ymd.year()) * 10000 + static_cast<int>(static_cast<unsigned>(ymd.month())) * 100 +
+		   static_cast<int>(static_cast<unsigned>(ymd.day()));
+}
+
+int TimestampToDate(Timestamp ts) noexcept { return DayToDate(SplitChinaDay(ts).first); }
+
+size_t FormatDateTime(Timestamp ts, char* buffer) noexcept {
+	auto [day, time_of_day] = SplitChinaDay(ts);
+	int date = DayToDate(day);
+	int millisec = static_cast<int>(time_of_day / 1'000'000);
+	int fields[] = {date / 10000, date / 100 % 100, date % 100, millisec / 3600000, millisec / 60000 % 60,
+					millisec / 1000 % 60, millisec % 1000};
+
+	auto put = [](char* p, int value, int width) {
+		for (int i = width - 1; i >= 0; --i) {
+			p[i] = static_cast<char>('0' + value % 10);
+			value /= 10;
+		}
+	};
+	// YYYY-MM-DD hh:mm:ss.mmm
+	put(buffer, fields[0], 4);
+	buffer[4] = '-';
+	put(buffer + 5, fields[1], 2);
+	buffer[7] = '-';
+	put(buffer + 8, fields[2], 2);
+	buffer[10] = ' ';
+	put(buffer + 11, fields[3], 2);
+	buffer[13] = ':';
+	put(buffer + 14, fields[4], 2);
+	buffer[16] = ':';
+	put(buffer + 17, fields[5], 2);
+	buffer[19] = '.';
+	put(buffer + 20, fields[6], 3);
+	buffer[kDateTimeStrLength] = '\0';
+	return kDateTimeStrLength;
+}
+
 std::chrono::time_point<std::chrono::system_clock> GetMarketCloseTime() {
 	using namespace std::chrono;
 	auto tp = system_clock::now();
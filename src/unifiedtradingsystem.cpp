@@ -10,12 +10,25 @@
 #include "ctpmarketdata.h"
 #include "ctptradingaccount.h"
 #include "enum_utils.h"
+#include "latencymonitor.h"
 #include "trading_utils.h"
 #include "utsexceptions.h"
 #include "version.h"
 
 using std::map, std::set, std::vector, std::string;
 
+namespace {
+/// 记录订阅失败的合约
+vector<Ticker> ReportSubscriptionFailure(vector<Ticker> failed) {
+	if (!failed.empty()) {
+		string tickers;
+		for (const auto& ticker : failed) { tickers += (tickers.empty() ? "" : ", ") + ticker; }
+		spdlog::warn("Failed to subscribe {} instruments: {}", failed.size(), tickers);
+	}
+	return failed;
+}
+}  // namespace
+
 UnifiedTradingSystem::UnifiedTradingSystem() {
 #ifdef NDEBUG
 	spdlog::set_level(spdlog::level::info);
@@ -45,7 +58,6 @@ void UnifiedTradingSystem::AddBroker(const BrokerInfo& broker_info) {
 
 void UnifiedTradingSystem::AddMarketDataSource(const vector<IPAddress>& server_addr) {
 	market_data_source_ = new CTPMarketData(server_addr);
-	market_data_ = &market_data_source_->market_data();
 }
 
 /**
@@ -150,7 +162,6 @@ void UnifiedTradingSystem::LogOut() {
 		market_data_source_->LogOut();
 		delete market_data_source_;
 		market_data_source_ = nullptr;
-		market_data_ = nullptr;
 	}
 
 	for (auto& [account_index, account] : accounts_) {
@@ -175,19 +186,22 @@ void UnifiedTradingSystem::QueryInstruments() {
 	if (!empty()) {
 		auto account = accounts_.begin();
 		instrument_info_ = account->second->QueryInstruments();
+		for (const auto& [index, info] : instrument_info_) {
+			LatencyMonitor::Instance().SetExchange(info.symbol_id, info.exchange);
+		}
 	} else {
 		spdlog::error("NO account registered and logged in. Cannot query market instruments!");
 	}
 }
-void UnifiedTradingSystem::SubscribeInstruments() {
+vector<Ticker> UnifiedTradingSystem::SubscribeInstruments() {
 	vector<Ticker> ticker_list;
 	for (auto& [ticker, instrumnet_info] : instrument_info_) { ticker_list.push_back(instrumnet_info.instrument_id); }
-	market_data_source_->Subscribe(ticker_list);
+	return ReportSubscriptionFailure(market_data_source_->Subscribe(ticker_list));
 }
 
 /// 订阅指定合约
-void UnifiedTradingSystem::SubscribeInstruments(const vector<Ticker>& tickers) {
-	market_data_source_->Subscribe(tickers);
+vector<Ticker> UnifiedTradingSystem::SubscribeInstruments(const vector<Ticker>& tickers) {
+	return ReportSubscriptionFailure(market_data_source_->Subscribe(tickers));
 }
 
 vector<Ticker> UnifiedTradingSystem::ListProducts(vector<ProductID> product_ids) {
@@ -205,9 +219,9 @@ vector<Ticker> UnifiedTradingSystem::ListProducts(vector<ProductID> product_ids)
 }
 
 /// 订阅指定品种的所有合约
-void UnifiedTradingSystem::SubscribeProducts(const vector<ProductID>& product_ids) {
+vector<Ticker> UnifiedTradingSystem::SubscribeProducts(const vector<ProductID>& product_ids) {
 	auto ticker_list = ListProducts(product_ids);
-	market_data_source_->Subscribe(ticker_list);
+	return ReportSubscriptionFailure(market_data_source_->Subscribe(ticker_list));
 }
 
 /// 查询所有合约的手续费
@@ -271,7 +285,7 @@ void UnifiedTradingSystem::DumpInfoJson(const std::filesystem::path& loc) const
 
 	res["account_info"] = account_info;
 	res["instrument_info"] = instrument_info_;
-	if (market_data_source_ != nullptr) { res["market_data"] = *market_data_; }
+	if (market_data_source_ != nullptr) { res["market_data"] = market_data_source_->market_data(); }
 
 	std::ofstream o(loc);
 	o << res.dump(4) << std::endl;
@@ -360,7 +374,10 @@ vector<Order> UnifiedTradingSystem::ProcessAdvancedOrder(Order order) {
 	}
 
 	// price related
-	auto market_depth = market_data_->at(instrument_id);
+	MarketDepth market_depth;
+	if ((market_data_source_ == nullptr) || !market_data_source_->market_data(instrument_info.symbol_id, market_depth)) {
+		throw OrderInfoError(id, fmt::format("No market data for {}", instrument_id));
+	}
 	if (order.level_offset > 5 || order.level_offset < 1) {
 		throw OrderInfoError(id, "Level Offset has to be between 1 and 5!");
 	}
@@ -427,7 +444,7 @@ vector<Order> UnifiedTradingSystem::ProcessAdvancedOrder(Order order) {
 	// check open_close
 	auto holding = account->holding();
 	auto reverse_direction = ReverseDirection(order.direction);
-	auto holding_loc = holding.find({order.instrument_id, reverse_direction, order.hedge_flag});
+	auto holding_loc = holding.find({instrument_info.symbol_id, order.instrument_id, reverse_direction, order.hedge_flag});
 	if ((order.open_close != OpenCloseType::Auto) && (order.open_close != OpenCloseType::Open)) {
 		if (holding_loc == holding.end()) {
 			throw OrderInfoError(id, "Cannot close non-existing position on " + ticker);
@@ -0,0 +1,112 @@
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "barengine.h"
+#include "trading_utils.h"
+
+class BarEngineTest : public ::testing::Test {
+protected:
+	TradingEventBus bus;
+	std::vector<Bar> bars;
+
+	void SetUp() override { bus.Subscribe<Bar, &BarEngineTest::OnBar>(this); }
+	void OnBar(const Bar& bar) { bars.push_back(bar); }
+
+	static MarketDepth Tick(Timestamp exchange_time, Price last, Volume volume, Timestamp local_time = 0) {
+		MarketDepth md{};
+		md.symbol_id = 0;
+		md.trading_day = 20210601;
+		md.exchange_time = exchange_time;
+		md.local_time = local_time;
+		md.ohlclvt.last = last;
+		md.ohlclvt.high = last;
+		md.ohlclvt.low = last;
+		md.ohlclvt.volume = volume;
+		md.ohlclvt.turnover = last * volume;
+		return md;
+	}
+};
+
+TEST_F(BarEngineTest, AggregatesAndClosesOnNextBucket) {
+	constexpr Timestamp kSecond = 1'000'000'000LL;
+	Timestamp base = MakeTimestamp(20210601, 9 * 3600 * kSecond);
+	BarEngine engine(bus, kSecond / 2, 3600 * 1000);
+
+	bus.Publish(Tick(base + 100'000'000, 10, 1));
+	bus.Publish(Tick(base + 600'000'000, 12, 2));
+	bus.Publish(Tick(base + 900'000'000, 9, 3));
+	ASSERT_TRUE(bars.empty());
+
+	bus.Publish(Tick(base + kSecond + 100'000'000, 11, 4));
+	ASSERT_EQ(bars.size(), 1);
+	const Bar& bar = bars[0];
+	ASSERT_EQ(bar.period, BarPeriod::Second);
+	ASSERT_EQ(bar.start_time, base);
+	ASSERT_EQ(bar.end_time, base + kSecond);
+	ASSERT_EQ(bar.open, 10);
+	ASSERT_EQ(bar.high, 12);
+	ASSERT_EQ(bar.low, 9);
+	ASSERT_EQ(bar.close, 9);
+	ASSERT_EQ(bar.volume, 6);
+	ASSERT_EQ(bar.tick_count, 3);
+
+	// 迟到的行情不计入已完成的K线
+	bus.Publish(Tick(base + 950'000'000, 9, 1));
+	ASSERT_EQ(engine.late_ticks(), 1);
+
+	// 无新行情时按时间完成
+	engine.CloseExpiredBars(base + 2 * kSecond + kSecond / 2);
+	ASSERT_EQ(bars.size(), 2);
+	ASSERT_EQ(bars[1].volume, 4);
+
+	engine.CloseExpiredBars(base + 60 * kSecond + kSecond / 2);
+	ASSERT_EQ(bars.size(), 3);
+	ASSERT_EQ(bars[2].period, BarPeriod::Minute);
+	ASSERT_EQ(bars[2].volume, 11);
+
+	engine.CloseSession();
+	ASSERT_EQ(bars.size(), 4);
+	ASSERT_EQ(bars[3].period, BarPeriod::Session);
+	ASSERT_EQ(bars[3].volume, 11);
+	ASSERT_EQ(bars[3].tick_count, 5);
+}
+
+TEST_F(BarEngineTest, ReentrantSubscriber) {
+	constexpr Timestamp kSecond = 1'000'000'000LL;
+	Timestamp base = MakeTimestamp(20210601, 9 * 3600 * kSecond);
+	BarEngine engine(bus, 0, 3600 * 1000);
+	// K线的处理函数回调本类, 其完成的K线在当前K线之后发布
+	int subscription = bus.Subscribe<Bar>(
+		[](void* context, const Bar& bar) {
+			if (bar.period == BarPeriod::Minute) { static_cast<BarEngine*>(context)->CloseSession(); }
+		},
+		&engine);
+
+	bus.Publish(Tick(base, 10, 1));
+	engine.CloseExpiredBars(base + 60 * kSecond);
+	ASSERT_EQ(bars.size(), 3);
+	ASSERT_EQ(bars[0].period, BarPeriod::Second);
+	ASSERT_EQ(bars[1].period, BarPeriod::Minute);
+	ASSERT_EQ(bars[2].period, BarPeriod::Session);
+	bus.Unsubscribe<Bar>(subscription);
+}
+
+TEST_F(BarEngineTest, TimerClosesBars) {
+	{
+		BarEngine engine(bus, 0, 10);
+		Timestamp now = Now();
+		bus.Publish(Tick(now, 10, 1, now));
+		std::this_thread::sleep_for(std::chrono::milliseconds(1200));
+	}
+	// 析构时等待定时线程结束后再检查
+	ASSERT_FALSE(bars.empty());
+	ASSERT_EQ(bars[0].period, BarPeriod::Second);
+}
+
+int main(int argc, char** argv) {
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -1,9 +1,15 @@
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <thread>
 #include <vector>
 
 #include <gtest/gtest.h>
 #include <spdlog/spdlog.h>
 
 #include "ctpmarketdata.h"
+#include "eventbus.h"
+#include "trading_utils.h"
 #include "utils.h"
 
 using nlohmann::json;
@@ -35,6 +41,46 @@ TEST_F(CTPMarketDataTest, MarketDataSubscribeTest) {
 	ASSERT_EQ(md_->subscribed_tickers().size(), 4);
 }
 
+/// 不登录, 直接向环形缓冲区投递行情
+class QueuedCTPMarketData : public CTPMarketData {
+public:
+	QueuedCTPMarketData() : CTPMarketData({"tcp://127.0.0.1:1"}) {
+		EnableRingDispatch(1024);
+		StartRingDispatch();
+	}
+
+	void Feed(size_t count) {
+		CThostFtdcDepthMarketDataField field{};
+		std::strcpy(field.InstrumentID, "ag2009");
+		for (size_t i = 0; i < count; ++i) {
+			field.Volume = static_cast<int>(i);
+			DeliverDepthMarketData(&field, Now());
+		}
+	}
+};
+
+struct SlowTickCounter {
+	size_t count = 0;
+	void OnTick(const MarketDepth&) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		++count;
+	}
+};
+
+TEST(CTPMarketDataRingTest, DestroyWithQueuedTicks) {
+	TradingEventBus bus;
+	SlowTickCounter counter;
+	bus.Subscribe<MarketDepth, &SlowTickCounter::OnTick>(&counter);
+
+	auto md = std::make_unique<QueuedCTPMarketData>();
+	md->SetEventBus(&bus);
+	md->Feed(100);
+	ASSERT_GT(md->ring_occupancy(), 0);
+	md.reset();
+	// 剩余行情在派生类析构前处理完毕
+	ASSERT_EQ(counter.count, 100);
+}
+
 int main(int argc, char** argv) {
 	::testing::InitGoogleTest(&argc, argv);
 	return RUN_ALL_TESTS();
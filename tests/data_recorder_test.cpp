@@ -1,11 +1,33 @@
 ﻿#include <gtest/gtest.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include "csvdatarecorder.h"
+#include "csvwriter.h"
 #include "data_struct.h"
+#include "fanoutdatarecorder.h"
 #include "mariadbdatarecorder.h"
+#include "rotatingdatarecorder.h"
+#include "shardeddatarecorder.h"
 #include "sqlite3datarecorder.h"
+#include "symboltable.h"
+#include "utsexceptions.h"
 
-MarketDepth md{"IC0000", "1111-11-11 11:11:11.111", {1, 1, 1, 1, 1, 1, 1}, 1, 1, 1, 1, 1, 1, {}, {}};
+MarketDepth md{"IC0000", 0, 20210601, 1622511000500000000, 1622511000500000000, {1, 1, 1, 1, 1, 1, 1},
+			   1, 1, 1, 1, 1, 1, {}, {}};
 
 TEST(DataRecorderTest, CSVDateRecorderTest) {
 	CSVDataRecorder recorder("test.csv");
@@ -15,6 +37,71 @@ TEST(DataRecorderTest, CSVDateRecorderTest) {
 	std::this_thread::sleep_for(std::chrono::seconds(1));
 }
 
+std::string ReadFile(const std::filesystem::path& filename) {
+	std::ifstream in(filename, std::ios::binary);
+	return std::string(std::istreambuf_iterator<char>(in), {});
+}
+
+TEST(DataRecorderTest, CSVWriter) {
+	std::filesystem::path filename = "test_writer.csv";
+	for (bool direct_io : {false, true}) {
+		std::filesystem::remove(filename);
+		{
+			CSVWriter writer(filename, direct_io, 1);
+			ASSERT_TRUE(writer.new_file());
+			// 超过缓冲区大小, 检验整块写出和尾部
+			for (int i = 0; i < 1000; ++i) {
+				writer.Write("rb2110");
+				writer.Write(0.1 + i);
+				writer.Write(-i);
+				writer.Write(uint64_t{1} << 40);
+				writer.EndRow();
+			}
+		}
+		std::ifstream in(filename);
+		std::string line;
+		for (int i = 0; i < 1000; ++i) {
+			ASSERT_TRUE(std::getline(in, line));
+			std::stringstream ss(line);
+			std::string cell;
+			std::getline(ss, cell, ',');
+			ASSERT_EQ(cell, "rb2110");
+			std::getline(ss, cell, ',');
+			ASSERT_EQ(std::stod(cell), 0.1 + i);
+			std::getline(ss, cell, ',');
+			ASSERT_EQ(std::stoi(cell), -i);
+			std::getline(ss, cell, ',');
+			ASSERT_EQ(cell, "1099511627776");
+		}
+		ASSERT_FALSE(std::getline(in, line));
+	}
+	std::filesystem::remove(filename);
+}
+
+TEST(DataRecorderTest, CSVFiveLevels) {
+	std::filesystem::path filename = "test_levels.csv";
+	std::filesystem::remove(filename);
+	MarketDepth tick = md;
+	for (int level = 0; level < 5; ++level) {
+		tick.bid[level] = {4000.2 - level, level + 1};
+		tick.ask[level] = {4000.4 + level, level + 11};
+	}
+	// 再次打开时追加, 不重复写表头
+	for (int i = 0; i < 2; ++i) {
+		CSVDataRecorder recorder(filename, 5);
+		recorder.DataSink(tick);
+	}
+	ASSERT_EQ(ReadFile(filename),
+			  "DateTime, ID, Open, High, Low, Latest, TurnOver, Volume, OpenInterest, BidPrice1, BidVolume1, AskPrice1, "
+			  "AskVolume1, BidPrice2, BidVolume2, AskPrice2, AskVolume2, BidPrice3, BidVolume3, AskPrice3, AskVolume3, "
+			  "BidPrice4, BidVolume4, AskPrice4, AskVolume4, BidPrice5, BidVolume5, AskPrice5, AskVolume5\n"
+			  "2021-06-01 09:30:00.500, IC0000, 1, 1, 1, 1, 1, 1, 1, 4000.2, 1, 4000.4, 11, 3999.2, 2, 4001.4, 12, "
+			  "3998.2, 3, 4002.4, 13, 3997.2, 4, 4003.4, 14, 3996.2, 5, 4004.4, 15\n"
+			  "2021-06-01 09:30:00.500, IC0000, 1, 1, 1, 1, 1, 1, 1, 4000.2, 1, 4000.4, 11, 3999.2, 2, 4001.4, 12, "
+			  "3998.2, 3, 4002.4, 13, 3997.2, 4, 4003.4, 14, 3996.2, 5, 4004.4, 15\n");
+	std::filesystem::remove(filename);
+}
+
 TEST(DataRecorderTest, SQLiteDateRecorderTest) {
 	SQLite3DataRecorder recorder("test.sqlite3");
 	recorder.DataSink(md);
@@ -23,6 +110,68 @@ TEST(DataRecorderTest, SQLiteDateRecorderTest) {
 	std::this_thread::sleep_for(std::chrono::seconds(1));
 }
 
+TEST(DataRecorderTest, SQLiteBatchedTransaction) {
+	std::filesystem::path db_name = "test_batched.sqlite3";
+	std::filesystem::remove(db_name);
+	{
+		SQLite3DataRecorder recorder(db_name, 100, std::chrono::milliseconds(50));
+		for (int i = 0; i < 1000; ++i) { recorder.DataSink(md); }
+	}
+
+	sqlite3* conn = nullptr;
+	ASSERT_EQ(sqlite3_open(db_name.string().c_str(), &conn), SQLITE_OK);
+	auto query = [conn](const char* sql) {
+		sqlite3_stmt* stmt = nullptr;
+		sqlite3_prepare_v2(conn, sql, -1, &stmt, nullptr);
+		sqlite3_step(stmt);
+		std::string ret = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+		sqlite3_finalize(stmt);
+		return ret;
+	};
+	ASSERT_EQ(query("SELECT COUNT(*) FROM tickdata;"), "1000");
+	ASSERT_EQ(query("PRAGMA journal_mode;"), "wal");
+	ASSERT_EQ(query("SELECT name FROM sqlite_master WHERE type = 'index' AND tbl_name = 'tickdata';"),
+			  "tickdata_id_datetime");
+	sqlite3_close(conn);
+}
+
+TEST(DataRecorderTest, SQLiteBarRecorder) {
+	std::filesystem::path db_name = "test_bars.sqlite3";
+	std::filesystem::remove(db_name);
+	SymbolID id = SymbolTable::Instance().Intern("IC0000");
+	{
+		SQLite3BarRecorder recorder(db_name);
+		for (int i = 0; i < 100; ++i) {
+			Timestamp start = 1622511000000000000 + i * 1'000'000'000LL;
+			recorder.BarSink(Bar{.symbol_id = id,
+								 .period = BarPeriod::Second,
+								 .trading_day = 20210601,
+								 .start_time = start,
+								 .end_time = start + 1'000'000'000LL,
+								 .open = 1,
+								 .high = 2,
+								 .low = 1,
+								 .close = 2,
+								 .volume = i,
+								 .turnover = 10.0 * i,
+								 .open_interest = 1,
+								 .tick_count = 2});
+		}
+	}
+	ASSERT_EQ(SymbolTable::Instance().Name(id), "IC0000");
+
+	sqlite3* conn = nullptr;
+	ASSERT_EQ(sqlite3_open(db_name.string().c_str(), &conn), SQLITE_OK);
+	sqlite3_stmt* stmt = nullptr;
+	sqlite3_prepare_v2(conn, "SELECT COUNT(*), COUNT(DISTINCT ID), SUM(Volume) FROM bardata;", -1, &stmt, nullptr);
+	ASSERT_EQ(sqlite3_step(stmt), SQLITE_ROW);
+	ASSERT_EQ(sqlite3_column_int(stmt, 0), 100);
+	ASSERT_EQ(sqlite3_column_int(stmt, 1), 1);
+	ASSERT_EQ(sqlite3_column_int(stmt, 2), 4950);
+	sqlite3_finalize(stmt);
+	sqlite3_close(conn);
+}
+
 TEST(DataRecorderTest, MariadbDateRecorderTest) {
 	MariadbDataRecorder recorder("127.0.0.1", "asharedata", "ce", "123");
 	recorder.DataSink(md);
@@ -31,6 +180,488 @@ TEST(DataRecorderTest, MariadbDateRecorderTest) {
 	std::this_thread::sleep_for(std::chrono::seconds(1));
 }
 
+TEST(DataRecorderTest, MariadbBatchedInsert) {
+	std::unique_ptr<sql::Connection> conn(
+		sql::DriverManager::getConnection("jdbc:mariadb://127.0.0.1/asharedata", "ce", "123"));
+	std::unique_ptr<sql::Statement> stmnt(conn->createStatement());
+	for (MariadbWriteMode mode : {MariadbWriteMode::MultiRowInsert, MariadbWriteMode::LoadDataInfile}) {
+		stmnt->executeUpdate("DELETE FROM tickdata WHERE ID = 'batch0000';");
+		{
+			MariadbDataRecorder recorder("127.0.0.1", "asharedata", "ce", "123", 100, std::chrono::milliseconds(50),
+										 mode);
+			MarketDepth tick = md;
+			strcpy(tick.instrument_id, "batch0000");
+			for (int i = 0; i < 1000; ++i) {
+				tick.exchange_time = md.exchange_time + i * 1'000'000LL;
+				recorder.DataSink(tick);
+			}
+			// 主键重复的行被忽略
+			recorder.DataSink(tick);
+		}
+		std::unique_ptr<sql::ResultSet> result(
+			stmnt->executeQuery("SELECT COUNT(*) FROM tickdata WHERE ID = 'batch0000';"));
+		ASSERT_TRUE(result->next());
+		ASSERT_EQ(result->getInt(1), 1000);
+	}
+}
+
+TEST(DataRecorderTest, MariadbEscapedInstrument) {
+	std::unique_ptr<sql::Connection> conn(
+		sql::DriverManager::getConnection("jdbc:mariadb://127.0.0.1/asharedata", "ce", "123"));
+	std::unique_ptr<sql::Statement> stmnt(conn->createStatement());
+	for (MariadbWriteMode mode : {MariadbWriteMode::MultiRowInsert, MariadbWriteMode::LoadDataInfile}) {
+		stmnt->executeUpdate("DELETE FROM tickdata WHERE ID LIKE 'esc%';");
+		{
+			MariadbDataRecorder recorder("127.0.0.1", "asharedata", "ce", "123", 100, std::chrono::milliseconds(50),
+										 mode);
+			// 含引号, 分隔符及反斜杠的合约代码不破坏语句或数据文件
+			for (const char* id : {"esc'1", "esc,2", "esc\\3"}) {
+				MarketDepth tick = md;
+				strcpy(tick.instrument_id, id);
+				recorder.DataSink(tick);
+			}
+		}
+		std::unique_ptr<sql::ResultSet> result(
+			stmnt->executeQuery("SELECT COUNT(*) FROM tickdata WHERE ID IN ('esc''1', 'esc,2', 'esc\\\\3');"));
+		ASSERT_TRUE(result->next());
+		ASSERT_EQ(result->getInt(1), 3);
+	}
+}
+
+/// 记录至内存, 可暂停写入以模拟慢速数据库
+class MemoryRecorder : public DataRecorder {
+public:
+	~MemoryRecorder() override { Stop(); }
+
+	std::vector<Volume> volumes;
+	std::vector<std::string> instruments;
+	std::vector<size_t> batch_sizes;
+	std::mutex gate;
+
+protected:
+	void WriteDB(const MarketDepth& data) override {
+		volumes.push_back(data.ohlclvt.volume);
+		instruments.push_back(data.instrument_id);
+	}
+	void WriteDB(std::span<const MarketDepth> data) override {
+		std::scoped_lock _(gate);
+		batch_sizes.push_back(data.size());
+		DataRecorder::WriteDB(data);
+	}
+};
+
+MarketDepth Tick(Volume volume) {
+	MarketDepth ret = md;
+	ret.ohlclvt.volume = volume;
+	return ret;
+}
+
+TEST(DataRecorderTest, BatchedDrain) {
+	MemoryRecorder recorder;
+	recorder.SetBackpressurePolicy(1024, BackpressurePolicy::Block);
+	{
+		// 记录线程暂停期间到达的行情合并为一批
+		std::scoped_lock _(recorder.gate);
+		recorder.DataSink(Tick(0));
+		// 等待记录线程取走第一批并阻塞在写入中
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		for (Volume i = 1; i < 100; ++i) { recorder.DataSink(Tick(i)); }
+	}
+	recorder.Stop();
+	ASSERT_EQ(recorder.volumes.size(), 100);
+	for (Volume i = 0; i < 100; ++i) { ASSERT_EQ(recorder.volumes[i], i); }
+	ASSERT_EQ(recorder.batch_sizes.size(), 2);
+	ASSERT_EQ(recorder.batch_sizes[1], 99);
+	RecorderStatistics stats = recorder.statistics();
+	ASSERT_EQ(stats.received, 100);
+	ASSERT_EQ(stats.written, 100);
+	ASSERT_EQ(stats.pending, 0);
+}
+
+TEST(DataRecorderTest, DropOldest) {
+	MemoryRecorder recorder;
+	recorder.SetBackpressurePolicy(10, BackpressurePolicy::DropOldest);
+	{
+		std::scoped_lock _(recorder.gate);
+		recorder.DataSink(Tick(0));
+		// 等待记录线程取走第一批并阻塞在写入中
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		for (Volume i = 1; i <= 30; ++i) { recorder.DataSink(Tick(i)); }
+	}
+	recorder.Stop();
+	RecorderStatistics stats = recorder.statistics();
+	ASSERT_EQ(stats.received, 31);
+	ASSERT_EQ(stats.dropped, 20);
+	ASSERT_EQ(stats.written, 11);
+	ASSERT_EQ(recorder.volumes.front(), 0);
+	ASSERT_EQ(recorder.volumes[1], 21);
+	ASSERT_EQ(recorder.volumes.back(), 30);
+}
+
+TEST(DataRecorderTest, SpillToDisk) {
+	std::filesystem::path spill_file = "recorder_spill.bin";
+	MemoryRecorder recorder;
+	recorder.SetBackpressurePolicy(10, BackpressurePolicy::SpillToDisk, spill_file);
+	// 无法打开转存文件时保留原来的设置
+	ASSERT_THROW(recorder.SetBackpressurePolicy(20, BackpressurePolicy::SpillToDisk, "no_such_dir/spill.bin"), IOError);
+	{
+		std::scoped_lock _(recorder.gate);
+		recorder.DataSink(Tick(0));
+		// 等待记录线程取走第一批并阻塞在写入中
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		for (Volume i = 1; i <= 35; ++i) { recorder.DataSink(Tick(i)); }
+		ASSERT_EQ(recorder.statistics().spilled, 30);
+	}
+	recorder.Stop();
+	RecorderStatistics stats = recorder.statistics();
+	ASSERT_EQ(stats.dropped, 0);
+	ASSERT_EQ(stats.written, 36);
+	ASSERT_EQ(recorder.volumes.size(), 36);
+	for (Volume i = 0; i <= 35; ++i) { ASSERT_EQ(recorder.volumes[i], i); }
+	std::filesystem::remove(spill_file);
+}
+
+TEST(DataRecorderTest, SpillToDiskWhileDraining) {
+	constexpr Volume kTicks = 20000;
+	std::filesystem::path spill_file = "recorder_spill_drain.bin";
+	MemoryRecorder recorder;
+	recorder.SetBackpressurePolicy(16, BackpressurePolicy::SpillToDisk, spill_file);
+	std::atomic<bool> done = false;
+	std::thread producer([&recorder, &done]() {
+		for (Volume i = 0; i < kTicks; ++i) { recorder.DataSink(Tick(i)); }
+		done = true;
+	});
+	// 间歇暂停写入, 补写期间仍不断有新的转存
+	while (!done) {
+		std::scoped_lock _(recorder.gate);
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	producer.join();
+	recorder.Stop();
+	RecorderStatistics stats = recorder.statistics();
+	ASSERT_EQ(stats.dropped, 0);
+	ASSERT_EQ(stats.written, kTicks);
+	ASSERT_GT(stats.spilled, 0);
+	for (Volume i = 0; i < kTicks; ++i) { ASSERT_EQ(recorder.volumes[i], i); }
+	std::filesystem::remove(spill_file);
+}
+
+TEST(DataRecorderTest, BlockUntilDrained) {
+	MemoryRecorder recorder;
+	recorder.SetBackpressurePolicy(4, BackpressurePolicy::Block);
+	std::thread producer([&recorder]() {
+		for (Volume i = 0; i < 1000; ++i) { recorder.DataSink(Tick(i)); }
+	});
+	producer.join();
+	recorder.Stop();
+	RecorderStatistics stats = recorder.statistics();
+	ASSERT_EQ(stats.dropped, 0);
+	ASSERT_EQ(stats.written, 1000);
+	for (Volume i = 0; i < 1000; ++i) { ASSERT_EQ(recorder.volumes[i], i); }
+}
+
+/// 构造函数耗时超过空闲提交间隔的记录器
+class SlowConstructedRecorder : public MemoryRecorder {
+public:
+	SlowConstructedRecorder() {
+		std::this_thread::sleep_for(kDefaultFlushInterval + std::chrono::milliseconds(200));
+		constructed = true;
+		set_flush_interval(std::chrono::milliseconds(10));
+	}
+
+	std::atomic<bool> constructed = false;
+	std::atomic<int> early_flushes = 0;
+	std::atomic<int> flushes = 0;
+
+protected:
+	void Flush() override { ++(constructed ? flushes : early_flushes); }
+};
+
+TEST(DataRecorderTest, NoIdleFlushDuringConstruction) {
+	SlowConstructedRecorder recorder;
+	for (int i = 0; (i < 300) && (recorder.flushes == 0); ++i) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	ASSERT_EQ(recorder.early_flushes, 0);
+	ASSERT_GT(recorder.flushes, 0);
+}
+
+TEST(DataRecorderTest, FanoutSpillToDisk) {
+	constexpr Volume kTicks = 5 * FanoutDataRecorder::kChunkRows;
+	std::filesystem::path spill_file = "fanout_spill.bin";
+	MemoryRecorder fast;
+	MemoryRecorder slow;
+	FanoutDataRecorder fanout(2 * FanoutDataRecorder::kChunkRows, BackpressurePolicy::SpillToDisk, spill_file);
+	ASSERT_EQ(fanout.AddSink(&fast), 0);
+	ASSERT_EQ(fanout.AddSink(&slow, 100), 1);
+	{
+		// 慢速的数据记录器不影响其他数据记录器
+		std::scoped_lock _(slow.gate);
+		for (Volume i = 0; i < kTicks; ++i) { fanout.DataSink(Tick(i)); }
+		for (int i = 0; (i < 500) && (fanout.sink_statistics(0).written < kTicks); ++i) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		ASSERT_EQ(fanout.sink_statistics(0).written, kTicks);
+		ASSERT_GT(fanout.sink_statistics(1).lag, 0);
+		ASSERT_GT(fanout.statistics().spilled, 0);
+	}
+	fanout.Stop();
+	for (MemoryRecorder* recorder : {&fast, &slow}) {
+		ASSERT_EQ(recorder->volumes.size(), kTicks);
+		for (Volume i = 0; i < kTicks; ++i) { ASSERT_EQ(recorder->volumes[i], i); }
+	}
+	ASSERT_LE(*std::max_element(slow.batch_sizes.begin(), slow.batch_sizes.end()), 100);
+	RecorderStatistics stats = fanout.statistics();
+	ASSERT_EQ(stats.received, kTicks);
+	ASSERT_EQ(stats.written, kTicks);
+	ASSERT_EQ(stats.dropped, 0);
+	ASSERT_EQ(stats.pending, 0);
+	ASSERT_EQ(fanout.sink_statistics(1).dropped, 0);
+	std::filesystem::remove(spill_file);
+}
+
+TEST(DataRecorderTest, FanoutDropOldest) {
+	constexpr Volume kChunk = FanoutDataRecorder::kChunkRows;
+	MemoryRecorder slow;
+	FanoutDataRecorder fanout(2 * kChunk, BackpressurePolicy::DropOldest);
+	fanout.AddSink(&slow);
+	{
+		std::scoped_lock _(slow.gate);
+		fanout.DataSink(Tick(0));
+		// 等待写入线程取走第一笔并阻塞在写入中
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		for (Volume i = 1; i < 5 * kChunk; ++i) { fanout.DataSink(Tick(i)); }
+		// 内存中只保留最后两个数据块
+		ASSERT_EQ(fanout.sink_statistics(0).lag, 2 * kChunk);
+	}
+	fanout.Stop();
+	SinkStatistics stats = fanout.sink_statistics(0);
+	ASSERT_EQ(stats.dropped, 3 * kChunk - 1);
+	ASSERT_EQ(stats.written, 2 * kChunk + 1);
+	ASSERT_EQ(stats.max_lag, 2 * kChunk);
+	ASSERT_EQ(fanout.statistics().dropped, 3 * kChunk - 1);
+	ASSERT_EQ(slow.volumes.front(), 0);
+	ASSERT_EQ(slow.volumes[1], 3 * kChunk);
+	ASSERT_EQ(slow.volumes.back(), 5 * kChunk - 1);
+}
+
+TEST(DataRecorderTest, FanoutSetBackpressurePolicy) {
+	constexpr Volume kChunk = FanoutDataRecorder::kChunkRows;
+	MemoryRecorder slow;
+	FanoutDataRecorder fanout;
+	fanout.AddSink(&slow);
+	// 组合记录器不能作为分发目标
+	FanoutDataRecorder nested;
+	ASSERT_THROW(fanout.AddSink(&nested), InvalidOperationError);
+	// 通过基类设置分发记录器的日志
+	DataRecorder& recorder = fanout;
+	recorder.SetBackpressurePolicy(2 * kChunk, BackpressurePolicy::DropOldest);
+	{
+		std::scoped_lock _(slow.gate);
+		fanout.DataSink(Tick(0));
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		for (Volume i = 1; i < 5 * kChunk; ++i) { fanout.DataSink(Tick(i)); }
+		ASSERT_EQ(fanout.sink_statistics(0).lag, 2 * kChunk);
+		ASSERT_THROW(recorder.SetBackpressurePolicy(kChunk, BackpressurePolicy::Block), InvalidOperationError);
+	}
+	fanout.Stop();
+	ASSERT_EQ(fanout.sink_statistics(0).dropped, 3 * kChunk - 1);
+	ASSERT_EQ(slow.volumes.back(), 5 * kChunk - 1);
+}
+
+TEST(DataRecorderTest, ShardedPerInstrumentOrder) {
+	std::vector<MemoryRecorder*> shards;
+	ShardedDataRecorder recorder(4, [&shards](size_t) {
+		auto ret = std::make_unique<MemoryRecorder>();
+		shards.push_back(ret.get());
+		return ret;
+	});
+	for (Volume i = 0; i < 1000; ++i) {
+		MarketDepth tick = Tick(i);
+		std::snprintf(tick.instrument_id, sizeof(tick.instrument_id), "IC%04d", static_cast<int>(i % 20));
+		recorder.DataSink(tick);
+	}
+	recorder.Stop();
+	ASSERT_EQ(recorder.statistics().written, 1000);
+
+	std::map<std::string, size_t> shard_of;
+	for (size_t i = 0; i < shards.size(); ++i) {
+		std::map<std::string, Volume> last;
+		for (size_t j = 0; j < shards[i]->volumes.size(); ++j) {
+			const std::string& id = shards[i]->instruments[j];
+			ASSERT_EQ(recorder.Shard(id), i);
+			// 同一合约按收到的顺序写入
+			if (last.contains(id)) { ASSERT_EQ(shards[i]->volumes[j], last[id] + 20); }
+			last[id] = shards[i]->volumes[j];
+			shard_of[id] = i;
+		}
+		// 各分片都有数据
+		ASSERT_FALSE(last.empty());
+	}
+	ASSERT_EQ(shard_of.size(), 20);
+}
+
+TEST(DataRecorderTest, ShardedSetBackpressurePolicy) {
+	std::filesystem::path spill_file = "sharded_spill.bin";
+	ShardedDataRecorder recorder(2, [](size_t) { return std::make_unique<MemoryRecorder>(); });
+	// 通过基类设置各分片的缓冲区
+	DataRecorder& base = recorder;
+	base.SetBackpressurePolicy(10, BackpressurePolicy::SpillToDisk, spill_file);
+	for (size_t i = 0; i < recorder.shard_count(); ++i) {
+		ASSERT_TRUE(std::filesystem::exists(ShardedDataRecorder::ShardFileName(spill_file, i)));
+	}
+	for (Volume i = 0; i < 100; ++i) { recorder.DataSink(Tick(i)); }
+	recorder.Stop();
+	ASSERT_EQ(recorder.statistics().written, 100);
+	for (size_t i = 0; i < recorder.shard_count(); ++i) {
+		std::filesystem::remove(ShardedDataRecorder::ShardFileName(spill_file, i));
+	}
+}
+
+TEST(DataRecorderTest, ShardedSQLite) {
+	std::filesystem::path db_name = "test_sharded.sqlite3";
+	std::vector<std::filesystem::path> shard_files;
+	for (size_t i = 0; i < 3; ++i) {
+		shard_files.push_back(ShardedDataRecorder::ShardFileName(db_name, i));
+		std::filesystem::remove(shard_files.back());
+	}
+	std::filesystem::remove(db_name);
+	ASSERT_EQ(shard_files[2], "test_sharded_2.sqlite3");
+	{
+		ShardedDataRecorder recorder(3, [&db_name](size_t shard) {
+			return std::make_unique<SQLite3DataRecorder>(ShardedDataRecorder::ShardFileName(db_name, shard));
+		});
+		MarketDepth tick = md;
+		for (int i = 0; i < 1000; ++i) {
+			std::snprintf(tick.instrument_id, sizeof(tick.instrument_id), "IC%04d", i % 10);
+			recorder.DataSink(tick);
+		}
+	}
+
+	// 合并后可一起查询
+	SQLite3DataRecorder::MergeShards(db_name, shard_files);
+	sqlite3* conn = nullptr;
+	ASSERT_EQ(sqlite3_open(db_name.string().c_str(), &conn), SQLITE_OK);
+	sqlite3_stmt* stmt = nullptr;
+	sqlite3_prepare_v2(conn, "SELECT COUNT(*), COUNT(DISTINCT ID) FROM tickdata;", -1, &stmt, nullptr);
+	ASSERT_EQ(sqlite3_step(stmt), SQLITE_ROW);
+	ASSERT_EQ(sqlite3_column_int(stmt, 0), 1000);
+	ASSERT_EQ(sqlite3_column_int(stmt, 1), 10);
+	sqlite3_reset(stmt);
+
+	// 重复合并只追加分片中新增的行
+	SQLite3DataRecorder::MergeShards(db_name, shard_files);
+	ASSERT_EQ(sqlite3_step(stmt), SQLITE_ROW);
+	ASSERT_EQ(sqlite3_column_int(stmt, 0), 1000);
+	sqlite3_reset(stmt);
+	{
+		SQLite3DataRecorder shard(shard_files[0]);
+		shard.DataSink(md);
+	}
+	SQLite3DataRecorder::MergeShards(db_name, shard_files);
+	ASSERT_EQ(sqlite3_step(stmt), SQLITE_ROW);
+	ASSERT_EQ(sqlite3_column_int(stmt, 0), 1001);
+	sqlite3_finalize(stmt);
+	sqlite3_close(conn);
+}
+
+TEST(DataRecorderTest, RotateByTradingDay) {
+	std::filesystem::path db_name = "test_rotating.sqlite3";
+	for (int day : {20210601, 20210602}) { std::filesystem::remove(RotatingDataRecorder::FileName(db_name, day)); }
+	ASSERT_EQ(RotatingDataRecorder::FileName(db_name, 20210601), "test_rotating_20210601.sqlite3");
+
+	std::atomic<int> compacted = 0;
+	RecorderStatistics stats;
+	{
+		RotatingDataRecorder recorder(
+			[&db_name](int trading_day) {
+				return std::make_unique<SQLite3DataRecorder>(RotatingDataRecorder::FileName(db_name, trading_day));
+			},
+			[&db_name, &compacted](int trading_day) {
+				SQLite3DataRecorder::Compact(RotatingDataRecorder::FileName(db_name, trading_day));
+				compacted = trading_day;
+			},
+			std::chrono::milliseconds(200));
+		MarketDepth tick = md;
+		for (int i = 0; i < 100; ++i) { recorder.DataSink(tick); }
+		tick.trading_day = 20210602;
+		for (int i = 0; i < 50; ++i) { recorder.DataSink(tick); }
+		ASSERT_EQ(recorder.trading_day(), 20210602);
+		// 整理前迟到的行情仍写入前一交易日
+		tick.trading_day = 20210601;
+		for (int i = 0; i < 5; ++i) { recorder.DataSink(tick); }
+
+		for (int i = 0; (i < 500) && (compacted == 0); ++i) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		ASSERT_EQ(compacted, 20210601);
+		for (int i = 0; i < 3; ++i) { recorder.DataSink(tick); }
+		// 交易时段之外(18:00)的行情被丢弃
+		tick.trading_day = 20210602;
+		tick.exchange_time = md.exchange_time + 8 * 3600'000'000'000LL + 1800'000'000'000LL;
+		recorder.DataSink(tick);
+		recorder.Stop();
+		stats = recorder.statistics();
+	}
+	ASSERT_EQ(stats.received, 159);
+	ASSERT_EQ(stats.written, 155);
+	ASSERT_EQ(stats.dropped, 4);
+	// 停止时当前交易日不整理
+	ASSERT_EQ(compacted, 20210601);
+
+	auto query = [](const std::filesystem::path& filename, const char* sql) {
+		sqlite3* conn = nullptr;
+		sqlite3_open(filename.string().c_str(), &conn);
+		sqlite3_stmt* stmt = nullptr;
+		sqlite3_prepare_v2(conn, sql, -1, &stmt, nullptr);
+		int ret = (sqlite3_step(stmt) == SQLITE_ROW) ? sqlite3_column_int(stmt, 0) : -1;
+		sqlite3_finalize(stmt);
+		sqlite3_close(conn);
+		return ret;
+	};
+	std::filesystem::path day1 = RotatingDataRecorder::FileName(db_name, 20210601);
+	ASSERT_EQ(query(day1, "SELECT COUNT(*) FROM tickdata;"), 105);
+	ASSERT_EQ(query(day1, "SELECT COUNT(*) FROM sqlite_master WHERE name = 'sqlite_stat1';"), 1);
+	ASSERT_EQ(query(RotatingDataRecorder::FileName(db_name, 20210602), "SELECT COUNT(*) FROM tickdata;"), 50);
+}
+
+TEST(DataRecorderTest, RotateConcurrently) {
+	std::mutex mutex;
+	std::map<int, int> created;
+	RecorderStatistics stats;
+	{
+		RotatingDataRecorder recorder([&mutex, &created](int trading_day) {
+			{
+				std::scoped_lock _(mutex);
+				++created[trading_day];
+			}
+			// 放大两个线程同时轮换的窗口
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+			return std::make_unique<MemoryRecorder>();
+		});
+		std::atomic<int> ready = 0;
+		auto feed = [&recorder, &ready](const char* id) {
+			MarketDepth tick = md;
+			strcpy(tick.instrument_id, id);
+			++ready;
+			while (ready < 2) {}
+			for (int day : {20210601, 20210602}) {
+				tick.trading_day = day;
+				for (int i = 0; i < 10; ++i) { recorder.DataSink(tick); }
+			}
+		};
+		std::thread a(feed, "IC0001");
+		std::thread b(feed, "IC0002");
+		a.join();
+		b.join();
+		recorder.Stop();
+		stats = recorder.statistics();
+	}
+	ASSERT_EQ(created, (std::map<int, int>{{20210601, 1}, {20210602, 1}}));
+	ASSERT_EQ(stats.received, 40);
+	ASSERT_EQ(stats.written, 40);
+}
+
 int main(int argc, char** argv) {
 	::testing::InitGoogleTest(&argc, argv);
 	return RUN_ALL_TESTS();
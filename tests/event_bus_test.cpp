@@ -0,0 +1,70 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "eventbus.h"
+
+struct TickCounter {
+	int ticks = 0;
+	Volume volume = 0;
+	void OnTick(const MarketDepth& md) {
+		++ticks;
+		volume += md.ohlclvt.volume;
+	}
+};
+
+TEST(EventBusTest, SubscribePublishUnsubscribe) {
+	TradingEventBus bus;
+	TickCounter counter;
+	int sub = bus.Subscribe<MarketDepth, &TickCounter::OnTick>(&counter);
+	ASSERT_EQ(bus.subscriber_count<MarketDepth>(), 1);
+	ASSERT_EQ(bus.subscriber_count<TradingRecord>(), 0);
+
+	MarketDepth md{};
+	md.ohlclvt.volume = 3;
+	bus.Publish(md);
+	bus.Publish(CapitalInfo{});
+	ASSERT_EQ(counter.ticks, 1);
+	ASSERT_EQ(counter.volume, 3);
+
+	bus.Unsubscribe<MarketDepth>(sub);
+	bus.Publish(md);
+	ASSERT_EQ(counter.ticks, 1);
+	ASSERT_EQ(bus.subscriber_count<MarketDepth>(), 0);
+}
+
+TEST(EventBusTest, HandlerLimit) {
+	EventBus<int> bus;
+	auto handler = [](void*, const int&) {};
+	for (size_t i = 0; i < EventBus<int>::kMaxHandlers; ++i) { bus.Subscribe<int>(handler, nullptr); }
+	ASSERT_THROW(bus.Subscribe<int>(handler, nullptr), std::length_error);
+	bus.Unsubscribe<int>(3);
+	ASSERT_EQ(bus.Subscribe<int>(handler, nullptr), 3);
+}
+
+TEST(EventBusTest, ConcurrentUnsubscribe) {
+	EventBus<int> bus;
+	std::atomic<bool> running = true;
+	std::thread publisher([&]() {
+		while (running) { bus.Publish(1); }
+	});
+
+	for (int round = 0; round < 1000; ++round) {
+		auto* alive = new std::atomic<bool>(true);
+		int sub = bus.Subscribe<int>(
+			[](void* context, const int&) { ASSERT_TRUE(static_cast<std::atomic<bool>*>(context)->load()); }, alive);
+		std::this_thread::yield();
+		bus.Unsubscribe<int>(sub);
+		alive->store(false);
+		delete alive;
+	}
+	running = false;
+	publisher.join();
+}
+
+int main(int argc, char** argv) {
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
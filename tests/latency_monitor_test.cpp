@@ -0,0 +1,79 @@
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "latencymonitor.h"
+
+TEST(LatencyHistogramTest, Buckets) {
+	for (uint64_t value : std::vector<uint64_t>{0, 1, 31, 32, 33, 1000, 123456789, LatencyHistogram::kMaxValue}) {
+		size_t index = LatencyHistogram::BucketIndex(value);
+		ASSERT_LT(index, LatencyHistogram::kBucketCount);
+		uint64_t upper = LatencyHistogram::BucketUpperBound(index);
+		ASSERT_GE(upper, value);
+		// 相对误差不超过 1/kSubBuckets
+		ASSERT_LE(upper - value, value / LatencyHistogram::kSubBuckets);
+		if (index > 0) { ASSERT_LT(LatencyHistogram::BucketUpperBound(index - 1), value); }
+	}
+	ASSERT_EQ(LatencyHistogram::BucketIndex(LatencyHistogram::kMaxValue + 1000), LatencyHistogram::kBucketCount - 1);
+}
+
+TEST(LatencyHistogramTest, Percentile) {
+	LatencyHistogram histogram;
+	ASSERT_EQ(histogram.Percentile(0.5), 0);
+	for (int i = 1; i <= 1000; ++i) { histogram.Record(i * 1000); }
+	histogram.Record(-5);
+	ASSERT_EQ(histogram.count(), 1001);
+	ASSERT_EQ(histogram.max(), 1000000);
+	ASSERT_NEAR(static_cast<double>(histogram.Percentile(0.5)), 500000, 500000 / 32.0);
+	ASSERT_NEAR(static_cast<double>(histogram.Percentile(0.99)), 990000, 990000 / 32.0);
+	ASSERT_EQ(histogram.Percentile(1), 1000000);
+	ASSERT_EQ(histogram.Percentile(0), 0);
+
+	histogram.Reset();
+	ASSERT_EQ(histogram.count(), 0);
+	ASSERT_EQ(histogram.max(), 0);
+}
+
+TEST(LatencyHistogramTest, ConcurrentRecord) {
+	LatencyHistogram histogram;
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; ++t) {
+		threads.emplace_back([&]() {
+			for (int i = 0; i < 100000; ++i) { histogram.Record(i); }
+		});
+	}
+	for (auto& thread : threads) { thread.join(); }
+	ASSERT_EQ(histogram.count(), 400000);
+	ASSERT_EQ(histogram.max(), 99999);
+}
+
+TEST(LatencyMonitorTest, RecordByExchangeAndFront) {
+	LatencyMonitor monitor;
+	monitor.SetExchange(1, Exchange::SHF);
+	monitor.Record(LatencyStage::Callback, 1, 2'000'000, 0);
+	monitor.Record(LatencyStage::Callback, 2, 3'000'000, 1);
+	monitor.Record(LatencyStage::RecorderWritten, 1, 9'000'000);
+
+	ASSERT_EQ(monitor.by_exchange(LatencyStage::Callback, Exchange::SHF).count(), 1);
+	ASSERT_EQ(monitor.by_exchange(LatencyStage::Callback, Exchange::NA).count(), 1);
+	ASSERT_EQ(monitor.by_front(LatencyStage::Callback, 0).count(), 1);
+	ASSERT_EQ(monitor.by_front(LatencyStage::Callback, 1).max(), 3'000'000);
+	ASSERT_EQ(monitor.by_exchange(LatencyStage::RecorderWritten, Exchange::SHF).count(), 1);
+	for (size_t front = 0; front < LatencyMonitor::kMaxFronts; ++front) {
+		ASSERT_EQ(monitor.by_front(LatencyStage::RecorderWritten, front).count(), 0);
+	}
+
+	std::string report = monitor.Report();
+	ASSERT_NE(report.find("callback"), std::string::npos);
+	ASSERT_NE(report.find("front1"), std::string::npos);
+	ASSERT_EQ(report.find("published"), std::string::npos);
+
+	monitor.Reset();
+	ASSERT_TRUE(monitor.Report().empty());
+}
+
+int main(int argc, char** argv) {
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,224 @@
+#include <cstdint>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "marketdatawatchdog.h"
+#include "symboltable.h"
+#include "timerwheel.h"
+#include "trading_utils.h"
+
+namespace {
+constexpr Timestamp kSecond = 1'000'000'000LL;
+}
+
+TEST(TimerWheelTest, ExpiresInOrderAcrossLevels) {
+	TimerWheel wheel(16, kSecond / 100);
+	Timestamp base = MakeTimestamp(20210601, TimeOfDay(9, 0));
+	wheel.Start(base);
+	// 分别落在第0, 1, 2层
+	wheel.Schedule(0, base + kSecond / 10);
+	wheel.Schedule(1, base + 30 * kSecond);
+	wheel.Schedule(2, base + 600 * kSecond);
+	wheel.Schedule(3, base + 5 * kSecond);
+	wheel.Cancel(3);
+	ASSERT_EQ(wheel.size(), 3);
+
+	std::vector<uint32_t> expired;
+	auto on_expire = [&](uint32_t id, Timestamp deadline) {
+		ASSERT_LE(deadline, base + 600 * kSecond);
+		expired.push_back(id);
+	};
+	wheel.Advance(base + kSecond / 20, on_expire);
+	ASSERT_TRUE(expired.empty());
+	wheel.Advance(base + kSecond, on_expire);
+	ASSERT_EQ(expired, std::vector<uint32_t>({0}));
+	wheel.Advance(base + 30 * kSecond - kSecond / 100, on_expire);
+	ASSERT_EQ(expired.size(), 1);
+	wheel.Advance(base + 30 * kSecond, on_expire);
+	ASSERT_EQ(expired, std::vector<uint32_t>({0, 1}));
+
+	// 重设后按新的到期时间
+	wheel.Schedule(2, base + 40 * kSecond);
+	wheel.Advance(base + 40 * kSecond, on_expire);
+	ASSERT_EQ(expired, std::vector<uint32_t>({0, 1, 2}));
+	ASSERT_EQ(wheel.size(), 0);
+	ASSERT_FALSE(wheel.scheduled(2));
+}
+
+TEST(TimerWheelTest, BeyondRange) {
+	TimerWheel wheel(1, kSecond);
+	wheel.Start(0);
+	// 超出四层范围(约194天)
+	Timestamp deadline = 300LL * 86400 * kSecond;
+	wheel.Schedule(0, deadline);
+	int count = 0;
+	wheel.Advance(deadline - kSecond, [&](uint32_t, Timestamp) { ++count; });
+	ASSERT_EQ(count, 0);
+	wheel.Advance(deadline, [&](uint32_t, Timestamp) { ++count; });
+	ASSERT_EQ(count, 1);
+}
+
+TEST(TimerWheelTest, JumpsOverLongGap) {
+	TimerWheel wheel(4, kSecond / 100);
+	wheel.Start(0);
+	wheel.Schedule(0, kSecond);
+	wheel.Schedule(1, kSecond / 2);
+	wheel.Schedule(2, 10LL * 86400 * kSecond);
+	wheel.Schedule(3, 100LL * 86400 * kSecond);
+	std::vector<uint32_t> expired;
+	auto on_expire = [&](uint32_t id, Timestamp) { expired.push_back(id); };
+	// 超过四层范围(约46小时)的推进一次完成, 到期的按到期时间回调, 其余的保留
+	wheel.Advance(5LL * 86400 * kSecond, on_expire);
+	ASSERT_EQ(expired, std::vector<uint32_t>({1, 0}));
+	ASSERT_EQ(wheel.size(), 2);
+	wheel.Advance(10LL * 86400 * kSecond - kSecond / 100, on_expire);
+	ASSERT_EQ(expired.size(), 2);
+	wheel.Advance(10LL * 86400 * kSecond, on_expire);
+	ASSERT_EQ(expired, std::vector<uint32_t>({1, 0, 2}));
+	wheel.Advance(100LL * 86400 * kSecond, on_expire);
+	ASSERT_EQ(expired, std::vector<uint32_t>({1, 0, 2, 3}));
+	ASSERT_EQ(wheel.size(), 0);
+}
+
+TEST(TradingSessionTest, OpenTime) {
+	// 2021-06-01为周二
+	Timestamp tuesday = MakeTimestamp(20210601, 0);
+	ASSERT_EQ(SessionOpenTime(kFuturesDaySessions, tuesday + TimeOfDay(10, 0)), tuesday + TimeOfDay(9, 0));
+	ASSERT_FALSE(SessionOpenTime(kFuturesDaySessions, tuesday + TimeOfDay(10, 20)));
+	ASSERT_EQ(NextSessionOpenTime(kFuturesDaySessions, tuesday + TimeOfDay(10, 20)), tuesday + TimeOfDay(10, 30));
+	ASSERT_EQ(NextSessionOpenTime(kFuturesDaySessions, tuesday + TimeOfDay(15, 0)),
+			  MakeTimestamp(20210602, TimeOfDay(9, 0)));
+
+	// 周五夜盘延续至周六凌晨, 周一开盘前没有交易
+	TradingSessions night = {{TimeOfDay(21, 0), TimeOfDay(2, 30)}};
+	ASSERT_EQ(SessionOpenTime(night, MakeTimestamp(20210605, TimeOfDay(1, 0))),
+			  MakeTimestamp(20210604, TimeOfDay(21, 0)));
+	ASSERT_FALSE(SessionOpenTime(night, MakeTimestamp(20210605, TimeOfDay(21, 30))));
+	ASSERT_EQ(NextSessionOpenTime(night, MakeTimestamp(20210605, TimeOfDay(3, 0))),
+			  MakeTimestamp(20210607, TimeOfDay(21, 0)));
+}
+
+class MarketDataWatchdogTest : public ::testing::Test {
+protected:
+	TradingEventBus bus;
+	std::vector<MarketDataAlert> alerts;
+	Timestamp base = MakeTimestamp(20210601, TimeOfDay(9, 0));
+
+	void SetUp() override { bus.Subscribe<MarketDataAlert, &MarketDataWatchdogTest::OnAlert>(this); }
+	void OnAlert(const MarketDataAlert& alert) { alerts.push_back(alert); }
+
+	static MarketDepth Tick(const Ticker& ticker, Timestamp local_time) {
+		MarketDepth md{};
+		md.symbol_id = SymbolTable::Instance().Intern(ticker);
+		md.local_time = local_time;
+		return md;
+	}
+};
+
+TEST_F(MarketDataWatchdogTest, StaleAndResumed) {
+	MarketDataWatchdog watchdog(bus, 3600 * kSecond, 3600 * 1000);
+	WatchdogRule rule{.max_interval = 5 * kSecond, .sessions = kFuturesDaySessions};
+	ASSERT_TRUE(watchdog.Watch("rb2110", rule, base));
+	ASSERT_TRUE(watchdog.Watch("ag2112", rule, base));
+	ASSERT_EQ(watchdog.watched_count(), 2);
+	SymbolID rb = SymbolTable::Instance().Find("rb2110");
+	SymbolID ag = SymbolTable::Instance().Find("ag2112");
+
+	for (int i = 1; i <= 8; ++i) {
+		bus.Publish(Tick("rb2110", base + i * kSecond));
+		watchdog.Check(base + i * kSecond);
+	}
+	ASSERT_EQ(alerts.size(), 1);
+	ASSERT_EQ(alerts[0].type, MarketDataAlertType::InstrumentStale);
+	ASSERT_EQ(alerts[0].symbol_id, ag);
+	ASSERT_EQ(alerts[0].last_tick, base);
+	ASSERT_TRUE(watchdog.stale(ag));
+	ASSERT_FALSE(watchdog.stale(rb));
+
+	// 告警不重复发布
+	watchdog.Check(base + 20 * kSecond);
+	ASSERT_EQ(watchdog.stale_count(), 2);
+	ASSERT_EQ(alerts.size(), 2);
+	ASSERT_EQ(alerts[1].symbol_id, rb);
+	ASSERT_EQ(alerts[1].last_tick, base + 8 * kSecond);
+
+	bus.Publish(Tick("ag2112", base + 21 * kSecond));
+	ASSERT_EQ(alerts.size(), 3);
+	ASSERT_EQ(alerts[2].type, MarketDataAlertType::InstrumentResumed);
+	ASSERT_EQ(alerts[2].symbol_id, ag);
+	ASSERT_EQ(watchdog.stale_count(), 1);
+
+	watchdog.Unwatch("rb2110");
+	ASSERT_EQ(watchdog.stale_count(), 0);
+	watchdog.Check(base + 40 * kSecond);
+	ASSERT_EQ(alerts.size(), 4);
+	ASSERT_EQ(alerts[3].symbol_id, ag);
+}
+
+TEST_F(MarketDataWatchdogTest, IgnoresBreaks) {
+	MarketDataWatchdog watchdog(bus, 3600 * kSecond, 3600 * 1000);
+	WatchdogRule rule{.max_interval = 60 * kSecond, .sessions = kFuturesDaySessions};
+	Timestamp close = MakeTimestamp(20210601, TimeOfDay(10, 15));
+	watchdog.Watch("rb2110", rule, close - 30 * kSecond);
+	bus.Publish(Tick("rb2110", close - kSecond));
+
+	// 10:15-10:30休市
+	for (Timestamp t = close; t < close + 15 * 60 * kSecond; t += 10 * kSecond) { watchdog.Check(t); }
+	ASSERT_TRUE(alerts.empty());
+	// 10:30开盘后重新计时
+	Timestamp open = MakeTimestamp(20210601, TimeOfDay(10, 30));
+	watchdog.Check(open + 59 * kSecond);
+	ASSERT_TRUE(alerts.empty());
+	watchdog.Check(open + 60 * kSecond);
+	ASSERT_EQ(alerts.size(), 1);
+	ASSERT_EQ(alerts[0].type, MarketDataAlertType::InstrumentStale);
+}
+
+TEST_F(MarketDataWatchdogTest, SilentFront) {
+	MarketDataWatchdog watchdog(bus, 10 * kSecond, 3600 * 1000);
+	std::vector<uint64_t> ticks = {0, 0};
+	watchdog.SetFrontCounters([&ticks]() { return ticks; });
+	watchdog.Watch("rb2110", {.max_interval = 3600 * kSecond, .sessions = {}}, base);
+
+	for (int i = 1; i <= 12; ++i) {
+		++ticks[0];
+		watchdog.Check(base + i * kSecond);
+	}
+	ASSERT_EQ(alerts.size(), 1);
+	ASSERT_EQ(alerts[0].type, MarketDataAlertType::FrontSilent);
+	ASSERT_EQ(alerts[0].front, 1);
+	ASSERT_EQ(alerts[0].symbol_id, kInvalidSymbol);
+
+	++ticks[1];
+	watchdog.Check(base + 13 * kSecond);
+	ASSERT_EQ(alerts.size(), 2);
+	ASSERT_EQ(alerts[1].type, MarketDataAlertType::FrontResumed);
+	ASSERT_EQ(alerts[1].front, 1);
+}
+
+TEST_F(MarketDataWatchdogTest, ManyInstruments) {
+	constexpr int kInstruments = 10000;
+	MarketDataWatchdog watchdog(bus, 3600 * kSecond, 3600 * 1000);
+	WatchdogRule rule{.max_interval = 30 * kSecond, .sessions = {}};
+	std::vector<Ticker> tickers;
+	for (int i = 0; i < kInstruments; ++i) {
+		tickers.push_back("wd" + std::to_string(i));
+		watchdog.Watch(tickers.back(), rule, base);
+	}
+	// 只有偶数合约有行情
+	for (Timestamp t = base; t <= base + 45 * kSecond; t += kSecond) {
+		for (int i = 0; i < kInstruments; i += 2) { bus.Publish(Tick(tickers[i], t)); }
+		watchdog.Check(t);
+	}
+	ASSERT_EQ(watchdog.stale_count(), kInstruments / 2);
+	ASSERT_EQ(alerts.size(), kInstruments / 2);
+	for (const MarketDataAlert& alert : alerts) {
+		ASSERT_EQ(SymbolTable::Instance().Name(alert.symbol_id).back() % 2, 1);
+	}
+}
+
+int main(int argc, char** argv) {
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
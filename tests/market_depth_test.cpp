@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+
+#include "marketdepth.h"
+
+TEST(MarketDepthTest, Layout) {
+	ASSERT_EQ(alignof(MarketDepthL1), 64);
+	ASSERT_LT(sizeof(MarketDepthL1), sizeof(MarketDepth));
+	ASSERT_EQ(offsetof(MarketDepthL5, open_interest) + sizeof(Volume), 64);
+	ASSERT_EQ(sizeof(MarketDepthT<10>), 384);
+}
+
+TEST(MarketDepthTest, RoundTrip) {
+	MarketDepth md{"IC2106",
+				   SymbolTable::Instance().Intern("IC2106"),
+				   20210601,
+				   1622511000500000000,
+				   1622511000502000000,
+				   {6000, 6010, 5990, 0, 6005, 3, 3600000},
+				   0,
+				   120000,
+				   6002,
+				   6600,
+				   5400,
+				   0,
+				   {PriceVolume{6004, 1}, {6003, 2}, {6002, 3}, {6001, 4}, {6000, 5}},
+				   {PriceVolume{6006, 6}, {6007, 7}, {6008, 8}, {6009, 9}, {6010, 10}}};
+
+	MarketDepthL5 l5 = MarketDepthL5::From(md);
+	ASSERT_EQ(l5.last, 6005);
+	ASSERT_EQ(l5.bid(0).price, 6004);
+	ASSERT_EQ(l5.ask(4).volume, 10);
+	MarketDepth back = l5.ToMarketDepth();
+	ASSERT_STREQ(back.instrument_id, "IC2106");
+	ASSERT_EQ(back.symbol_id, md.symbol_id);
+	ASSERT_EQ(back.local_time, md.local_time);
+	ASSERT_EQ(back.ohlclvt.high, md.ohlclvt.high);
+	ASSERT_EQ(back.upper_limit, md.upper_limit);
+	for (size_t level = 0; level < md.bid.size(); ++level) {
+		ASSERT_EQ(back.bid[level].price, md.bid[level].price);
+		ASSERT_EQ(back.ask[level].volume, md.ask[level].volume);
+	}
+
+	MarketDepthL1 l1 = MarketDepthL1::From(md);
+	ASSERT_EQ(l1.bid_price1, 6004);
+	ASSERT_EQ(l1.ask_volume1, 6);
+	back = l1.ToMarketDepth();
+	ASSERT_EQ(back.bid[0].price, 6004);
+	ASSERT_EQ(back.bid[1].price, 0);
+	ASSERT_EQ(back.ohlclvt.turnover, 3600000);
+}
+
+int main(int argc, char** argv) {
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
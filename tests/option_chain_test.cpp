@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+#include "optionchain.h"
+#include "symboltable.h"
+#include "trading_utils.h"
+
+namespace {
+double Black76(double forward, double strike, double t, double rate, double sigma, double sign) {
+	auto cdf = [](double x) { return 0.5 * std::erfc(-x / std::sqrt(2.0)); };
+	double d1 = (std::log(forward / strike) + 0.5 * sigma * sigma * t) / (sigma * std::sqrt(t));
+	double d2 = d1 - sigma * std::sqrt(t);
+	return std::exp(-rate * t) * sign * (forward * cdf(sign * d1) - strike * cdf(sign * d2));
+}
+
+InstrumentInfo MakeOption(const Ticker& id, OptionType type, Strike strike) {
+	InstrumentInfo info;
+	info.instrument_id = id;
+	info.instrument_type = InstrumentType::FutureOption;
+	info.option_type = type;
+	info.strike_price = strike;
+	info.underlying_instrument_id = "m2109";
+	info.expire_date = "20210806";
+	return info;
+}
+
+MarketDepth MakeTick(const Ticker& id, Timestamp time, Price bid, Price ask) {
+	MarketDepth md{};
+	md.symbol_id = SymbolTable::Instance().Intern(id);
+	md.exchange_time = time;
+	md.bid[0] = {bid, 1};
+	md.ask[0] = {ask, 1};
+	return md;
+}
+}  // namespace
+
+TEST(OptionChainTest, SolveBatch) {
+	OptionBatch batch;
+	batch.forward = 3500;
+	batch.time_to_expiry = 0.25;
+	batch.rate = 0.02;
+	const std::vector<double> strikes = {2800, 3200, 3500, 3800, 4400};
+	const std::vector<double> sigmas = {0.35, 0.25, 0.2, 0.22, 0.4};
+	batch.resize(2 * strikes.size());
+	for (size_t i = 0; i < batch.size(); ++i) {
+		size_t k = i % strikes.size();
+		batch.strike[i] = strikes[k];
+		batch.sign[i] = i < strikes.size() ? 1 : -1;
+		batch.price[i] = Black76(batch.forward, strikes[k], batch.time_to_expiry, batch.rate, sigmas[k], batch.sign[i]);
+	}
+	SolveOptionBatch(batch);
+	for (size_t i = 0; i < batch.size(); ++i) {
+		size_t k = i % strikes.size();
+		ASSERT_NEAR(batch.iv[i], sigmas[k], 1e-6);
+		ASSERT_GT(batch.gamma[i], 0);
+		ASSERT_GT(batch.vega[i], 0);
+	}
+	// 看涨与看跌期权的Delta之差为折现因子
+	for (size_t k = 0; k < strikes.size(); ++k) {
+		ASSERT_NEAR(batch.delta[k] - batch.delta[k + strikes.size()], std::exp(-0.02 * 0.25), 1e-9);
+	}
+
+	batch.price[0] = 1;	 // 低于内在价值
+	batch.price[1] = std::nan("");
+	SolveOptionBatch(batch);
+	ASSERT_TRUE(std::isnan(batch.iv[0]));
+	ASSERT_TRUE(std::isnan(batch.delta[1]));
+	ASSERT_NEAR(batch.iv[2], sigmas[2], 1e-6);
+}
+
+TEST(OptionChainTest, Chain) {
+	OptionChain chain;
+	InstrumentInfo future;
+	future.instrument_id = "m2109";
+	chain.AddOption(future);
+	chain.AddOption(MakeOption("m2109-C-3600", OptionType::Call, 3600));
+	chain.AddOption(MakeOption("m2109-P-3400", OptionType::Put, 3400));
+	chain.AddOption(MakeOption("m2109-C-3400", OptionType::Call, 3400));
+	ASSERT_EQ(chain.expiry_count(), 1);
+
+	SymbolID underlying = SymbolTable::Instance().Intern("m2109");
+	auto expiries = chain.expiries(underlying);
+	ASSERT_EQ(expiries.size(), 1);
+	ASSERT_EQ(expiries[0]->strikes, (std::vector<Strike>{3400, 3600}));
+	ASSERT_EQ(expiries[0]->puts[1], kInvalidSymbol);
+
+	Timestamp now = MakeTimestamp(20210601, 10LL * 3600 * 1'000'000'000LL);
+	double t = static_cast<double>(expiries[0]->expire_time - now) / static_cast<double>(365 * kNanosecondsPerDay);
+	double call = Black76(3500, 3400, t, 0, 0.2, 1);
+	chain.OnMarketData(MakeTick("m2109", now, 3499, 3501));
+	chain.OnMarketData(MakeTick("m2109-C-3400", now, call - 0.5, call + 0.5));
+	ASSERT_EQ(chain.Recompute(), 1);
+	ASSERT_EQ(chain.Recompute(), 0);
+
+	OptionGreeks greeks{};
+	ASSERT_TRUE(chain.greeks(SymbolTable::Instance().Intern("m2109-C-3400"), greeks));
+	ASSERT_NEAR(greeks.iv, 0.2, 1e-6);
+	ASSERT_GT(greeks.delta, 0.5);
+	ASSERT_TRUE(chain.greeks(SymbolTable::Instance().Intern("m2109-P-3400"), greeks));
+	ASSERT_TRUE(std::isnan(greeks.iv));
+	ASSERT_FALSE(chain.greeks(underlying, greeks));
+}
+
+TEST(OptionChainTest, EnrichDelta) {
+	OptionChain chain;
+	chain.AddOption(MakeOption("m2109-C-3450", OptionType::Call, 3450));
+	Timestamp now = MakeTimestamp(20210601, 10LL * 3600 * 1'000'000'000LL);
+	SymbolID underlying = SymbolTable::Instance().Intern("m2109");
+	double t = static_cast<double>(chain.expiries(underlying)[0]->expire_time - now) /
+			   static_cast<double>(365 * kNanosecondsPerDay);
+	double call = Black76(3500, 3450, t, 0, 0.2, 1);
+	chain.OnMarketData(MakeTick("m2109", now, 3499, 3501));
+	MarketDepth md = MakeTick("m2109-C-3450", now, call - 0.5, call + 0.5);
+	chain.Enrich(md);
+
+	OptionGreeks greeks{};
+	ASSERT_TRUE(chain.greeks(md.symbol_id, greeks));
+	ASSERT_DOUBLE_EQ(md.delta, greeks.delta);
+	ASSERT_GT(md.delta, 0.5);
+	ASSERT_LT(md.delta, 1);
+
+	// 新增行权价后保留已收到的价格
+	chain.AddOption(MakeOption("m2109-C-3300", OptionType::Call, 3300));
+	ASSERT_EQ(chain.Recompute(now), 1);
+	ASSERT_TRUE(chain.greeks(md.symbol_id, greeks));
+	ASSERT_NEAR(greeks.iv, 0.2, 1e-6);
+
+	// 标的行情不改写Delta
+	MarketDepth future = MakeTick("m2109", now, 3499, 3501);
+	future.delta = 1;
+	chain.Enrich(future);
+	ASSERT_EQ(future.delta, 1);
+}
+
+int main(int argc, char** argv) {
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
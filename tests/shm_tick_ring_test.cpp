@@ -0,0 +1,178 @@
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "shmmarketdata.h"
+#include "shmtickring.h"
+#include "symboltable.h"
+#include "utsexceptions.h"
+
+namespace {
+std::string TestName() { return "uts_shm_tick_test_" + std::to_string(getpid()); }
+
+MarketDepth MakeTick(const char* ticker, Volume volume) {
+	MarketDepth md{};
+	std::snprintf(md.instrument_id, sizeof(md.instrument_id), "%s", ticker);
+	md.symbol_id = SymbolTable::Instance().Intern(ticker);
+	md.exchange_time = 1622511000000000000 + volume;
+	md.ohlclvt.last = 4000 + volume;
+	md.ohlclvt.volume = volume;
+	md.bid[0] = {md.ohlclvt.last - 1, volume};
+	md.ask[4] = {md.ohlclvt.last + 5, volume};
+	return md;
+}
+}  // namespace
+
+TEST(ShmTickRingTest, ReadInOrder) {
+	ShmTickWriter writer(TestName(), 6);
+	ASSERT_EQ(writer.capacity(), 8);
+	ShmTickReader reader(TestName());
+	MarketDepth md;
+	ASSERT_EQ(reader.Read(md), ShmReadResult::Empty);
+
+	writer.Publish(MakeTick("rb2110", 1));
+	writer.Publish(MakeTick("ag2112", 2));
+	ASSERT_EQ(reader.backlog(), 2);
+	ASSERT_EQ(reader.Read(md), ShmReadResult::Ok);
+	ASSERT_STREQ(md.instrument_id, "rb2110");
+	ASSERT_EQ(md.symbol_id, SymbolTable::Instance().Find("rb2110"));
+	ASSERT_EQ(md.ohlclvt.volume, 1);
+	ASSERT_EQ(reader.Read(md), ShmReadResult::Ok);
+	ASSERT_STREQ(md.instrument_id, "ag2112");
+	ASSERT_EQ(md.ask[4].price, 4007);
+	ASSERT_EQ(reader.Read(md), ShmReadResult::Empty);
+
+	// 新的读进程默认只读之后的行情
+	ShmTickReader late_reader(TestName());
+	ASSERT_EQ(late_reader.Read(md), ShmReadResult::Empty);
+	ShmTickReader replay_reader(TestName(), true);
+	ASSERT_EQ(replay_reader.Read(md), ShmReadResult::Ok);
+	ASSERT_EQ(md.ohlclvt.volume, 1);
+}
+
+TEST(ShmTickRingTest, Lapped) {
+	ShmTickWriter writer(TestName(), 8);
+	ShmTickReader reader(TestName());
+	for (int i = 0; i < 20; ++i) { writer.Publish(MakeTick("rb2110", i)); }
+
+	MarketDepth md;
+	ASSERT_EQ(reader.Read(md), ShmReadResult::Lapped);
+	ASSERT_EQ(reader.lapped(), 1);
+	ASSERT_EQ(reader.dropped(), 20);
+	ASSERT_EQ(reader.Read(md), ShmReadResult::Empty);
+	writer.Publish(MakeTick("rb2110", 20));
+	ASSERT_EQ(reader.Read(md), ShmReadResult::Ok);
+	ASSERT_EQ(md.ohlclvt.volume, 20);
+}
+
+TEST(ShmTickRingTest, WriterLifecycle) {
+	ASSERT_THROW(ShmTickReader("uts_shm_tick_test_missing"), IOError);
+	auto writer = std::make_unique<ShmTickWriter>(TestName(), 8);
+	ShmTickReader reader(TestName());
+	writer->Publish(MakeTick("rb2110", 1));
+	ASSERT_FALSE(reader.writer_closed());
+	writer.reset();
+	ASSERT_TRUE(reader.writer_closed());
+	MarketDepth md;
+	ASSERT_EQ(reader.Read(md), ShmReadResult::Ok);
+}
+
+TEST(ShmTickRingTest, ReaderFollowsWriterRestart) {
+	auto writer = std::make_unique<ShmTickWriter>(TestName(), 8);
+	ShmTickReader reader(TestName());
+	writer->Publish(MakeTick("rb2110", 1));
+	MarketDepth md;
+	ASSERT_EQ(reader.Read(md), ShmReadResult::Ok);
+	ASSERT_FALSE(reader.Reattach());
+
+	// 写进程正常退出后重启, 读进程仍映射着旧缓冲区
+	Timestamp session = reader.session();
+	writer.reset();
+	writer = std::make_unique<ShmTickWriter>(TestName(), 16);
+	writer->Publish(MakeTick("ag2112", 2));
+	writer->Publish(MakeTick("rb2110", 3));
+	auto deadline = std::chrono::steady_clock::now() + ShmTickReader::kReattachInterval * 3;
+	ShmReadResult result = ShmReadResult::Empty;
+	while ((result == ShmReadResult::Empty) && (std::chrono::steady_clock::now() < deadline)) {
+		result = reader.Read(md);
+	}
+	ASSERT_EQ(result, ShmReadResult::Restarted);
+	ASSERT_NE(reader.session(), session);
+	ASSERT_EQ(reader.capacity(), 16);
+	ASSERT_EQ(reader.restarts(), 1);
+	ASSERT_FALSE(reader.writer_closed());
+
+	// 从新缓冲区的起点读取, 合约ID重新映射
+	ASSERT_EQ(reader.Read(md), ShmReadResult::Ok);
+	ASSERT_STREQ(md.instrument_id, "ag2112");
+	ASSERT_EQ(md.symbol_id, SymbolTable::Instance().Find("ag2112"));
+	ASSERT_EQ(reader.Read(md), ShmReadResult::Ok);
+	ASSERT_EQ(md.ohlclvt.volume, 3);
+	ASSERT_EQ(reader.Read(md), ShmReadResult::Empty);
+}
+
+TEST(ShmTickRingTest, ReattachAfterWriterCrash) {
+	auto crashed = std::make_unique<ShmTickWriter>(TestName(), 8);
+	ShmMarketData source(TestName());
+	source.LogIn();
+	source.Subscribe({"rb2110"});
+	auto wait_for_volume = [&source](Volume volume) {
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+		MarketDepth md;
+		while (std::chrono::steady_clock::now() < deadline) {
+			if (source.market_data(Ticker("rb2110"), md) && (md.ohlclvt.volume == volume)) { return true; }
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		return false;
+	};
+	crashed->Publish(MakeTick("rb2110", 1));
+	ASSERT_TRUE(wait_for_volume(1));
+
+	// 网关崩溃后重启: 旧的写端未析构, `closed` 未设置, 新的写端以同一名称重建缓冲区
+	ShmTickWriter restarted(TestName(), 8);
+	restarted.Publish(MakeTick("rb2110", 2));
+	ASSERT_TRUE(wait_for_volume(2));
+	source.LogOut();
+}
+
+TEST(ShmTickRingTest, ConcurrentReader) {
+	constexpr Volume kTicks = 200000;
+	ShmTickWriter writer(TestName(), 1024);
+	ShmTickReader reader(TestName());
+
+	std::atomic<bool> done = false;
+	std::thread producer([&] {
+		for (Volume i = 1; i <= kTicks; ++i) { writer.Publish(MakeTick("rb2110", i)); }
+		done = true;
+	});
+	MarketDepth md;
+	Volume last = 0;
+	uint64_t received = 0;
+	while (!done || (reader.backlog() != 0)) {
+		ShmReadResult result = reader.Read(md);
+		if (result != ShmReadResult::Ok) {
+			std::this_thread::yield();
+			continue;
+		}
+		// 读到的每笔行情都是完整的, 且顺序不乱
+		ASSERT_GT(md.ohlclvt.volume, last);
+		ASSERT_EQ(md.ohlclvt.last, 4000 + md.ohlclvt.volume);
+		ASSERT_EQ(md.ask[4].volume, md.ohlclvt.volume);
+		last = md.ohlclvt.volume;
+		++received;
+	}
+	producer.join();
+	ASSERT_EQ(received + reader.dropped(), static_cast<uint64_t>(kTicks));
+}
+
+int main(int argc, char** argv) {
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,118 @@
+#include <array>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "data_struct.h"
+#include "snapshotstore.h"
+
+struct TestSnapshot {
+	std::array<long, 16> values;
+};
+
+TEST(SnapshotStoreTest, LoadStoreClear) {
+	SnapshotStore<MarketDepth> store(4);
+	MarketDepth md{"IC0000", 0, 20210601, 1622511000500000000, 1622511000500000000, {1, 1, 1, 1, 1, 1, 1},
+				   1, 1, 1, 1, 1, 1, {}, {}};
+	MarketDepth out{};
+	ASSERT_FALSE(store.Load(0, out));
+
+	store.Store(2, md);
+	ASSERT_TRUE(store.Load(2, out));
+	ASSERT_STREQ(out.instrument_id, "IC0000");
+	ASSERT_EQ(store.CrossSection().size(), 1);
+
+	store.Clear(2);
+	ASSERT_FALSE(store.Load(2, out));
+	ASSERT_TRUE(store.CrossSection().empty());
+}
+
+TEST(SnapshotStoreTest, ForEachVisitsOccupiedSlots) {
+	SnapshotStore<TestSnapshot> store(1 << 15);
+	TestSnapshot snapshot{};
+	for (size_t id : {30000, 7, 12345}) {
+		snapshot.values.fill(static_cast<long>(id));
+		store.Store(id, snapshot);
+	}
+	store.Store(7, snapshot);
+	store.Clear(12345);
+	ASSERT_EQ(store.occupied(), 3);
+
+	std::vector<size_t> ids;
+	store.ForEach([&](size_t id, const TestSnapshot&) { ids.push_back(id); });
+	ASSERT_EQ(ids, (std::vector<size_t>{30000, 7}));
+
+	// 清空后再次写入不重复登记
+	store.Store(12345, snapshot);
+	ASSERT_EQ(store.occupied(), 3);
+	ASSERT_EQ(store.CrossSection().size(), 3);
+}
+
+TEST(SnapshotStoreTest, ConcurrentFirstWrites) {
+	constexpr size_t kWriters = 4;
+	constexpr size_t kSlots = 1000;
+	SnapshotStore<TestSnapshot> store(kWriters * kSlots);
+	std::atomic_bool done = false;
+	std::thread reader([&]() {
+		while (!done) {
+			store.ForEach([](size_t id, const TestSnapshot& snapshot) { ASSERT_EQ(snapshot.values[0], id); });
+		}
+	});
+	std::vector<std::thread> writers;
+	for (size_t w = 0; w < kWriters; ++w) {
+		writers.emplace_back([&, w]() {
+			TestSnapshot snapshot;
+			for (size_t i = 0; i < kSlots; ++i) {
+				size_t id = i * kWriters + w;
+				snapshot.values.fill(static_cast<long>(id));
+				store.Store(id, snapshot);
+			}
+		});
+	}
+	for (auto& writer : writers) { writer.join(); }
+	done = true;
+	reader.join();
+	ASSERT_EQ(store.occupied(), kWriters * kSlots);
+	ASSERT_EQ(store.CrossSection().size(), kWriters * kSlots);
+}
+
+TEST(SnapshotStoreTest, ConcurrentReadsAreConsistent) {
+	SnapshotStore<TestSnapshot> store(8);
+	std::atomic_bool done = false;
+
+	std::thread writer([&]() {
+		TestSnapshot snapshot;
+		for (long i = 0; i < 200000; ++i) {
+			snapshot.values.fill(i);
+			store.Store(static_cast<size_t>(i % 8), snapshot);
+		}
+		done = true;
+	});
+
+	std::vector<std::thread> readers;
+	std::atomic_int torn_reads = 0;
+	for (int r = 0; r < 3; ++r) {
+		readers.emplace_back([&]() {
+			TestSnapshot snapshot;
+			while (!done) {
+				for (size_t id = 0; id < store.capacity(); ++id) {
+					if (!store.Load(id, snapshot)) { continue; }
+					for (long v : snapshot.values) {
+						if (v != snapshot.values[0]) { ++torn_reads; }
+					}
+				}
+			}
+		});
+	}
+
+	writer.join();
+	for (auto& reader : readers) { reader.join(); }
+	ASSERT_EQ(torn_reads, 0);
+}
+
+int main(int argc, char** argv) {
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
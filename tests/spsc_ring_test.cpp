@@ -0,0 +1,63 @@
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "spscring.h"
+
+TEST(SPSCRingTest, PushPop) {
+	SPSCRing<int> ring(3);
+	ASSERT_EQ(ring.capacity(), 4);
+	ASSERT_TRUE(ring.empty());
+
+	for (int i = 0; i < 4; ++i) { ASSERT_TRUE(ring.TryPush(i)); }
+	ASSERT_FALSE(ring.TryPush(4));
+	ASSERT_EQ(ring.size(), 4);
+
+	int value;
+	for (int i = 0; i < 4; ++i) {
+		ASSERT_TRUE(ring.TryPop(value));
+		ASSERT_EQ(value, i);
+	}
+	ASSERT_FALSE(ring.TryPop(value));
+	ASSERT_TRUE(ring.TryPush(5));
+	ASSERT_TRUE(ring.TryPop(value));
+	ASSERT_EQ(value, 5);
+}
+
+TEST(SPSCRingTest, ProducerConsumer) {
+	constexpr uint64_t kCount = 1'000'000;
+	SPSCRing<uint64_t> ring(1024);
+	std::atomic<bool> running = true;
+
+	std::thread consumer([&]() {
+		uint64_t expected = 0, value;
+		while (true) {
+			if (ring.TryPop(value)) {
+				ASSERT_EQ(value, expected++);
+			} else if (running) {
+				ring.WaitForData([&]() { return !running; });
+			} else {
+				break;
+			}
+		}
+		ASSERT_EQ(expected, kCount);
+	});
+
+	for (uint64_t i = 0; i < kCount;) {
+		if (ring.TryPush(i)) {
+			++i;
+		} else {
+			std::this_thread::yield();
+		}
+	}
+	running = false;
+	ring.Wake();
+	consumer.join();
+}
+
+int main(int argc, char** argv) {
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,45 @@
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "symboltable.h"
+
+TEST(SymbolTableTest, InternAndFind) {
+	SymbolTable table;
+	ASSERT_EQ(table.Find("IF2106"), kInvalidSymbol);
+
+	SymbolID if_id = table.Intern("IF2106");
+	SymbolID ic_id = table.Intern("IC2106");
+	ASSERT_EQ(if_id, 0);
+	ASSERT_EQ(ic_id, 1);
+	ASSERT_EQ(table.Intern("IF2106"), if_id);
+	ASSERT_EQ(table.size(), 2);
+
+	char ctp_field[31] = "IC2106";
+	ASSERT_EQ(table.Find(ctp_field), ic_id);
+	ASSERT_EQ(table.Name(if_id), "IF2106");
+}
+
+TEST(SymbolTableTest, ConcurrentIntern) {
+	SymbolTable table;
+	std::vector<std::string> tickers;
+	for (int i = 0; i < 1000; ++i) { tickers.push_back("T" + std::to_string(i)); }
+
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; ++t) {
+		threads.emplace_back([&]() {
+			for (const auto& ticker : tickers) { table.Intern(ticker); }
+		});
+	}
+	for (auto& thread : threads) { thread.join(); }
+
+	ASSERT_EQ(table.size(), tickers.size());
+	for (const auto& ticker : tickers) { ASSERT_EQ(table.Name(table.Find(ticker)), ticker); }
+}
+
+int main(int argc, char** argv) {
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
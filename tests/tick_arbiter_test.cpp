@@ -0,0 +1,93 @@
+#include <atomic>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "tickarbiter.h"
+
+TEST(TickArbiterTest, FirstArrivalWins) {
+	TickArbiter arbiter(2, 16);
+	int forwarded = 0;
+	auto forward = [&]() { ++forwarded; };
+
+	ASSERT_EQ(arbiter.Arbitrate(0, 1, 1000, 10, 5000, forward), TickArbiter::Verdict::First);
+	ASSERT_EQ(arbiter.Arbitrate(1, 1, 1000, 10, 5300, forward), TickArbiter::Verdict::Duplicate);
+	// 同一时间戳内成交量增加视为新行情
+	ASSERT_EQ(arbiter.Arbitrate(1, 1, 1000, 12, 5400, forward), TickArbiter::Verdict::First);
+	ASSERT_EQ(arbiter.Arbitrate(0, 1, 1000, 12, 5500, forward), TickArbiter::Verdict::Duplicate);
+	ASSERT_EQ(arbiter.Arbitrate(0, 1, 1000, 10, 5600, forward), TickArbiter::Verdict::Stale);
+	// 不同合约互不影响
+	ASSERT_EQ(arbiter.Arbitrate(0, 2, 1000, 10, 5700, forward), TickArbiter::Verdict::First);
+	ASSERT_EQ(forwarded, 3);
+
+	TickArbiter::FrontStatistics front0 = arbiter.statistics(0);
+	ASSERT_EQ(front0.ticks, 4);
+	ASSERT_EQ(front0.wins, 2);
+	ASSERT_EQ(front0.duplicates, 1);
+	ASSERT_EQ(front0.stale, 1);
+	ASSERT_EQ(front0.mean_delay, 100);
+	ASSERT_DOUBLE_EQ(front0.win_rate(), 0.5);
+
+	TickArbiter::FrontStatistics front1 = arbiter.statistics(1);
+	ASSERT_EQ(front1.ticks, 2);
+	ASSERT_EQ(front1.wins, 1);
+	ASSERT_EQ(front1.mean_delay, 300);
+	ASSERT_EQ(front1.max_delay, 300);
+}
+
+TEST(TickArbiterTest, ConcurrentFronts) {
+	constexpr size_t kFronts = 4;
+	constexpr int kTicks = 20000;
+	TickArbiter arbiter(kFronts, 4);
+	std::vector<int> forwarded(4, 0);
+	std::vector<std::thread> fronts;
+	for (size_t front = 0; front < kFronts; ++front) {
+		fronts.emplace_back([&, front]() {
+			for (int i = 1; i <= kTicks; ++i) {
+				SymbolID id = static_cast<SymbolID>(i % 4);
+				arbiter.Arbitrate(front, id, i, i, i, [&]() { ++forwarded[id]; });
+			}
+		});
+	}
+	for (auto& front : fronts) { front.join(); }
+
+	int total = 0;
+	for (int count : forwarded) { total += count; }
+	ASSERT_LE(total, kTicks);
+	uint64_t wins = 0;
+	for (size_t front = 0; front < kFronts; ++front) {
+		TickArbiter::FrontStatistics stats = arbiter.statistics(front);
+		ASSERT_EQ(stats.ticks, kTicks);
+		ASSERT_EQ(stats.wins + stats.duplicates + stats.stale, stats.ticks);
+		wins += stats.wins;
+	}
+	ASSERT_EQ(wins, static_cast<uint64_t>(total));
+}
+
+TEST(TickArbiterTest, SlowForwardDoesNotBlockOtherFronts) {
+	TickArbiter arbiter(2, 16);
+	std::promise<void> forwarding, release;
+	std::shared_future<void> released = release.get_future().share();
+	std::thread slow([&]() {
+		arbiter.Arbitrate(0, 1, 1000, 10, 5000, [&]() {
+			forwarding.set_value();
+			released.wait();
+		});
+	});
+	forwarding.get_future().wait();
+
+	// 前置0仍在转发时, 前置1的判定立即返回
+	ASSERT_EQ(arbiter.Arbitrate(1, 1, 1000, 10, 5100, []() {}), TickArbiter::Verdict::Duplicate);
+	ASSERT_EQ(arbiter.Arbitrate(1, 2, 1000, 10, 5200, []() {}), TickArbiter::Verdict::First);
+	release.set_value();
+	slow.join();
+	ASSERT_EQ(arbiter.statistics(0).wins, 1);
+	ASSERT_EQ(arbiter.statistics(1).duplicates, 1);
+}
+
+int main(int argc, char** argv) {
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
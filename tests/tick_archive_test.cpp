@@ -0,0 +1,249 @@
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "archivedatarecorder.h"
+#include "symboltable.h"
+#include "tickarchive.h"
+
+using tick_archive::TickColumn;
+
+namespace {
+std::filesystem::path TestPath(const std::string& name) {
+	return std::filesystem::temp_directory_path() / ("uts_tick_archive_" + std::to_string(getpid()) + "_" + name);
+}
+
+/// 随机游走的行情, 价格为最小变动价位的整数倍, 无效价格为 -1
+std::vector<MarketDepth> MakeTicks(const char* ticker, size_t count, double price_tick, unsigned seed) {
+	std::mt19937 gen(seed);
+	std::uniform_int_distribution<int> step(-2, 2);
+	std::uniform_int_distribution<int> latency(100'000, 900'000);
+	std::vector<MarketDepth> ticks;
+	Timestamp time = 1622509200000000000;
+	int last = 20000;
+	Volume volume = 0;
+	for (size_t i = 0; i < count; ++i) {
+		MarketDepth md{};
+		std::snprintf(md.instrument_id, sizeof(md.instrument_id), "%s", ticker);
+		md.trading_day = 20210601;
+		time += 500'000'000 + (i % 7 == 0 ? 1'000'000 : 0);
+		md.exchange_time = time;
+		md.local_time = time + latency(gen);
+		last += step(gen);
+		volume += step(gen) + 2;
+		md.ohlclvt = {.open = 20000 / (1 / price_tick),
+					  .high = (last + 10) / (1 / price_tick),
+					  .low = (last - 10) / (1 / price_tick),
+					  .close = -1,
+					  .last = last / (1 / price_tick),
+					  .volume = volume,
+					  .turnover = volume * md.ohlclvt.open * 10};
+		md.settle = -1;
+		md.average_price = md.ohlclvt.last * 1.0001;
+		md.upper_limit = 22000 / (1 / price_tick);
+		md.lower_limit = 18000 / (1 / price_tick);
+		md.delta = -1;
+		md.open_interest = 100000 + static_cast<Volume>(i);
+		for (int level = 0; level < 5; ++level) {
+			md.bid[level] = {(last - 1 - level) / (1 / price_tick), volume % 17 + level};
+			md.ask[level] = {(last + 1 + level) / (1 / price_tick), volume % 13 + level};
+		}
+		ticks.push_back(md);
+	}
+	return ticks;
+}
+
+void ExpectSameTick(const MarketDepth& a, const MarketDepth& b) {
+	ASSERT_STREQ(a.instrument_id, b.instrument_id);
+	ASSERT_EQ(a.trading_day, b.trading_day);
+	ASSERT_EQ(a.exchange_time, b.exchange_time);
+	ASSERT_EQ(a.local_time, b.local_time);
+	ASSERT_EQ(a.ohlclvt.open, b.ohlclvt.open);
+	ASSERT_EQ(a.ohlclvt.high, b.ohlclvt.high);
+	ASSERT_EQ(a.ohlclvt.low, b.ohlclvt.low);
+	ASSERT_EQ(a.ohlclvt.close, b.ohlclvt.close);
+	ASSERT_EQ(a.ohlclvt.last, b.ohlclvt.last);
+	ASSERT_EQ(a.ohlclvt.volume, b.ohlclvt.volume);
+	ASSERT_EQ(a.ohlclvt.turnover, b.ohlclvt.turnover);
+	ASSERT_EQ(a.settle, b.settle);
+	ASSERT_EQ(a.average_price, b.average_price);
+	ASSERT_EQ(a.upper_limit, b.upper_limit);
+	ASSERT_EQ(a.lower_limit, b.lower_limit);
+	ASSERT_EQ(a.delta, b.delta);
+	ASSERT_EQ(a.open_interest, b.open_interest);
+	for (int level = 0; level < 5; ++level) {
+		ASSERT_EQ(a.bid[level].price, b.bid[level].price);
+		ASSERT_EQ(a.bid[level].volume, b.bid[level].volume);
+		ASSERT_EQ(a.ask[level].price, b.ask[level].price);
+		ASSERT_EQ(a.ask[level].volume, b.ask[level].volume);
+	}
+}
+}  // namespace
+
+TEST(TickArchiveTest, RoundTrip) {
+	std::filesystem::path filename = TestPath("round_trip.utstick");
+	std::vector<MarketDepth> rb = MakeTicks("rb2110", 10000, 1, 1);
+	std::vector<MarketDepth> ic = MakeTicks("IC2106", 3000, 0.2, 2);
+	std::vector<MarketDepth> au = MakeTicks("au2112", 100, 0.02, 3);
+	{
+		TickArchiveWriter writer(filename, 20210601, {{"rb2110", 1}, {"IC2106", 0.2}});
+		for (size_t i = 0; i < rb.size(); ++i) {
+			writer.Append(rb[i]);
+			if (i < ic.size()) { writer.Append(ic[i]); }
+			if (i < au.size()) { writer.Append(au[i]); }
+		}
+	}
+
+	TickArchiveReader reader(filename);
+	ASSERT_EQ(reader.trading_day(), 20210601);
+	ASSERT_FALSE(reader.truncated());
+	ASSERT_EQ(reader.size(), rb.size() + ic.size() + au.size());
+	// rb2110 满两块时先写出, 其余在关闭时写出
+	std::vector<Ticker> instruments = reader.instruments();
+	ASSERT_EQ(instruments.front(), "rb2110");
+	std::sort(instruments.begin(), instruments.end());
+	ASSERT_EQ(instruments, std::vector<Ticker>({"IC2106", "au2112", "rb2110"}));
+	ASSERT_EQ(reader.blocks().size(), 5);
+
+	for (const std::vector<MarketDepth>* expected : {&rb, &ic, &au}) {
+		std::vector<MarketDepth> ticks = reader.Read(expected->front().instrument_id);
+		ASSERT_EQ(ticks.size(), expected->size());
+		for (size_t i = 0; i < ticks.size(); ++i) { ExpectSameTick(ticks[i], (*expected)[i]); }
+		ASSERT_EQ(SymbolTable::Instance().Name(ticks.front().symbol_id), expected->front().instrument_id);
+	}
+
+	// 压缩后远小于原始结构体
+	ASSERT_LT(std::filesystem::file_size(filename), reader.size() * sizeof(MarketDepth) / 4);
+	std::filesystem::remove(filename);
+}
+
+TEST(TickArchiveTest, DecodeColumn) {
+	std::filesystem::path filename = TestPath("column.utstick");
+	std::vector<MarketDepth> ticks = MakeTicks("rb2110", 100, 1, 4);
+	{
+		TickArchiveWriter writer(filename, 20210601, {{"rb2110", 1}});
+		for (const MarketDepth& md : ticks) { writer.Append(md); }
+	}
+	TickArchiveReader reader(filename);
+	ASSERT_EQ(reader.blocks().size(), 1);
+	const TickBlock& block = reader.blocks()[0];
+	ASSERT_EQ(block.instrument_id, "rb2110");
+	ASSERT_EQ(block.rows, ticks.size());
+	// 除首行外, 等间隔的时间戳和小幅变动的价格每行1字节
+	ASSERT_LT(block.columns[static_cast<size_t>(TickColumn::ExchangeTime)].size(), 2 * ticks.size());
+	ASSERT_LT(block.columns[static_cast<size_t>(TickColumn::Last)].size(), ticks.size() + 8);
+
+	std::vector<int64_t> times(block.rows);
+	reader.DecodeColumn(block, TickColumn::ExchangeTime, times);
+	std::vector<double> prices(block.rows);
+	reader.DecodeColumn(block, TickColumn::Last, prices);
+	for (size_t i = 0; i < ticks.size(); ++i) {
+		ASSERT_EQ(times[i], ticks[i].exchange_time);
+		ASSERT_EQ(prices[i], ticks[i].ohlclvt.last);
+	}
+	ASSERT_THROW(reader.DecodeColumn(block, TickColumn::Volume, prices), std::invalid_argument);
+	std::filesystem::remove(filename);
+}
+
+TEST(TickArchiveTest, TruncatedFile) {
+	std::filesystem::path filename = TestPath("truncated.utstick");
+	std::vector<MarketDepth> ticks = MakeTicks("rb2110", tick_archive::kBlockRows + 10, 1, 5);
+	{
+		TickArchiveWriter writer(filename, 20210601, {{"rb2110", 1}});
+		for (const MarketDepth& md : ticks) { writer.Append(md); }
+	}
+	// 模拟写入第二块时退出
+	std::filesystem::resize_file(filename, std::filesystem::file_size(filename) - 10);
+	{
+		TickArchiveReader reader(filename);
+		ASSERT_TRUE(reader.truncated());
+		ASSERT_EQ(reader.size(), tick_archive::kBlockRows);
+	}
+
+	// 再次打开时截去不完整的块后追加
+	{
+		TickArchiveWriter writer(filename, 20210601, {{"rb2110", 1}});
+		writer.Append(ticks.back());
+	}
+	TickArchiveReader reader(filename);
+	ASSERT_FALSE(reader.truncated());
+	ASSERT_EQ(reader.size(), tick_archive::kBlockRows + 1);
+	ASSERT_THROW(TickArchiveWriter(filename, 20210602), std::runtime_error);
+	std::filesystem::remove(filename);
+}
+
+TEST(TickArchiveTest, Flush) {
+	std::filesystem::path filename = TestPath("flush.utstick");
+	std::vector<MarketDepth> ticks = MakeTicks("rb2110", 300, 1, 7);
+	TickArchiveWriter writer(filename, 20210601, {{"rb2110", 1}});
+	for (size_t i = 0; i < 100; ++i) { writer.Append(ticks[i]); }
+	// 未满的块在写入器关闭前即可读出
+	writer.Flush();
+	{
+		TickArchiveReader reader(filename);
+		ASSERT_FALSE(reader.truncated());
+		ASSERT_EQ(reader.size(), 100);
+	}
+	for (size_t i = 100; i < ticks.size(); ++i) { writer.Append(ticks[i]); }
+	writer.Close();
+	TickArchiveReader reader(filename);
+	ASSERT_EQ(reader.blocks().size(), 2);
+	std::vector<MarketDepth> read = reader.Read("rb2110");
+	ASSERT_EQ(read.size(), ticks.size());
+	for (size_t i = 0; i < ticks.size(); ++i) { ExpectSameTick(read[i], ticks[i]); }
+	std::filesystem::remove(filename);
+}
+
+TEST(TickArchiveTest, Recorder) {
+	std::filesystem::path directory = TestPath("recorder");
+	std::filesystem::remove_all(directory);
+	std::vector<MarketDepth> ticks = MakeTicks("rb2110", 1000, 1, 6);
+	for (size_t i = 500; i < ticks.size(); ++i) { ticks[i].trading_day = 20210602; }
+	{
+		InstrumentInfo info{};
+		info.instrument_id = "rb2110";
+		info.price_ticker = 1;
+		ArchiveDataRecorder recorder(directory, {{"rb2110", info}});
+		for (const MarketDepth& md : ticks) { recorder.DataSink(md); }
+	}
+	size_t total = 0;
+	for (int day : {20210601, 20210602}) {
+		TickArchiveReader reader(ArchiveDataRecorder::FileName(directory, day));
+		ASSERT_EQ(reader.trading_day(), day);
+		reader.ForEach([&](const MarketDepth& md) {
+			ASSERT_EQ(md.trading_day, day);
+			ExpectSameTick(md, ticks[total++]);
+		});
+		ASSERT_EQ(reader.blocks()[0].price_tick, 1);
+	}
+	ASSERT_EQ(total, ticks.size());
+	std::filesystem::remove_all(directory);
+}
+
+TEST(TickArchiveTest, RecorderDropsUnopenableDay) {
+	std::filesystem::path directory = TestPath("recorder_drop");
+	std::filesystem::remove_all(directory);
+	// 归档文件所在位置被目录占用, 无法打开
+	std::filesystem::create_directories(ArchiveDataRecorder::FileName(directory, 20210601));
+	std::vector<MarketDepth> ticks = MakeTicks("rb2110", 100, 1, 8);
+	ArchiveDataRecorder recorder(directory);
+	for (const MarketDepth& md : ticks) { recorder.DataSink(md); }
+	recorder.Stop();
+	RecorderStatistics stats = recorder.statistics();
+	ASSERT_EQ(stats.received, ticks.size());
+	ASSERT_EQ(stats.dropped, ticks.size());
+	ASSERT_EQ(stats.written, 0);
+	std::filesystem::remove_all(directory);
+}
+
+int main(int argc, char** argv) {
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
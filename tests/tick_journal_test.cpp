@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "journaleddatarecorder.h"
+#include "sqlite3datarecorder.h"
+#include "tickjournal.h"
+
+namespace {
+std::filesystem::path TestPath(const std::string& name) {
+	std::filesystem::path ret =
+		std::filesystem::temp_directory_path() / ("uts_tick_journal_" + std::to_string(getpid()) + "_" + name);
+	std::filesystem::remove_all(ret);
+	return ret;
+}
+
+MarketDepth Tick(Volume volume) {
+	MarketDepth ret{};
+	std::snprintf(ret.instrument_id, sizeof(ret.instrument_id), "rb2110");
+	ret.trading_day = 20210601;
+	ret.exchange_time = 1622509200000000000 + volume * 500'000'000;
+	ret.ohlclvt.volume = volume;
+	return ret;
+}
+
+/// 记录至内存, 可模拟数据库不可用
+class FlakyRecorder : public DataRecorder {
+public:
+	~FlakyRecorder() override { Stop(); }
+
+	std::atomic<bool> failing = false;
+	std::vector<Volume> volumes;
+
+protected:
+	void WriteDB(const MarketDepth& data) override { volumes.push_back(data.ohlclvt.volume); }
+	bool Sync() override { return !failing; }
+};
+
+template <typename F>
+bool WaitFor(F&& f) {
+	for (int i = 0; i < 500; ++i) {
+		if (f()) { return true; }
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	return false;
+}
+}  // namespace
+
+TEST(TickJournalTest, Recover) {
+	std::filesystem::path directory = TestPath("recover");
+	{
+		TickJournal journal(directory, 100);
+		for (Volume i = 0; i < 250; ++i) { ASSERT_EQ(journal.Append(Tick(i)), i); }
+		ASSERT_EQ(journal.head(), 250);
+		journal.Commit(120);
+	}
+	// 已全部提交的段被删除
+	ASSERT_FALSE(std::filesystem::exists(directory / "00000000000000000000.journal"));
+	ASSERT_TRUE(std::filesystem::exists(directory / "00000000000000000100.journal"));
+
+	// 模拟写入最后一笔时被杀死
+	{
+		std::fstream file(directory / "00000000000000000200.journal", std::ios::binary | std::ios::in | std::ios::out);
+		file.seekp(sizeof(tick_journal::SegmentHeader) + 49 * sizeof(tick_journal::Record) + 100);
+		file.put('\x5a');
+	}
+	TickJournal journal(directory, 100);
+	ASSERT_EQ(journal.committed(), 120);
+	ASSERT_EQ(journal.head(), 249);
+	std::vector<MarketDepth> ticks(200);
+	ASSERT_EQ(journal.Read(120, ticks), 129);
+	for (size_t i = 0; i < 129; ++i) { ASSERT_EQ(ticks[i].ohlclvt.volume, 120 + static_cast<Volume>(i)); }
+
+	// 覆盖不完整的记录
+	ASSERT_EQ(journal.Append(Tick(1000)), 249);
+	ASSERT_EQ(journal.Read(249, ticks), 1);
+	ASSERT_EQ(ticks[0].ohlclvt.volume, 1000);
+	std::filesystem::remove_all(directory);
+}
+
+TEST(TickJournalTest, RetryUntilDatabaseRecovers) {
+	std::filesystem::path directory = TestPath("retry");
+	FlakyRecorder sink;
+	sink.failing = true;
+	JournaledDataRecorder recorder(directory, &sink, 100, std::chrono::milliseconds(10),
+								   std::chrono::milliseconds(20));
+	for (Volume i = 0; i < 1000; ++i) { recorder.DataSink(Tick(i)); }
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	ASSERT_EQ(recorder.journal().committed(), 0);
+	ASSERT_EQ(recorder.statistics().pending, 1000);
+
+	// 数据库恢复后补写全部积压的行情
+	sink.failing = false;
+	ASSERT_TRUE(WaitFor([&recorder]() { return recorder.statistics().pending == 0; }));
+	recorder.Stop();
+	ASSERT_EQ(recorder.journal().committed(), 1000);
+	std::set<Volume> written(sink.volumes.begin(), sink.volumes.end());
+	ASSERT_EQ(written.size(), 1000);
+	ASSERT_EQ(*written.rbegin(), 999);
+	std::filesystem::remove_all(directory);
+}
+
+TEST(TickJournalTest, ReplayAfterRestart) {
+	std::filesystem::path directory = TestPath("restart");
+	{
+		FlakyRecorder sink;
+		sink.failing = true;
+		JournaledDataRecorder recorder(directory, &sink);
+		for (Volume i = 0; i < 500; ++i) { recorder.DataSink(Tick(i)); }
+	}
+	FlakyRecorder sink;
+	{
+		JournaledDataRecorder recorder(directory, &sink);
+		ASSERT_TRUE(WaitFor([&recorder]() { return recorder.statistics().pending == 0; }));
+		recorder.DataSink(Tick(500));
+	}
+	ASSERT_EQ(sink.volumes.size(), 501);
+	for (Volume i = 0; i <= 500; ++i) { ASSERT_EQ(sink.volumes[i], i); }
+	ASSERT_EQ(TickJournal(directory).committed(), 501);
+	std::filesystem::remove_all(directory);
+}
+
+TEST(TickJournalTest, SQLiteCommitsOnlyOnSync) {
+	std::filesystem::path directory = TestPath("sqlite");
+	std::filesystem::path db_name = TestPath("sqlite.sqlite3");
+	auto count_rows = [&db_name]() {
+		sqlite3* conn = nullptr;
+		sqlite3_open(db_name.string().c_str(), &conn);
+		sqlite3_stmt* stmt = nullptr;
+		sqlite3_prepare_v2(conn, "SELECT COUNT(*) FROM tickdata;", -1, &stmt, nullptr);
+		int ret = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int(stmt, 0) : -1;
+		sqlite3_finalize(stmt);
+		sqlite3_close(conn);
+		return ret;
+	};
+	{
+		// 数据记录器每10行提交一次, 由日志驱动时只在日志提交时提交
+		SQLite3DataRecorder sink(db_name, 10, std::chrono::milliseconds(1));
+		JournaledDataRecorder recorder(directory, &sink, 1000, std::chrono::seconds(60));
+		for (Volume i = 0; i < 100; ++i) { recorder.DataSink(Tick(i)); }
+		ASSERT_TRUE(WaitFor([&sink]() { return sink.statistics().written == 100; }));
+		ASSERT_EQ(count_rows(), 0);
+		recorder.Stop();
+		ASSERT_EQ(recorder.journal().committed(), 100);
+	}
+	ASSERT_EQ(count_rows(), 100);
+	std::filesystem::remove_all(directory);
+	std::filesystem::remove(db_name);
+}
+
+int main(int argc, char** argv) {
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,210 @@
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "archivedatarecorder.h"
+#include "tickarchive.h"
+#include "tickquery.h"
+
+namespace {
+constexpr Timestamp kSecond = 1'000'000'000;
+constexpr Timestamp kDay1 = 1622509200000000000;  // 2021-06-01 09:00:00
+constexpr Timestamp kDay2 = kDay1 + 86400 * kSecond;
+
+std::filesystem::path TestPath(const std::string& name) {
+	std::filesystem::path ret =
+		std::filesystem::temp_directory_path() / ("uts_tick_query_" + std::to_string(getpid()) + "_" + name);
+	std::filesystem::remove_all(ret);
+	std::filesystem::create_directories(ret);
+	return ret;
+}
+
+/// 每个合约每 `interval` 一笔, 成交量为当日序号
+std::vector<MarketDepth> MakeTicks(const char* ticker, int trading_day, Timestamp start, Timestamp interval,
+								   Volume count) {
+	std::vector<MarketDepth> ret;
+	for (Volume i = 0; i < count; ++i) {
+		MarketDepth md{};
+		std::snprintf(md.instrument_id, sizeof(md.instrument_id), "%s", ticker);
+		md.trading_day = trading_day;
+		md.exchange_time = start + i * interval;
+		md.local_time = md.exchange_time + 300'000;
+		md.ohlclvt.last = 4000 + i % 10;
+		md.ohlclvt.volume = i;
+		ret.push_back(md);
+	}
+	return ret;
+}
+
+/// 两个交易日, 三个合约, 各合约跨多个数据块
+std::vector<MarketDepth> WriteArchives(const std::filesystem::path& directory) {
+	std::vector<MarketDepth> all;
+	for (auto [trading_day, start] : {std::pair{20210601, kDay1}, std::pair{20210602, kDay2}}) {
+		std::vector<MarketDepth> rb = MakeTicks("rb2110", trading_day, start, kSecond / 2, 20000);
+		std::vector<MarketDepth> ic = MakeTicks("IC2106", trading_day, start, kSecond, 10000);
+		std::vector<MarketDepth> au = MakeTicks("au2112", trading_day, start + 3600 * kSecond, kSecond, 100);
+		TickArchiveWriter writer(ArchiveDataRecorder::FileName(directory, trading_day), trading_day,
+								 {{"rb2110", 1}, {"IC2106", 0.2}});
+		for (size_t i = 0; i < rb.size(); ++i) {
+			writer.Append(rb[i]);
+			all.push_back(rb[i]);
+			if (i % 2 == 0) {
+				writer.Append(ic[i / 2]);
+				all.push_back(ic[i / 2]);
+			}
+			if (i < au.size()) {
+				writer.Append(au[i]);
+				all.push_back(au[i]);
+			}
+		}
+	}
+	return all;
+}
+
+std::vector<MarketDepth> Filter(const std::vector<MarketDepth>& all, const std::vector<Ticker>& tickers,
+								Timestamp begin, Timestamp end) {
+	std::vector<MarketDepth> ret;
+	for (const MarketDepth& md : all) {
+		if ((md.exchange_time >= begin) && (md.exchange_time < end) &&
+			(tickers.empty() || std::find(tickers.begin(), tickers.end(), md.instrument_id) != tickers.end())) {
+			ret.push_back(md);
+		}
+	}
+	return ret;
+}
+
+/// 时间相同的行情按块的顺序给出, 与写入顺序不同, 按合约代码排序后比较
+void ExpectSameTicks(std::vector<MarketDepth> actual, std::vector<MarketDepth> expected) {
+	auto less = [](const MarketDepth& lhs, const MarketDepth& rhs) {
+		if (lhs.exchange_time != rhs.exchange_time) { return lhs.exchange_time < rhs.exchange_time; }
+		return std::string_view(lhs.instrument_id) < std::string_view(rhs.instrument_id);
+	};
+	ASSERT_TRUE(std::is_sorted(actual.begin(), actual.end(), [](const MarketDepth& lhs, const MarketDepth& rhs) {
+		return lhs.exchange_time < rhs.exchange_time;
+	}));
+	std::sort(actual.begin(), actual.end(), less);
+	std::sort(expected.begin(), expected.end(), less);
+	ASSERT_EQ(actual.size(), expected.size());
+	for (size_t i = 0; i < actual.size(); ++i) {
+		ASSERT_STREQ(actual[i].instrument_id, expected[i].instrument_id);
+		ASSERT_EQ(actual[i].exchange_time, expected[i].exchange_time);
+		ASSERT_EQ(actual[i].ohlclvt.volume, expected[i].ohlclvt.volume);
+	}
+}
+}  // namespace
+
+TEST(TickQueryTest, Index) {
+	std::filesystem::path directory = TestPath("index");
+	WriteArchives(directory);
+	TickArchiveIndex index(ArchiveDataRecorder::FileName(directory, 20210601));
+	ASSERT_EQ(index.trading_day(), 20210601);
+	ASSERT_EQ(index.first_time(), kDay1);
+	ASSERT_EQ(index.last_time(), kDay1 + 19999 * kSecond / 2);
+	ASSERT_EQ(index.instruments().size(), 3);
+
+	std::span<const TickBlockIndex> rb = index.Find("rb2110");
+	ASSERT_EQ(rb.size(), 5);
+	ASSERT_EQ(rb[1].first_time, kDay1 + 4096 * kSecond / 2);
+	ASSERT_TRUE(index.Find("cu2107").empty());
+
+	// 只命中与区间相交的块
+	std::vector<TickBlockIndex> hits;
+	index.Find("rb2110", kDay1 + 4100 * kSecond / 2, kDay1 + 4200 * kSecond / 2, hits);
+	ASSERT_EQ(hits.size(), 1);
+	ASSERT_EQ(hits[0].block, rb[1].block);
+	std::filesystem::remove_all(directory);
+}
+
+TEST(TickQueryTest, Query) {
+	std::filesystem::path directory = TestPath("query");
+	std::vector<MarketDepth> all = WriteArchives(directory);
+	for (size_t threads : {1, 4}) {
+		TickQueryEngine engine(directory, threads);
+		ASSERT_EQ(engine.files().size(), 2);
+		ASSERT_EQ(engine.instruments(), std::vector<Ticker>({"IC2106", "au2112", "rb2110"}));
+
+		std::vector<Ticker> tickers = {"rb2110", "au2112"};
+		Timestamp begin = kDay1 + 3000 * kSecond;
+		Timestamp end = kDay2 + 1000 * kSecond;
+		ExpectSameTicks(engine.Query(tickers, begin, end), Filter(all, tickers, begin, end));
+		ExpectSameTicks(engine.Query({}, begin, end), Filter(all, {}, begin, end));
+		ASSERT_TRUE(engine.Query(tickers, kDay2 + 86400 * kSecond, kDay2 + 86401 * kSecond).empty());
+		ASSERT_TRUE(engine.Query(std::vector<Ticker>{"cu2107"}, begin, end).empty());
+	}
+	std::filesystem::remove_all(directory);
+}
+
+TEST(TickQueryTest, ForEach) {
+	std::filesystem::path directory = TestPath("for_each");
+	WriteArchives(directory);
+	TickQueryEngine engine(directory, 4);
+	std::vector<Ticker> tickers = {"IC2106"};
+	// 按交易日顺序逐块给出, 同一合约内按时间排序
+	std::vector<Timestamp> times;
+	size_t calls = 0;
+	engine.ForEach(tickers, kDay1, kDay2 + 86400 * kSecond, [&](std::span<const MarketDepth> rows) {
+		++calls;
+		for (const MarketDepth& md : rows) { times.push_back(md.exchange_time); }
+	});
+	ASSERT_EQ(times.size(), 20000);
+	ASSERT_TRUE(std::is_sorted(times.begin(), times.end()));
+	ASSERT_EQ(calls, 6);
+
+	// 解码窗口小于块数时仍按顺序给出, 回调抛出的异常传给调用方
+	TickQueryEngine narrow(directory, 1);
+	std::vector<Timestamp> narrow_times;
+	narrow.ForEach(tickers, kDay1, kDay2 + 86400 * kSecond, [&](std::span<const MarketDepth> rows) {
+		for (const MarketDepth& md : rows) { narrow_times.push_back(md.exchange_time); }
+	});
+	ASSERT_EQ(narrow_times, times);
+	ASSERT_THROW(narrow.ForEach(tickers, kDay1, kDay2 + 86400 * kSecond,
+								[](std::span<const MarketDepth>) { throw std::runtime_error("stop"); }),
+				 std::runtime_error);
+	std::filesystem::remove_all(directory);
+}
+
+TEST(TickQueryTest, Snapshot) {
+	std::filesystem::path directory = TestPath("snapshot");
+	WriteArchives(directory);
+	TickQueryEngine engine(directory, 4);
+
+	// 第一日 au2112 开始前
+	std::vector<MarketDepth> snapshot = engine.Snapshot(kDay1 + 100 * kSecond + 1);
+	ASSERT_EQ(snapshot.size(), 2);
+	ASSERT_STREQ(snapshot[0].instrument_id, "IC2106");
+	ASSERT_EQ(snapshot[0].ohlclvt.volume, 100);
+	ASSERT_STREQ(snapshot[1].instrument_id, "rb2110");
+	ASSERT_EQ(snapshot[1].ohlclvt.volume, 200);
+
+	// 第二日开盘前为第一日的最后一笔
+	snapshot = engine.Snapshot(kDay2 - 1, std::vector<Ticker>{"au2112", "rb2110"});
+	ASSERT_EQ(snapshot.size(), 2);
+	ASSERT_STREQ(snapshot[0].instrument_id, "au2112");
+	ASSERT_EQ(snapshot[0].trading_day, 20210601);
+	ASSERT_EQ(snapshot[0].ohlclvt.volume, 99);
+	ASSERT_EQ(snapshot[1].trading_day, 20210601);
+	ASSERT_EQ(snapshot[1].ohlclvt.volume, 19999);
+
+	snapshot = engine.Snapshot(kDay2 + 3600 * kSecond);
+	ASSERT_EQ(snapshot.size(), 3);
+	ASSERT_EQ(snapshot[0].ohlclvt.volume, 3600);
+	ASSERT_EQ(snapshot[0].trading_day, 20210602);
+	ASSERT_EQ(snapshot[1].ohlclvt.volume, 0);
+	ASSERT_EQ(snapshot[2].ohlclvt.volume, 7200);
+
+	ASSERT_TRUE(engine.Snapshot(kDay1 - 1).empty());
+	std::filesystem::remove_all(directory);
+}
+
+int main(int argc, char** argv) {
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -1,6 +1,7 @@
 ﻿#include "utils.h"
 
 #include <filesystem>
+#include <limits>
 #include <string>
 #include <vector>
 
@@ -9,6 +10,7 @@
 #include <uts/dbconfig.h>
 #include <uts/trading_utils.h>
 
+#include "ctp_utils.h"
 #include "data_struct.h"
 #include "enum_utils.h"
 #include "utsexceptions.h"
@@ -50,6 +52,76 @@ TEST(UtilsTest, PutCallSwitchTest) {
 	ASSERT_THROW(PutOptionToCallOption("IO2106-"), std::runtime_error);
 }
 
+TEST(UtilsTest, FormatDateTime) {
+	// 2021-06-01 09:30:00.500 北京时间
+	Timestamp ts = MakeTimestamp(20210601, (9 * 3600 + 30 * 60) * 1'000'000'000LL + 500'000'000LL);
+	ASSERT_EQ(ts, 1622511000'500'000'000LL);
+	ASSERT_EQ(FormatDateTime(ts), "2021-06-01 09:30:00.500");
+	ASSERT_EQ(TimestampToDate(ts), 20210601);
+	ASSERT_EQ(TimestampToDate(MakeTimestamp(20210601, 23 * 3600 * 1'000'000'000LL)), 20210601);
+}
+
+TEST(UtilsTest, ParseCTPDateTime) {
+	Timestamp received = MakeTimestamp(20210601, (21 * 3600 + 5) * 1'000'000'000LL);
+	// 大商所夜盘 ActionDay 为下一交易日, 以接收时间为准
+	ASSERT_EQ(FormatDateTime(ParseCTPDateTime("20210602", "21:00:04", 500, received)), "2021-06-01 21:00:04.500");
+	ASSERT_EQ(FormatDateTime(ParseCTPDateTime("20210601", "21:00:04", 500, 0)), "2021-06-01 21:00:04.500");
+	// 跨零点: 行情时间略早于零点, 接收时间已过零点
+	received = MakeTimestamp(20210602, 1'000'000'000LL);
+	ASSERT_EQ(FormatDateTime(ParseCTPDateTime("20210602", "23:59:59", 900, received)), "2021-06-01 23:59:59.900");
+
+	// 郑商所夜盘 TradingDay 为当前自然日; 周五夜盘对应下周一
+	Timestamp friday_night = MakeTimestamp(20210604, 21 * 3600 * 1'000'000'000LL);
+	ASSERT_EQ(NormalizeTradingDay(20210604, friday_night), 20210607);
+	ASSERT_EQ(NormalizeTradingDay(20210607, friday_night), 20210607);
+	ASSERT_EQ(NormalizeTradingDay(20210604, MakeTimestamp(20210604, 10 * 3600 * 1'000'000'000LL)), 20210604);
+}
+
+TEST(UtilsTest, NormalizeDepthMarketData) {
+	CThostFtdcDepthMarketDataField field{};
+	field.ClosePrice = std::numeric_limits<double>::max();
+	field.SettlementPrice = 5000;
+	field.UpperLimitPrice = 5500;
+	field.LowerLimitPrice = 4500;
+	field.AveragePrice = 5001;
+	field.CurrDelta = std::numeric_limits<double>::quiet_NaN();
+	field.BidPrice1 = 4999;
+	field.BidVolume1 = 3;
+	field.AskPrice1 = 5002;
+	field.AskVolume1 = 4;
+	field.BidPrice2 = std::numeric_limits<double>::max();
+	field.AskPrice5 = std::numeric_limits<double>::max();
+	field.AskVolume5 = 7;
+
+	MarketDepth expected{};
+	NormalizeDepthMarketDataScalar(field, expected);
+	ASSERT_EQ(expected.ohlclvt.close, -1);
+	ASSERT_EQ(expected.settle, 5000);
+	ASSERT_EQ(expected.delta, -1);
+	ASSERT_EQ(expected.bid[0].price, 4999);
+	ASSERT_EQ(expected.bid[0].volume, 3);
+	ASSERT_EQ(expected.bid[1].price, -1);
+	ASSERT_EQ(expected.ask[4].price, -1);
+	ASSERT_EQ(expected.ask[4].volume, 7);
+
+	MarketDepth md{};
+	NormalizeDepthMarketData(field, md);
+	if (CPUSupportsAVX2()) {
+		MarketDepth vectorized{};
+		NormalizeDepthMarketDataAVX2(field, vectorized);
+		ASSERT_EQ(vectorized.ohlclvt.close, expected.ohlclvt.close);
+		ASSERT_EQ(vectorized.lower_limit, expected.lower_limit);
+		ASSERT_EQ(vectorized.average_price, expected.average_price);
+		ASSERT_EQ(vectorized.delta, expected.delta);
+	}
+	for (size_t level = 0; level < md.bid.size(); ++level) {
+		ASSERT_EQ(md.bid[level].price, expected.bid[level].price);
+		ASSERT_EQ(md.bid[level].volume, expected.bid[level].volume);
+		ASSERT_EQ(md.ask[level].price, expected.ask[level].price);
+		ASSERT_EQ(md.ask[level].volume, expected.ask[level].volume);
+	}
+}
+
 TEST(DBConfigTest, DBRuns) {
 	UTSConfigDB conf("./test_files/sample_db.sqlite3");
 	std::vector<IPAddress> t1 = conf.UnSpeedTestedCTPMDServers();
@@ -107,6 +179,24 @@ TEST(JsonTest, ContractListJson) {
 	map<Ticker, DateStr> order = order_json.get<map<Ticker, DateStr>>();
 }
 
+TEST(UtilsTest, InstrumentIndexWithoutSymbolID) {
+	InstrumentIndex a{
+		.instrument_id = "IF2106", .direction = Direction::Long, .hedge_flag = HedgeFlagType::Speculation};
+	InstrumentIndex b = a;
+	b.instrument_id = "IC2106";
+	json j = a;
+	InstrumentIndex read = j.get<InstrumentIndex>();
+	ASSERT_EQ(read.symbol_id, kInvalidSymbol);
+	ASSERT_EQ(read, a);
+	ASSERT_NE(read, b);
+
+	map<InstrumentIndex, int> holding{{a, 1}, {b, 2}};
+	ASSERT_EQ(holding.size(), 2);
+	InstrumentIndex interned{.symbol_id = 0, .instrument_id = "IF2106", .direction = Direction::Long,
+							 .hedge_flag = HedgeFlagType::Speculation};
+	ASSERT_LT(interned, a);
+}
+
 int main(int argc, char** argv) {
 	::testing::InitGoogleTest(&argc, argv);
 	return RUN_ALL_TESTS();